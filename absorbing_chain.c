@@ -0,0 +1,2025 @@
+#include "absorbing_chain.h"
+#include <string.h>
+#include <math.h>
+
+#define ALLOC_ERROR_ABSORBING_CHAIN \
+"Allocation failure: Alloc of new AbsorbingChain failed.\n"
+#define ALLOC_ERROR_ABSORBING_QUEUE \
+"Allocation failure: Alloc of AbsorbingChain queue failed.\n"
+#define ALLOC_ERROR_DISTRIBUTION \
+"Allocation failure: Alloc of length distribution failed.\n"
+#define ALLOC_ERROR_BOUNDED_WALKS \
+"Allocation failure: Alloc of bounded walks failed.\n"
+#define CONVERGENCE_ERROR "ERROR: the solve did not converge.\n"
+#define ENDLESS_ERROR "ERROR: the walk may never be absorbed.\n"
+#define WALK_WORK_ERROR "ERROR: the walk is too long to follow step by step.\n"
+
+#define MAX(X, Y) (((X) < (Y)) ? (Y) : (X))
+#define MIN(X, Y) (((X) < (Y)) ? (X) : (Y))
+#define INITIAL_LENGTHS 256
+#define DENSE_FRONTIER 8 // share of the states held from which a step pulls
+#define SETTLING_LENGTHS 3 // expected lengths walked before the shape settles
+#define SEGMENT_STATES 1024 // most states of a segment of the correction
+#define SEGMENT_INPUTS 32 // most inputs of a segment, unless of one state
+
+/**
+ * Fill the sparse rows: the links of every transient state, as
+ * probabilities
+ */
+static void fill_rows(AbsorbingChain *chain, MarkovChain *markov_chain)
+{
+  int link = 0;
+  for (Node *node = markov_chain->database->first; node != NULL;
+       node = node->next)
+    {
+      MarkovNode *markov_node = node->data;
+      int state = markov_node->id;
+      chain->row_starts[state] = link;
+      chain->is_goal[state] = markov_chain->is_last (markov_node->data);
+      chain->is_absorbing[state] = chain->is_goal[state]
+                                   || markov_node->counter_list_length == 0;
+      if (chain->is_absorbing[state])
+        {
+          continue; // the walk stops there
+        }
+      for (int i = 0; i < markov_node->counter_list_length; i++)
+        {
+          NextNodeCounter counter = markov_node->counter_list[i];
+          chain->successors[link] = counter.markov_node->id;
+          chain->probabilities[link] = counter.frequency
+                                       / (double) markov_node
+                                           ->counter_list_total;
+          link++;
+        }
+    }
+  chain->row_starts[chain->num_of_states] = link;
+}
+
+/**
+ * Fill the transpose of the sparse rows
+ */
+static void fill_columns(AbsorbingChain *chain)
+{
+  int n = chain->num_of_states;
+  memset (chain->column_starts, 0, sizeof (int) * (n + 1));
+  for (int link = 0; link < chain->row_starts[n]; link++)
+    {
+      chain->column_starts[chain->successors[link] + 1]++;
+    }
+  for (int state = 0; state < n; state++)
+    {
+      chain->column_starts[state + 1] += chain->column_starts[state];
+    }
+  for (int state = 0; state < n; state++)
+    {
+      for (int link = chain->row_starts[state];
+           link < chain->row_starts[state + 1]; link++)
+        {
+          int place = chain->column_starts[chain->successors[link]]++;
+          chain->predecessors[place] = state;
+          chain->column_probabilities[place] = chain->probabilities[link];
+        }
+    }
+  for (int state = n; state > 0; state--) // undo the shift of the fill
+    {
+      chain->column_starts[state] = chain->column_starts[state - 1];
+    }
+  chain->column_starts[0] = 0;
+}
+
+/**
+ * Mark every state that can get to a marked one, walking the links back
+ * @param marked in/out param
+ * @param queue room for num_of_states states
+ */
+static void mark_predecessors(AbsorbingChain *chain, bool *marked, int *queue)
+{
+  int head = 0, tail = 0;
+  for (int state = 0; state < chain->num_of_states; state++)
+    {
+      if (marked[state])
+        {
+          queue[tail++] = state;
+        }
+    }
+  while (head < tail)
+    {
+      int state = queue[head++];
+      for (int i = chain->column_starts[state];
+           i < chain->column_starts[state + 1]; i++)
+        {
+          int predecessor = chain->predecessors[i];
+          if (!marked[predecessor])
+            {
+              marked[predecessor] = true;
+              queue[tail++] = predecessor;
+            }
+        }
+    }
+}
+
+/**
+ * Find the states absorbed with probability 1: the ones that can not get
+ * to a trapped state, that is a state that can not get to an absorbing one
+ * @return false in case of memory allocation failure
+ */
+static bool find_ending_states(AbsorbingChain *chain)
+{
+  int n = chain->num_of_states;
+  int *queue = malloc (sizeof (int) * (n + (size_t) 1));
+  bool *may_not_end = malloc (sizeof (bool) * (n + (size_t) 1));
+  if (queue == NULL || may_not_end == NULL)
+    {
+      printf ("%s", ALLOC_ERROR_ABSORBING_QUEUE);
+      free (queue);
+      free (may_not_end);
+      return false;
+    }
+  memcpy (chain->ends_surely, chain->is_absorbing, sizeof (bool) * n);
+  mark_predecessors (chain, chain->ends_surely, queue); // may be absorbed
+  for (int state = 0; state < n; state++)
+    {
+      chain->is_trapped[state] = !chain->ends_surely[state];
+      may_not_end[state] = chain->is_trapped[state];
+    }
+  mark_predecessors (chain, may_not_end, queue);
+  for (int state = 0; state < n; state++)
+    {
+      chain->ends_surely[state] = !may_not_end[state];
+    }
+  free (queue);
+  free (may_not_end);
+  return true;
+}
+
+/**
+ * Initialize and Allocate the AbsorbingChain of the given MarkovChain
+ * @param markov_chain
+ * @return AbsorbingChain pointer, NULL in case of memory allocation failure
+ * @ownership Weak Ownership. separate function for Free
+ * (free_absorbing_chain)
+ */
+AbsorbingChain* new_absorbing_chain(MarkovChain *markov_chain)
+{
+  AbsorbingChain *chain = calloc (1, sizeof (AbsorbingChain));
+  if (chain == NULL)
+    {
+      printf ("%s", ALLOC_ERROR_ABSORBING_CHAIN);
+      return NULL;
+    }
+  size_t n = markov_chain->database->size, num_of_links = 0;
+  for (Node *node = markov_chain->database->first; node != NULL;
+       node = node->next)
+    {
+      num_of_links += node->data->counter_list_length;
+    }
+  chain->num_of_states = (int) n;
+  chain->row_starts = malloc (sizeof (int) * (n + 1));
+  chain->successors = malloc (sizeof (int) * (num_of_links + 1));
+  chain->probabilities = malloc (sizeof (double) * (num_of_links + 1));
+  chain->column_starts = malloc (sizeof (int) * (n + 1));
+  chain->predecessors = malloc (sizeof (int) * (num_of_links + 1));
+  chain->column_probabilities = malloc (sizeof (double)
+                                        * (num_of_links + 1));
+  chain->is_absorbing = malloc (sizeof (bool) * (n + 1));
+  chain->is_goal = malloc (sizeof (bool) * (n + 1));
+  chain->ends_surely = malloc (sizeof (bool) * (n + 1));
+  chain->is_trapped = malloc (sizeof (bool) * (n + 1));
+  if (chain->row_starts == NULL || chain->successors == NULL
+      || chain->probabilities == NULL || chain->column_starts == NULL
+      || chain->predecessors == NULL || chain->column_probabilities == NULL
+      || chain->is_absorbing == NULL || chain->is_goal == NULL
+      || chain->ends_surely == NULL || chain->is_trapped == NULL)
+    {
+      printf ("%s", ALLOC_ERROR_ABSORBING_CHAIN);
+      free_absorbing_chain (&chain);
+      return NULL;
+    }
+  fill_rows (chain, markov_chain);
+  fill_columns (chain);
+  if (!find_ending_states (chain))
+    {
+      free_absorbing_chain (&chain);
+      return NULL;
+    }
+  return chain;
+}
+
+/**
+ * The linear system of a solve, x = constants + A x for the active
+ * unknowns, written (I - A) x = b: the known values of the other unknowns
+ * are moved into b.
+ */
+typedef struct LinearSystem {
+    int num_of_states;
+    const int *starts; // num_of_states + 1, into indexes and weights, the
+                       // sparse rows of A
+    const int *indexes;
+    const double *weights;
+    const bool *active;
+    double *diagonal; // of I - A, for every active unknown
+    double norm; // largest row sum of I - A, absolute values
+    bool forward; // direction of the sweep of the correction
+    int num_of_columns; // states linked to against the sweep, -1 if too
+                        // many to correct for
+    int *columns;
+    int num_of_aggregates; // ranges of states of the coarse correction, 0
+                           // for none
+    double *factors; // LU of the capacitance, num_of_columns^2 values, or
+                     // of the aggregated I - A
+    int *pivots;
+    double *values; // num_of_columns or num_of_aggregates values
+    double *spread; // num_of_states values, 0 but at the columns
+    double *work; // num_of_states values
+} LinearSystem;
+
+/**
+ * Work vectors of a BiCGSTAB solve, num_of_states values each, 0 at the
+ * unknowns that are not active
+ */
+typedef struct SolveVectors {
+    double *b;
+    double *r; // residual b - (I - A) x, of the updates
+    double *r_hat; // shadow residual
+    double *p; // search direction
+    double *v; // (I - A) y of p
+    double *t; // (I - A) y of r
+    double *y; // preconditioned p or r
+} SolveVectors;
+
+/**
+ * Sweeps of all the columns of the correction, done as one: the sweep is
+ * split into segments of states that read few states before the segment,
+ * and link to few columns, the inputs of the segment. Every state of a
+ * segment is swept once, as a combination of them; only the states read
+ * after the segment, and the columns, are expanded to all the columns, from
+ * the rows of the inputs, kept until their last use.
+ */
+typedef struct Transfer {
+    int *column_of; // num_of_states values, -1 for the states not columns
+    int *last_uses; // last step reading every state along the sweep, -1
+    int *segment_ends; // step after every segment
+    int num_of_segments;
+    int *marks; // last segment every state is an input of, -1
+    int *slots; // of every input in the last segment it is an input of
+    int *inputs; // states before the segment it reads
+    int num_of_inputs;
+    int *column_marks; // last segment every column is an input of, -1
+    int *column_slots; // of every column in the last segment it is in
+    int *segment_columns; // columns the segment links to
+    int num_of_segment_columns;
+    double *combinations; // of the inputs, for every state of a segment
+    size_t block; // most combinations values of a segment
+    double *row_values; // max_rows rows of num_of_columns values
+    int *rows; // row of every state read after it's segment
+    int *row_lengths; // values of every row before it's last nonzero one
+    int *free_rows;
+    int num_of_free;
+    int max_rows; // most rows kept at once
+} Transfer;
+
+/**
+ * @return sum of the products of the active values of a and b
+ */
+static double dot(const LinearSystem *system, const double *a,
+                  const double *b)
+{
+  double sum = 0;
+  for (int state = 0; state < system->num_of_states; state++)
+    {
+      sum += a[state] * b[state]; // 0 unless active
+    }
+  return sum;
+}
+
+/**
+ * @return largest absolute value of the active values of x
+ */
+static double max_norm(const LinearSystem *system, const double *x)
+{
+  double norm = 0;
+  for (int state = 0; state < system->num_of_states; state++)
+    {
+      if (system->active[state])
+        {
+          norm = MAX (norm, fabs (x[state]));
+        }
+    }
+  return norm;
+}
+
+/**
+ * y = (I - A) x on the active unknowns, 0 on the others
+ */
+static void multiply_system(const LinearSystem *system, const double *x,
+                            double *y)
+{
+  for (int state = 0; state < system->num_of_states; state++)
+    {
+      if (!system->active[state])
+        {
+          y[state] = 0;
+          continue;
+        }
+      double sum = system->diagonal[state] * x[state];
+      for (int i = system->starts[state]; i < system->starts[state + 1]; i++)
+        {
+          int index = system->indexes[i];
+          if (index != state && system->active[index])
+            {
+              sum -= system->weights[i] * x[index];
+            }
+        }
+      y[state] = sum;
+    }
+}
+
+/**
+ * @return true if the link from state to index is against the sweep of the
+ * correction, to a state the sweep gets to after it
+ */
+static bool is_against(const LinearSystem *system, int state, int index)
+{
+  return system->forward ? index > state : index < state;
+}
+
+/**
+ * @return the step of the sweep that gets to state, and the state it gets
+ * to at a step
+ */
+static int step_of(const LinearSystem *system, int state)
+{
+  return system->forward ? state : system->num_of_states - 1 - state;
+}
+
+/**
+ * Solve T z = r in place, for T the triangular part of I - A: the diagonal
+ * and the links along the sweep, from states it already got to
+ * @param z in/out param, r on entry
+ */
+static void sweep(const LinearSystem *system, double *z)
+{
+  int n = system->num_of_states;
+  for (int step = 0; step < n; step++)
+    {
+      int state = step_of (system, step);
+      if (!system->active[state])
+        {
+          z[state] = 0;
+          continue;
+        }
+      double sum = z[state];
+      for (int i = system->starts[state]; i < system->starts[state + 1]; i++)
+        {
+          int index = system->indexes[i];
+          if (index != state && system->active[index]
+              && !is_against (system, state, index))
+            {
+              sum += system->weights[i] * z[index];
+            }
+        }
+      z[state] = sum / system->diagonal[state];
+    }
+}
+
+/**
+ * y = the links of A against the sweep times x, on the active unknowns
+ */
+static void multiply_against(const LinearSystem *system, const double *x,
+                             double *y)
+{
+  for (int state = 0; state < system->num_of_states; state++)
+    {
+      double sum = 0;
+      for (int i = system->starts[state];
+           system->active[state] && i < system->starts[state + 1]; i++)
+        {
+          int index = system->indexes[i];
+          if (system->active[index] && is_against (system, state, index))
+            {
+              sum += system->weights[i] * x[index];
+            }
+        }
+      y[state] = sum;
+    }
+}
+
+/**
+ * LU factorization of a dense matrix in place, by partial pivoting
+ * @param matrix size^2 values, row by row
+ * @param pivots out param, size values, the row swapped with every row
+ * @return false if the matrix is singular
+ */
+static bool factor_dense(double *matrix, int *pivots, int size)
+{
+  for (int column = 0; column < size; column++)
+    {
+      int pivot = column;
+      for (int row = column + 1; row < size; row++)
+        {
+          if (fabs (matrix[(size_t) row * size + column])
+              > fabs (matrix[(size_t) pivot * size + column]))
+            {
+              pivot = row;
+            }
+        }
+      double *top = matrix + (size_t) column * size;
+      double *pivot_row = matrix + (size_t) pivot * size;
+      if (pivot_row[column] == 0)
+        {
+          return false;
+        }
+      pivots[column] = pivot;
+      for (int i = 0; pivot != column && i < size; i++)
+        {
+          double swapped = top[i];
+          top[i] = pivot_row[i];
+          pivot_row[i] = swapped;
+        }
+      for (int row = column + 1; row < size; row++)
+        {
+          double *current = matrix + (size_t) row * size;
+          double factor = current[column] / top[column];
+          current[column] = factor;
+          for (int i = column + 1; factor != 0 && i < size; i++)
+            {
+              current[i] -= factor * top[i];
+            }
+        }
+    }
+  return true;
+}
+
+/**
+ * Solve the factored dense system in place
+ * @param x in/out param, size values, the right hand side on entry
+ */
+static void solve_dense(const double *matrix, const int *pivots, int size,
+                        double *x)
+{
+  for (int row = 0; row < size; row++)
+    {
+      double swapped = x[row];
+      x[row] = x[pivots[row]];
+      x[pivots[row]] = swapped;
+      for (int i = 0; i < row; i++)
+        {
+          x[row] -= matrix[(size_t) row * size + i] * x[i];
+        }
+    }
+  for (int row = size - 1; row >= 0; row--)
+    {
+      for (int i = row + 1; i < size; i++)
+        {
+          x[row] -= matrix[(size_t) row * size + i] * x[i];
+        }
+      x[row] /= matrix[(size_t) row * size + row];
+    }
+}
+
+/**
+ * z = (I - A)^-1 r exactly, for I - A = T - B split into the triangular
+ * part T of the sweep and the links B against it: B only links to the
+ * columns, so x = T^-1 (r + B x) is known from x at the columns, solved
+ * first from the dense capacitance system (I - (T^-1 B) at the columns).
+ */
+static void correct(const LinearSystem *system, const double *r, double *z)
+{
+  int n = system->num_of_states, size = system->num_of_columns;
+  memcpy (z, r, sizeof (double) * n);
+  sweep (system, z);
+  for (int i = 0; i < size; i++)
+    {
+      system->values[i] = z[system->columns[i]];
+    }
+  solve_dense (system->factors, system->pivots, size, system->values);
+  for (int i = 0; i < size; i++)
+    {
+      system->spread[system->columns[i]] = system->values[i];
+    }
+  multiply_against (system, system->spread, system->work);
+  sweep (system, system->work);
+  for (int i = 0; i < size; i++)
+    {
+      system->spread[system->columns[i]] = 0;
+    }
+  for (int state = 0; state < n; state++)
+    {
+      z[state] += system->work[state];
+    }
+}
+
+/**
+ * z = M^-1 r, for M the symmetric Gauss-Seidel splitting of I - A: a
+ * forward sweep, then a backward one. A walk going one way along the states
+ * is solved by it exactly, so only the links going back, against the sweep,
+ * are left to the iterations.
+ */
+static void smooth(const LinearSystem *system, const double *r, double *z)
+{
+  int n = system->num_of_states;
+  for (int state = 0; state < n; state++)
+    {
+      if (!system->active[state])
+        {
+          z[state] = 0;
+          continue;
+        }
+      double sum = r[state];
+      for (int i = system->starts[state]; i < system->starts[state + 1]; i++)
+        {
+          int index = system->indexes[i];
+          if (index < state && system->active[index])
+            {
+              sum += system->weights[i] * z[index];
+            }
+        }
+      z[state] = sum / system->diagonal[state];
+    }
+  for (int state = n - 1; state >= 0; state--)
+    {
+      if (!system->active[state])
+        {
+          continue;
+        }
+      double sum = 0;
+      for (int i = system->starts[state]; i < system->starts[state + 1]; i++)
+        {
+          int index = system->indexes[i];
+          if (index > state && system->active[index])
+            {
+              sum += system->weights[i] * z[index];
+            }
+        }
+      z[state] += sum / system->diagonal[state];
+    }
+}
+
+/**
+ * Add to z the coarse correction of the residual of r: the residual summed
+ * over every range of states, solved for by the aggregated I - A and
+ * spread back over the range. A link going back far is a link between two
+ * ranges, so what a sweep takes one iteration to carry back across it the
+ * correction carries at once.
+ */
+static void correct_coarse(const LinearSystem *system, const double *r,
+                           double *z)
+{
+  int n = system->num_of_states, size = system->num_of_aggregates;
+  int range = (n + size - 1) / size;
+  multiply_system (system, z, system->work);
+  memset (system->values, 0, sizeof (double) * size);
+  for (int state = 0; state < n; state++)
+    {
+      if (system->active[state])
+        {
+          system->values[state / range] += r[state] - system->work[state];
+        }
+    }
+  solve_dense (system->factors, system->pivots, size, system->values);
+  for (int state = 0; state < n; state++)
+    {
+      if (system->active[state])
+        {
+          z[state] += system->values[state / range];
+        }
+    }
+}
+
+/**
+ * z = M^-1 r: I - A itself if the links against a sweep are corrected for,
+ * otherwise the symmetric Gauss-Seidel sweeps, followed by the coarse
+ * correction if there is one.
+ */
+static void precondition(const LinearSystem *system, const double *r,
+                         double *z)
+{
+  if (system->num_of_columns >= 0)
+    {
+      correct (system, r, z);
+      return;
+    }
+  smooth (system, r, z);
+  if (system->num_of_aggregates > 0)
+    {
+      correct_coarse (system, r, z);
+    }
+}
+
+/**
+ * Set up the diagonal, the norm and b of the system
+ * @param constants NULL for 0
+ * @param x the known values of the unknowns that are not active
+ */
+static void init_system(LinearSystem *system, const double *constants,
+                        const double *x, double *b)
+{
+  system->norm = 0;
+  for (int state = 0; state < system->num_of_states; state++)
+    {
+      b[state] = 0;
+      if (!system->active[state])
+        {
+          continue;
+        }
+      double diagonal = 1, off_diagonal = 0;
+      b[state] = constants == NULL ? 0 : constants[state];
+      for (int i = system->starts[state]; i < system->starts[state + 1]; i++)
+        {
+          int index = system->indexes[i];
+          if (index == state)
+            {
+              diagonal -= system->weights[i];
+            }
+          else if (system->active[index])
+            {
+              off_diagonal += system->weights[i];
+            }
+          else if (x[index] != 0) // known, 0 for the states never reached
+            {
+              b[state] += system->weights[i] * x[index];
+            }
+        }
+      system->diagonal[state] = diagonal;
+      system->norm = MAX (system->norm, fabs (diagonal) + off_diagonal);
+    }
+}
+
+/**
+ * Number the states linked to against the sweep, in the order the sweep
+ * first gets to a state linking to them
+ * @param column_of out param, num_of_states values, -1 for the states not
+ * linked to against the sweep
+ * @return number of states linked to against the sweep
+ */
+static int find_columns(const LinearSystem *system, int *column_of)
+{
+  int n = system->num_of_states, size = 0;
+  for (int state = 0; state < n; state++)
+    {
+      column_of[state] = -1;
+    }
+  for (int step = 0; step < n; step++)
+    {
+      int state = step_of (system, step);
+      for (int i = system->starts[state];
+           system->active[state] && i < system->starts[state + 1]; i++)
+        {
+          int index = system->indexes[i];
+          if (system->active[index] && is_against (system, state, index)
+              && column_of[index] < 0)
+            {
+              column_of[index] = size++;
+            }
+        }
+    }
+  return size;
+}
+
+/**
+ * Find the last step of the sweep reading every state along it
+ * @param last_uses out param, num_of_states values, -1 for the states
+ * never read
+ */
+static void find_last_uses(const LinearSystem *system, int *last_uses)
+{
+  int n = system->num_of_states;
+  for (int state = 0; state < n; state++)
+    {
+      last_uses[state] = -1;
+    }
+  for (int step = 0; step < n; step++)
+    {
+      int state = step_of (system, step);
+      for (int i = system->starts[state];
+           system->active[state] && i < system->starts[state + 1]; i++)
+        {
+          int index = system->indexes[i];
+          if (index != state && system->active[index]
+              && !is_against (system, state, index))
+            {
+              last_uses[index] = step;
+            }
+        }
+    }
+}
+
+/**
+ * Add the inputs of state to the segment starting at step first: the states
+ * before the segment it reads along the sweep, and the columns it links to
+ * against it. Added ones get the next slots of the segment.
+ * @param segment number of the segment, marked on the ones added
+ * @param add false to only count the ones that would be added
+ * @return number of inputs added
+ */
+static int add_inputs(const LinearSystem *system, Transfer *transfer,
+                      int state, int first, int segment, bool add)
+{
+  int added = 0;
+  for (int i = system->starts[state];
+       system->active[state] && i < system->starts[state + 1]; i++)
+    {
+      int index = system->indexes[i];
+      if (index == state || !system->active[index])
+        {
+          continue;
+        }
+      if (is_against (system, state, index))
+        {
+          int column = transfer->column_of[index];
+          if (transfer->column_marks[column] == segment)
+            {
+              continue;
+            }
+          added++;
+          if (add)
+            {
+              int slot = transfer->num_of_segment_columns++;
+              transfer->column_marks[column] = segment;
+              transfer->column_slots[column] = slot;
+              transfer->segment_columns[slot] = column;
+            }
+        }
+      else if (step_of (system, index) < first
+               && transfer->marks[index] != segment)
+        {
+          added++;
+          if (add)
+            {
+              int slot = transfer->num_of_inputs++;
+              transfer->marks[index] = segment;
+              transfer->slots[index] = slot;
+              transfer->inputs[slot] = index;
+            }
+        }
+    }
+  return added;
+}
+
+/**
+ * @return true if the row of state is kept after the segment ending at step
+ * end: it is read after it, or it is a column
+ */
+static bool is_output(const LinearSystem *system, const Transfer *transfer,
+                      int state, int end)
+{
+  return system->active[state] && (transfer->last_uses[state] >= end
+                                   || transfer->column_of[state] >= 0);
+}
+
+/**
+ * Close the segment of the steps [first, end): count it's work, and the
+ * rows kept once it is expanded
+ * @param links number of links of it's states
+ * @param seen_p in/out param, columns linked to up to the segment
+ * @param live_p in/out param, rows kept before the segment
+ * @return number of operations of the segment, about
+ */
+static double close_segment(const LinearSystem *system, Transfer *transfer,
+                            int first, int end, int links, int *seen_p,
+                            int *live_p)
+{
+  int width = transfer->num_of_inputs + transfer->num_of_segment_columns;
+  int outputs = 0, kept = 0, freed = 0;
+  for (int step = first; step < end; step++)
+    {
+      int state = step_of (system, step);
+      outputs += is_output (system, transfer, state, end);
+      kept += system->active[state] && transfer->last_uses[state] >= end;
+    }
+  for (int i = 0; i < transfer->num_of_inputs; i++)
+    {
+      freed += transfer->last_uses[transfer->inputs[i]] < end;
+    }
+  for (int i = 0; i < transfer->num_of_segment_columns; i++)
+    {
+      *seen_p = MAX (*seen_p, transfer->segment_columns[i] + 1);
+    }
+  transfer->block = MAX (transfer->block, (size_t) (end - first) * width);
+  transfer->max_rows = MAX (transfer->max_rows, *live_p + kept);
+  *live_p += kept - freed;
+  double expand = (double) transfer->num_of_inputs * *seen_p
+                  + transfer->num_of_segment_columns;
+  double work = (double) links * width + outputs * expand;
+  transfer->segment_ends[transfer->num_of_segments++] = end;
+  transfer->num_of_inputs = transfer->num_of_segment_columns = 0;
+  return work;
+}
+
+/**
+ * Split the sweep into segments of at most SEGMENT_STATES states with at
+ * most SEGMENT_INPUTS inputs, unless a single state has more, and count
+ * the work of the correction and the rows kept at once
+ * @return number of operations of the correction, about
+ */
+static double plan_segments(const LinearSystem *system, Transfer *transfer,
+                            int size)
+{
+  int n = system->num_of_states, first = 0, links = 0, seen = 0, live = 0;
+  double work = (double) size * size * size / 3;
+  transfer->num_of_segments = 0;
+  transfer->num_of_inputs = transfer->num_of_segment_columns = 0;
+  for (int step = 0; step < n; step++)
+    {
+      int state = step_of (system, step);
+      int width = transfer->num_of_inputs + transfer->num_of_segment_columns;
+      if (step > first
+          && (step - first == SEGMENT_STATES
+              || width + add_inputs (system, transfer, state, first,
+                                     transfer->num_of_segments, false)
+                 > SEGMENT_INPUTS))
+        {
+          work += close_segment (system, transfer, first, step, links, &seen,
+                                 &live);
+          first = step;
+          links = 0;
+        }
+      add_inputs (system, transfer, state, first, transfer->num_of_segments,
+                  true);
+      links += system->starts[state + 1] - system->starts[state];
+    }
+  if (n > first)
+    {
+      work += close_segment (system, transfer, first, n, links, &seen, &live);
+    }
+  return work + (double) transfer->max_rows * size;
+}
+
+/**
+ * Sweep the states of a segment once, every one as a combination of the
+ * inputs of the segment: the values at the inputs before it, then the
+ * columns.
+ */
+static void sweep_segment(const LinearSystem *system, Transfer *transfer,
+                          int first, int end)
+{
+  int width = transfer->num_of_inputs + transfer->num_of_segment_columns;
+  for (int step = first; step < end; step++)
+    {
+      int state = step_of (system, step);
+      double *row = transfer->combinations + (size_t) (step - first) * width;
+      memset (row, 0, sizeof (double) * width);
+      for (int i = system->starts[state];
+           system->active[state] && i < system->starts[state + 1]; i++)
+        {
+          int index = system->indexes[i];
+          double weight = system->weights[i];
+          if (index == state || !system->active[index])
+            {
+              continue;
+            }
+          if (is_against (system, state, index))
+            {
+              row[transfer->num_of_inputs
+                  + transfer->column_slots[transfer->column_of[index]]] +=
+                  weight;
+            }
+          else if (step_of (system, index) < first)
+            {
+              row[transfer->slots[index]] += weight;
+            }
+          else
+            {
+              const double *from = transfer->combinations
+                                   + (size_t) (step_of (system, index) - first)
+                                     * width;
+              for (int k = 0; k < width; k++)
+                {
+                  row[k] += weight * from[k];
+                }
+            }
+        }
+      for (int k = 0; k < width && system->active[state]; k++)
+        {
+          row[k] /= system->diagonal[state];
+        }
+    }
+}
+
+/**
+ * Expand the states of the segment kept after it to all the columns, from
+ * the rows of the inputs: rows of T^-1 B, with the ones of the columns
+ * going into the capacitance.
+ */
+static void expand_segment(LinearSystem *system, Transfer *transfer,
+                           int first, int end, int size)
+{
+  int width = transfer->num_of_inputs + transfer->num_of_segment_columns;
+  for (int step = first; step < end; step++)
+    {
+      int state = step_of (system, step);
+      if (!is_output (system, transfer, state, end))
+        {
+          continue;
+        }
+      const double *row = transfer->combinations
+                          + (size_t) (step - first) * width;
+      int kept = transfer->last_uses[state] >= end
+                 ? transfer->free_rows[--transfer->num_of_free] : -1;
+      double *values = kept < 0 ? system->values
+                                : transfer->row_values + (size_t) kept * size;
+      int length = 0;
+      memset (values, 0, sizeof (double) * size);
+      for (int i = 0; i < transfer->num_of_inputs; i++)
+        {
+          int input = transfer->rows[transfer->inputs[i]];
+          int input_length = transfer->row_lengths[input];
+          const double *from = transfer->row_values + (size_t) input * size;
+          for (int k = 0; row[i] != 0 && k < input_length; k++)
+            {
+              values[k] += row[i] * from[k];
+            }
+          length = MAX (length, row[i] != 0 ? input_length : 0);
+        }
+      for (int i = 0; i < transfer->num_of_segment_columns; i++)
+        {
+          int column = transfer->segment_columns[i];
+          values[column] += row[transfer->num_of_inputs + i];
+          length = MAX (length, column + 1);
+        }
+      if (kept >= 0)
+        {
+          transfer->rows[state] = kept;
+          transfer->row_lengths[kept] = length;
+        }
+      int column = transfer->column_of[state];
+      for (int k = 0; column >= 0 && k < size; k++)
+        {
+          system->factors[(size_t) column * size + k] = (k == column)
+                                                        - values[k];
+        }
+    }
+  for (int i = 0; i < transfer->num_of_inputs; i++)
+    {
+      int input = transfer->inputs[i];
+      if (transfer->last_uses[input] < end)
+        {
+          transfer->free_rows[transfer->num_of_free++] = transfer->rows[input];
+        }
+    }
+}
+
+/**
+ * Fill the capacitance I - (T^-1 B) at the columns, segment by segment
+ */
+static void fill_capacitance(LinearSystem *system, Transfer *transfer,
+                             int size)
+{
+  int n = system->num_of_states, first = 0;
+  for (int state = 0; state < n; state++)
+    {
+      transfer->marks[state] = -1;
+    }
+  for (int column = 0; column < size; column++)
+    {
+      transfer->column_marks[column] = -1;
+    }
+  transfer->num_of_free = transfer->max_rows;
+  for (int row = 0; row < transfer->max_rows; row++)
+    {
+      transfer->free_rows[row] = transfer->max_rows - 1 - row;
+    }
+  for (int segment = 0; segment < transfer->num_of_segments; segment++)
+    {
+      int end = transfer->segment_ends[segment];
+      transfer->num_of_inputs = transfer->num_of_segment_columns = 0;
+      for (int step = first; step < end; step++)
+        {
+          add_inputs (system, transfer, step_of (system, step), first,
+                      segment, true);
+        }
+      sweep_segment (system, transfer, first, end);
+      expand_segment (system, transfer, first, end, size);
+      first = end;
+    }
+}
+
+/**
+ * Allocate the arrays of the transfer of n states and size columns
+ * @return false in case of memory allocation failure
+ */
+static bool new_transfer(Transfer *transfer, int n, int size)
+{
+  *transfer = (Transfer) {0};
+  int **ints[] = {&transfer->column_of, &transfer->last_uses,
+                  &transfer->segment_ends, &transfer->marks,
+                  &transfer->slots, &transfer->inputs, &transfer->rows};
+  bool allocated = true;
+  for (size_t i = 0; i < sizeof (ints) / sizeof (ints[0]); i++)
+    {
+      *ints[i] = malloc (sizeof (int) * (n + (size_t) 1));
+      allocated = allocated && *ints[i] != NULL;
+    }
+  transfer->column_marks = malloc (sizeof (int) * (size + (size_t) 1));
+  transfer->column_slots = malloc (sizeof (int) * (size + (size_t) 1));
+  transfer->segment_columns = malloc (sizeof (int) * (size + (size_t) 1));
+  return allocated && transfer->column_marks != NULL
+         && transfer->column_slots != NULL
+         && transfer->segment_columns != NULL;
+}
+
+/**
+ * Allocate the rows and the combinations of a planned transfer
+ * @return false in case of memory allocation failure
+ */
+static bool new_transfer_rows(Transfer *transfer, int size)
+{
+  transfer->combinations = malloc (sizeof (double) * (transfer->block + 1));
+  transfer->row_values = malloc (sizeof (double)
+                                 * ((size_t) transfer->max_rows * size + 1));
+  transfer->row_lengths = malloc (sizeof (int)
+                                  * (transfer->max_rows + (size_t) 1));
+  transfer->free_rows = malloc (sizeof (int)
+                                * (transfer->max_rows + (size_t) 1));
+  return transfer->combinations != NULL && transfer->row_values != NULL
+         && transfer->row_lengths != NULL && transfer->free_rows != NULL;
+}
+
+/**
+ * Free the arrays of a transfer
+ */
+static void free_transfer(Transfer *transfer)
+{
+  free (transfer->column_of);
+  free (transfer->last_uses);
+  free (transfer->segment_ends);
+  free (transfer->marks);
+  free (transfer->slots);
+  free (transfer->inputs);
+  free (transfer->rows);
+  free (transfer->column_marks);
+  free (transfer->column_slots);
+  free (transfer->segment_columns);
+  free (transfer->combinations);
+  free (transfer->row_values);
+  free (transfer->row_lengths);
+  free (transfer->free_rows);
+}
+
+/**
+ * Set up the coarse correction, for when the links against a sweep are too
+ * many to correct for exactly: factor I - A aggregated over at most
+ * ABSORBING_MAX_AGGREGATES ranges of states, summed over the rows of every
+ * range and the columns of every other one.
+ * @return false in case of memory allocation failure
+ */
+static bool init_aggregation(LinearSystem *system)
+{
+  int n = system->num_of_states;
+  int range = (n + ABSORBING_MAX_AGGREGATES - 1) / ABSORBING_MAX_AGGREGATES;
+  int size = range > 0 ? (n + range - 1) / range : 0;
+  system->factors = calloc ((size_t) size * size + 1, sizeof (double));
+  system->pivots = malloc (sizeof (int) * (size + (size_t) 1));
+  system->values = calloc (size + (size_t) 1, sizeof (double));
+  system->work = malloc (sizeof (double) * (n + (size_t) 1));
+  if (system->factors == NULL || system->pivots == NULL
+      || system->values == NULL || system->work == NULL)
+    {
+      printf ("%s", ALLOC_ERROR_ABSORBING_QUEUE);
+      return false;
+    }
+  for (int state = 0; state < n; state++)
+    {
+      if (!system->active[state])
+        {
+          continue;
+        }
+      double *row = system->factors + (size_t) (state / range) * size;
+      row[state / range] += system->diagonal[state];
+      system->values[state / range] = 1; // the range has an active state
+      for (int i = system->starts[state]; i < system->starts[state + 1]; i++)
+        {
+          int index = system->indexes[i];
+          if (index != state && system->active[index])
+            {
+              row[index / range] -= system->weights[i];
+            }
+        }
+    }
+  for (int aggregate = 0; aggregate < size; aggregate++)
+    {
+      if (system->values[aggregate] == 0) // no residual is ever summed there
+        {
+          system->factors[(size_t) aggregate * size + aggregate] = 1;
+        }
+    }
+  // singular only through rounding, the sweeps are left alone then
+  system->num_of_aggregates = factor_dense (system->factors, system->pivots,
+                                            size) ? size : 0;
+  return true;
+}
+
+/**
+ * Set up the correction for the links against the sweep with the fewest
+ * states linked to, if it costs at most ABSORBING_MAX_CORRECTION_WORK
+ * operations: fill the capacitance by a single sweep over the segments,
+ * and factor it.
+ * @return false in case of memory allocation failure
+ */
+static bool init_correction(LinearSystem *system)
+{
+  int n = system->num_of_states;
+  Transfer transfer;
+  system->num_of_columns = -1;
+  bool allocated = new_transfer (&transfer, n, n);
+  if (allocated)
+    {
+      system->forward = false;
+      int size = find_columns (system, transfer.column_of);
+      system->forward = true;
+      int forward_size = find_columns (system, transfer.column_of);
+      if (forward_size > size)
+        {
+          system->forward = false;
+          find_columns (system, transfer.column_of);
+        }
+      size = MIN (size, forward_size);
+      find_last_uses (system, transfer.last_uses);
+      for (int state = 0; state < n; state++)
+        {
+          transfer.marks[state] = -1;
+          transfer.column_marks[state] = -1;
+        }
+      if (plan_segments (system, &transfer, size)
+          > ABSORBING_MAX_CORRECTION_WORK)
+        {
+          free_transfer (&transfer);
+          return init_aggregation (system); // left to the iterations
+        }
+      system->columns = malloc (sizeof (int) * (size + (size_t) 1));
+      system->pivots = malloc (sizeof (int) * (size + (size_t) 1));
+      system->values = malloc (sizeof (double) * (size + (size_t) 1));
+      system->factors = malloc (sizeof (double) * ((size_t) size * size + 1));
+      system->spread = calloc (n + (size_t) 1, sizeof (double));
+      system->work = malloc (sizeof (double) * (n + (size_t) 1));
+      allocated = new_transfer_rows (&transfer, size)
+                  && system->columns != NULL && system->pivots != NULL
+                  && system->values != NULL && system->factors != NULL
+                  && system->spread != NULL && system->work != NULL;
+      for (int state = 0; allocated && state < n; state++)
+        {
+          if (transfer.column_of[state] >= 0)
+            {
+              system->columns[transfer.column_of[state]] = state;
+            }
+        }
+      if (allocated)
+        {
+          fill_capacitance (system, &transfer, size);
+          // singular only through rounding, the iterations still solve it
+          system->num_of_columns = factor_dense (system->factors,
+                                                 system->pivots, size)
+                                   ? size : -1;
+        }
+    }
+  free_transfer (&transfer);
+  if (!allocated)
+    {
+      printf ("%s", ALLOC_ERROR_ABSORBING_QUEUE);
+    }
+  return allocated;
+}
+
+/**
+ * Free the correction of a system
+ */
+static void free_correction(LinearSystem *system)
+{
+  free (system->columns);
+  free (system->factors);
+  free (system->pivots);
+  free (system->values);
+  free (system->spread);
+  free (system->work);
+}
+
+/**
+ * @return true if the residual in r is small enough to stop: every value
+ * within ABSORBING_TOLERANCE of the size of b and of (I - A) x
+ */
+static bool is_small_residual(const LinearSystem *system,
+                              const SolveVectors *vectors, const double *x)
+{
+  double bound = ABSORBING_TOLERANCE * (max_norm (system, vectors->b)
+                                        + system->norm
+                                          * max_norm (system, x));
+  return max_norm (system, vectors->r) <= bound;
+}
+
+/**
+ * Compute the true residual b - (I - A) x into r
+ * @return true if it is small enough to stop
+ */
+static bool is_solved(const LinearSystem *system, SolveVectors *vectors,
+                      const double *x)
+{
+  multiply_system (system, x, vectors->r);
+  for (int state = 0; state < system->num_of_states; state++)
+    {
+      vectors->r[state] = vectors->b[state] - vectors->r[state];
+    }
+  return is_small_residual (system, vectors, x);
+}
+
+/**
+ * Allocate the vectors and the diagonal of a solve
+ * @return false in case of memory allocation failure
+ */
+static bool new_solve_vectors(LinearSystem *system, SolveVectors *vectors)
+{
+  size_t size = sizeof (double) * (system->num_of_states + (size_t) 1);
+  double **all[] = {&vectors->b, &vectors->r, &vectors->r_hat, &vectors->p,
+                    &vectors->v, &vectors->t, &vectors->y,
+                    &system->diagonal};
+  bool allocated = true;
+  for (size_t i = 0; i < sizeof (all) / sizeof (all[0]); i++)
+    {
+      *all[i] = calloc (1, size);
+      allocated = allocated && *all[i] != NULL;
+    }
+  if (!allocated)
+    {
+      printf ("%s", ALLOC_ERROR_ABSORBING_QUEUE);
+    }
+  return allocated;
+}
+
+/**
+ * Free the vectors and the diagonal of a solve
+ */
+static void free_solve_vectors(LinearSystem *system, SolveVectors *vectors)
+{
+  free (vectors->b);
+  free (vectors->r);
+  free (vectors->r_hat);
+  free (vectors->p);
+  free (vectors->v);
+  free (vectors->t);
+  free (vectors->y);
+  free (system->diagonal);
+}
+
+/**
+ * Iterate BiCGSTAB, preconditioned on the right, from the residual in r
+ * until it is small enough, a breakdown or max_iterations.
+ * @param x in/out param
+ * @param iterations_p in/out param, iterations done
+ * @return true if the updated residual got small enough
+ */
+static bool bicgstab(const LinearSystem *system, SolveVectors *vectors,
+                     double *x, int *iterations_p)
+{
+  int n = system->num_of_states;
+  double *r = vectors->r, *p = vectors->p, *v = vectors->v;
+  double *t = vectors->t, *y = vectors->y;
+  memcpy (vectors->r_hat, r, sizeof (double) * n);
+  memset (p, 0, sizeof (double) * n);
+  memset (v, 0, sizeof (double) * n);
+  double rho_old = 1, alpha = 1, omega = 1;
+  while (*iterations_p < ABSORBING_MAX_ITERATIONS)
+    {
+      (*iterations_p)++;
+      double rho = dot (system, vectors->r_hat, r);
+      if (rho == 0 || omega == 0)
+        {
+          return false; // broke down, start over from the residual
+        }
+      double beta = (rho / rho_old) * (alpha / omega);
+      for (int state = 0; state < n; state++)
+        {
+          p[state] = r[state] + beta * (p[state] - omega * v[state]);
+        }
+      precondition (system, p, y);
+      multiply_system (system, y, v);
+      double projection = dot (system, vectors->r_hat, v);
+      if (projection == 0)
+        {
+          return false;
+        }
+      alpha = rho / projection;
+      for (int state = 0; state < n; state++)
+        {
+          x[state] += system->active[state] ? alpha * y[state] : 0;
+          r[state] -= alpha * v[state];
+        }
+      if (is_small_residual (system, vectors, x))
+        {
+          return true;
+        }
+      precondition (system, r, y);
+      multiply_system (system, y, t);
+      double t_norm = dot (system, t, t);
+      omega = t_norm == 0 ? 0 : dot (system, t, r) / t_norm;
+      for (int state = 0; state < n; state++)
+        {
+          x[state] += system->active[state] ? omega * y[state] : 0;
+          r[state] -= omega * t[state];
+        }
+      if (is_small_residual (system, vectors, x))
+        {
+          return true;
+        }
+      rho_old = rho;
+    }
+  return false;
+}
+
+/**
+ * Solve x = constants + A x for the active unknowns by BiCGSTAB; the others
+ * keep their value. It is preconditioned by the exact correction if few
+ * enough states are linked to against a sweep, a board whose snakes and
+ * ladders are few however long, and by symmetric Gauss-Seidel otherwise.
+ * The solve stops once the true residual b - (I - A) x is within
+ * ABSORBING_TOLERANCE of the size of b and of (I - A) x.
+ * @param starts num_of_states + 1, into indexes and weights, the sparse
+ * rows of A
+ * @param constants NULL for 0
+ * @param x in/out param, the first guess
+ * @return EXIT_SUCCESS or EXIT_FAILURE in case of memory allocation failure
+ * or if the solve did not converge
+ */
+static int solve_system(const int *starts, const int *indexes,
+                        const double *weights, const double *constants,
+                        const bool *active, int num_of_states, double *x)
+{
+  LinearSystem system = {num_of_states, starts, indexes, weights, active,
+                         NULL, 0, true, -1, NULL, 0, NULL, NULL, NULL, NULL,
+                         NULL};
+  SolveVectors vectors = {NULL, NULL, NULL, NULL, NULL, NULL, NULL};
+  bool allocated = new_solve_vectors (&system, &vectors);
+  if (allocated)
+    {
+      init_system (&system, constants, x, vectors.b);
+      allocated = init_correction (&system);
+    }
+  if (!allocated)
+    {
+      free_solve_vectors (&system, &vectors);
+      free_correction (&system);
+      return EXIT_FAILURE;
+    }
+  int iterations = 0;
+  bool solved = is_solved (&system, &vectors, x);
+  while (!solved && iterations < ABSORBING_MAX_ITERATIONS)
+    {
+      // the updated residual drifts from the true one: check it, and go on
+      // from it if it is not small enough yet
+      bicgstab (&system, &vectors, x, &iterations);
+      solved = is_solved (&system, &vectors, x);
+    }
+  free_solve_vectors (&system, &vectors);
+  free_correction (&system);
+  if (!solved)
+    {
+      printf ("%s", CONVERGENCE_ERROR);
+      return EXIT_FAILURE;
+    }
+  return EXIT_SUCCESS;
+}
+
+/**
+ * @return array of the states to solve for, NULL in case of memory
+ * allocation failure
+ */
+static bool* transient_states(AbsorbingChain *chain, const bool *included)
+{
+  bool *active = malloc (sizeof (bool) * (chain->num_of_states + (size_t) 1));
+  if (active == NULL)
+    {
+      printf ("%s", ALLOC_ERROR_ABSORBING_QUEUE);
+      return NULL;
+    }
+  for (int state = 0; state < chain->num_of_states; state++)
+    {
+      active[state] = !chain->is_absorbing[state] && included[state];
+    }
+  return active;
+}
+
+/**
+ * Probability of every state to get to a goal state
+ * @param chain
+ * @param probabilities out param, num_of_states values
+ * @return EXIT_SUCCESS or EXIT_FAILURE if the solve did not converge
+ */
+int solve_goal_probabilities(AbsorbingChain *chain, double *probabilities)
+{
+  int n = chain->num_of_states;
+  bool *may_end = malloc (sizeof (bool) * (n + (size_t) 1));
+  if (may_end == NULL)
+    {
+      printf ("%s", ALLOC_ERROR_ABSORBING_QUEUE);
+      return EXIT_FAILURE;
+    }
+  // the trapped states are never absorbed, the system of the others has a
+  // single solution
+  for (int state = 0; state < n; state++)
+    {
+      may_end[state] = !chain->is_trapped[state];
+      probabilities[state] = chain->is_goal[state] ? 1 : 0;
+    }
+  bool *active = transient_states (chain, may_end);
+  free (may_end);
+  if (active == NULL)
+    {
+      return EXIT_FAILURE;
+    }
+  int success = solve_system (chain->row_starts, chain->successors,
+                              chain->probabilities, NULL, active, n,
+                              probabilities);
+  free (active);
+  return success;
+}
+
+/**
+ * Expected cost of the walk from every state until it is absorbed
+ * @param chain
+ * @param costs cost of leaving every state, NULL for 1 (count the steps)
+ * @param expected out param, num_of_states values, INFINITY for the
+ * states that may never be absorbed
+ * @return EXIT_SUCCESS or EXIT_FAILURE if the solve did not converge
+ */
+int solve_expected_costs(AbsorbingChain *chain, const double *costs,
+                         double *expected)
+{
+  int n = chain->num_of_states;
+  double *constants = malloc (sizeof (double) * (n + (size_t) 1));
+  bool *active = transient_states (chain, chain->ends_surely);
+  if (constants == NULL || active == NULL)
+    {
+      printf ("%s", ALLOC_ERROR_ABSORBING_QUEUE);
+      free (constants);
+      free (active);
+      return EXIT_FAILURE;
+    }
+  for (int state = 0; state < n; state++)
+    {
+      constants[state] = costs == NULL ? 1 : costs[state];
+      expected[state] = chain->ends_surely[state] ? 0 : INFINITY;
+    }
+  // the states absorbed surely only get to states absorbed surely
+  int success = solve_system (chain->row_starts, chain->successors,
+                              chain->probabilities, constants, active, n,
+                              expected);
+  free (constants);
+  free (active);
+  return success;
+}
+
+/**
+ * Expected number of times the walk from start is at every state: the
+ * visits of an absorbing state are the probability to be absorbed there.
+ * @param chain
+ * @param start state the walk starts at, absorbed with probability 1
+ * @param visits out param, num_of_states values
+ * @return EXIT_SUCCESS or EXIT_FAILURE if start may never be absorbed or
+ * the solve did not converge
+ */
+int solve_expected_visits(AbsorbingChain *chain, int start, double *visits)
+{
+  if (!chain->ends_surely[start])
+    {
+      printf ("%s", ENDLESS_ERROR);
+      return EXIT_FAILURE;
+    }
+  int n = chain->num_of_states;
+  double *constants = calloc (n + (size_t) 1, sizeof (double));
+  bool *active = transient_states (chain, chain->ends_surely);
+  if (constants == NULL || active == NULL)
+    {
+      printf ("%s", ALLOC_ERROR_ABSORBING_QUEUE);
+      free (constants);
+      free (active);
+      return EXIT_FAILURE;
+    }
+  constants[start] = 1;
+  memset (visits, 0, sizeof (double) * n);
+  int success = solve_system (chain->column_starts, chain->predecessors,
+                              chain->column_probabilities, constants, active,
+                              n, visits);
+  for (int state = 0; success == EXIT_SUCCESS && state < n; state++)
+    {
+      if (chain->is_absorbing[state]) // reached from the transient ones
+        {
+          visits[state] = state == start ? 1 : 0;
+          for (int i = chain->column_starts[state];
+               i < chain->column_starts[state + 1]; i++)
+            {
+              visits[state] += chain->column_probabilities[i]
+                               * visits[chain->predecessors[i]];
+            }
+        }
+    }
+  free (constants);
+  free (active);
+  return success;
+}
+
+/**
+ * Probability of the walk at every state, with the list of the states that
+ * hold any, so a step only costs the links of those
+ */
+typedef struct Frontier {
+    double *probabilities; // num_of_states values
+    int *states; // listed once, may hold 0 after a push
+    int size;
+    bool *is_listed;
+} Frontier;
+
+/**
+ * Allocate the arrays of a frontier, all the probabilities 0
+ * @return false in case of memory allocation failure
+ */
+static bool new_frontier(Frontier *frontier, int num_of_states)
+{
+  frontier->probabilities = calloc (num_of_states + (size_t) 1,
+                                    sizeof (double));
+  frontier->states = malloc (sizeof (int) * (num_of_states + (size_t) 1));
+  frontier->is_listed = calloc (num_of_states + (size_t) 1, sizeof (bool));
+  frontier->size = 0;
+  return frontier->probabilities != NULL && frontier->states != NULL
+         && frontier->is_listed != NULL;
+}
+
+/**
+ * Free the arrays of a frontier
+ */
+static void free_frontier(Frontier *frontier)
+{
+  free (frontier->probabilities);
+  free (frontier->states);
+  free (frontier->is_listed);
+}
+
+/**
+ * Add probability to a state of the frontier, listing it if it is not yet
+ */
+static void add_probability(Frontier *frontier, int state,
+                            double probability)
+{
+  frontier->probabilities[state] += probability;
+  if (!frontier->is_listed[state])
+    {
+      frontier->is_listed[state] = true;
+      frontier->states[frontier->size++] = state;
+    }
+}
+
+/**
+ * Move the probability of a transient state along it's links
+ * @param from emptied at state
+ * @param to gets the probability moved, may be from
+ */
+static void push_probability(AbsorbingChain *chain, int state,
+                             Frontier *from, Frontier *to)
+{
+  double probability = from->probabilities[state];
+  from->probabilities[state] = 0;
+  for (int i = chain->row_starts[state]; i < chain->row_starts[state + 1];
+       i++)
+    {
+      add_probability (to, chain->successors[i],
+                       probability * chain->probabilities[i]);
+    }
+}
+
+/**
+ * Move the probability of all the states of a frontier along their links at
+ * once, every state pulling it from it's predecessors: cheaper than pushing
+ * it state by state once most states hold some
+ * @param from emptied
+ * @param to empty, gets the probability moved
+ */
+static void pull_probability(AbsorbingChain *chain, Frontier *from,
+                             Frontier *to)
+{
+  for (int state = 0; state < chain->num_of_states; state++)
+    {
+      double probability = 0;
+      for (int i = chain->column_starts[state];
+           i < chain->column_starts[state + 1]; i++)
+        {
+          probability += chain->column_probabilities[i]
+                         * from->probabilities[chain->predecessors[i]];
+        }
+      if (probability > 0)
+        {
+          add_probability (to, state, probability);
+        }
+    }
+  for (int i = 0; i < from->size; i++)
+    {
+      from->probabilities[from->states[i]] = 0;
+      from->is_listed[from->states[i]] = false;
+    }
+  from->size = 0;
+}
+
+/**
+ * @return true if the probability at state is passed on in the same step:
+ * it costs nothing and it is neither absorbing nor trapped
+ */
+static bool is_free(AbsorbingChain *chain, const double *costs, int state)
+{
+  return costs != NULL && costs[state] == 0 && !chain->is_absorbing[state]
+         && !chain->is_trapped[state];
+}
+
+/**
+ * Pass on the probability of the free states, until none is left on them
+ * (or for num_of_states rounds, for a loop of them that may be left). A
+ * round passes on the states that got probability in the one before it.
+ * @param queue num_of_states values, a ring of the states to pass on
+ * @param is_queued num_of_states values, all false, left so
+ */
+static void settle_free_states(AbsorbingChain *chain, const double *costs,
+                               Frontier *frontier, int *queue,
+                               bool *is_queued)
+{
+  int n = chain->num_of_states;
+  size_t head = 0, tail = 0; // every state is queued at most once at a time
+  for (int i = 0; costs != NULL && i < frontier->size; i++)
+    {
+      int state = frontier->states[i];
+      if (is_free (chain, costs, state)
+          && frontier->probabilities[state] > 0)
+        {
+          queue[tail++ % n] = state;
+          is_queued[state] = true;
+        }
+    }
+  for (int round = 0; head < tail && round < n; round++)
+    {
+      for (size_t round_end = tail; head < round_end; head++)
+        {
+          int state = queue[head % n];
+          is_queued[state] = false;
+          push_probability (chain, state, frontier, frontier);
+          for (int i = chain->row_starts[state];
+               i < chain->row_starts[state + 1]; i++)
+            {
+              int successor = chain->successors[i];
+              if (!is_queued[successor]
+                  && is_free (chain, costs, successor)
+                  && frontier->probabilities[successor] > 0)
+                {
+                  queue[tail++ % n] = successor;
+                  is_queued[successor] = true;
+                }
+            }
+        }
+    }
+  for (; head < tail; head++)
+    {
+      is_queued[queue[head % n]] = false;
+    }
+}
+
+/**
+ * Take the probability of the absorbing and the trapped states out of the
+ * frontier, and drop the states left with none from it's list
+ * @param left out param, probability of the other states
+ * @param trapped in/out param, gets the probability of the trapped states
+ * @return probability of the absorbing states
+ */
+static double absorb_probability(AbsorbingChain *chain, Frontier *frontier,
+                                 double *left, double *trapped)
+{
+  double absorbed = 0;
+  *left = 0;
+  int size = 0;
+  for (int i = 0; i < frontier->size; i++)
+    {
+      int state = frontier->states[i];
+      double probability = frontier->probabilities[state];
+      if (chain->is_absorbing[state] || chain->is_trapped[state])
+        {
+          *(chain->is_absorbing[state] ? &absorbed : trapped) += probability;
+          frontier->probabilities[state] = 0;
+        }
+      else if (probability > 0)
+        {
+          *left += probability;
+          frontier->states[size++] = state;
+          continue;
+        }
+      frontier->is_listed[state] = false;
+    }
+  frontier->size = size;
+  return absorbed;
+}
+
+/**
+ * Append the probability of one more length to the distribution
+ * @return false in case of memory allocation failure
+ */
+static bool add_length(double **distribution_p, int *size_p, int *capacity_p,
+                       double probability)
+{
+  if (*size_p == *capacity_p)
+    {
+      int capacity = *capacity_p == 0 ? INITIAL_LENGTHS : *capacity_p * 2;
+      double *distribution = realloc (*distribution_p,
+                                      sizeof (double) * capacity);
+      if (distribution == NULL)
+        {
+          printf ("%s", ALLOC_ERROR_DISTRIBUTION);
+          return false;
+        }
+      *distribution_p = distribution;
+      *capacity_p = capacity;
+    }
+  (*distribution_p)[(*size_p)++] = probability;
+  return true;
+}
+
+/**
+ * Set shape to the probability of the frontier over left, the shape of the
+ * walk that is left
+ * @return L1 distance of the shape from the one it is set over
+ */
+static double move_shape(const Frontier *frontier, double left, int n,
+                         double *shape)
+{
+  double distance = 0;
+  for (int state = 0; state < n; state++)
+    {
+      double share = frontier->probabilities[state] / left;
+      distance += fabs (share - shape[state]);
+      shape[state] = share;
+    }
+  return distance;
+}
+
+/**
+ * Check up front that the walk from start can be followed: it takes about
+ * SETTLING_LENGTHS expected lengths for the shape left to settle, every
+ * step over the links of about all the states.
+ * @return EXIT_SUCCESS, or EXIT_FAILURE if that is more than
+ * ABSORBING_MAX_WALK_WORK links or the solve failed
+ */
+static int check_walk_work(AbsorbingChain *chain, int start,
+                           const double *costs)
+{
+  int n = chain->num_of_states;
+  double *expected = malloc (sizeof (double) * (n + (size_t) 1));
+  if (expected == NULL)
+    {
+      printf ("%s", ALLOC_ERROR_DISTRIBUTION);
+      return EXIT_FAILURE;
+    }
+  int success = solve_expected_costs (chain, costs, expected);
+  // a walk that may never be absorbed has no expected length, the cap of
+  // the steps is left to stop it
+  double work = SETTLING_LENGTHS * expected[start] * chain->row_starts[n];
+  free (expected);
+  if (success == EXIT_SUCCESS && isfinite (work)
+      && work > ABSORBING_MAX_WALK_WORK)
+    {
+      printf ("%s", WALK_WORK_ERROR);
+      return EXIT_FAILURE;
+    }
+  return success;
+}
+
+/**
+ * Distribution of the cost of the walk from start until it is absorbed,
+ * for costs of 0 or 1: the probability of the walk is moved along the links
+ * one step at a time, the states that cost nothing passing it on in the
+ * same step, until less than tolerance of it is left on states that may
+ * still be absorbed. The probability that gets to a trapped state is taken
+ * out as it gets there. A step only goes over the states holding
+ * probability, or pulls it over all the links once most states hold some.
+ * Once the shape of the probability left settles, every step absorbs and
+ * traps the same shares of it: the rest of the lengths are geometric,
+ * extrapolated to within tolerance. Settling takes a few expected lengths
+ * of steps over about all the states, so the walk is refused up front if
+ * that is estimated at more than ABSORBING_MAX_WALK_WORK links, and not
+ * followed past that many links: the lengths left out are the rest of the
+ * probability; that many links take about a minute. Measured on random
+ * boards of dice 6: 10^5 cells with an expected game of 8762 rolls take
+ * 41s, and one of 43830 rolls is refused in 0.1s, as are the boards of
+ * 10^6 cells in 1s, the time to solve for the expected length.
+ * @param chain
+ * @param start state the walk starts at
+ * @param costs cost of leaving every state, 0 or 1, NULL for 1
+ * @param tolerance probability of a longer walk to stop at
+ * @param max_length longest walk to follow
+ * @param distribution_p out param, probability of every length [0, *size),
+ * allocated
+ * @param size_p out param, number of lengths
+ * @param trapped_p out param, probability of the walk to never be absorbed
+ * @return EXIT_SUCCESS or EXIT_FAILURE in case of memory allocation failure
+ * or if the walk is too long to follow
+ * @ownership Weak Ownership. *distribution_p is freed by the caller (free)
+ */
+int solve_length_distribution(AbsorbingChain *chain, int start,
+                              const double *costs, double tolerance,
+                              int max_length, double **distribution_p,
+                              int *size_p, double *trapped_p)
+{
+  int n = chain->num_of_states, capacity = 0;
+  *distribution_p = NULL;
+  *size_p = 0;
+  *trapped_p = 0;
+  if (check_walk_work (chain, start, costs) == EXIT_FAILURE)
+    {
+      return EXIT_FAILURE;
+    }
+  Frontier current, next;
+  int *queue = malloc (sizeof (int) * (n + (size_t) 1));
+  bool *is_queued = calloc (n + (size_t) 1, sizeof (bool));
+  double *shape = calloc (n + (size_t) 1, sizeof (double));
+  double *checked_shape = calloc (n + (size_t) 1, sizeof (double));
+  bool allocated = new_frontier (&current, n);
+  allocated = new_frontier (&next, n) && allocated;
+  if (!allocated || queue == NULL || is_queued == NULL || shape == NULL
+      || checked_shape == NULL)
+    {
+      printf ("%s", ALLOC_ERROR_DISTRIBUTION);
+      free_frontier (&current);
+      free_frontier (&next);
+      free (queue);
+      free (is_queued);
+      free (shape);
+      free (checked_shape);
+      return EXIT_FAILURE;
+    }
+  add_probability (&current, start, 1);
+  settle_free_states (chain, costs, &current, queue, is_queued);
+  double left = 0, absorbed_share = 0, trapped_share = 0;
+  bool success = add_length (distribution_p, size_p, &capacity,
+                             absorb_probability (chain, &current, &left,
+                                                 trapped_p));
+  bool is_geometric = false;
+  int length = 1;
+  double work = 0;
+  // the shape is checked against the one of the step before and of the
+  // last check, a quarter of the walk back, so a slow drift is seen too
+  for (int next_check = 1; success && length <= max_length
+                           && left > tolerance && !is_geometric
+                           && work <= ABSORBING_MAX_WALK_WORK; length++)
+    {
+      double before = left, trapped_before = *trapped_p;
+      if (length == next_check)
+        {
+          move_shape (&current, before, n, shape);
+        }
+      if (current.size > n / DENSE_FRONTIER)
+        {
+          work += chain->row_starts[n];
+          pull_probability (chain, &current, &next);
+        }
+      for (int i = 0; i < current.size; i++) // absorbing ones are out
+        {
+          int state = current.states[i];
+          work += chain->row_starts[state + 1] - chain->row_starts[state];
+          push_probability (chain, state, &current, &next);
+          current.is_listed[state] = false;
+        }
+      current.size = 0;
+      settle_free_states (chain, costs, &next, queue, is_queued);
+      double absorbed = absorb_probability (chain, &next, &left, trapped_p);
+      success = add_length (distribution_p, size_p, &capacity, absorbed);
+      absorbed_share = absorbed / before;
+      trapped_share = (*trapped_p - trapped_before) / before;
+      if (length == next_check && left > 0)
+        {
+          double step_distance = move_shape (&next, left, n, shape);
+          double check_distance = move_shape (&next, left, n, checked_shape);
+          is_geometric = left * MAX (step_distance, check_distance)
+                         <= tolerance;
+          next_check = length + length / 4 + 1;
+        }
+      Frontier swap = current;
+      current = next;
+      next = swap;
+    }
+  // the shape left is kept by every step, which takes the same shares of it
+  for (; success && is_geometric && length <= max_length && left > tolerance;
+       length++)
+    {
+      success = add_length (distribution_p, size_p, &capacity,
+                            left * absorbed_share);
+      *trapped_p += left * trapped_share;
+      left *= 1 - absorbed_share - trapped_share;
+    }
+  free (shape);
+  free (checked_shape);
+  free_frontier (&current);
+  free_frontier (&next);
+  free (queue);
+  free (is_queued);
+  if (!success)
+    {
+      free (*distribution_p);
+      *distribution_p = NULL;
+      *size_p = 0;
+      return EXIT_FAILURE;
+    }
+  return EXIT_SUCCESS;
+}
+
+/**
+ * What solve_bounded_walks carries back for a state, kept together so a
+ * successor is read from one place
+ */
+typedef struct BoundedWalk {
+    double goal; // probability to be absorbed at a goal state
+    double end; // probability to be absorbed
+    double length; // expected number of steps
+} BoundedWalk;
+
+/**
+ * Probabilities of the walk from every state to be absorbed within
+ * num_of_steps steps, at a goal state or at all, and the expected number of
+ * steps it takes, cut at num_of_steps: the three are carried back along the
+ * links one step at a time, every step a pass over the sparse rows.
+ * @param chain
+ * @param num_of_steps
+ * @param goal_probabilities out param, num_of_states values
+ * @param end_probabilities out param, num_of_states values
+ * @param lengths out param, num_of_states values
+ * @return EXIT_SUCCESS or EXIT_FAILURE in case of memory allocation failure
+ */
+int solve_bounded_walks(AbsorbingChain *chain, int num_of_steps,
+                        double *goal_probabilities, double *end_probabilities,
+                        double *lengths)
+{
+  int n = chain->num_of_states;
+  BoundedWalk *current = malloc (sizeof (BoundedWalk) * (n + (size_t) 1));
+  BoundedWalk *next = malloc (sizeof (BoundedWalk) * (n + (size_t) 1));
+  if (current == NULL || next == NULL)
+    {
+      printf ("%s", ALLOC_ERROR_BOUNDED_WALKS);
+      free (current);
+      free (next);
+      return EXIT_FAILURE;
+    }
+  for (int state = 0; state < n; state++) // the walks of no steps
+    {
+      current[state] = (BoundedWalk) {chain->is_goal[state],
+                                      chain->is_absorbing[state], 0};
+      next[state] = current[state];
+    }
+  bool changed = true;
+  for (int step = 0; step < num_of_steps && changed; step++)
+    {
+      changed = false;
+      for (int state = 0; state < n; state++) // absorbing ones stay
+        {
+          if (chain->is_absorbing[state])
+            {
+              continue;
+            }
+          BoundedWalk walk = {0, 0, 1};
+          for (int i = chain->row_starts[state];
+               i < chain->row_starts[state + 1]; i++)
+            {
+              const BoundedWalk *successor = &current[chain->successors[i]];
+              walk.goal += chain->probabilities[i] * successor->goal;
+              walk.end += chain->probabilities[i] * successor->end;
+              walk.length += chain->probabilities[i] * successor->length;
+            }
+          // once no walk is left unabsorbed, the next steps change nothing
+          changed = changed || walk.end != current[state].end
+                    || walk.length != current[state].length;
+          next[state] = walk;
+        }
+      BoundedWalk *swap = current;
+      current = next;
+      next = swap;
+    }
+  for (int state = 0; state < n; state++)
+    {
+      goal_probabilities[state] = current[state].goal;
+      end_probabilities[state] = current[state].end;
+      lengths[state] = current[state].length;
+    }
+  free (current);
+  free (next);
+  return EXIT_SUCCESS;
+}
+
+/**
+ * Free chain and all of it's content from memory
+ * @param chain_p chain to free
+ */
+void free_absorbing_chain(AbsorbingChain **chain_p)
+{
+  if (*chain_p != NULL)
+    {
+      free ((*chain_p)->row_starts);
+      free ((*chain_p)->successors);
+      free ((*chain_p)->probabilities);
+      free ((*chain_p)->column_starts);
+      free ((*chain_p)->predecessors);
+      free ((*chain_p)->column_probabilities);
+      free ((*chain_p)->is_absorbing);
+      free ((*chain_p)->is_goal);
+      free ((*chain_p)->ends_surely);
+      free ((*chain_p)->is_trapped);
+      free (*chain_p);
+      *chain_p = NULL;
+    }
+}
@@ -0,0 +1,446 @@
+#include "bigram_counts.h"
+#include "corpus_reader.h"
+#include <string.h>
+#include <limits.h>
+
+#define ALLOC_ERROR_BIGRAM \
+"Allocation failure: Alloc of bigram counts buffer failed.\n"
+#define FORMAT_ERROR "ERROR: bad bigram counts file.\n"
+#define LINE_ERROR "ERROR: bad bigram counts line %lu.\n"
+#define WRITE_ERROR "ERROR: problem with writing file.\n"
+
+#define FIELD_SEPARATOR '\t'
+#define ESCAPE '\\'
+#define DECIMAL 10
+#define PAIRS_PER_READ 4096
+
+/**
+ * State of a text import, passed to every row
+ */
+typedef struct TextImport {
+    MarkovChain *markov_chain;
+    Node* (*add_func)(MarkovChain*, void*, size_t);
+    unsigned long line_number;
+} TextImport;
+
+/**
+ * Replace the escape sequences of the text format, in place
+ * @param str
+ * @return false if str holds an unknown escape sequence
+ */
+static bool unescape(char *str)
+{
+  char *to = str;
+  for (char *from = str; *from != '\0'; from++)
+    {
+      if (*from != ESCAPE)
+        {
+          *to++ = *from;
+          continue;
+        }
+      from++;
+      if (*from == 't')
+        {
+          *to++ = '\t';
+        }
+      else if (*from == 'n')
+        {
+          *to++ = '\n';
+        }
+      else if (*from == ESCAPE)
+        {
+          *to++ = ESCAPE;
+        }
+      else
+        {
+          return false;
+        }
+    }
+  *to = '\0';
+  return true;
+}
+
+/**
+ * @param str
+ * @param count_p out param
+ * @return true if the whole of str is a count in [1, INT_MAX]
+ */
+static bool parse_count(char *str, int *count_p)
+{
+  char *end = NULL;
+  long count = strtol (str, &end, DECIMAL);
+  if (end == str || *end != '\0' || count < 1 || count > INT_MAX)
+    {
+      return false;
+    }
+  *count_p = (int) count;
+  return true;
+}
+
+/**
+ * Import one row of the text format
+ * @param line null terminated row
+ * @param length
+ * @param arg TextImport pointer
+ * @return CORPUS_LINE_NEXT or CORPUS_LINE_ERROR
+ */
+static int import_row(char *line, size_t length, void *arg)
+{
+  TextImport *import = arg;
+  import->line_number++;
+  if (length > 0 && line[length - 1] == '\r')
+    {
+      line[--length] = '\0';
+    }
+  if (length == 0)
+    {
+      return CORPUS_LINE_NEXT;
+    }
+  char *second = strchr (line, FIELD_SEPARATOR);
+  char *count_field = NULL;
+  if (second != NULL)
+    {
+      *second++ = '\0';
+      count_field = strchr (second, FIELD_SEPARATOR);
+      if (count_field == NULL)
+        {
+          printf (LINE_ERROR, import->line_number);
+          return CORPUS_LINE_ERROR;
+        }
+      *count_field++ = '\0';
+    }
+  int count = 0;
+  if (!unescape (line) || (second != NULL && (!unescape (second)
+      || !parse_count (count_field, &count))))
+    {
+      printf (LINE_ERROR, import->line_number);
+      return CORPUS_LINE_ERROR;
+    }
+  Node *first = import->add_func (import->markov_chain, line,
+                                  strlen (line) + 1);
+  if (first == NULL)
+    {
+      return CORPUS_LINE_ERROR;
+    }
+  if (second == NULL) // a state declaration
+    {
+      return CORPUS_LINE_NEXT;
+    }
+  Node *next = import->add_func (import->markov_chain, second,
+                                 strlen (second) + 1);
+  if (next == NULL || !add_weighted_node_to_counter_list
+      (first->data, next->data, import->markov_chain, count))
+    {
+      return CORPUS_LINE_ERROR;
+    }
+  return CORPUS_LINE_NEXT;
+}
+
+/**
+ * @return true if exactly length bytes were read
+ */
+static bool read_exactly(CorpusReader *reader, void *buffer, size_t length)
+{
+  size_t read_length = 0;
+  return read_corpus (reader, buffer, length, &read_length) == EXIT_SUCCESS
+         && read_length == length;
+}
+
+/**
+ * Read the words section of the binary format into the database
+ * @param nodes out param, MarkovNode of every word index
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+static int import_words(CorpusReader *reader, uint32_t num_of_words,
+                        MarkovNode **nodes, MarkovChain *markov_chain,
+                        Node* (*add_func)(MarkovChain*, void*, size_t))
+{
+  char *word = NULL;
+  size_t capacity = 0;
+  for (uint32_t i = 0; i < num_of_words; i++)
+    {
+      uint32_t length = 0;
+      if (!read_exactly (reader, &length, sizeof (uint32_t)) || length == 0)
+        {
+          printf ("%s", FORMAT_ERROR);
+          free (word);
+          return EXIT_FAILURE;
+        }
+      if ((size_t) length + 1 > capacity)
+        {
+          char *grown = realloc (word, (size_t) length + 1);
+          if (grown == NULL)
+            {
+              printf ("%s", ALLOC_ERROR_BIGRAM);
+              free (word);
+              return EXIT_FAILURE;
+            }
+          word = grown;
+          capacity = (size_t) length + 1;
+        }
+      if (!read_exactly (reader, word, length))
+        {
+          printf ("%s", FORMAT_ERROR);
+          free (word);
+          return EXIT_FAILURE;
+        }
+      word[length] = '\0';
+      Node *node = add_func (markov_chain, word, (size_t) length + 1);
+      if (node == NULL)
+        {
+          free (word);
+          return EXIT_FAILURE;
+        }
+      nodes[i] = node->data;
+    }
+  free (word);
+  return EXIT_SUCCESS;
+}
+
+/**
+ * Read the pairs section of the binary format into the counter lists
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+static int import_pairs(CorpusReader *reader, uint64_t num_of_pairs,
+                        uint32_t num_of_words, MarkovNode **nodes,
+                        MarkovChain *markov_chain)
+{
+  BigramPair *pairs = malloc (sizeof (BigramPair) * PAIRS_PER_READ);
+  if (pairs == NULL)
+    {
+      printf ("%s", ALLOC_ERROR_BIGRAM);
+      return EXIT_FAILURE;
+    }
+  for (uint64_t done = 0; done < num_of_pairs;)
+    {
+      size_t n = num_of_pairs - done < PAIRS_PER_READ ?
+                 (size_t) (num_of_pairs - done) : PAIRS_PER_READ;
+      if (!read_exactly (reader, pairs, sizeof (BigramPair) * n))
+        {
+          printf ("%s", FORMAT_ERROR);
+          free (pairs);
+          return EXIT_FAILURE;
+        }
+      for (size_t i = 0; i < n; i++)
+        {
+          BigramPair pair = pairs[i];
+          if (pair.first >= num_of_words || pair.second >= num_of_words
+              || pair.count < 1 || pair.count > INT_MAX)
+            {
+              printf ("%s", FORMAT_ERROR);
+              free (pairs);
+              return EXIT_FAILURE;
+            }
+          if (!add_weighted_node_to_counter_list (nodes[pair.first],
+                                                  nodes[pair.second],
+                                                  markov_chain,
+                                                  (int) pair.count))
+            {
+              free (pairs);
+              return EXIT_FAILURE;
+            }
+        }
+      done += n;
+    }
+  free (pairs);
+  return EXIT_SUCCESS;
+}
+
+/**
+ * Import the binary format
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+static int import_binary(CorpusReader *reader, MarkovChain *markov_chain,
+                         Node* (*add_func)(MarkovChain*, void*, size_t))
+{
+  BigramHeader header;
+  if (!read_exactly (reader, &header, sizeof (BigramHeader))
+      || memcmp (header.magic, BIGRAM_MAGIC, BIGRAM_MAGIC_LENGTH) != 0
+      || header.reserved != 0)
+    {
+      printf ("%s", FORMAT_ERROR);
+      return EXIT_FAILURE;
+    }
+  MarkovNode **nodes = malloc (sizeof (MarkovNode*)
+                               * (header.num_of_words + (size_t) 1));
+  if (nodes == NULL)
+    {
+      printf ("%s", ALLOC_ERROR_BIGRAM);
+      return EXIT_FAILURE;
+    }
+  int success = import_words (reader, header.num_of_words, nodes,
+                              markov_chain, add_func);
+  if (success == EXIT_SUCCESS)
+    {
+      success = import_pairs (reader, header.num_of_pairs,
+                              header.num_of_words, nodes, markov_chain);
+    }
+  free (nodes);
+  return success;
+}
+
+/**
+ * Fill the database of a MarkovChain of strings from bigram counts.
+ * The file may be compressed with gzip or zstd.
+ * @param fp file to read from
+ * @param text true for the text format, false for the binary one
+ * @param markov_chain chain of strings to fill
+ * @param add_func adds a state to the database if it is not in it, as
+ * add_sized_to_database, which it may be, or one that finds the state in an
+ * index rather than scanning the database
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+int import_bigram_counts(FILE *fp, bool text, MarkovChain *markov_chain,
+                         Node* (*add_func)(MarkovChain*, void*, size_t))
+{
+  CorpusReader *reader = open_corpus (fp);
+  if (reader == NULL)
+    {
+      return EXIT_FAILURE;
+    }
+  int success;
+  if (text)
+    {
+      TextImport import = {markov_chain, add_func, 0};
+      success = read_corpus_lines (reader, import_row, &import);
+    }
+  else
+    {
+      success = import_binary (reader, markov_chain, add_func);
+    }
+  close_corpus (&reader);
+  return success;
+}
+
+/**
+ * Write str escaped for the text format
+ * @return false in case of write error
+ */
+static bool write_escaped(const char *str, FILE *fp)
+{
+  for (; *str != '\0'; str++)
+    {
+      int written;
+      if (*str == '\t')
+        {
+          written = fputs ("\\t", fp);
+        }
+      else if (*str == '\n')
+        {
+          written = fputs ("\\n", fp);
+        }
+      else if (*str == ESCAPE)
+        {
+          written = fputs ("\\\\", fp);
+        }
+      else
+        {
+          written = fputc (*str, fp);
+        }
+      if (written == EOF)
+        {
+          return false;
+        }
+    }
+  return true;
+}
+
+/**
+ * Export the text format
+ * @return false in case of write error
+ */
+static bool export_text(MarkovChain *markov_chain, FILE *fp)
+{
+  for (Node *node = markov_chain->database->first; node != NULL;
+       node = node->next)
+    {
+      if (!write_escaped (node->data->data, fp) || fputc ('\n', fp) == EOF)
+        {
+          return false;
+        }
+    }
+  for (Node *node = markov_chain->database->first; node != NULL;
+       node = node->next)
+    {
+      MarkovNode *markov_node = node->data;
+      for (int i = 0; i < markov_node->counter_list_length; i++)
+        {
+          NextNodeCounter counter = markov_node->counter_list[i];
+          if (!write_escaped (markov_node->data, fp)
+              || fputc (FIELD_SEPARATOR, fp) == EOF
+              || !write_escaped (counter.markov_node->data, fp)
+              || fprintf (fp, "%c%d\n", FIELD_SEPARATOR,
+                          counter.frequency) < 0)
+            {
+              return false;
+            }
+        }
+    }
+  return true;
+}
+
+/**
+ * Export the binary format
+ * @return false in case of write error
+ */
+static bool export_binary(MarkovChain *markov_chain, FILE *fp)
+{
+  BigramHeader header = {BIGRAM_MAGIC, 0, 0, 0};
+  header.num_of_words = (uint32_t) markov_chain->database->size;
+  for (Node *node = markov_chain->database->first; node != NULL;
+       node = node->next)
+    {
+      header.num_of_pairs += node->data->counter_list_length;
+    }
+  if (fwrite (&header, sizeof (BigramHeader), 1, fp) != 1)
+    {
+      return false;
+    }
+  for (Node *node = markov_chain->database->first; node != NULL;
+       node = node->next)
+    {
+      char *word = node->data->data;
+      uint32_t length = (uint32_t) strlen (word);
+      if (fwrite (&length, sizeof (uint32_t), 1, fp) != 1
+          || fwrite (word, 1, length, fp) != length)
+        {
+          return false;
+        }
+    }
+  for (Node *node = markov_chain->database->first; node != NULL;
+       node = node->next)
+    {
+      MarkovNode *markov_node = node->data;
+      for (int i = 0; i < markov_node->counter_list_length; i++)
+        {
+          NextNodeCounter counter = markov_node->counter_list[i];
+          BigramPair pair = {(uint32_t) markov_node->id,
+                             (uint32_t) counter.markov_node->id,
+                             (uint32_t) counter.frequency};
+          if (fwrite (&pair, sizeof (BigramPair), 1, fp) != 1)
+            {
+              return false;
+            }
+        }
+    }
+  return true;
+}
+
+/**
+ * Write the states and link counts of a MarkovChain of strings.
+ * @param markov_chain chain of strings
+ * @param fp file to write to
+ * @param text true for the text format, false for the binary one
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+int export_bigram_counts(MarkovChain *markov_chain, FILE *fp, bool text)
+{
+  bool success = text ? export_text (markov_chain, fp)
+                      : export_binary (markov_chain, fp);
+  if (!success)
+    {
+      printf ("%s", WRITE_ERROR);
+      return EXIT_FAILURE;
+    }
+  return EXIT_SUCCESS;
+}
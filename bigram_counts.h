@@ -0,0 +1,62 @@
+#ifndef _BIGRAM_COUNTS_H
+#define _BIGRAM_COUNTS_H
+
+#include "markov_chain.h"
+#include <stdint.h> // For uint32_t
+
+#define BIGRAM_MAGIC "MKVBGR01"
+#define BIGRAM_MAGIC_LENGTH 8
+
+/***************************/
+/*        STRUCTS          */
+/***************************/
+
+/**
+ * Header of the binary bigram counts format. It is followed by
+ * num_of_words words, each a uint32_t length and it's bytes, then by
+ * num_of_pairs BigramPair. Numbers are in the byte order of the machine.
+ *
+ * The text format has one tab separated row per line: "word" declares a
+ * state, "word_1<TAB>word_2<TAB>count" adds count to the link between them.
+ * Tabs, new lines and backslashes inside words are written \t, \n and \\.
+ *
+ * In both formats states are added to the database in the order they first
+ * appear, so an exported chain is imported back identical.
+ */
+typedef struct BigramHeader {
+    char magic[BIGRAM_MAGIC_LENGTH];
+    uint32_t num_of_words;
+    uint32_t reserved;
+    uint64_t num_of_pairs;
+} BigramHeader;
+
+typedef struct BigramPair {
+    uint32_t first; // word indexes, in order of the words section
+    uint32_t second;
+    uint32_t count;
+} BigramPair;
+
+/**
+ * Fill the database of a MarkovChain of strings from bigram counts.
+ * The file may be compressed with gzip or zstd.
+ * @param fp file to read from
+ * @param text true for the text format, false for the binary one
+ * @param markov_chain chain of strings to fill
+ * @param add_func adds a state to the database if it is not in it, as
+ * add_sized_to_database, which it may be, or one that finds the state in an
+ * index rather than scanning the database
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+int import_bigram_counts(FILE *fp, bool text, MarkovChain *markov_chain,
+                         Node* (*add_func)(MarkovChain*, void*, size_t));
+
+/**
+ * Write the states and link counts of a MarkovChain of strings.
+ * @param markov_chain chain of strings
+ * @param fp file to write to
+ * @param text true for the text format, false for the binary one
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+int export_bigram_counts(MarkovChain *markov_chain, FILE *fp, bool text);
+
+#endif /* _BIGRAM_COUNTS_H */
@@ -0,0 +1,678 @@
+#include "bulk_builder.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#define ALLOC_ERROR_BULK_BUILDER \
+"Allocation failure: Alloc of new BulkBuilder failed.\n"
+#define ALLOC_ERROR_BULK_PAIRS \
+"Allocation failure: Alloc of bulk pairs failed.\n"
+#define RUN_ERROR "ERROR: problem with a temporary run file.\n"
+
+#define INITIAL_CAPACITY (1 << 16)
+#define ID_SHIFT 32 // of id_1 in a pair read
+#define RADIX_BITS 11
+#define RADIX_SIZE (1 << RADIX_BITS)
+#define RADIX_MASK (RADIX_SIZE - 1)
+#define MIN_PAIRS_PER_THREAD (1 << 16)
+#define MIN_RUN_PAIRS 1024
+
+/**
+ * The part of one radix sort pass done by one thread
+ */
+typedef struct SortTask {
+    const uint64_t *from;
+    uint64_t *to;
+    size_t begin; // keys [begin, end) of from are the task's
+    size_t end;
+    uint32_t shift; // of the digit sorted by
+    size_t counts[RADIX_SIZE]; // of each digit, then where it's next key goes
+} SortTask;
+
+/**
+ * The next edge of a run being merged
+ */
+typedef struct RunHead {
+    FrozenEdge edge;
+    int run;
+} RunHead;
+
+/**
+ * @return number of bits needed to represent value, 0 for 0
+ */
+static uint32_t bit_width(uint64_t value)
+{
+  uint32_t width = 0;
+  while (value != 0)
+    {
+      width++;
+      value >>= 1;
+    }
+  return width;
+}
+
+/**
+ * Size of a word state, to use in frozen database
+ */
+static size_t word_size(void *word)
+{
+  return strlen (word) + 1;
+}
+
+/**
+ * Initialize and Allocate new BulkBuilder
+ * @param num_of_threads number of sorting threads
+ * @param memory_budget bytes the pairs may use before being spilled to
+ * temporary files, 0 to keep them all in memory
+ * @return BulkBuilder pointer, NULL in case of memory allocation failure
+ * @ownership Weak Ownership. separate function for Free (free_bulk_builder)
+ */
+BulkBuilder* new_bulk_builder(int num_of_threads, size_t memory_budget)
+{
+  BulkBuilder *builder = malloc (sizeof (BulkBuilder));
+  if (builder == NULL)
+    {
+      printf ("%s", ALLOC_ERROR_BULK_BUILDER);
+      return NULL;
+    }
+  builder->words = new_string_table ('\0');
+  if (builder->words == NULL)
+    {
+      free (builder);
+      return NULL;
+    }
+  builder->pairs = NULL;
+  builder->num_of_pairs = 0;
+  builder->pairs_capacity = 0;
+  builder->num_of_threads = num_of_threads > 0 ? num_of_threads : 1;
+  builder->max_pairs = 0; // the pairs and their sort buffer fit the budget
+  if (memory_budget > 0)
+    {
+      builder->max_pairs = memory_budget / (2 * sizeof (uint64_t));
+      builder->max_pairs = builder->max_pairs > MIN_RUN_PAIRS ?
+                           builder->max_pairs : MIN_RUN_PAIRS;
+    }
+  builder->runs = NULL;
+  builder->run_levels = NULL;
+  builder->num_of_runs = 0;
+  builder->runs_capacity = 0;
+  return builder;
+}
+
+/**
+ * Count the digits of the task's keys
+ * @param arg SortTask pointer
+ */
+static void* count_digits(void *arg)
+{
+  SortTask *task = arg;
+  memset (task->counts, 0, sizeof (task->counts));
+  for (size_t i = task->begin; i < task->end; i++)
+    {
+      task->counts[(task->from[i] >> task->shift) & RADIX_MASK]++;
+    }
+  return NULL;
+}
+
+/**
+ * Move the task's keys to where their digit puts them, keeping their order
+ * @param arg SortTask pointer
+ */
+static void* scatter_digits(void *arg)
+{
+  SortTask *task = arg;
+  for (size_t i = task->begin; i < task->end; i++)
+    {
+      uint64_t key = task->from[i];
+      task->to[task->counts[(key >> task->shift) & RADIX_MASK]++] = key;
+    }
+  return NULL;
+}
+
+/**
+ * Run func on every task, the first one on the calling thread. A task whose
+ * thread can not be started is run on the calling thread too.
+ * @param threads room for num_of_tasks - 1 threads
+ */
+static void run_tasks(void* (*func)(void*), SortTask *tasks, int num_of_tasks,
+                      pthread_t *threads)
+{
+  int started = 0;
+  for (int i = 1; i < num_of_tasks; i++)
+    {
+      if (pthread_create (&threads[started], NULL, func, &tasks[i]) == 0)
+        {
+          started++;
+        }
+      else
+        {
+          func (&tasks[i]);
+        }
+    }
+  func (&tasks[0]);
+  for (int i = 0; i < started; i++)
+    {
+      pthread_join (threads[i], NULL);
+    }
+}
+
+/**
+ * Turn the digit counts of the tasks into the position of their first key:
+ * the keys of a digit go in the order of their tasks.
+ * @return false if all the keys have the same digit, so the pass is not
+ * needed
+ */
+static bool count_positions(SortTask *tasks, int num_of_tasks,
+                            size_t num_of_keys)
+{
+  size_t position = 0;
+  for (int digit = 0; digit < RADIX_SIZE; digit++)
+    {
+      size_t digit_count = 0;
+      for (int i = 0; i < num_of_tasks; i++)
+        {
+          size_t count = tasks[i].counts[digit];
+          tasks[i].counts[digit] = position;
+          position += count;
+          digit_count += count;
+        }
+      if (digit_count == num_of_keys)
+        {
+          return false;
+        }
+    }
+  return true;
+}
+
+/**
+ * LSD radix sort of the pairs, RADIX_BITS at a time. Every pass is split
+ * between the threads: each one counts the digits of it's part of the keys,
+ * then moves them, so a pass is stable.
+ * @param builder
+ * @param key_bits number of low bits the keys differ in
+ * @return false in case of memory allocation failure
+ */
+static bool sort_pairs(BulkBuilder *builder, uint32_t key_bits)
+{
+  size_t num_of_keys = builder->num_of_pairs;
+  int num_of_tasks = builder->num_of_threads;
+  if ((size_t) num_of_tasks > num_of_keys / MIN_PAIRS_PER_THREAD)
+    {
+      num_of_tasks = (int) (num_of_keys / MIN_PAIRS_PER_THREAD);
+      num_of_tasks = num_of_tasks > 0 ? num_of_tasks : 1;
+    }
+  size_t capacity = builder->pairs_capacity; // the buffer replaces the pairs
+  uint64_t *buffer = malloc (sizeof (uint64_t) * (capacity > 0 ? capacity
+                                                               : 1));
+  SortTask *tasks = malloc (sizeof (SortTask) * num_of_tasks);
+  pthread_t *threads = malloc (sizeof (pthread_t) * num_of_tasks);
+  if (buffer == NULL || tasks == NULL || threads == NULL)
+    {
+      printf ("%s", ALLOC_ERROR_BULK_PAIRS);
+      free (buffer);
+      free (tasks);
+      free (threads);
+      return false;
+    }
+  uint64_t *from = builder->pairs, *to = buffer;
+  for (uint32_t shift = 0; shift < key_bits; shift += RADIX_BITS)
+    {
+      for (int i = 0; i < num_of_tasks; i++)
+        {
+          tasks[i].from = from;
+          tasks[i].to = to;
+          tasks[i].begin = num_of_keys * i / num_of_tasks;
+          tasks[i].end = num_of_keys * (i + 1) / num_of_tasks;
+          tasks[i].shift = shift;
+        }
+      run_tasks (count_digits, tasks, num_of_tasks, threads);
+      if (!count_positions (tasks, num_of_tasks, num_of_keys))
+        {
+          continue;
+        }
+      run_tasks (scatter_digits, tasks, num_of_tasks, threads);
+      to = from;
+      from = tasks[0].to;
+    }
+  builder->pairs = from;
+  free (to);
+  free (tasks);
+  free (threads);
+  return true;
+}
+
+/**
+ * Pack the pairs into sort keys, id_1 just above the bits of id_2
+ * @return number of bits of an id
+ */
+static uint32_t pack_pairs(BulkBuilder *builder)
+{
+  int size = builder->words->size;
+  uint32_t id_bits = bit_width (size > 0 ? size - 1 : 0);
+  for (size_t i = 0; i < builder->num_of_pairs; i++)
+    {
+      uint64_t pair = builder->pairs[i];
+      builder->pairs[i] = (pair >> ID_SHIFT) << id_bits | (pair & UINT32_MAX);
+    }
+  return id_bits;
+}
+
+/**
+ * Count the runs of equal sorted keys into edges
+ * @param pairs sorted keys, id_1 above the id_bits low bits of id_2
+ * @param num_of_pairs
+ * @param id_bits
+ * @param num_of_edges_p out param, number of edges
+ * @return the edges, NULL in case of memory allocation failure
+ */
+static FrozenEdge* count_edges(const uint64_t *pairs, size_t num_of_pairs,
+                               uint32_t id_bits, uint64_t *num_of_edges_p)
+{
+  uint64_t num_of_edges = 0;
+  for (size_t i = 0; i < num_of_pairs; i++)
+    {
+      num_of_edges += i == 0 || pairs[i] != pairs[i - 1];
+    }
+  FrozenEdge *edges = malloc (sizeof (FrozenEdge)
+                              * (num_of_edges > 0 ? num_of_edges : 1));
+  if (edges == NULL)
+    {
+      printf ("%s", ALLOC_ERROR_BULK_PAIRS);
+      return NULL;
+    }
+  uint64_t id_mask = (UINT64_C(1) << id_bits) - 1, edge = 0;
+  for (size_t i = 0; i < num_of_pairs;)
+    {
+      size_t run = i + 1;
+      while (run < num_of_pairs && pairs[run] == pairs[i])
+        {
+          run++;
+        }
+      edges[edge++] = (FrozenEdge) {(uint32_t) (pairs[i] >> id_bits),
+                                    (uint32_t) (pairs[i] & id_mask),
+                                    (uint32_t) (run - i)};
+      i = run;
+    }
+  *num_of_edges_p = num_of_edges;
+  return edges;
+}
+
+/**
+ * @return the words of the table, by id, NULL in case of memory allocation
+ * failure
+ */
+static void** collect_words(StringTable *words)
+{
+  void **states = malloc (sizeof (void*) * (words->size > 0 ? words->size
+                                                            : 1));
+  if (states == NULL)
+    {
+      printf ("%s", ALLOC_ERROR_BULK_PAIRS);
+      return NULL;
+    }
+  for (int i = 0; i < words->size; i++)
+    {
+      states[i] = words->arena + words->offsets[i];
+    }
+  return states;
+}
+
+/**
+ * Sort and count the links read, and build the FrozenChain of the words.
+ * The pairs are consumed: the builder reads no more words afterwards.
+ * Only for a builder with no memory budget, see write_bulk_model otherwise.
+ * @param builder
+ * @param max_error maximal relative error of a stored frequency, 0 for
+ * exact frequencies
+ * @param print_func print function of the words
+ * @return FrozenChain pointer, NULL in case of memory allocation failure
+ * @ownership Weak Ownership. separate function for Free (free_frozen_chain)
+ */
+FrozenChain* build_bulk_chain(BulkBuilder *builder, double max_error,
+                              void (*print_func)(void*))
+{
+  StringTable *words = builder->words;
+  uint32_t id_bits = pack_pairs (builder);
+  if (!sort_pairs (builder, 2 * id_bits))
+    {
+      return NULL;
+    }
+  uint64_t num_of_edges = 0;
+  FrozenEdge *edges = count_edges (builder->pairs, builder->num_of_pairs,
+                                   id_bits, &num_of_edges);
+  free (builder->pairs);
+  builder->pairs = NULL;
+  builder->num_of_pairs = 0;
+  builder->pairs_capacity = 0;
+  if (edges == NULL)
+    {
+      return NULL;
+    }
+  void **states = collect_words (words);
+  if (states == NULL)
+    {
+      free (edges);
+      return NULL;
+    }
+  FrozenChain *frozen_chain = freeze_edges (states, (uint32_t) words->size,
+                                            word_size, edges, num_of_edges,
+                                            max_error);
+  if (frozen_chain != NULL)
+    {
+      frozen_chain->print_func = print_func;
+    }
+  free (states);
+  free (edges);
+  return frozen_chain;
+}
+
+/**
+ * @return true if edge a goes before edge b in a run
+ */
+static bool is_edge_before(FrozenEdge a, FrozenEdge b)
+{
+  return a.from < b.from || (a.from == b.from && a.to < b.to);
+}
+
+/**
+ * Restore the min-heap order of heap below index
+ */
+static void sift_down(RunHead *heap, int size, int index)
+{
+  while (2 * index + 1 < size)
+    {
+      int child = 2 * index + 1;
+      if (child + 1 < size
+          && is_edge_before (heap[child + 1].edge, heap[child].edge))
+        {
+          child++;
+        }
+      if (!is_edge_before (heap[child].edge, heap[index].edge))
+        {
+          return;
+        }
+      RunHead head = heap[index];
+      heap[index] = heap[child];
+      heap[child] = head;
+      index = child;
+    }
+}
+
+/**
+ * k-way merge of sorted runs, adding up the frequencies of equal edges
+ * @param runs
+ * @param num_of_runs
+ * @param merged file to write the merged run to
+ * @return false in case of memory allocation failure or file error
+ */
+static bool merge_runs(FILE **runs, int num_of_runs, FILE *merged)
+{
+  RunHead *heap = malloc (sizeof (RunHead) * num_of_runs);
+  if (heap == NULL)
+    {
+      printf ("%s", ALLOC_ERROR_BULK_PAIRS);
+      return false;
+    }
+  int size = 0;
+  for (int i = 0; i < num_of_runs; i++)
+    {
+      rewind (runs[i]);
+      if (fread (&heap[size].edge, sizeof (FrozenEdge), 1, runs[i]) == 1)
+        {
+          heap[size++].run = i;
+        }
+    }
+  for (int i = size / 2 - 1; i >= 0; i--)
+    {
+      sift_down (heap, size, i);
+    }
+  bool failed = false, has_edge = false;
+  FrozenEdge edge = {0, 0, 0};
+  while (size > 0)
+    {
+      FrozenEdge next = heap[0].edge;
+      if (has_edge && next.from == edge.from && next.to == edge.to)
+        {
+          edge.frequency += next.frequency;
+        }
+      else
+        {
+          failed |= has_edge && fwrite (&edge, sizeof (FrozenEdge), 1,
+                                        merged) != 1;
+          edge = next;
+          has_edge = true;
+        }
+      if (fread (&heap[0].edge, sizeof (FrozenEdge), 1,
+                 runs[heap[0].run]) != 1)
+        {
+          failed |= ferror (runs[heap[0].run]) != 0;
+          heap[0] = heap[--size];
+        }
+      sift_down (heap, size, 0);
+    }
+  failed |= has_edge && fwrite (&edge, sizeof (FrozenEdge), 1, merged) != 1;
+  free (heap);
+  if (failed || fflush (merged) != 0)
+    {
+      printf ("%s", RUN_ERROR);
+      return false;
+    }
+  return true;
+}
+
+/**
+ * Add a run of the given level to the builder, then merge every
+ * BULK_MERGE_WAYS last runs of the same level into one
+ * @return false in case of memory allocation failure or file error
+ */
+static bool add_run(BulkBuilder *builder, FILE *run, int level)
+{
+  if (builder->num_of_runs == builder->runs_capacity)
+    {
+      int capacity = builder->runs_capacity + BULK_MERGE_WAYS;
+      FILE **runs = realloc (builder->runs, sizeof (FILE*) * capacity);
+      if (runs != NULL)
+        {
+          builder->runs = runs;
+        }
+      int *levels = realloc (builder->run_levels, sizeof (int) * capacity);
+      if (levels != NULL)
+        {
+          builder->run_levels = levels;
+        }
+      if (runs == NULL || levels == NULL)
+        {
+          printf ("%s", ALLOC_ERROR_BULK_PAIRS);
+          fclose (run);
+          return false;
+        }
+      builder->runs_capacity = capacity;
+    }
+  builder->runs[builder->num_of_runs] = run;
+  builder->run_levels[builder->num_of_runs++] = level;
+  int first = builder->num_of_runs - BULK_MERGE_WAYS;
+  if (first < 0 || builder->run_levels[first] != level)
+    {
+      return true;
+    }
+  FILE *merged = tmpfile ();
+  if (merged == NULL)
+    {
+      printf ("%s", RUN_ERROR);
+      return false;
+    }
+  if (!merge_runs (builder->runs + first, BULK_MERGE_WAYS, merged))
+    {
+      fclose (merged);
+      return false;
+    }
+  for (int i = first; i < builder->num_of_runs; i++)
+    {
+      fclose (builder->runs[i]);
+    }
+  builder->num_of_runs = first;
+  return add_run (builder, merged, level + 1);
+}
+
+/**
+ * Sort and count the pairs into a new run, and empty the pairs
+ * @return false in case of memory allocation failure or file error
+ */
+static bool spill_run(BulkBuilder *builder)
+{
+  uint32_t id_bits = pack_pairs (builder);
+  if (!sort_pairs (builder, 2 * id_bits))
+    {
+      return false;
+    }
+  FILE *run = tmpfile ();
+  if (run == NULL)
+    {
+      printf ("%s", RUN_ERROR);
+      return false;
+    }
+  uint64_t id_mask = (UINT64_C(1) << id_bits) - 1;
+  bool failed = false;
+  for (size_t i = 0; i < builder->num_of_pairs;)
+    {
+      size_t end = i + 1;
+      while (end < builder->num_of_pairs
+             && builder->pairs[end] == builder->pairs[i])
+        {
+          end++;
+        }
+      FrozenEdge edge = {(uint32_t) (builder->pairs[i] >> id_bits),
+                         (uint32_t) (builder->pairs[i] & id_mask),
+                         (uint32_t) (end - i)};
+      failed |= fwrite (&edge, sizeof (FrozenEdge), 1, run) != 1;
+      i = end;
+    }
+  builder->num_of_pairs = 0;
+  if (failed || fflush (run) != 0)
+    {
+      printf ("%s", RUN_ERROR);
+      fclose (run);
+      return false;
+    }
+  return add_run (builder, run, 0);
+}
+
+/**
+ * Read a word, and the link to it from the word before it if there is one.
+ * @param builder
+ * @param prev id of the word before, BULK_NO_WORD if none
+ * @param word bytes of the word, no null needed
+ * @param length number of bytes, the word ending at the first null among
+ * them as it does for a MarkovChain
+ * @return id of the word, BULK_ERROR in case of memory allocation failure
+ * or if a run could not be spilled
+ */
+int bulk_observe(BulkBuilder *builder, int prev, const char *word,
+                 size_t length)
+{
+  const char *null = memchr (word, '\0', length);
+  length = null != NULL ? (size_t) (null - word) : length;
+  int id = add_to_string_table (builder->words, word, length);
+  if (id == STRING_TABLE_ERROR)
+    {
+      return BULK_ERROR;
+    }
+  if (prev == BULK_NO_WORD)
+    {
+      return id;
+    }
+  if (builder->num_of_pairs == builder->max_pairs
+      && builder->max_pairs > 0 && !spill_run (builder))
+    {
+      return BULK_ERROR;
+    }
+  if (builder->num_of_pairs == builder->pairs_capacity)
+    {
+      size_t capacity = builder->pairs_capacity * 2;
+      capacity = capacity > 0 ? capacity : INITIAL_CAPACITY;
+      if (builder->max_pairs > 0 && capacity > builder->max_pairs)
+        {
+          capacity = builder->max_pairs;
+        }
+      uint64_t *pairs = realloc (builder->pairs, sizeof (uint64_t) * capacity);
+      if (pairs == NULL)
+        {
+          printf ("%s", ALLOC_ERROR_BULK_PAIRS);
+          return BULK_ERROR;
+        }
+      builder->pairs = pairs;
+      builder->pairs_capacity = capacity;
+    }
+  builder->pairs[builder->num_of_pairs++] = (uint64_t) prev << ID_SHIFT
+                                            | (uint32_t) id;
+  return id;
+}
+
+/**
+ * Sort and count the links read, merge them with the spilled runs and write
+ * the frozen model of the words, as save_frozen_chain would write the chain
+ * build_bulk_chain builds. The pairs and runs are consumed.
+ * @param builder
+ * @param max_error maximal relative error of a stored frequency, 0 for
+ * exact frequencies
+ * @param fp file opened for binary writing
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+int write_bulk_model(BulkBuilder *builder, double max_error, FILE *fp)
+{
+  if ((builder->num_of_pairs > 0 || builder->num_of_runs == 0)
+      && !spill_run (builder))
+    {
+      return EXIT_FAILURE;
+    }
+  FILE *edges_file = builder->runs[0];
+  if (builder->num_of_runs > 1)
+    {
+      edges_file = tmpfile ();
+      if (edges_file == NULL)
+        {
+          printf ("%s", RUN_ERROR);
+          return EXIT_FAILURE;
+        }
+      if (!merge_runs (builder->runs, builder->num_of_runs, edges_file))
+        {
+          fclose (edges_file);
+          return EXIT_FAILURE;
+        }
+    }
+  void **states = collect_words (builder->words);
+  int success = EXIT_FAILURE;
+  if (states != NULL)
+    {
+      success = write_frozen_edges (states, (uint32_t) builder->words->size,
+                                    word_size, edges_file, max_error, fp);
+    }
+  free (states);
+  if (builder->num_of_runs > 1)
+    {
+      fclose (edges_file);
+    }
+  return success;
+}
+
+/**
+ * Free builder and all of it's content from memory
+ * @param builder_p builder to free
+ */
+void free_bulk_builder(BulkBuilder **builder_p)
+{
+  if (*builder_p != NULL)
+    {
+      for (int i = 0; i < (*builder_p)->num_of_runs; i++)
+        {
+          fclose ((*builder_p)->runs[i]);
+        }
+      free ((*builder_p)->runs);
+      free ((*builder_p)->run_levels);
+      free_string_table (&(*builder_p)->words);
+      free ((*builder_p)->pairs);
+      free (*builder_p);
+      *builder_p = NULL;
+    }
+}
@@ -0,0 +1,107 @@
+#ifndef _BULK_BUILDER_H
+#define _BULK_BUILDER_H
+
+#include "frozen_chain.h"
+#include "string_table.h"
+#include <stdio.h> // For FILE
+#include <stdlib.h> // For size_t
+#include <stdint.h> // For uint64_t
+
+#define BULK_ERROR (-1)
+#define BULK_NO_WORD (-1) // previous word of the first word of a line
+
+#define BULK_SORT_THREADS 4 // default number of sorting threads
+#define BULK_MERGE_WAYS 64 // runs merged at once
+
+/***************************/
+/*        STRUCTS          */
+/***************************/
+
+/**
+ * Builds a FrozenChain of strings in bulk, with no MarkovChain: every word
+ * read gets an id, in order of first occurrence, and every link read is
+ * appended to a flat array of (id_1, id_2) pairs. The pairs are then radix
+ * sorted, by several threads, so equal links end up next to each other and
+ * are counted in one sequential pass, straight into the CSR rows of the
+ * frozen chain.
+ *
+ * The states get the ids a MarkovChain learning the same words would give
+ * them, but the successors of a state are kept in order of their id, not of
+ * their first link: the chain is the same, sampling it with a given seed
+ * is not.
+ *
+ * With a memory budget, the pairs array never grows past it: once full, the
+ * pairs are sorted and counted into a run of FrozenEdge spilled to a
+ * temporary file. Every BULK_MERGE_WAYS runs of the same level are merged
+ * into one run of the next level, and the last runs are merged straight into
+ * the model file, so only the words are kept in memory.
+ */
+typedef struct BulkBuilder {
+    StringTable *words; // null separated, by id
+    uint64_t *pairs; // id_1 in the high half, id_2 in the low one
+    size_t num_of_pairs;
+    size_t pairs_capacity;
+    int num_of_threads; // sorting threads
+    size_t max_pairs; // pairs kept before spilling a run, 0 for no limit
+    FILE **runs; // temporary files of FrozenEdge, sorted by (from, to)
+    int *run_levels; // number of merges that made each run
+    int num_of_runs;
+    int runs_capacity;
+} BulkBuilder;
+
+/**
+ * Initialize and Allocate new BulkBuilder
+ * @param num_of_threads number of sorting threads
+ * @param memory_budget bytes the pairs may use before being spilled to
+ * temporary files, 0 to keep them all in memory
+ * @return BulkBuilder pointer, NULL in case of memory allocation failure
+ * @ownership Weak Ownership. separate function for Free (free_bulk_builder)
+ */
+BulkBuilder* new_bulk_builder(int num_of_threads, size_t memory_budget);
+
+/**
+ * Read a word, and the link to it from the word before it if there is one.
+ * @param builder
+ * @param prev id of the word before, BULK_NO_WORD if none
+ * @param word bytes of the word, no null needed
+ * @param length number of bytes, the word ending at the first null among
+ * them as it does for a MarkovChain
+ * @return id of the word, BULK_ERROR in case of memory allocation failure
+ * or if a run could not be spilled
+ */
+int bulk_observe(BulkBuilder *builder, int prev, const char *word,
+                 size_t length);
+
+/**
+ * Sort and count the links read, and build the FrozenChain of the words.
+ * The pairs are consumed: the builder reads no more words afterwards.
+ * Only for a builder with no memory budget, see write_bulk_model otherwise.
+ * @param builder
+ * @param max_error maximal relative error of a stored frequency, 0 for
+ * exact frequencies
+ * @param print_func print function of the words
+ * @return FrozenChain pointer, NULL in case of memory allocation failure
+ * @ownership Weak Ownership. separate function for Free (free_frozen_chain)
+ */
+FrozenChain* build_bulk_chain(BulkBuilder *builder, double max_error,
+                              void (*print_func)(void*));
+
+/**
+ * Sort and count the links read, merge them with the spilled runs and write
+ * the frozen model of the words, as save_frozen_chain would write the chain
+ * build_bulk_chain builds. The pairs and runs are consumed.
+ * @param builder
+ * @param max_error maximal relative error of a stored frequency, 0 for
+ * exact frequencies
+ * @param fp file opened for binary writing
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+int write_bulk_model(BulkBuilder *builder, double max_error, FILE *fp);
+
+/**
+ * Free builder and all of it's content from memory
+ * @param builder_p builder to free
+ */
+void free_bulk_builder(BulkBuilder **builder_p);
+
+#endif /* _BULK_BUILDER_H */
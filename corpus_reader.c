@@ -0,0 +1,530 @@
+#include "corpus_reader.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#define ALLOC_ERROR_CORPUS_READER \
+"Allocation failure: Alloc of new CorpusReader failed.\n"
+#define ALLOC_ERROR_CORPUS_BUFFER \
+"Allocation failure: Alloc of decompression buffer failed.\n"
+#define ALLOC_ERROR_LINE "Allocation failure: Alloc of line buffer failed.\n"
+#define THREAD_ERROR "ERROR: problem with starting decompression.\n"
+#define READ_ERROR "ERROR: problem with reading file.\n"
+#define DECOMPRESS_ERROR "ERROR: problem with decompressing file.\n"
+#define ZSTD_ERROR "ERROR: zstd support is not built in (make ZSTD=1).\n"
+
+#define INPUT_BUFFER_SIZE (1 << 18)
+#define GZIP_WINDOW_BITS (15 + 16) // maximal window, gzip header expected
+
+static const unsigned char gzip_magic[] = {0x1f, 0x8b};
+static const unsigned char zstd_magic[] = {0x28, 0xb5, 0x2f, 0xfd};
+
+/**
+ * @return true if the first bytes of the corpus are the given magic
+ */
+static bool has_magic(CorpusReader *reader, const unsigned char *magic,
+                      size_t length)
+{
+  return reader->magic_length >= length
+         && memcmp (reader->magic, magic, length) == 0;
+}
+
+/**
+ * Read raw bytes of the file, starting with the magic bytes read for
+ * detection.
+ * @return number of bytes read, 0 at end of file
+ */
+static size_t read_raw(CorpusReader *reader, char *buffer, size_t capacity)
+{
+  size_t length = reader->magic_length - reader->magic_position;
+  length = length < capacity ? length : capacity;
+  memcpy (buffer, reader->magic + reader->magic_position, length);
+  reader->magic_position += length;
+  return length + fread (buffer + length, 1, capacity - length, reader->fp);
+}
+
+/**
+ * Wait for an empty buffer of the ring.
+ * @return the buffer to fill, NULL if the caller stopped reading
+ */
+static char* acquire_buffer(CorpusReader *reader)
+{
+  pthread_mutex_lock (&reader->lock);
+  while (reader->filled == CORPUS_BUFFERS && !reader->closing)
+    {
+      pthread_cond_wait (&reader->changed, &reader->lock);
+    }
+  char *buffer = NULL;
+  if (!reader->closing)
+    {
+      buffer = reader->buffers[(reader->first + reader->filled)
+                               % CORPUS_BUFFERS];
+    }
+  pthread_mutex_unlock (&reader->lock);
+  return buffer;
+}
+
+/**
+ * Hand the buffer returned by acquire_buffer to the consumer.
+ */
+static void publish_buffer(CorpusReader *reader, size_t length)
+{
+  pthread_mutex_lock (&reader->lock);
+  reader->lengths[(reader->first + reader->filled) % CORPUS_BUFFERS] = length;
+  reader->filled++;
+  pthread_cond_broadcast (&reader->changed);
+  pthread_mutex_unlock (&reader->lock);
+}
+
+/**
+ * Inflate a gzip corpus, possibly made of several concatenated members.
+ * @return false if the input is corrupted or truncated
+ */
+static bool inflate_gzip(CorpusReader *reader, char *input)
+{
+  z_stream stream;
+  memset (&stream, 0, sizeof (z_stream));
+  if (inflateInit2 (&stream, GZIP_WINDOW_BITS) != Z_OK)
+    {
+      return false;
+    }
+  bool success = true, stream_end = false;
+  char *output = acquire_buffer (reader);
+  stream.next_out = (Bytef*) output;
+  stream.avail_out = CORPUS_BUFFER_SIZE;
+  while (output != NULL)
+    {
+      if (stream.avail_in == 0)
+        {
+          stream.next_in = (Bytef*) input;
+          stream.avail_in = (uInt) read_raw (reader, input, INPUT_BUFFER_SIZE);
+          if (stream.avail_in == 0)
+            {
+              success = stream_end && !ferror (reader->fp);
+              break;
+            }
+        }
+      int result = inflate (&stream, Z_NO_FLUSH);
+      stream_end = result == Z_STREAM_END;
+      if (stream_end)
+        {
+          inflateReset (&stream); // the next member, if any
+        }
+      else if (result != Z_OK && result != Z_BUF_ERROR)
+        {
+          success = false;
+          break;
+        }
+      if (stream.avail_out == 0)
+        {
+          publish_buffer (reader, CORPUS_BUFFER_SIZE);
+          output = acquire_buffer (reader);
+          stream.next_out = (Bytef*) output;
+          stream.avail_out = CORPUS_BUFFER_SIZE;
+        }
+    }
+  if (output != NULL && stream.avail_out < CORPUS_BUFFER_SIZE)
+    {
+      publish_buffer (reader, CORPUS_BUFFER_SIZE - stream.avail_out);
+    }
+  inflateEnd (&stream);
+  return success;
+}
+
+#ifdef HAVE_ZSTD
+/**
+ * Decompress a zstd corpus, possibly made of several frames.
+ * @return false if the input is corrupted or truncated
+ */
+static bool decompress_zstd(CorpusReader *reader, char *input)
+{
+  ZSTD_DStream *stream = ZSTD_createDStream ();
+  if (stream == NULL)
+    {
+      return false;
+    }
+  ZSTD_initDStream (stream);
+  bool success = true;
+  size_t hint = 1; // 0 once a frame is complete
+  char *output = acquire_buffer (reader);
+  ZSTD_inBuffer in = {input, 0, 0};
+  ZSTD_outBuffer out = {output, CORPUS_BUFFER_SIZE, 0};
+  while (output != NULL)
+    {
+      if (in.pos == in.size)
+        {
+          in.size = read_raw (reader, input, INPUT_BUFFER_SIZE);
+          in.pos = 0;
+          if (in.size == 0)
+            {
+              success = hint == 0 && !ferror (reader->fp);
+              break;
+            }
+        }
+      hint = ZSTD_decompressStream (stream, &out, &in);
+      if (ZSTD_isError (hint))
+        {
+          success = false;
+          break;
+        }
+      if (out.pos == out.size)
+        {
+          publish_buffer (reader, out.pos);
+          output = acquire_buffer (reader);
+          out.dst = output;
+          out.pos = 0;
+        }
+    }
+  if (output != NULL && out.pos > 0)
+    {
+      publish_buffer (reader, out.pos);
+    }
+  ZSTD_freeDStream (stream);
+  return success;
+}
+#endif
+
+/**
+ * Body of the decompression thread.
+ * @param arg CorpusReader pointer
+ * @return NULL
+ */
+static void* decompress_corpus(void *arg)
+{
+  CorpusReader *reader = arg;
+  char *input = malloc (INPUT_BUFFER_SIZE);
+  bool success = false;
+  if (input == NULL)
+    {
+      printf ("%s", ALLOC_ERROR_CORPUS_BUFFER);
+    }
+  else if (reader->format == CORPUS_GZIP)
+    {
+      success = inflate_gzip (reader, input);
+    }
+#ifdef HAVE_ZSTD
+  else
+    {
+      success = decompress_zstd (reader, input);
+    }
+#endif
+  free (input);
+  pthread_mutex_lock (&reader->lock);
+  reader->finished = true;
+  reader->failed = !success && !reader->closing;
+  pthread_cond_broadcast (&reader->changed);
+  pthread_mutex_unlock (&reader->lock);
+  return NULL;
+}
+
+/**
+ * Free the ring buffers of reader.
+ */
+static void free_buffers(CorpusReader *reader)
+{
+  for (int i = 0; i < CORPUS_BUFFERS; i++)
+    {
+      free (reader->buffers[i]);
+      reader->buffers[i] = NULL;
+    }
+}
+
+/**
+ * Allocate the ring buffers and start the decompression thread.
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+static int start_pipeline(CorpusReader *reader)
+{
+  for (int i = 0; i < CORPUS_BUFFERS; i++)
+    {
+      reader->buffers[i] = malloc (CORPUS_BUFFER_SIZE);
+      if (reader->buffers[i] == NULL)
+        {
+          printf ("%s", ALLOC_ERROR_CORPUS_BUFFER);
+          free_buffers (reader);
+          return EXIT_FAILURE;
+        }
+    }
+  pthread_mutex_init (&reader->lock, NULL);
+  pthread_cond_init (&reader->changed, NULL);
+  if (pthread_create (&reader->worker, NULL, decompress_corpus, reader) != 0)
+    {
+      printf ("%s", THREAD_ERROR);
+      pthread_cond_destroy (&reader->changed);
+      pthread_mutex_destroy (&reader->lock);
+      free_buffers (reader);
+      return EXIT_FAILURE;
+    }
+  return EXIT_SUCCESS;
+}
+
+/**
+ * Initialize and Allocate new CorpusReader, detecting the format of fp and
+ * starting the decompression if needed.
+ * @param fp file to read from
+ * @return CorpusReader pointer, NULL in case of memory allocation failure or
+ * unsupported format
+ * @ownership Weak Ownership. separate function for Free (close_corpus)
+ */
+CorpusReader* open_corpus(FILE *fp)
+{
+  CorpusReader *reader = malloc (sizeof (CorpusReader));
+  if (reader == NULL)
+    {
+      printf ("%s", ALLOC_ERROR_CORPUS_READER);
+      return NULL;
+    }
+  memset (reader, 0, sizeof (CorpusReader));
+  reader->fp = fp;
+  reader->magic_length = fread (reader->magic, 1, CORPUS_MAGIC_LENGTH, fp);
+  reader->format = CORPUS_PLAIN;
+  if (has_magic (reader, gzip_magic, sizeof (gzip_magic)))
+    {
+      reader->format = CORPUS_GZIP;
+    }
+  else if (has_magic (reader, zstd_magic, sizeof (zstd_magic)))
+    {
+      reader->format = CORPUS_ZSTD;
+#ifndef HAVE_ZSTD
+      printf ("%s", ZSTD_ERROR);
+      free (reader);
+      return NULL;
+#endif
+    }
+  if (reader->format != CORPUS_PLAIN
+      && start_pipeline (reader) == EXIT_FAILURE)
+    {
+      free (reader);
+      return NULL;
+    }
+  return reader;
+}
+
+/**
+ * Initialize and Allocate new CorpusReader over bytes already in memory.
+ * @param data plain corpus bytes, must outlive the reader
+ * @param length number of bytes
+ * @return CorpusReader pointer, NULL in case of memory allocation failure
+ * @ownership Weak Ownership. separate function for Free (close_corpus)
+ */
+CorpusReader* open_corpus_buffer(const char *data, size_t length)
+{
+  CorpusReader *reader = malloc (sizeof (CorpusReader));
+  if (reader == NULL)
+    {
+      printf ("%s", ALLOC_ERROR_CORPUS_READER);
+      return NULL;
+    }
+  memset (reader, 0, sizeof (CorpusReader));
+  reader->format = CORPUS_BUFFER;
+  reader->data = data;
+  reader->data_length = length;
+  return reader;
+}
+
+/**
+ * Read up to capacity decompressed bytes.
+ * @param reader
+ * @param buffer out param
+ * @param capacity size of buffer
+ * @param length_p out param, number of bytes read, 0 at end of corpus
+ * @return EXIT_SUCCESS or EXIT_FAILURE in case of read or decompression error
+ */
+int read_corpus(CorpusReader *reader, char *buffer, size_t capacity,
+                size_t *length_p)
+{
+  if (reader->format == CORPUS_BUFFER)
+    {
+      size_t length = reader->data_length - reader->position;
+      length = length < capacity ? length : capacity;
+      if (length > 0)
+        {
+          memcpy (buffer, reader->data + reader->position, length);
+        }
+      reader->position += length;
+      *length_p = length;
+      return EXIT_SUCCESS;
+    }
+  if (reader->format == CORPUS_PLAIN)
+    {
+      *length_p = read_raw (reader, buffer, capacity);
+      if (ferror (reader->fp))
+        {
+          printf ("%s", READ_ERROR);
+          return EXIT_FAILURE;
+        }
+      return EXIT_SUCCESS;
+    }
+  size_t length = 0;
+  pthread_mutex_lock (&reader->lock);
+  while (length < capacity)
+    {
+      while (reader->filled == 0 && !reader->finished)
+        {
+          pthread_cond_wait (&reader->changed, &reader->lock);
+        }
+      if (reader->filled == 0)
+        {
+          break;
+        }
+      // the oldest filled buffer belongs to the consumer, copy it unlocked
+      char *source = reader->buffers[reader->first] + reader->position;
+      size_t available = reader->lengths[reader->first] - reader->position;
+      size_t copied = available < capacity - length ?
+                      available : capacity - length;
+      pthread_mutex_unlock (&reader->lock);
+      memcpy (buffer + length, source, copied);
+      length += copied;
+      pthread_mutex_lock (&reader->lock);
+      reader->position += copied;
+      if (reader->position == reader->lengths[reader->first])
+        {
+          reader->first = (reader->first + 1) % CORPUS_BUFFERS;
+          reader->filled--;
+          reader->position = 0;
+          pthread_cond_broadcast (&reader->changed);
+        }
+    }
+  bool failed = reader->filled == 0 && reader->failed;
+  pthread_mutex_unlock (&reader->lock);
+  *length_p = length;
+  if (failed && length == 0)
+    {
+      printf ("%s", DECOMPRESS_ERROR);
+      return EXIT_FAILURE;
+    }
+  return EXIT_SUCCESS;
+}
+
+/**
+ * Append bytes to the line cut by the end of a block, keeping it null
+ * terminated
+ * @return false in case of memory allocation failure
+ */
+static bool append_to_line(char **line_p, size_t *length_p,
+                           size_t *capacity_p, const char *bytes,
+                           size_t length)
+{
+  if (*length_p + length + 1 > *capacity_p)
+    {
+      size_t capacity = *capacity_p == 0 ? CORPUS_BUFFER_SIZE : *capacity_p;
+      while (capacity < *length_p + length + 1)
+        {
+          capacity *= 2;
+        }
+      char *line = realloc (*line_p, capacity);
+      if (line == NULL)
+        {
+          printf ("%s", ALLOC_ERROR_LINE);
+          return false;
+        }
+      *line_p = line;
+      *capacity_p = capacity;
+    }
+  memcpy (*line_p + *length_p, bytes, length);
+  *length_p += length;
+  (*line_p)[*length_p] = '\0';
+  return true;
+}
+
+/**
+ * Read the corpus line by line, up to it's end or until line_func stops it.
+ * @param reader
+ * @param line_func called with every line, null terminated in place of it's
+ * new line, returns CORPUS_LINE_NEXT, CORPUS_LINE_STOP or CORPUS_LINE_ERROR
+ * @param arg passed to line_func
+ * @return EXIT_SUCCESS or EXIT_FAILURE in case of read error, memory
+ * allocation failure or line_func error
+ */
+int read_corpus_lines(CorpusReader *reader,
+                      int (*line_func)(char *line, size_t length, void *arg),
+                      void *arg)
+{
+  char *block = malloc (CORPUS_BUFFER_SIZE);
+  if (block == NULL)
+    {
+      printf ("%s", ALLOC_ERROR_LINE);
+      return EXIT_FAILURE;
+    }
+  char *carry = NULL; // beginning of a line cut by the end of a block
+  size_t carry_length = 0, carry_capacity = 0, length = 0;
+  int status = CORPUS_LINE_NEXT;
+  while (status == CORPUS_LINE_NEXT)
+    {
+      if (read_corpus (reader, block, CORPUS_BUFFER_SIZE, &length)
+          == EXIT_FAILURE)
+        {
+          status = CORPUS_LINE_ERROR;
+          break;
+        }
+      if (length == 0)
+        {
+          break;
+        }
+      char *start = block, *end = block + length, *new_line;
+      while (status == CORPUS_LINE_NEXT
+             && (new_line = memchr (start, '\n', end - start)) != NULL)
+        {
+          *new_line = '\0';
+          if (carry_length == 0)
+            {
+              status = line_func (start, new_line - start, arg);
+            }
+          else if (append_to_line (&carry, &carry_length, &carry_capacity,
+                                   start, new_line - start))
+            {
+              status = line_func (carry, carry_length, arg);
+              carry_length = 0;
+            }
+          else
+            {
+              status = CORPUS_LINE_ERROR;
+            }
+          start = new_line + 1;
+        }
+      if (status == CORPUS_LINE_NEXT && start < end
+          && !append_to_line (&carry, &carry_length, &carry_capacity, start,
+                              end - start))
+        {
+          status = CORPUS_LINE_ERROR;
+        }
+    }
+  if (status == CORPUS_LINE_NEXT && carry_length > 0)
+    {
+      status = line_func (carry, carry_length, arg); // no final new line
+    }
+  free (carry);
+  free (block);
+  return status == CORPUS_LINE_ERROR ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/**
+ * Stop the decompression and free reader and all of it's content from memory.
+ * The file itself is not closed.
+ * @param reader_p reader to close
+ */
+void close_corpus(CorpusReader **reader_p)
+{
+  CorpusReader *reader = *reader_p;
+  if (reader == NULL)
+    {
+      return;
+    }
+  if (reader->format == CORPUS_GZIP || reader->format == CORPUS_ZSTD)
+    {
+      pthread_mutex_lock (&reader->lock);
+      reader->closing = true;
+      pthread_cond_broadcast (&reader->changed);
+      pthread_mutex_unlock (&reader->lock);
+      pthread_join (reader->worker, NULL);
+      pthread_cond_destroy (&reader->changed);
+      pthread_mutex_destroy (&reader->lock);
+      free_buffers (reader);
+    }
+  free (reader);
+  *reader_p = NULL;
+}
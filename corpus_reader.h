@@ -0,0 +1,106 @@
+#ifndef _CORPUS_READER_H
+#define _CORPUS_READER_H
+
+#include <stdio.h>  // For FILE
+#include <stdlib.h> // For size_t
+#include <stdbool.h> // for bool
+#include <pthread.h> // For pthread_t
+
+#define CORPUS_PLAIN 0
+#define CORPUS_GZIP 1
+#define CORPUS_ZSTD 2
+#define CORPUS_BUFFER 3 // bytes already in memory
+
+#define CORPUS_LINE_NEXT 0
+#define CORPUS_LINE_STOP 1
+#define CORPUS_LINE_ERROR 2
+
+#define CORPUS_MAGIC_LENGTH 4
+#define CORPUS_BUFFERS 4
+#define CORPUS_BUFFER_SIZE (1 << 20)
+
+/***************************/
+/*        STRUCTS          */
+/***************************/
+
+/**
+ * Reads the bytes of a corpus file, plain or compressed with gzip or zstd.
+ * The format is detected from the first bytes, so pipes work too.
+ * A compressed corpus is decompressed by a worker thread into a ring of
+ * CORPUS_BUFFERS fixed-size buffers, while the reader's caller consumes the
+ * buffers already filled.
+ */
+typedef struct CorpusReader {
+    FILE *fp; // not owned by the reader
+    int format;
+    char magic[CORPUS_MAGIC_LENGTH]; // first bytes, read for detection
+    size_t magic_length;
+    size_t magic_position; // magic bytes already given back
+    const char *data; // CORPUS_BUFFER bytes, not owned by the reader
+    size_t data_length;
+
+    // decompression pipeline, used by compressed formats only
+    pthread_t worker;
+    pthread_mutex_t lock;
+    pthread_cond_t changed; // a buffer was filled or emptied
+    char *buffers[CORPUS_BUFFERS];
+    size_t lengths[CORPUS_BUFFERS];
+    int first; // oldest filled buffer
+    int filled; // number of filled buffers
+    size_t position; // bytes of the oldest buffer (or of data) consumed
+    bool finished; // the worker filled it's last buffer
+    bool failed; // the worker met a corrupted or truncated input
+    bool closing; // the caller stopped reading
+} CorpusReader;
+
+/**
+ * Initialize and Allocate new CorpusReader, detecting the format of fp and
+ * starting the decompression if needed.
+ * @param fp file to read from
+ * @return CorpusReader pointer, NULL in case of memory allocation failure or
+ * unsupported format
+ * @ownership Weak Ownership. separate function for Free (close_corpus)
+ */
+CorpusReader* open_corpus(FILE *fp);
+
+/**
+ * Initialize and Allocate new CorpusReader over bytes already in memory.
+ * @param data plain corpus bytes, must outlive the reader
+ * @param length number of bytes
+ * @return CorpusReader pointer, NULL in case of memory allocation failure
+ * @ownership Weak Ownership. separate function for Free (close_corpus)
+ */
+CorpusReader* open_corpus_buffer(const char *data, size_t length);
+
+/**
+ * Read up to capacity decompressed bytes.
+ * @param reader
+ * @param buffer out param
+ * @param capacity size of buffer
+ * @param length_p out param, number of bytes read, 0 at end of corpus
+ * @return EXIT_SUCCESS or EXIT_FAILURE in case of read or decompression error
+ */
+int read_corpus(CorpusReader *reader, char *buffer, size_t capacity,
+                size_t *length_p);
+
+/**
+ * Read the corpus line by line, up to it's end or until line_func stops it.
+ * @param reader
+ * @param line_func called with every line, null terminated in place of it's
+ * new line, returns CORPUS_LINE_NEXT, CORPUS_LINE_STOP or CORPUS_LINE_ERROR
+ * @param arg passed to line_func
+ * @return EXIT_SUCCESS or EXIT_FAILURE in case of read error, memory
+ * allocation failure or line_func error
+ */
+int read_corpus_lines(CorpusReader *reader,
+                      int (*line_func)(char *line, size_t length, void *arg),
+                      void *arg);
+
+/**
+ * Stop the decompression and free reader and all of it's content from memory.
+ * The file itself is not closed.
+ * @param reader_p reader to close
+ */
+void close_corpus(CorpusReader **reader_p);
+
+#endif /* _CORPUS_READER_H */
@@ -2945,7 +2945,7 @@ static void string_to_file(char* data, char* path)
  */
 static int do_diff(char* path1, char* path2, char* diff_path)
 {
-    char diff_command[154] = {0};
+    char diff_command[256] = {0};
     struct stat diff_stat;
     
     sprintf(diff_command, "diff -a -u --color=always %s %s |perl /usr/share/doc/git/contrib/diff-highlight/diff-highlight > %s", path1, path2, diff_path);
@@ -3219,12 +3219,1424 @@ static MunitTest memory_tests[] = {
     {NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL}};
 
 
+#ifdef TWEETS
+#include "tokenizer.h"
+#include "corpus_reader.h"
+#include "frozen_chain.h"
+#include <zlib.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#define TSV_FILE_TEMPLATE TEMP_FILE_TEMPLATE ".tsv"
+#define TSV_FILE_SUFFIX_LENGTH 4
+#define LONG_WORD_LENGTH (TOKENIZER_BLOCK_SIZE + 12345)
+#define CORPUS_CAPACITY (4 * TOKENIZER_BLOCK_SIZE)
+#define CLASSIFY_TEST_LENGTHS 200 // past three words of the bitmap
+#define PIPE_TEST_CHUNK 1000 // bytes of every write to a pipe
+#define SHARD_TEST_SHARDS 3
+#define SPILL_TEST_COPIES 70 // over BULK_MERGE_WAYS runs of a megabyte
+#define LOOKUP_TEST_WORDS 3000
+#define LOOKUP_TEST_HASHES 5
+#define ENDINGS_TEST_CORPUS "a b.\na c\nc a\nc d\n"
+#define ENDINGS_TEST_HEADER "Start words likeliest to be cut:\n" \
+    "Word\tEnds a sentence\tEnds\tExpected words\n"
+#define ENDINGS_TEST_ALL "Tweets of at most 4 words: 0.437500 end a " \
+    "sentence, 0.437500 end with no more words, 0.125000 are cut, " \
+    "2.750000 words expected\n" ENDINGS_TEST_HEADER \
+    "a\t0.625000\t0.875000\t2.750000\n" \
+    "c\t0.250000\t0.875000\t2.750000\n"
+#define ENDINGS_TEST_FIRST "Tweets of at most 4 words: 0.625000 end a " \
+    "sentence, 0.250000 end with no more words, 0.125000 are cut, " \
+    "2.750000 words expected\n" ENDINGS_TEST_HEADER \
+    "a\t0.625000\t0.875000\t2.750000\n"
+#endif
+#ifdef SNAKE
+#include "transition_matrix.h"
+#include "simulation.h"
+#include "int_chain.h"
+
+#define STEP_TEST_STATES 40
+#define STEP_TEST_STEPS 1000
+#define DEFAULT_BOARD_SUMMARY \
+    "Expected rolls from cell 1 to cell 100: 39.500822\n"
+#define DEFAULT_BOARD_ROLLS 39.500822
+#define SIMULATION_TEST_GAMES "20000"
+#define SIMULATION_LINE_LENGTH 200
+#define LANES_TEST_CELLS 11
+#define LANES_TEST_GAMES (1000 * SIMULATION_LANES + 5)
+#define INT_CHAIN_TEST_STATES 5
+#define STATIONARY_TEST_STATES 3
+#endif
+
+/**
+ * @brief create an empty temporary file and return it's path via path
+ *
+ * @param path
+ */
+static void new_temp_file(char* path)
+{
+    strcpy(path, TEMP_FILE_TEMPLATE);
+    int fd = mkstemp(path);
+    close(fd);
+}
+
+/**
+ * @brief run main with a NULL terminated argv into a new temporary file
+ *
+ * @param argv
+ * @param stdout_path out param, path of the file
+ * @return int exit code of main
+ */
+static int run_args_into_file(const char** argv, char* stdout_path)
+{
+    char argc[16] = {0};
+    int count = 0;
+    while(argv[count] != NULL)
+    {
+        count++;
+    }
+    sprintf(argc, "%d", count);
+    new_temp_file(stdout_path);
+    return run_main_into_file(argc, (const char*)argv, stdout_path);
+}
+
+/**
+ * @brief diff two files, printing the diff if they differ
+ *
+ * @return MunitResult MUNIT_OK if the files are the same
+ */
+static MunitResult diff_files(char* expected_path, char* actual_path)
+{
+    char diff_path[RANDOM_FILE_PATH_LENGTH] = {0};
+    MunitResult result = MUNIT_OK;
+    new_temp_file(diff_path);
+    if(do_diff(expected_path, actual_path, diff_path) > 0)
+    {
+        putchar('\n');
+        print_file(diff_path);
+        printf("expected: %s, actual: %s\n", expected_path, actual_path);
+        result = MUNIT_FAIL;
+    }
+    unlink(diff_path);
+    return result;
+}
+
+#ifdef TWEETS
+/**
+ * @brief append a word and a delimiter to the corpus
+ */
+static void add_corpus_word(char* corpus, size_t* length, const char* word,
+                            char delimiter)
+{
+    size_t word_length = strlen(word);
+    memcpy(corpus + *length, word, word_length);
+    *length += word_length;
+    corpus[(*length)++] = delimiter;
+}
+
+/**
+ * @brief build a corpus of words cut by the ends of the tokenizer's blocks,
+ * a dot right before the end of a block, and a line longer than two blocks
+ * with a word longer than a block in it
+ *
+ * @param length out param
+ * @return char* the corpus, freed by the caller
+ */
+static char* new_block_corpus(size_t* length)
+{
+    char* corpus = malloc(CORPUS_CAPACITY);
+    char word[32] = {0};
+    *length = 0;
+    for (int i = 0; *length + 32 < TOKENIZER_BLOCK_SIZE - 4; i++)
+    {
+        sprintf(word, i % 7 == 0 ? "w%d." : "w%d", i);
+        add_corpus_word(corpus, length, word, i % 50 == 49 ? '\n' : ' ');
+    }
+    memset(corpus + *length, ' ', TOKENIZER_BLOCK_SIZE - 4 - *length);
+    *length = TOKENIZER_BLOCK_SIZE - 4;
+    add_corpus_word(corpus, length, "crossing.", '\n'); // cut by the block
+    for (int i = 0; *length + 32 < 2 * TOKENIZER_BLOCK_SIZE - 5; i++)
+    {
+        sprintf(word, i % 5 == 0 ? "long%d." : "long%d", i);
+        add_corpus_word(corpus, length, word, ' ');
+    }
+    memset(corpus + *length, ' ', 2 * TOKENIZER_BLOCK_SIZE - 5 - *length);
+    *length = 2 * TOKENIZER_BLOCK_SIZE - 5;
+    add_corpus_word(corpus, length, "edge.", ' '); // dot ends the block
+    memset(corpus + *length, 'x', LONG_WORD_LENGTH - 1);
+    *length += LONG_WORD_LENGTH - 1;
+    add_corpus_word(corpus, length, ".", '\r');
+    add_corpus_word(corpus, length, "", '\n');
+    add_corpus_word(corpus, length, "last", ' ');
+    memcpy(corpus + *length, "line.", 5); // no new line at the end
+    *length += 5;
+    return corpus;
+}
+
+/**
+ * @brief tokens and dot flags of words cut by block ends and on a line
+ * longer than two blocks, against a byte by byte split of the corpus
+ */
+static MunitResult tokenizer_test(const MunitParameter params[], void *fixture)
+{
+    size_t length = 0;
+    char* corpus = new_block_corpus(&length);
+    CorpusReader* reader = open_corpus_buffer(corpus, length);
+    Tokenizer* tokenizer = new_tokenizer(reader);
+    munit_assert_not_null(tokenizer);
+    bool line_start = true;
+    size_t num_of_words = 0;
+    for (size_t begin = 0; begin < length; )
+    {
+        if (is_token_delimiter(corpus[begin]))
+        {
+            line_start = line_start || corpus[begin] == '\n';
+            begin++;
+            continue;
+        }
+        size_t end = begin;
+        while (end < length && !is_token_delimiter(corpus[end]))
+        {
+            end++;
+        }
+        Token token;
+        munit_assert_int(next_token(tokenizer, &token), ==, TOKEN_FOUND);
+        munit_assert_size(token.length, ==, end - begin);
+        munit_assert_memory_equal(token.length, token.word, corpus + begin);
+        munit_assert_int(token.line_start, ==, line_start);
+        munit_assert_int(token.ends_with_dot, ==, corpus[end - 1] == '.');
+        line_start = false;
+        num_of_words++;
+        begin = end;
+    }
+    Token token;
+    munit_assert_int(next_token(tokenizer, &token), ==, TOKEN_END);
+    munit_assert_size(num_of_words, >, 100000);
+    free_tokenizer(&tokenizer);
+    close_corpus(&reader);
+    free(corpus);
+    return MUNIT_OK;
+}
+
+/**
+ * @brief check the delimiter bits of words [from_word, to_word) against
+ * the bytes one by one, the bits past length set
+ */
+static void assert_delimiter_bits(const char* block, size_t length,
+                                  const uint64_t* delimiters,
+                                  size_t from_word, size_t to_word)
+{
+    for (size_t i = from_word * 64; i < to_word * 64; i++)
+    {
+        bool expected = i >= length || is_token_delimiter(block[i]);
+        munit_assert_int((delimiters[i / 64] >> (i % 64)) & 1, ==, expected);
+    }
+}
+
+/**
+ * @brief the bitmap of the classifier the CPU runs, 16 or 32 bytes at a
+ * time, against the bytes one by one, at every length around the vector
+ * widths and the end of a block
+ */
+static MunitResult classify_test(const MunitParameter params[], void *fixture)
+{
+    char* block = malloc(TOKENIZER_BLOCK_SIZE);
+    uint64_t* delimiters = malloc(TOKENIZER_BLOCK_SIZE / 8);
+    for (size_t i = 0; i < TOKENIZER_BLOCK_SIZE; i++)
+    {
+        // every byte value, bytes over 127 too, and many delimiters
+        block[i] = i % 5 == 0 ? " \n\r"[i % 3] : (char)(i * 131 % 256);
+    }
+    CorpusReader* reader = open_corpus_buffer(block, 0);
+    Tokenizer* tokenizer = new_tokenizer(reader);
+    munit_assert_not_null(tokenizer);
+    for (size_t length = 1; length <= CLASSIFY_TEST_LENGTHS; length++)
+    {
+        tokenizer->classify(block, length, delimiters);
+        assert_delimiter_bits(block, length, delimiters, 0,
+                              (length + 63) / 64);
+    }
+    for (size_t cut = 0; cut <= CLASSIFY_TEST_LENGTHS; cut++)
+    {
+        size_t length = TOKENIZER_BLOCK_SIZE - cut;
+        size_t words = (length + 63) / 64;
+        tokenizer->classify(block, length, delimiters);
+        assert_delimiter_bits(block, length, delimiters, 0, 2);
+        assert_delimiter_bits(block, length, delimiters, words - 3, words);
+    }
+    tokenizer->classify(block, TOKENIZER_BLOCK_SIZE, delimiters);
+    assert_delimiter_bits(block, TOKENIZER_BLOCK_SIZE, delimiters, 0,
+                          TOKENIZER_BLOCK_SIZE / 64);
+    free_tokenizer(&tokenizer);
+    close_corpus(&reader);
+    free(delimiters);
+    free(block);
+    return MUNIT_OK;
+}
+
+/**
+ * @brief write a copy of a file with the middle of it overwritten
+ */
+static void corrupt_file(char* path, char* corrupt_path)
+{
+    FILE* in = fopen(path, "rb");
+    fseek(in, 0, SEEK_END);
+    long size = ftell(in);
+    fseek(in, 0, SEEK_SET);
+    char* data = malloc(size);
+    fread(data, 1, size, in);
+    fclose(in);
+    memset(data + size / 4, 0xff, size / 4);
+    FILE* out = fopen(corrupt_path, "wb");
+    fwrite(data, 1, size, out);
+    fclose(out);
+    free(data);
+}
+
+/**
+ * @brief tweets of a saved model match the ones learned, and a model with
+ * a corrupted body is rejected
+ */
+static MunitResult frozen_model_test(const MunitParameter params[], void *fixture)
+{
+    char model_path[RANDOM_FILE_PATH_LENGTH] = {0};
+    char corrupt_path[RANDOM_FILE_PATH_LENGTH] = {0};
+    char learned_path[RANDOM_FILE_PATH_LENGTH] = {0};
+    char loaded_path[RANDOM_FILE_PATH_LENGTH] = {0};
+    char rejected_path[RANDOM_FILE_PATH_LENGTH] = {0};
+    new_temp_file(model_path);
+    new_temp_file(corrupt_path);
+    const char* save_argv[] = {"", "1", "5", justdoit_tweets_path,
+                               "--save-model", model_path, NULL};
+    const char* load_argv[] = {"", "1", "5", "--load-model", model_path,
+                               NULL};
+    const char* corrupt_argv[] = {"", "1", "5", "--load-model",
+                                  corrupt_path, NULL};
+    munit_assert_int(run_args_into_file(save_argv, learned_path), ==,
+                     EXIT_SUCCESS);
+    munit_assert_int(run_args_into_file(load_argv, loaded_path), ==,
+                     EXIT_SUCCESS);
+    MunitResult result = diff_files(learned_path, loaded_path);
+    corrupt_file(model_path, corrupt_path);
+    munit_assert_int(run_args_into_file(corrupt_argv, rejected_path), ==,
+                     EXIT_FAILURE);
+    unlink(model_path);
+    unlink(corrupt_path);
+    unlink(learned_path);
+    unlink(loaded_path);
+    unlink(rejected_path);
+    return result;
+}
+
+/**
+ * @brief export bigram counts, import them and export them again
+ *
+ * @param text true for the tsv format
+ * @return MunitResult MUNIT_OK if both exports and the tweets are the same
+ */
+static MunitResult bigram_round_trip(bool text)
+{
+    char exported_path[sizeof(TSV_FILE_TEMPLATE)] = {0};
+    char reexported_path[sizeof(TSV_FILE_TEMPLATE)] = {0};
+    char learned_path[RANDOM_FILE_PATH_LENGTH] = {0};
+    char imported_path[RANDOM_FILE_PATH_LENGTH] = {0};
+    strcpy(exported_path, text ? TSV_FILE_TEMPLATE : TEMP_FILE_TEMPLATE);
+    strcpy(reexported_path, exported_path);
+    int suffix_length = text ? TSV_FILE_SUFFIX_LENGTH : 0;
+    close(mkstemps(exported_path, suffix_length));
+    close(mkstemps(reexported_path, suffix_length));
+    const char* export_argv[] = {"", "1", "5", justdoit_tweets_path,
+                                 "--export-counts", exported_path, NULL};
+    const char* import_argv[] = {"", "1", "5", "--import-counts",
+                                 exported_path, "--export-counts",
+                                 reexported_path, NULL};
+    munit_assert_int(run_args_into_file(export_argv, learned_path), ==,
+                     EXIT_SUCCESS);
+    munit_assert_int(run_args_into_file(import_argv, imported_path), ==,
+                     EXIT_SUCCESS);
+    MunitResult result = diff_files(exported_path, reexported_path);
+    if (result == MUNIT_OK)
+    {
+        result = diff_files(learned_path, imported_path);
+    }
+    unlink(exported_path);
+    unlink(reexported_path);
+    unlink(learned_path);
+    unlink(imported_path);
+    return result;
+}
+
+static MunitResult bigram_tsv_test(const MunitParameter params[], void *fixture)
+{
+    return bigram_round_trip(true);
+}
+
+static MunitResult bigram_binary_test(const MunitParameter params[], void *fixture)
+{
+    return bigram_round_trip(false);
+}
+
+/**
+ * @brief --dedup learns the same counts as a plain run
+ */
+static MunitResult dedup_test(const MunitParameter params[], void *fixture)
+{
+    char plain_path[sizeof(TSV_FILE_TEMPLATE)] = {0};
+    char dedup_path[sizeof(TSV_FILE_TEMPLATE)] = {0};
+    char plain_tweets_path[RANDOM_FILE_PATH_LENGTH] = {0};
+    char dedup_tweets_path[RANDOM_FILE_PATH_LENGTH] = {0};
+    strcpy(plain_path, TSV_FILE_TEMPLATE);
+    strcpy(dedup_path, TSV_FILE_TEMPLATE);
+    close(mkstemps(plain_path, TSV_FILE_SUFFIX_LENGTH));
+    close(mkstemps(dedup_path, TSV_FILE_SUFFIX_LENGTH));
+    const char* plain_argv[] = {"", "1", "5", justdoit_tweets_path,
+                                "--export-counts", plain_path, NULL};
+    const char* dedup_argv[] = {"", "1", "5", justdoit_tweets_path, "--dedup",
+                                "--export-counts", dedup_path, NULL};
+    munit_assert_int(run_args_into_file(plain_argv, plain_tweets_path), ==,
+                     EXIT_SUCCESS);
+    munit_assert_int(run_args_into_file(dedup_argv, dedup_tweets_path), ==,
+                     EXIT_SUCCESS);
+    MunitResult result = diff_files(plain_path, dedup_path);
+    unlink(plain_path);
+    unlink(dedup_path);
+    unlink(plain_tweets_path);
+    unlink(dedup_tweets_path);
+    return result;
+}
+
+/**
+ * @brief run main with it's standard input read from a pipe, fed the bytes
+ * of a file in small writes by a child process
+ *
+ * @return int exit code of main
+ */
+static int run_args_piped(const char** argv, const char* input_path,
+                          char* stdout_path)
+{
+    int fds[2];
+    munit_assert_int(pipe(fds), ==, 0);
+    fflush(stdout);
+    pid_t child = fork();
+    munit_assert_int(child, >=, 0);
+    if (child == 0)
+    {
+        close(fds[0]);
+        int input = open(input_path, O_RDONLY);
+        char buffer[PIPE_TEST_CHUNK];
+        ssize_t count = 0;
+        while ((count = read(input, buffer, sizeof(buffer))) > 0)
+        {
+            write(fds[1], buffer, count);
+        }
+        _exit(0);
+    }
+    close(fds[1]);
+    int saved = dup(STDIN_FILENO);
+    dup2(fds[0], STDIN_FILENO);
+    close(fds[0]);
+    int result = run_args_into_file(argv, stdout_path);
+    dup2(saved, STDIN_FILENO);
+    close(saved);
+    clearerr(stdin);
+    waitpid(child, NULL, 0);
+    return result;
+}
+
+/**
+ * @brief tweets learned from a pipe on the standard input match the ones
+ * learned from the file
+ */
+static MunitResult stdin_test(const MunitParameter params[], void *fixture)
+{
+    char file_path[RANDOM_FILE_PATH_LENGTH] = {0};
+    char piped_path[RANDOM_FILE_PATH_LENGTH] = {0};
+    const char* file_argv[] = {"", "2", "20", justdoit_tweets_path, NULL};
+    const char* piped_argv[] = {"", "2", "20", "-", NULL};
+    munit_assert_int(run_args_into_file(file_argv, file_path), ==,
+                     EXIT_SUCCESS);
+    munit_assert_int(run_args_piped(piped_argv, justdoit_tweets_path,
+                                    piped_path), ==, EXIT_SUCCESS);
+    MunitResult result = diff_files(file_path, piped_path);
+    unlink(file_path);
+    unlink(piped_path);
+    return result;
+}
+
+/**
+ * @brief read a whole file into memory
+ *
+ * @param size_p out param, number of bytes
+ * @return char* the bytes, freed by the caller
+ */
+static char* read_whole_file(const char* path, size_t* size_p)
+{
+    FILE* in = fopen(path, "rb");
+    fseek(in, 0, SEEK_END);
+    *size_p = (size_t)ftell(in);
+    fseek(in, 0, SEEK_SET);
+    char* data = malloc(*size_p + 1);
+    munit_assert_size(fread(data, 1, *size_p, in), ==, *size_p);
+    fclose(in);
+    return data;
+}
+
+/**
+ * @brief write a copy of a file compressed with gzip, or with zstd
+ */
+static void compress_file(const char* path, const char* compressed_path,
+                          int format)
+{
+    size_t size = 0;
+    char* data = read_whole_file(path, &size);
+    if (format == CORPUS_GZIP)
+    {
+        gzFile out = gzopen(compressed_path, "wb");
+        munit_assert_int(gzwrite(out, data, (unsigned)size), ==, (int)size);
+        gzclose(out);
+    }
+#ifdef HAVE_ZSTD
+    else
+    {
+        size_t bound = ZSTD_compressBound(size);
+        char* compressed = malloc(bound);
+        size_t length = ZSTD_compress(compressed, bound, data, size, 3);
+        munit_assert_false(ZSTD_isError(length));
+        FILE* out = fopen(compressed_path, "wb");
+        fwrite(compressed, 1, length, out);
+        fclose(out);
+        free(compressed);
+    }
+#endif
+    free(data);
+}
+
+/**
+ * @brief learn from a compressed copy of the tweets, from it's file and
+ * from a pipe, and from a copy cut in the middle
+ *
+ * @return MunitResult MUNIT_OK if the tweets match the ones of the plain
+ * file and the cut copy is rejected
+ */
+static MunitResult compressed_round_trip(int format)
+{
+    char compressed_path[RANDOM_FILE_PATH_LENGTH] = {0};
+    char plain_path[RANDOM_FILE_PATH_LENGTH] = {0};
+    char file_path[RANDOM_FILE_PATH_LENGTH] = {0};
+    char piped_path[RANDOM_FILE_PATH_LENGTH] = {0};
+    char truncated_path[RANDOM_FILE_PATH_LENGTH] = {0};
+    new_temp_file(compressed_path);
+    compress_file(justdoit_tweets_path, compressed_path, format);
+    const char* plain_argv[] = {"", "3", "20", justdoit_tweets_path, NULL};
+    const char* file_argv[] = {"", "3", "20", compressed_path, NULL};
+    const char* piped_argv[] = {"", "3", "20", "-", NULL};
+    munit_assert_int(run_args_into_file(plain_argv, plain_path), ==,
+                     EXIT_SUCCESS);
+    munit_assert_int(run_args_into_file(file_argv, file_path), ==,
+                     EXIT_SUCCESS);
+    munit_assert_int(run_args_piped(piped_argv, compressed_path,
+                                    piped_path), ==, EXIT_SUCCESS);
+    MunitResult result = diff_files(plain_path, file_path);
+    if (result == MUNIT_OK)
+    {
+        result = diff_files(plain_path, piped_path);
+    }
+    struct stat status;
+    stat(compressed_path, &status);
+    truncate(compressed_path, status.st_size / 2);
+    munit_assert_int(run_args_into_file(file_argv, truncated_path), ==,
+                     EXIT_FAILURE);
+    unlink(compressed_path);
+    unlink(plain_path);
+    unlink(file_path);
+    unlink(piped_path);
+    unlink(truncated_path);
+    return result;
+}
+
+static MunitResult gzip_test(const MunitParameter params[], void *fixture)
+{
+    return compressed_round_trip(CORPUS_GZIP);
+}
+
+/**
+ * @brief zstd corpora are read like gzip ones if built in, and rejected
+ * otherwise
+ */
+static MunitResult zstd_test(const MunitParameter params[], void *fixture)
+{
+#ifdef HAVE_ZSTD
+    return compressed_round_trip(CORPUS_ZSTD);
+#else
+    char zstd_path[RANDOM_FILE_PATH_LENGTH] = {0};
+    char rejected_path[RANDOM_FILE_PATH_LENGTH] = {0};
+    const unsigned char frame[] = {0x28, 0xb5, 0x2f, 0xfd, 0, 0, 0, 0};
+    new_temp_file(zstd_path);
+    FILE* out = fopen(zstd_path, "wb");
+    fwrite(frame, 1, sizeof(frame), out);
+    fclose(out);
+    const char* argv[] = {"", "3", "20", zstd_path, NULL};
+    munit_assert_int(run_args_into_file(argv, rejected_path), ==,
+                     EXIT_FAILURE);
+    unlink(zstd_path);
+    unlink(rejected_path);
+    return MUNIT_OK;
+#endif
+}
+
+/**
+ * @brief write bytes [begin, end) of data to a file
+ */
+static void write_file_part(const char* path, const char* data, size_t begin,
+                            size_t end)
+{
+    FILE* out = fopen(path, "wb");
+    fwrite(data + begin, 1, end - begin, out);
+    fclose(out);
+}
+
+/**
+ * @brief the tweets cut into shards in the middle of their lines, written
+ * last shard first, are read in the order of their names, and no word is
+ * linked across two shards: the counts match the ones of the tweets with a
+ * new line at every cut
+ */
+static MunitResult shards_test(const MunitParameter params[], void *fixture)
+{
+    char directory[RANDOM_FILE_PATH_LENGTH] = {0};
+    char shard_paths[SHARD_TEST_SHARDS][RANDOM_FILE_PATH_LENGTH * 2];
+    char joined_path[RANDOM_FILE_PATH_LENGTH] = {0};
+    char sharded_counts[sizeof(TSV_FILE_TEMPLATE)] = {0};
+    char joined_counts[sizeof(TSV_FILE_TEMPLATE)] = {0};
+    char sharded_path[RANDOM_FILE_PATH_LENGTH] = {0};
+    char joined_tweets_path[RANDOM_FILE_PATH_LENGTH] = {0};
+    strcpy(directory, TEMP_FILE_TEMPLATE);
+    munit_assert_not_null(mkdtemp(directory));
+    strcpy(sharded_counts, TSV_FILE_TEMPLATE);
+    strcpy(joined_counts, TSV_FILE_TEMPLATE);
+    close(mkstemps(sharded_counts, TSV_FILE_SUFFIX_LENGTH));
+    close(mkstemps(joined_counts, TSV_FILE_SUFFIX_LENGTH));
+    new_temp_file(joined_path);
+    size_t size = 0;
+    char* data = read_whole_file(justdoit_tweets_path, &size);
+    FILE* joined = fopen(joined_path, "wb");
+    for (int shard = SHARD_TEST_SHARDS - 1; shard >= 0; shard--)
+    {
+        size_t begin = size * shard / SHARD_TEST_SHARDS + (shard > 0);
+        size_t end = size * (shard + 1) / SHARD_TEST_SHARDS + 1;
+        end = end > size ? size : end;
+        sprintf(shard_paths[shard], "%s/shard_%d", directory, shard);
+        write_file_part(shard_paths[shard], data, begin, end);
+    }
+    for (int shard = 0; shard < SHARD_TEST_SHARDS; shard++)
+    {
+        size_t begin = size * shard / SHARD_TEST_SHARDS + (shard > 0);
+        size_t end = size * (shard + 1) / SHARD_TEST_SHARDS + 1;
+        end = end > size ? size : end;
+        fwrite(data + begin, 1, end - begin, joined);
+        fputc('\n', joined);
+    }
+    fclose(joined);
+    free(data);
+    const char* sharded_argv[] = {"", "1", "1", directory, "--readers", "2",
+                                  "--export-counts", sharded_counts, NULL};
+    const char* joined_argv[] = {"", "1", "1", joined_path, "--export-counts",
+                                 joined_counts, NULL};
+    munit_assert_int(run_args_into_file(sharded_argv, sharded_path), ==,
+                     EXIT_SUCCESS);
+    munit_assert_int(run_args_into_file(joined_argv, joined_tweets_path), ==,
+                     EXIT_SUCCESS);
+    MunitResult result = diff_files(joined_counts, sharded_counts);
+    for (int shard = 0; shard < SHARD_TEST_SHARDS; shard++)
+    {
+        unlink(shard_paths[shard]);
+    }
+    rmdir(directory);
+    unlink(joined_path);
+    unlink(sharded_counts);
+    unlink(joined_counts);
+    unlink(sharded_path);
+    unlink(joined_tweets_path);
+    return result;
+}
+
+/**
+ * @brief every word of a saved model is found by it's perfect hash, and
+ * words not in it are not
+ */
+static MunitResult perfect_hash_test(const MunitParameter params[], void *fixture)
+{
+    char model_path[RANDOM_FILE_PATH_LENGTH] = {0};
+    char learned_path[RANDOM_FILE_PATH_LENGTH] = {0};
+    new_temp_file(model_path);
+    const char* save_argv[] = {"", "1", "1", justdoit_tweets_path,
+                               "--save-model", model_path, NULL};
+    munit_assert_int(run_args_into_file(save_argv, learned_path), ==,
+                     EXIT_SUCCESS);
+    FILE* fp = fopen(model_path, "rb");
+    FrozenChain* frozen_chain = load_frozen_chain(fp, NULL);
+    fclose(fp);
+    munit_assert_not_null(frozen_chain);
+    int num_of_states = (int)frozen_chain->header->num_of_states;
+    munit_assert_int(num_of_states, >, 1000);
+    for (int state = 0; state < num_of_states; state++)
+    {
+        char* word = get_frozen_state(frozen_chain, state);
+        munit_assert_int(find_frozen_state(frozen_chain, word,
+                                           strlen(word) + 1), ==, state);
+        munit_assert_int(find_frozen_state(frozen_chain, word,
+                                           strlen(word)), ==, FROZEN_NO_STATE);
+    }
+    const char* missing = "not-a-word-of-the-tweets";
+    munit_assert_int(find_frozen_state(frozen_chain, missing,
+                                       strlen(missing) + 1), ==,
+                     FROZEN_NO_STATE);
+    free_frozen_chain(&frozen_chain);
+    unlink(model_path);
+    unlink(learned_path);
+    return MUNIT_OK;
+}
+
+/**
+ * @brief size of a string key, terminating null included
+ */
+static size_t key_size(void* key)
+{
+    return strlen(key) + 1;
+}
+
+/**
+ * @brief key hashes differ between seeds, and a set with a key twice has
+ * no perfect hash
+ */
+static MunitResult hash_seeds_test(const MunitParameter params[], void *fixture)
+{
+    char* keys[] = {"just", "do", "it", "do"};
+    PerfectHash hash;
+    munit_assert_uint64(hash_key("just", 4, 0), !=, hash_key("just", 4, 1));
+    munit_assert_true(build_perfect_hash((void**)keys, key_size,
+                                         3, &hash));
+    for (int i = 0; i < 3; i++)
+    {
+        uint64_t key_hash = hash_key(keys[i], key_size(keys[i]), hash.seed);
+        munit_assert_uint64(get_perfect_hash_value(&hash, key_hash), <, 3);
+    }
+    free_perfect_hash(&hash);
+    munit_assert_false(build_perfect_hash((void**)keys, key_size,
+                                          4, &hash));
+    return MUNIT_OK;
+}
+
+/**
+ * @brief tweets served from the model file match the ones of the loaded
+ * model
+ */
+static MunitResult paged_model_test(const MunitParameter params[], void *fixture)
+{
+    char model_path[RANDOM_FILE_PATH_LENGTH] = {0};
+    char learned_path[RANDOM_FILE_PATH_LENGTH] = {0};
+    char loaded_path[RANDOM_FILE_PATH_LENGTH] = {0};
+    char paged_path[RANDOM_FILE_PATH_LENGTH] = {0};
+    new_temp_file(model_path);
+    const char* save_argv[] = {"", "2", "20", justdoit_tweets_path,
+                               "--save-model", model_path, NULL};
+    const char* load_argv[] = {"", "3", "20", "--load-model", model_path,
+                               NULL};
+    const char* paged_argv[] = {"", "3", "20", "--paged-model", model_path,
+                                NULL};
+    munit_assert_int(run_args_into_file(save_argv, learned_path), ==,
+                     EXIT_SUCCESS);
+    munit_assert_int(run_args_into_file(load_argv, loaded_path), ==,
+                     EXIT_SUCCESS);
+    munit_assert_int(run_args_into_file(paged_argv, paged_path), ==,
+                     EXIT_SUCCESS);
+    MunitResult result = diff_files(loaded_path, paged_path);
+    unlink(model_path);
+    unlink(learned_path);
+    unlink(loaded_path);
+    unlink(paged_path);
+    return result;
+}
+
+/**
+ * @brief a model file with links but all of it's totals zero fails to
+ * serve a tweet, rather than drawing start states forever
+ */
+static MunitResult paged_zero_totals_test(const MunitParameter params[], void *fixture)
+{
+    char model_path[RANDOM_FILE_PATH_LENGTH] = {0};
+    char learned_path[RANDOM_FILE_PATH_LENGTH] = {0};
+    char paged_path[RANDOM_FILE_PATH_LENGTH] = {0};
+    new_temp_file(model_path);
+    const char* save_argv[] = {"", "1", "1", justdoit_tweets_path,
+                               "--save-model", model_path, NULL};
+    const char* paged_argv[] = {"", "1", "1", "--paged-model", model_path,
+                                NULL};
+    munit_assert_int(run_args_into_file(save_argv, learned_path), ==,
+                     EXIT_SUCCESS);
+    FrozenHeader header;
+    FILE* fp = fopen(model_path, "r+b");
+    munit_assert_size(fread(&header, sizeof(header), 1, fp), ==, 1);
+    munit_assert_uint64(header.num_of_edges, >, 0);
+    uint32_t* totals = calloc(header.num_of_states, sizeof(uint32_t));
+    fseek(fp, (long)header.totals, SEEK_SET);
+    fwrite(totals, sizeof(uint32_t), header.num_of_states, fp);
+    fclose(fp);
+    free(totals);
+    munit_assert_int(run_args_into_file(paged_argv, paged_path), ==,
+                     EXIT_FAILURE);
+    unlink(model_path);
+    unlink(learned_path);
+    unlink(paged_path);
+    return MUNIT_OK;
+}
+
+/**
+ * @brief load a frozen model file
+ */
+static FrozenChain* load_model_file(const char* path)
+{
+    FILE* fp = fopen(path, "rb");
+    munit_assert_not_null(fp);
+    FrozenChain* frozen_chain = load_frozen_chain(fp, NULL);
+    fclose(fp);
+    munit_assert_not_null(frozen_chain);
+    return frozen_chain;
+}
+
+/**
+ * @brief the chain built in bulk has the states of the learned one, with
+ * the same ids, and every state has the same successors with the same
+ * frequencies, in whatever order
+ */
+static MunitResult bulk_model_test(const MunitParameter params[], void *fixture)
+{
+    char learned_model_path[RANDOM_FILE_PATH_LENGTH] = {0};
+    char bulk_model_path[RANDOM_FILE_PATH_LENGTH] = {0};
+    char learned_path[RANDOM_FILE_PATH_LENGTH] = {0};
+    char bulk_path[RANDOM_FILE_PATH_LENGTH] = {0};
+    new_temp_file(learned_model_path);
+    new_temp_file(bulk_model_path);
+    const char* learned_argv[] = {"", "1", "1", justdoit_tweets_path,
+                                  "--save-model", learned_model_path, NULL};
+    const char* bulk_argv[] = {"", "1", "1", justdoit_tweets_path, "--bulk",
+                               "--save-model", bulk_model_path, NULL};
+    munit_assert_int(run_args_into_file(learned_argv, learned_path), ==,
+                     EXIT_SUCCESS);
+    munit_assert_int(run_args_into_file(bulk_argv, bulk_path), ==,
+                     EXIT_SUCCESS);
+    FrozenChain* learned = load_model_file(learned_model_path);
+    FrozenChain* bulk = load_model_file(bulk_model_path);
+    uint32_t num_of_states = learned->header->num_of_states;
+    munit_assert_uint32(bulk->header->num_of_states, ==, num_of_states);
+    munit_assert_uint64(bulk->header->num_of_edges, ==,
+                        learned->header->num_of_edges);
+    for (uint32_t state = 0; state < num_of_states; state++)
+    {
+        munit_assert_string_equal(get_frozen_state(bulk, (int)state),
+                                  get_frozen_state(learned, (int)state));
+        uint64_t begin = learned->edge_offsets[state];
+        uint64_t end = learned->edge_offsets[state + 1];
+        munit_assert_uint64(bulk->edge_offsets[state], ==, begin);
+        munit_assert_uint64(bulk->edge_offsets[state + 1], ==, end);
+        munit_assert_uint32(bulk->totals[state], ==, learned->totals[state]);
+        for (uint64_t edge = begin; edge < end; edge++)
+        {
+            int successor = get_frozen_successor(learned, edge);
+            uint64_t match = begin;
+            while (match < end && get_frozen_successor(bulk, match) != successor)
+            {
+                match++;
+            }
+            munit_assert_uint64(match, <, end);
+            munit_assert_uint32(get_frozen_frequency(bulk, (int)state, match),
+                                ==, get_frozen_frequency(learned, (int)state,
+                                                         edge));
+        }
+    }
+    free_frozen_chain(&learned);
+    free_frozen_chain(&bulk);
+    unlink(learned_model_path);
+    unlink(bulk_model_path);
+    unlink(learned_path);
+    unlink(bulk_path);
+    return MUNIT_OK;
+}
+
+/**
+ * @brief the model built under a memory budget of a megabyte, from enough
+ * copies of the tweets to spill more runs than are merged at once, is the
+ * same file as the one built in memory, and gives the same tweets
+ */
+static MunitResult spilled_model_test(const MunitParameter params[], void *fixture)
+{
+    char corpus_path[RANDOM_FILE_PATH_LENGTH] = {0};
+    char memory_model_path[RANDOM_FILE_PATH_LENGTH] = {0};
+    char spilled_model_path[RANDOM_FILE_PATH_LENGTH] = {0};
+    char memory_path[RANDOM_FILE_PATH_LENGTH] = {0};
+    char spilled_path[RANDOM_FILE_PATH_LENGTH] = {0};
+    new_temp_file(corpus_path);
+    new_temp_file(memory_model_path);
+    new_temp_file(spilled_model_path);
+    size_t size = 0;
+    char* data = read_whole_file(justdoit_tweets_path, &size);
+    FILE* corpus = fopen(corpus_path, "wb");
+    for (int copy = 0; copy < SPILL_TEST_COPIES; copy++)
+    {
+        fwrite(data, 1, size, corpus);
+        fputc('\n', corpus);
+    }
+    fclose(corpus);
+    free(data);
+    const char* memory_argv[] = {"", "2", "20", corpus_path, "--bulk",
+                                 "--save-model", memory_model_path, NULL};
+    const char* spilled_argv[] = {"", "2", "20", corpus_path,
+                                  "--memory-budget", "1", "--save-model",
+                                  spilled_model_path, NULL};
+    munit_assert_int(run_args_into_file(memory_argv, memory_path), ==,
+                     EXIT_SUCCESS);
+    munit_assert_int(run_args_into_file(spilled_argv, spilled_path), ==,
+                     EXIT_SUCCESS);
+    MunitResult result = diff_files(memory_model_path, spilled_model_path);
+    if (result == MUNIT_OK)
+    {
+        result = diff_files(memory_path, spilled_path);
+    }
+    unlink(corpus_path);
+    unlink(memory_model_path);
+    unlink(spilled_model_path);
+    unlink(memory_path);
+    unlink(spilled_path);
+    return result;
+}
+
+int copied_states = 0;
+int freed_states = 0;
+
+/**
+ * @brief copy_func of the inline states test, counting the copies
+ */
+static void* copy_counted_state(void* state)
+{
+    copied_states++;
+    char* copy = malloc(strlen(state) + 1);
+    return copy == NULL ? NULL : strcpy(copy, state);
+}
+
+/**
+ * @brief free_data of the inline states test, counting the frees
+ */
+static void free_counted_state(void* state)
+{
+    freed_states++;
+    free(state);
+}
+
+/**
+ * @brief a state of MARKOV_INLINE_SIZE bytes is copied inside it's node,
+ * one byte more goes through copy_func and free_data, and both are found
+ * and linked again by their bytes
+ */
+static MunitResult inline_states_test(const MunitParameter params[], void *fixture)
+{
+    char short_word[MARKOV_INLINE_SIZE + 1] = {0};
+    char long_word[MARKOV_INLINE_SIZE + 2] = {0};
+    memset(short_word, 'a', MARKOV_INLINE_SIZE - 1);
+    memset(long_word, 'b', MARKOV_INLINE_SIZE);
+    MarkovChain* markov_chain = new_markov_chain();
+    markov_chain->database = new_linked_list();
+    markov_chain->print_func = NULL;
+    markov_chain->comp_func = (void*) strcmp;
+    markov_chain->free_data = free_counted_state;
+    markov_chain->copy_func = copy_counted_state;
+    markov_chain->is_last = NULL;
+    copied_states = 0;
+    freed_states = 0;
+    MarkovNode* prev = NULL;
+    for (int i = 0; i < 2; i++)
+    {
+        prev = markov_chain_observe_sized(markov_chain, prev, short_word,
+                                          sizeof(short_word) - 1, 1);
+        prev = markov_chain_observe_sized(markov_chain, prev, long_word,
+                                          sizeof(long_word) - 1, 1);
+    }
+    memset(short_word, 'z', MARKOV_INLINE_SIZE - 1);
+    memset(long_word, 'z', MARKOV_INLINE_SIZE);
+    munit_assert_int(markov_chain->database->size, ==, 2);
+    MarkovNode* short_node = markov_chain->database->first->data;
+    MarkovNode* long_node = markov_chain->database->last->data;
+    munit_assert_ptr_equal(short_node->data, short_node->inline_data.bytes);
+    munit_assert_ptr_not_equal(long_node->data, long_node->inline_data.bytes);
+    munit_assert_int(copied_states, ==, 1);
+    munit_assert_size(strspn(short_node->data, "a"), ==,
+                      MARKOV_INLINE_SIZE - 1);
+    munit_assert_size(strlen(short_node->data), ==, MARKOV_INLINE_SIZE - 1);
+    munit_assert_size(strspn(long_node->data, "b"), ==, MARKOV_INLINE_SIZE);
+    munit_assert_size(strlen(long_node->data), ==, MARKOV_INLINE_SIZE);
+    munit_assert_int(short_node->counter_list_length, ==, 1);
+    munit_assert_ptr_equal(short_node->counter_list[0].markov_node,
+                           long_node);
+    munit_assert_int(short_node->counter_list[0].frequency, ==, 2);
+    munit_assert_int(long_node->counter_list_length, ==, 1);
+    munit_assert_ptr_equal(long_node->counter_list[0].markov_node,
+                           short_node);
+    munit_assert_int(long_node->counter_list[0].frequency, ==, 1);
+    free_markov_chain(&markov_chain);
+    munit_assert_int(freed_states, ==, 1);
+    return MUNIT_OK;
+}
+
+MarkovStateIndex lookup_test_index = {0};
+
+#define MARKOV_TEMPLATE_NAME indexed_test
+#define MARKOV_TEMPLATE_TYPE char
+#define MARKOV_TEMPLATE_EQUAL(a, b) (strcmp (a, b) == 0)
+#define MARKOV_TEMPLATE_PRINT(a) printf ("%s", a)
+// few hashes, so most states share their hash with others
+#define MARKOV_TEMPLATE_HASH(a) (strlen (a) % LOOKUP_TEST_HASHES)
+#define MARKOV_TEMPLATE_INDEX(markov_chain) (&lookup_test_index)
+#include "markov_chain_template.h"
+
+#define MARKOV_TEMPLATE_NAME scanned_test
+#define MARKOV_TEMPLATE_TYPE char
+#define MARKOV_TEMPLATE_EQUAL(a, b) (strcmp (a, b) == 0)
+#define MARKOV_TEMPLATE_PRINT(a) printf ("%s", a)
+#include "markov_chain_template.h"
+
+/**
+ * @brief new chain of strings for the lookup test
+ */
+static MarkovChain* new_lookup_test_chain(void)
+{
+    MarkovChain* markov_chain = new_markov_chain();
+    markov_chain->database = new_linked_list();
+    markov_chain->print_func = NULL;
+    markov_chain->comp_func = (void*) strcmp;
+    markov_chain->free_data = free_counted_state;
+    markov_chain->copy_func = copy_counted_state;
+    markov_chain->is_last = NULL;
+    return markov_chain;
+}
+
+/**
+ * @brief the same words learned by the generic functions, by the indexed
+ * ones of markov_chain_template.h (some of them by the generic ones, that
+ * the index catches up with) and by the scanning ones make the same chain
+ */
+static MunitResult template_lookup_test(const MunitParameter params[], void *fixture)
+{
+    MarkovChain* generic = new_lookup_test_chain();
+    MarkovChain* indexed = new_lookup_test_chain();
+    MarkovChain* scanned = new_lookup_test_chain();
+    MarkovNode *generic_prev = NULL, *indexed_prev = NULL, *scanned_prev = NULL;
+    size_t size = 0;
+    char* data = read_whole_file(justdoit_tweets_path, &size);
+    char* word = strtok(data, " \n");
+    for (int i = 0; word != NULL && i < LOOKUP_TEST_WORDS; i++)
+    {
+        size_t word_size = strlen(word) + 1;
+        generic_prev = markov_chain_observe_sized(generic, generic_prev, word,
+                                                  word_size, 1);
+        indexed_prev = i % 7 == 0
+            ? markov_chain_observe_sized(indexed, indexed_prev, word,
+                                         word_size, 1)
+            : indexed_test_observe_sized(indexed, indexed_prev, word,
+                                         word_size, 1);
+        scanned_prev = scanned_test_observe_sized(scanned, scanned_prev, word,
+                                                  word_size, 1);
+        munit_assert_not_null(indexed_prev);
+        munit_assert_not_null(scanned_prev);
+        word = strtok(NULL, " \n");
+    }
+    free(data);
+    munit_assert_null(indexed_test_get_node_from_database(indexed, "#none#"));
+    munit_assert_null(scanned_test_get_node_from_database(scanned, "#none#"));
+    munit_assert_int(indexed->database->size, ==, generic->database->size);
+    munit_assert_int(scanned->database->size, ==, generic->database->size);
+    Node* indexed_node = indexed->database->first;
+    Node* scanned_node = scanned->database->first;
+    for (Node* node = generic->database->first; node != NULL;
+         node = node->next)
+    {
+        MarkovNode* expected = node->data;
+        MarkovNode* others[] = {indexed_node->data, scanned_node->data};
+        munit_assert_ptr_equal(
+            indexed_test_get_node_from_database(indexed, expected->data),
+            indexed_node);
+        for (int i = 0; i < 2; i++)
+        {
+            munit_assert_string_equal(others[i]->data, expected->data);
+            munit_assert_int(others[i]->counter_list_total, ==,
+                             expected->counter_list_total);
+            munit_assert_int(others[i]->counter_list_length, ==,
+                             expected->counter_list_length);
+            for (int j = 0; j < expected->counter_list_length; j++)
+            {
+                munit_assert_int(others[i]->counter_list[j].markov_node->id,
+                                 ==, expected->counter_list[j].markov_node->id);
+                munit_assert_int(others[i]->counter_list[j].frequency, ==,
+                                 expected->counter_list[j].frequency);
+            }
+        }
+        indexed_node = indexed_node->next;
+        scanned_node = scanned_node->next;
+    }
+    free_markov_chain(&generic);
+    free_markov_chain(&indexed);
+    free_markov_chain(&scanned);
+    free_markov_state_index(&lookup_test_index);
+    return MUNIT_OK;
+}
+
+/**
+ * @brief how tweets of at most 4 words end, worked out by hand: from a,
+ * a b. ends a sentence, a c d ends with no more words, a c a b. ends a
+ * sentence and a c a c is cut, and so on from c
+ */
+static MunitResult endings_test(const MunitParameter params[], void *fixture)
+{
+    char corpus_path[RANDOM_FILE_PATH_LENGTH] = {0};
+    char all_expected_path[RANDOM_FILE_PATH_LENGTH] = {0};
+    char first_expected_path[RANDOM_FILE_PATH_LENGTH] = {0};
+    char all_path[RANDOM_FILE_PATH_LENGTH] = {0};
+    char first_path[RANDOM_FILE_PATH_LENGTH] = {0};
+    string_to_file(ENDINGS_TEST_CORPUS, corpus_path);
+    string_to_file(ENDINGS_TEST_ALL, all_expected_path);
+    string_to_file(ENDINGS_TEST_FIRST, first_expected_path);
+    const char* all_argv[] = {"", "1", "5", corpus_path, "--endings", "4",
+                              NULL};
+    const char* first_argv[] = {"", "1", "5", corpus_path, "--endings", "4",
+                                "--first-word", "a", NULL};
+    munit_assert_int(run_args_into_file(all_argv, all_path), ==,
+                     EXIT_SUCCESS);
+    munit_assert_int(run_args_into_file(first_argv, first_path), ==,
+                     EXIT_SUCCESS);
+    MunitResult result = diff_files(all_expected_path, all_path);
+    if (result == MUNIT_OK)
+    {
+        result = diff_files(first_expected_path, first_path);
+    }
+    unlink(corpus_path);
+    unlink(all_expected_path);
+    unlink(first_expected_path);
+    unlink(all_path);
+    unlink(first_path);
+    return result;
+}
+
+static MunitTest features_tests[] = {
+    {"/tokenizer_blocks", tokenizer_test, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/classify_bitmap", classify_test, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/frozen_model", frozen_model_test, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/bigram_tsv", bigram_tsv_test, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/bigram_binary", bigram_binary_test, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/dedup", dedup_test, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/stdin_pipe", stdin_test, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/gzip", gzip_test, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/zstd", zstd_test, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/shards", shards_test, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/perfect_hash", perfect_hash_test, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/hash_seeds", hash_seeds_test, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/paged_model", paged_model_test, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/paged_zero_totals", paged_zero_totals_test, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/bulk_model", bulk_model_test, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/spilled_model", spilled_model_test, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/inline_states", inline_states_test, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/template_lookup", template_lookup_test, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/endings", endings_test, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    /* Mark the end of the array with an entry where the test
+     * function is NULL */
+    {NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL}};
+#endif
+
+#ifdef SNAKE
+/**
+ * @brief the exact expected game of the default board
+ */
+static MunitResult expected_rolls_test(const MunitParameter params[], void *fixture)
+{
+    char actual_path[RANDOM_FILE_PATH_LENGTH] = {0};
+    char summary[100] = {0};
+    const char* argv[] = {"", "--analyze", NULL};
+    munit_assert_int(run_args_into_file(argv, actual_path), ==, EXIT_SUCCESS);
+    FILE* fp = fopen(actual_path, "r");
+    munit_assert_not_null(fgets(summary, sizeof(summary), fp));
+    fclose(fp);
+    unlink(actual_path);
+    munit_assert_string_equal(summary, DEFAULT_BOARD_SUMMARY);
+    return MUNIT_OK;
+}
+
+/**
+ * @brief many steps at once, by squaring the dense matrix, against as many
+ * single sparse steps, on a matrix with links between all the states and a
+ * dangling one
+ */
+static MunitResult step_distribution_test(const MunitParameter params[], void *fixture)
+{
+    int n = STEP_TEST_STATES;
+    static int column_starts[STEP_TEST_STATES + 1];
+    static int predecessors[STEP_TEST_STATES * STEP_TEST_STATES];
+    static double probabilities[STEP_TEST_STATES * STEP_TEST_STATES];
+    static bool is_dangling[STEP_TEST_STATES];
+    static double restart[STEP_TEST_STATES];
+    double row_sums[STEP_TEST_STATES] = {0};
+    double dense[STEP_TEST_STATES] = {0};
+    double sparse[STEP_TEST_STATES] = {0};
+    for (int from = 0; from < n; from++)
+    {
+        is_dangling[from] = from == n - 1;
+        restart[from] = 1.0 / n;
+        for (int to = 0; to < n; to++)
+        {
+            row_sums[from] += 1 + (from * to) % 7;
+        }
+    }
+    int num_of_links = 0;
+    for (int to = 0; to < n; to++)
+    {
+        column_starts[to] = num_of_links;
+        for (int from = 0; from < n - 1; from++)
+        {
+            predecessors[num_of_links] = from;
+            probabilities[num_of_links++] = (1 + (from * to) % 7) / row_sums[from];
+        }
+    }
+    column_starts[n] = num_of_links;
+    TransitionMatrix matrix = {n, column_starts, predecessors, probabilities,
+                               is_dangling, restart};
+    dense[0] = 1;
+    sparse[0] = 1;
+    munit_assert_int(step_distribution(&matrix, dense, STEP_TEST_STEPS, 1), ==,
+                     EXIT_SUCCESS);
+    for (int step = 0; step < STEP_TEST_STEPS; step++)
+    {
+        munit_assert_int(step_distribution(&matrix, sparse, 1, 1), ==,
+                         EXIT_SUCCESS);
+    }
+    for (int state = 0; state < n; state++)
+    {
+        munit_assert_double_equal(dense[state], sparse[state], 12);
+    }
+    return MUNIT_OK;
+}
+
+/**
+ * @brief simulated games of a seed are the same on every run with the same
+ * threads, but for the time they took, and their mean number of rolls is
+ * the exact one, within the error of the simulation
+ */
+static MunitResult simulation_test(const MunitParameter params[], void *fixture)
+{
+    char first_path[RANDOM_FILE_PATH_LENGTH] = {0};
+    char second_path[RANDOM_FILE_PATH_LENGTH] = {0};
+    char first_line[SIMULATION_LINE_LENGTH] = {0};
+    char second_line[SIMULATION_LINE_LENGTH] = {0};
+    const char* argv[] = {"", "1", SIMULATION_TEST_GAMES, "--simulate",
+                          "--threads", "3", NULL};
+    munit_assert_int(run_args_into_file(argv, first_path), ==, EXIT_SUCCESS);
+    munit_assert_int(run_args_into_file(argv, second_path), ==, EXIT_SUCCESS);
+    FILE* first = fopen(first_path, "r");
+    FILE* second = fopen(second_path, "r");
+    munit_assert_not_null(fgets(first_line, sizeof(first_line), first));
+    munit_assert_not_null(fgets(second_line, sizeof(second_line), second));
+    double mean = 0, variance = 0;
+    int num_of_lines = 0;
+    while (fgets(first_line, sizeof(first_line), first) != NULL)
+    {
+        munit_assert_not_null(fgets(second_line, sizeof(second_line), second));
+        munit_assert_string_equal(first_line, second_line);
+        if (num_of_lines++ == 0)
+        {
+            munit_assert_int(sscanf(first_line, "Rolls: mean %lf, variance %lf",
+                                    &mean, &variance), ==, 2);
+        }
+    }
+    munit_assert_null(fgets(second_line, sizeof(second_line), second));
+    fclose(first);
+    fclose(second);
+    unlink(first_path);
+    unlink(second_path);
+    munit_assert_int(num_of_lines, >, 1);
+    // within 5 standard errors of the mean
+    double error = mean - DEFAULT_BOARD_ROLLS;
+    munit_assert_double(error * error, <,
+                        25 * variance / strtod(SIMULATION_TEST_GAMES, NULL));
+    return MUNIT_OK;
+}
+
+/**
+ * @brief games in lockstep lanes, a number of them the lanes do not divide,
+ * on a board whose first roll ends the game in 2 rolls, in 3, or in a loop
+ * of ladders and snakes, a third of the time each
+ */
+static MunitResult dice_lanes_test(const MunitParameter params[], void *fixture)
+{
+    // 0 -> 1 -> 2 => 9 -> 10, 0 -> 2 => 9 -> 10, 0 -> 3 -> 4 => 6 => 4
+    int moves[LANES_TEST_CELLS] = {3, 1, 0, 1, 0, 1, 0, 1, 1, 1, 0};
+    int links[LANES_TEST_CELLS] = {0, 1, 9, 3, 6, 5, 4, 7, 8, 9, 10};
+    long long games = LANES_TEST_GAMES;
+    DiceBoard* board = new_dice_board(moves, links, LANES_TEST_CELLS);
+    munit_assert_not_null(board);
+    WalkStatistics* statistics = simulate_dice_games(board, 0, games, 100, 3,
+                                                     1);
+    WalkStatistics* again = simulate_dice_games(board, 0, games, 100, 3, 1);
+    free_dice_board(&board);
+    munit_assert_not_null(statistics);
+    munit_assert_not_null(again);
+    munit_assert_llong(statistics->num_of_walks, ==, games);
+    munit_assert_int(statistics->num_of_lengths, ==, 4);
+    munit_assert_llong(statistics->length_counts[0], ==, 0);
+    munit_assert_llong(statistics->length_counts[1], ==, 0);
+    long long in_two = statistics->length_counts[2];
+    long long in_three = statistics->length_counts[3];
+    long long trapped = statistics->num_of_unfinished;
+    munit_assert_llong(in_two + in_three + trapped, ==, games);
+    // within 5 standard deviations of a third: 3 * count - games has a
+    // variance of 2 * games
+    munit_assert_llong((3 * in_two - games) * (3 * in_two - games), <,
+                       50 * games);
+    munit_assert_llong((3 * in_three - games) * (3 * in_three - games), <,
+                       50 * games);
+    munit_assert_llong((3 * trapped - games) * (3 * trapped - games), <,
+                       50 * games);
+    munit_assert_llong(statistics->visits[0], ==, games);
+    munit_assert_llong(statistics->visits[1], ==, in_three);
+    munit_assert_llong(statistics->visits[2], ==, in_two + in_three);
+    munit_assert_llong(statistics->visits[9], ==, in_two + in_three);
+    munit_assert_llong(statistics->visits[10], ==, in_two + in_three);
+    munit_assert_llong(statistics->visits[3], ==, trapped);
+    munit_assert_llong(statistics->visits[4], ==, trapped);
+    munit_assert_llong(again->length_counts[2], ==, in_two);
+    munit_assert_llong(again->length_counts[3], ==, in_three);
+    munit_assert_llong(again->num_of_unfinished, ==, trapped);
+    free_walk_statistics(&statistics);
+    free_walk_statistics(&again);
+    return MUNIT_OK;
+}
+
+/**
+ * @brief the states of an IntChain are found by their number, in the order
+ * of the database of it's view, and their links add up as a MarkovChain's
+ */
+static MunitResult int_chain_test(const MunitParameter params[], void *fixture)
+{
+    IntChain* int_chain = new_int_chain(INT_CHAIN_TEST_STATES, NULL, NULL);
+    munit_assert_not_null(int_chain);
+    munit_assert_null(get_int_node(int_chain, -1));
+    munit_assert_null(get_int_node(int_chain, INT_CHAIN_TEST_STATES));
+    LinkedList* database = int_chain->markov_chain->database;
+    munit_assert_int(database->size, ==, INT_CHAIN_TEST_STATES);
+    Node* node = database->first;
+    for (int state = 0; state < INT_CHAIN_TEST_STATES; state++)
+    {
+        MarkovNode* markov_node = get_int_node(int_chain, state);
+        munit_assert_not_null(markov_node);
+        munit_assert_int(get_int_state(markov_node), ==, state);
+        munit_assert_int(*(int*) markov_node->data, ==, state);
+        munit_assert_ptr_equal(node->data, markov_node);
+        munit_assert_int(markov_node->counter_list_length, ==, 0);
+        node = node->next;
+    }
+    munit_assert_null(node);
+    munit_assert_ptr_equal(database->last->data,
+                           get_int_node(int_chain, INT_CHAIN_TEST_STATES - 1));
+    munit_assert_true(add_int_link(int_chain, 0, 1, 2));
+    munit_assert_true(add_int_link(int_chain, 0, 3, 1));
+    munit_assert_true(add_int_link(int_chain, 0, 1, 1));
+    munit_assert_false(add_int_link(int_chain, 0, INT_CHAIN_TEST_STATES, 1));
+    munit_assert_false(add_int_link(int_chain, -1, 0, 1));
+    MarkovNode* first = get_int_node(int_chain, 0);
+    munit_assert_int(first->counter_list_length, ==, 2);
+    munit_assert_int(first->counter_list_total, ==, 4);
+    for (int value = 0; value < 3; value++)
+    {
+        munit_assert_ptr_equal(get_next_node_by_value(first, value),
+                               get_int_node(int_chain, 1));
+    }
+    munit_assert_ptr_equal(get_next_node_by_value(first, 3),
+                           get_int_node(int_chain, 3));
+    free_int_chain(&int_chain);
+    munit_assert_null(int_chain);
+    return MUNIT_OK;
+}
+
+/**
+ * @brief stationary distribution of a matrix, against the expected one, and
+ * left as it is by one more step
+ */
+static void assert_stationary(TransitionMatrix* matrix, const double* expected)
+{
+    double distribution[STATIONARY_TEST_STATES] = {0};
+    int steps = 0;
+    munit_assert_int(stationary_distribution(matrix, TRANSITION_TOLERANCE,
+                                             TRANSITION_MAX_STEPS, 1,
+                                             distribution, &steps), ==,
+                     EXIT_SUCCESS);
+    munit_assert_int(steps, >, 0);
+    for (int state = 0; state < matrix->num_of_states; state++)
+    {
+        munit_assert_double_equal(distribution[state], expected[state], 6);
+    }
+    munit_assert_int(step_distribution(matrix, distribution, 1, 1), ==,
+                     EXIT_SUCCESS);
+    for (int state = 0; state < matrix->num_of_states; state++)
+    {
+        munit_assert_double_equal(distribution[state], expected[state], 6);
+    }
+}
+
+/**
+ * @brief the share of the steps of an endless walk at every state, on a
+ * chain 0 -> 1 -> 0 or 2 -> 0, and on a periodic one 0 -> 1 whose last
+ * state starts the walk over
+ */
+static MunitResult stationary_test(const MunitParameter params[], void *fixture)
+{
+    int column_starts[] = {0, 2, 3, 4};
+    int predecessors[] = {1, 2, 0, 1};
+    double probabilities[] = {0.5, 1, 1, 0.5};
+    bool is_dangling[] = {false, false, false};
+    double restart[] = {1, 0, 0};
+    double expected[] = {0.4, 0.4, 0.2};
+    TransitionMatrix matrix = {STATIONARY_TEST_STATES, column_starts,
+                               predecessors, probabilities, is_dangling,
+                               restart};
+    assert_stationary(&matrix, expected);
+    int periodic_starts[] = {0, 0, 1};
+    int periodic_predecessors[] = {0};
+    double periodic_probabilities[] = {1};
+    bool periodic_dangling[] = {false, true};
+    double periodic_expected[] = {0.5, 0.5};
+    TransitionMatrix periodic = {2, periodic_starts, periodic_predecessors,
+                                 periodic_probabilities, periodic_dangling,
+                                 restart};
+    assert_stationary(&periodic, periodic_expected);
+    return MUNIT_OK;
+}
+
+static MunitTest analysis_tests[] = {
+    {"/expected_rolls", expected_rolls_test, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/step_distribution", step_distribution_test, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/simulation", simulation_test, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/dice_lanes", dice_lanes_test, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/int_chain", int_chain_test, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/stationary", stationary_test, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    /* Mark the end of the array with an entry where the test
+     * function is NULL */
+    {NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL}};
+#endif
+
+
 static MunitSuite suites_list[] = {
 #ifdef TWEETS
     {"/ex3a_prsb", ex3a_prsb_tests, NULL, 1, MUNIT_SUITE_OPTION_NONE},
+    {"/features", features_tests, NULL, 1, MUNIT_SUITE_OPTION_NONE},
 #endif
 #ifdef SNAKE
     {"/ex3b_prsb", ex3b_prsb_tests, NULL, 1, MUNIT_SUITE_OPTION_NONE},
+    {"/analysis", analysis_tests, NULL, 1, MUNIT_SUITE_OPTION_NONE},
 #endif
     {"/longIO", long_IO_tests, NULL, 1, MUNIT_SUITE_OPTION_NONE},
     {"/memory", memory_tests, NULL, 1, MUNIT_SUITE_OPTION_NONE},
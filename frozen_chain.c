@@ -0,0 +1,1383 @@
+#include "frozen_chain.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <limits.h>
+
+#define ALLOC_ERROR_FROZEN_CHAIN \
+"Allocation failure: Alloc of new FrozenChain failed.\n"
+#define ALLOC_ERROR_FROZEN_BUFFER \
+"Allocation failure: Alloc of frozen model buffer failed.\n"
+#define FORMAT_ERROR_FROZEN "ERROR: invalid frozen model file.\n"
+#define WRITE_ERROR_FROZEN "ERROR: problem with writing frozen model.\n"
+#define EDGES_ERROR_FROZEN "ERROR: invalid or unreadable edges file.\n"
+
+#define ALIGNMENT 8
+#define WORD_BITS 64
+#define WORD_SHIFT 6
+#define WORD_MASK 63
+
+/**
+ * Round size up to the next multiple of ALIGNMENT.
+ */
+static uint64_t align_up(uint64_t size)
+{
+  return (size + ALIGNMENT - 1) & ~((uint64_t) ALIGNMENT - 1);
+}
+
+/**
+ * @return number of bits needed to represent value, 0 for 0
+ */
+static uint32_t bit_width(uint64_t value)
+{
+  uint32_t width = 0;
+  while (value != 0)
+    {
+      width++;
+      value >>= 1;
+    }
+  return width;
+}
+
+/**
+ * Write value in width bits starting at bit of words (zero initialized).
+ */
+static void write_bits(uint64_t *words, uint64_t bit, uint32_t width,
+                       uint64_t value)
+{
+  if (width == 0)
+    {
+      return;
+    }
+  uint64_t word = bit >> WORD_SHIFT;
+  uint32_t shift = (uint32_t) (bit & WORD_MASK);
+  words[word] |= value << shift;
+  if (shift + width > WORD_BITS)
+    {
+      words[word + 1] |= value >> (WORD_BITS - shift);
+    }
+}
+
+/**
+ * Read width bits (at most 32) starting at bit of words.
+ */
+static uint64_t read_bits(const uint64_t *words, uint64_t bit, uint32_t width)
+{
+  if (width == 0)
+    {
+      return 0;
+    }
+  uint64_t word = bit >> WORD_SHIFT;
+  uint32_t shift = (uint32_t) (bit & WORD_MASK);
+  uint64_t value = words[word] >> shift;
+  if (shift + width > WORD_BITS)
+    {
+      value |= words[word + 1] << (WORD_BITS - shift);
+    }
+  return value & ((UINT64_C(1) << width) - 1);
+}
+
+/**
+ * Build the log-spaced table of representable frequencies: entry q is
+ * round(base^q), base = 1 + 2 * max_error, up to the first entry that
+ * reaches max_frequency.
+ * @param max_error maximal relative error of a stored frequency
+ * @param max_frequency biggest frequency to represent
+ * @param length_p out param, length of the returned table
+ * @return the table, NULL in case of memory allocation failure
+ */
+static uint32_t* new_quant_table(double max_error, uint32_t max_frequency,
+                                 uint32_t *length_p)
+{
+  double base = 1 + 2 * max_error;
+  uint32_t length = 1;
+  for (double value = 1; value + 0.5 < max_frequency; value *= base)
+    {
+      length++;
+    }
+  uint32_t *table = malloc (sizeof (uint32_t) * length);
+  if (table == NULL)
+    {
+      printf ("%s", ALLOC_ERROR_FROZEN_BUFFER);
+      return NULL;
+    }
+  double value = 1;
+  for (uint32_t q = 0; q < length; q++, value *= base)
+    {
+      table[q] = (uint32_t) (value + 0.5);
+    }
+  if (table[length - 1] < max_frequency)
+    {
+      table[length - 1] = max_frequency;
+    }
+  *length_p = length;
+  return table;
+}
+
+/**
+ * @return the code of the table entry closest (relatively) to frequency
+ */
+static uint32_t quantize(const uint32_t *table, uint32_t length,
+                         uint32_t frequency)
+{
+  uint32_t low = 0, high = length - 1; // last entry <= frequency
+  while (low < high)
+    {
+      uint32_t middle = (low + high + 1) / 2;
+      if (table[middle] <= frequency)
+        {
+          low = middle;
+        }
+      else
+        {
+          high = middle - 1;
+        }
+    }
+  if (low + 1 < length && (uint64_t) frequency * frequency
+                          > (uint64_t) table[low] * table[low + 1])
+    {
+      return low + 1;
+    }
+  return low;
+}
+
+/**
+ * @return the stored code of frequency
+ */
+static uint32_t encode_frequency(const uint32_t *table, uint32_t length,
+                                 uint32_t frequency)
+{
+  if (table == NULL)
+    {
+      return frequency - FROZEN_EXACT_CODE_SHIFT;
+    }
+  return quantize (table, length, frequency);
+}
+
+/**
+ * Point the section fields of frozen_chain into it's buffer.
+ */
+static void attach_sections(FrozenChain *frozen_chain)
+{
+  char *buffer = frozen_chain->buffer;
+  FrozenHeader *header = (FrozenHeader*) buffer;
+  frozen_chain->header = header;
+  frozen_chain->state_offsets = (uint64_t*) (buffer + header->state_offsets);
+  frozen_chain->state_pool = buffer + header->state_pool;
+  frozen_chain->edge_offsets = (uint64_t*) (buffer + header->edge_offsets);
+  frozen_chain->totals = (uint32_t*) (buffer + header->totals);
+  frozen_chain->freq_widths = (uint8_t*) (buffer + header->freq_widths);
+  frozen_chain->freq_bit_offsets = (uint64_t*) (buffer
+      + header->freq_bit_offsets);
+  frozen_chain->successor_bits = (uint64_t*) (buffer
+      + header->successor_bits);
+  frozen_chain->freq_bits = (uint64_t*) (buffer + header->freq_bits);
+  frozen_chain->quant_table = NULL;
+  if (header->quant_table_length != 0)
+    {
+      frozen_chain->quant_table = (uint32_t*) (buffer + header->quant_table);
+    }
+  PerfectHash *state_hash = &frozen_chain->state_hash;
+  state_hash->seed = header->hash_seed;
+  state_hash->num_of_levels = header->num_of_hash_levels;
+  state_hash->level_offsets = (uint64_t*) (buffer + header->hash_levels);
+  state_hash->bits = (uint64_t*) (buffer + header->hash_bits);
+  state_hash->ranks = (uint32_t*) (buffer + header->hash_ranks);
+  frozen_chain->hash_states = (uint64_t*) (buffer + header->hash_states);
+}
+
+/**
+ * Perfect hash of the states being frozen, and the state of every value
+ */
+typedef struct StateIndex {
+    PerfectHash hash;
+    uint64_t *states; // packed, successor_width bits per value
+    uint64_t num_of_words; // of states
+} StateIndex;
+
+/**
+ * Start a header of the given number of states, with no section yet
+ */
+static void init_header(FrozenHeader *header, uint32_t num_of_states)
+{
+  memset (header, 0, sizeof (FrozenHeader));
+  memcpy (header->magic, FROZEN_MAGIC, FROZEN_MAGIC_LENGTH);
+  header->num_of_states = num_of_states;
+  header->successor_width = bit_width (num_of_states > 0 ?
+                                       num_of_states - 1 : 0);
+}
+
+/**
+ * Build the perfect hash of the states, and the packed state of every value
+ * @param index out param, free_state_index frees it
+ * @return false in case of memory allocation failure
+ */
+static bool index_states(void **states, size_t (*size_func)(void*),
+                         FrozenHeader *header, StateIndex *index)
+{
+  uint32_t num_of_states = header->num_of_states;
+  index->states = NULL;
+  index->num_of_words = 0;
+  if (!build_perfect_hash (states, size_func, num_of_states, &index->hash))
+    {
+      return false;
+    }
+  header->hash_seed = index->hash.seed;
+  header->num_of_hash_levels = index->hash.num_of_levels;
+  if (index->hash.num_of_levels > 0)
+    {
+      uint32_t width = header->successor_width;
+      index->num_of_words = (num_of_states * (uint64_t) width + WORD_MASK)
+                            >> WORD_SHIFT;
+      index->states = calloc (index->num_of_words + 1, sizeof (uint64_t));
+      if (index->states == NULL)
+        {
+          printf ("%s", ALLOC_ERROR_FROZEN_BUFFER);
+          free_perfect_hash (&index->hash);
+          return false;
+        }
+      for (uint32_t i = 0; i < num_of_states; i++)
+        {
+          uint64_t key_hash = hash_key (states[i], size_func (states[i]),
+                                        index->hash.seed);
+          uint64_t value = get_perfect_hash_value (&index->hash, key_hash);
+          write_bits (index->states, value * width, width, i);
+        }
+    }
+  return true;
+}
+
+/**
+ * Free the arrays of an index built by index_states
+ */
+static void free_state_index(StateIndex *index)
+{
+  free_perfect_hash (&index->hash);
+  free (index->states);
+  index->states = NULL;
+}
+
+/**
+ * Copy the index into the sections of frozen_chain
+ */
+static void fill_state_index(FrozenChain *frozen_chain,
+                             const StateIndex *index)
+{
+  const PerfectHash *hash = &index->hash;
+  FrozenHeader *header = frozen_chain->header;
+  char *buffer = frozen_chain->buffer;
+  memcpy (buffer + header->hash_levels, hash->level_offsets,
+          sizeof (uint64_t) * (hash->num_of_levels + 1));
+  if (hash->bits != NULL) // no bits if there are no states
+    {
+      memcpy (buffer + header->hash_bits, hash->bits,
+              sizeof (uint64_t) * get_perfect_hash_words (hash));
+    }
+  memcpy (buffer + header->hash_ranks, hash->ranks,
+          sizeof (uint32_t) * get_perfect_hash_ranks (hash));
+  if (index->num_of_words > 0)
+    {
+      memcpy (buffer + header->hash_states, index->states,
+              sizeof (uint64_t) * index->num_of_words);
+    }
+}
+
+/**
+ * Place the sections after the header, given the sizes of the variable
+ * ones, and set the total size.
+ */
+static void layout_sections(FrozenHeader *header, uint64_t pool_size,
+                            uint64_t successor_words, uint64_t freq_words,
+                            const StateIndex *index)
+{
+  uint64_t states = header->num_of_states;
+  uint64_t offset = align_up (sizeof (FrozenHeader));
+  header->state_offsets = offset;
+  offset += align_up (sizeof (uint64_t) * (states + 1));
+  header->state_pool = offset;
+  offset += align_up (pool_size);
+  header->edge_offsets = offset;
+  offset += align_up (sizeof (uint64_t) * (states + 1));
+  header->totals = offset;
+  offset += align_up (sizeof (uint32_t) * states);
+  header->freq_widths = offset;
+  offset += align_up (sizeof (uint8_t) * states);
+  header->freq_bit_offsets = offset;
+  offset += align_up (sizeof (uint64_t) * states);
+  header->successor_bits = offset;
+  offset += sizeof (uint64_t) * successor_words;
+  header->freq_bits = offset;
+  offset += sizeof (uint64_t) * freq_words;
+  header->quant_table = offset;
+  offset += align_up (sizeof (uint32_t) * header->quant_table_length);
+  header->hash_levels = offset;
+  offset += sizeof (uint64_t) * (index->hash.num_of_levels + (uint64_t) 1);
+  header->hash_bits = offset;
+  offset += sizeof (uint64_t) * get_perfect_hash_words (&index->hash);
+  header->hash_ranks = offset;
+  offset += align_up (sizeof (uint32_t)
+                      * get_perfect_hash_ranks (&index->hash));
+  header->hash_states = offset;
+  offset += sizeof (uint64_t) * index->num_of_words;
+  header->size = offset;
+}
+
+/**
+ * Collect the nodes of the markov_chain's database, indexed by their id.
+ * @return MarkovNode pointers array, NULL in case of memory allocation failure
+ */
+static MarkovNode** collect_nodes(MarkovChain *markov_chain)
+{
+  int size = markov_chain->database->size;
+  MarkovNode **nodes = malloc (sizeof (MarkovNode*) * (size > 0 ? size : 1));
+  if (nodes == NULL)
+    {
+      printf ("%s", ALLOC_ERROR_FROZEN_BUFFER);
+      return NULL;
+    }
+  for (Node *ptr = markov_chain->database->first; ptr != NULL; ptr = ptr->next)
+    {
+      nodes[ptr->data->id] = ptr->data;
+    }
+  return nodes;
+}
+
+/**
+ * @return index of the first edge after the ones leaving state, which start
+ * at edge
+ */
+static uint64_t row_end(const FrozenEdge *edges, uint64_t num_of_edges,
+                        uint64_t edge, uint32_t state)
+{
+  while (edge < num_of_edges && edges[edge].from == state)
+    {
+      edge++;
+    }
+  return edge;
+}
+
+/**
+ * @return bits needed by the biggest frequency code of edges [begin, end)
+ */
+static uint32_t row_width(const FrozenEdge *edges, uint64_t begin,
+                          uint64_t end, const uint32_t *table,
+                          uint32_t length)
+{
+  uint32_t max_code = 0;
+  for (uint64_t edge = begin; edge < end; edge++)
+    {
+      uint32_t code = encode_frequency (table, length, edges[edge].frequency);
+      max_code = code > max_code ? code : max_code;
+    }
+  return bit_width (max_code);
+}
+
+/**
+ * Fill the sections of frozen_chain from the given states and edges.
+ */
+static void fill_sections(FrozenChain *frozen_chain, void **states,
+                          size_t (*size_func)(void*),
+                          const FrozenEdge *edges, uint32_t *table)
+{
+  FrozenHeader *header = frozen_chain->header;
+  uint32_t length = header->quant_table_length;
+  uint64_t pool_offset = 0, edge = 0, freq_bit = 0;
+  for (uint32_t i = 0; i < header->num_of_states; i++)
+    {
+      size_t size = size_func (states[i]);
+      frozen_chain->state_offsets[i] = pool_offset;
+      memcpy (frozen_chain->state_pool + pool_offset, states[i], size);
+      pool_offset += align_up (size);
+
+      uint64_t end = row_end (edges, header->num_of_edges, edge, i);
+      uint32_t width = row_width (edges, edge, end, table, length);
+      uint32_t total = 0;
+      frozen_chain->edge_offsets[i] = edge;
+      frozen_chain->freq_widths[i] = (uint8_t) width;
+      frozen_chain->freq_bit_offsets[i] = freq_bit;
+      for (; edge < end; edge++)
+        {
+          uint32_t code = encode_frequency (table, length,
+                                            edges[edge].frequency);
+          write_bits (frozen_chain->successor_bits,
+                      edge * header->successor_width,
+                      header->successor_width, edges[edge].to);
+          write_bits (frozen_chain->freq_bits, freq_bit, width, code);
+          freq_bit += width;
+          total += table == NULL ? code + FROZEN_EXACT_CODE_SHIFT
+                                 : table[code];
+        }
+      frozen_chain->totals[i] = total;
+    }
+  frozen_chain->state_offsets[header->num_of_states] = pool_offset;
+  frozen_chain->edge_offsets[header->num_of_states] = edge;
+  if (table != NULL)
+    {
+      memcpy (frozen_chain->quant_table, table, sizeof (uint32_t) * length);
+    }
+}
+
+/**
+ * Allocate a zeroed FrozenChain with a buffer of the given size.
+ * @return FrozenChain pointer, NULL in case of memory allocation failure
+ */
+static FrozenChain* new_frozen_chain(uint64_t size)
+{
+  FrozenChain *frozen_chain = malloc (sizeof (FrozenChain));
+  if (frozen_chain == NULL)
+    {
+      printf ("%s", ALLOC_ERROR_FROZEN_CHAIN);
+      return NULL;
+    }
+  frozen_chain->buffer = calloc (1, size);
+  if (frozen_chain->buffer == NULL)
+    {
+      printf ("%s", ALLOC_ERROR_FROZEN_BUFFER);
+      free (frozen_chain);
+      return NULL;
+    }
+  frozen_chain->print_func = NULL;
+  return frozen_chain;
+}
+
+/**
+ * Build a frozen chain straight from it's states and edges, with no
+ * MarkovChain. States are copied byte by byte, so they must be flat.
+ * @param states the states, by index
+ * @param num_of_states
+ * @param size_func returns the size in bytes of a generic state
+ * @param edges edges sorted by their from state, the successors of a state in
+ * the order they are to be sampled in
+ * @param num_of_edges
+ * @param max_error maximal relative error of a stored frequency, 0 for
+ * exact frequencies
+ * @return FrozenChain pointer, NULL in case of memory allocation failure or
+ * if the states have no perfect hash
+ * @ownership Weak Ownership. separate function for Free (free_frozen_chain)
+ */
+FrozenChain* freeze_edges(void **states, uint32_t num_of_states,
+                          size_t (*size_func)(void*),
+                          const FrozenEdge *edges, uint64_t num_of_edges,
+                          double max_error)
+{
+  FrozenHeader header;
+  init_header (&header, num_of_states);
+  header.num_of_edges = num_of_edges;
+  uint64_t pool_size = 0;
+  for (uint32_t i = 0; i < num_of_states; i++)
+    {
+      pool_size += align_up (size_func (states[i]));
+    }
+  uint32_t max_frequency = 1;
+  for (uint64_t edge = 0; edge < num_of_edges; edge++)
+    {
+      uint32_t frequency = edges[edge].frequency;
+      max_frequency = frequency > max_frequency ? frequency : max_frequency;
+    }
+  uint32_t *table = NULL;
+  if (max_error > 0)
+    {
+      table = new_quant_table (max_error, max_frequency,
+                               &header.quant_table_length);
+      if (table == NULL)
+        {
+          return NULL;
+        }
+    }
+  StateIndex index;
+  if (!index_states (states, size_func, &header, &index))
+    {
+      free (table);
+      return NULL;
+    }
+  uint64_t freq_bits = 0; // widths depend on the codes, so size them first
+  for (uint64_t edge = 0; edge < num_of_edges;)
+    {
+      uint64_t end = row_end (edges, num_of_edges, edge, edges[edge].from);
+      freq_bits += row_width (edges, edge, end, table,
+                              header.quant_table_length) * (end - edge);
+      edge = end;
+    }
+  uint64_t successor_bits = num_of_edges * header.successor_width;
+  layout_sections (&header, pool_size,
+                   (successor_bits + WORD_MASK) >> WORD_SHIFT,
+                   (freq_bits + WORD_MASK) >> WORD_SHIFT, &index);
+  FrozenChain *frozen_chain = new_frozen_chain (header.size);
+  if (frozen_chain != NULL)
+    {
+      memcpy (frozen_chain->buffer, &header, sizeof (FrozenHeader));
+      attach_sections (frozen_chain);
+      fill_sections (frozen_chain, states, size_func, edges, table);
+      fill_state_index (frozen_chain, &index);
+    }
+  free_state_index (&index);
+  free (table);
+  return frozen_chain;
+}
+
+/**
+ * Collect the states and the counter lists of the nodes as edges, in the
+ * order the counter lists keep them.
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+static int collect_edges(MarkovNode **nodes, int num_of_nodes, void **states,
+                         FrozenEdge **edges_p, uint64_t *num_of_edges_p)
+{
+  uint64_t num_of_edges = 0;
+  for (int i = 0; i < num_of_nodes; i++)
+    {
+      num_of_edges += (uint64_t) nodes[i]->counter_list_length;
+    }
+  FrozenEdge *edges = malloc (sizeof (FrozenEdge)
+                              * (num_of_edges > 0 ? num_of_edges : 1));
+  if (edges == NULL)
+    {
+      printf ("%s", ALLOC_ERROR_FROZEN_BUFFER);
+      return EXIT_FAILURE;
+    }
+  uint64_t edge = 0;
+  for (int i = 0; i < num_of_nodes; i++)
+    {
+      states[i] = nodes[i]->data;
+      for (int j = 0; j < nodes[i]->counter_list_length; j++, edge++)
+        {
+          NextNodeCounter counter = nodes[i]->counter_list[j];
+          edges[edge] = (FrozenEdge) {(uint32_t) i,
+                                      (uint32_t) counter.markov_node->id,
+                                      (uint32_t) counter.frequency};
+        }
+    }
+  *edges_p = edges;
+  *num_of_edges_p = num_of_edges;
+  return EXIT_SUCCESS;
+}
+
+/**
+ * Freeze the given markov_chain. States are copied byte by byte, so they must
+ * be flat (hold no pointers).
+ * @param markov_chain chain to freeze, left untouched
+ * @param size_func returns the size in bytes of a generic state
+ * @param max_error maximal relative error of a stored frequency, 0 for
+ * exact frequencies
+ * @return FrozenChain pointer, NULL in case of memory allocation failure or
+ * if the states have no perfect hash
+ * @ownership Weak Ownership. separate function for Free (free_frozen_chain)
+ */
+FrozenChain* freeze_markov_chain(MarkovChain *markov_chain,
+                                 size_t (*size_func)(void*),
+                                 double max_error)
+{
+  int size = markov_chain->database->size;
+  MarkovNode **nodes = collect_nodes (markov_chain);
+  if (nodes == NULL)
+    {
+      return NULL;
+    }
+  void **states = malloc (sizeof (void*) * (size > 0 ? size : 1));
+  FrozenEdge *edges = NULL;
+  uint64_t num_of_edges = 0;
+  FrozenChain *frozen_chain = NULL;
+  if (states == NULL)
+    {
+      printf ("%s", ALLOC_ERROR_FROZEN_BUFFER);
+    }
+  else if (collect_edges (nodes, size, states, &edges, &num_of_edges)
+           == EXIT_SUCCESS)
+    {
+      frozen_chain = freeze_edges (states, (uint32_t) size, size_func, edges,
+                                   num_of_edges, max_error);
+    }
+  if (frozen_chain != NULL)
+    {
+      frozen_chain->print_func = markov_chain->print_func;
+    }
+  free (edges);
+  free (states);
+  free (nodes);
+  return frozen_chain;
+}
+
+/**
+ * Write frozen_chain to the given file.
+ * @param frozen_chain
+ * @param fp file opened for binary writing
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+int save_frozen_chain(FrozenChain *frozen_chain, FILE *fp)
+{
+  size_t size = (size_t) frozen_chain->header->size;
+  if (fwrite (frozen_chain->buffer, 1, size, fp) != size)
+    {
+      printf ("%s", WRITE_ERROR_FROZEN);
+      return EXIT_FAILURE;
+    }
+  return EXIT_SUCCESS;
+}
+
+/**
+ * Sequential writer of a model file, keeping track of the offset reached
+ */
+typedef struct ModelWriter {
+    FILE *fp;
+    uint64_t offset;
+    bool failed;
+    uint64_t bits; // bits of a packed section not written yet
+    uint32_t num_of_bits;
+} ModelWriter;
+
+/**
+ * Write size bytes of data
+ */
+static void write_bytes(ModelWriter *writer, const void *data, uint64_t size)
+{
+  if (size > 0 && !writer->failed
+      && fwrite (data, 1, (size_t) size, writer->fp) != size)
+    {
+      writer->failed = true;
+    }
+  writer->offset += size;
+}
+
+/**
+ * Write zeros up to offset
+ */
+static void write_padding(ModelWriter *writer, uint64_t offset)
+{
+  static const char zeros[ALIGNMENT] = {0};
+  while (writer->offset < offset)
+    {
+      uint64_t size = offset - writer->offset;
+      write_bytes (writer, zeros, size < ALIGNMENT ? size : ALIGNMENT);
+    }
+}
+
+/**
+ * Append value in width bits to the packed section being written
+ */
+static void write_packed(ModelWriter *writer, uint32_t width, uint64_t value)
+{
+  if (width == 0)
+    {
+      return;
+    }
+  writer->bits |= value << writer->num_of_bits;
+  writer->num_of_bits += width;
+  if (writer->num_of_bits >= WORD_BITS)
+    {
+      write_bytes (writer, &writer->bits, sizeof (uint64_t));
+      writer->num_of_bits -= WORD_BITS;
+      writer->bits = writer->num_of_bits > 0 ?
+                     value >> (width - writer->num_of_bits) : 0;
+    }
+}
+
+/**
+ * Write the last word of the packed section being written
+ */
+static void flush_packed(ModelWriter *writer)
+{
+  if (writer->num_of_bits > 0)
+    {
+      write_bytes (writer, &writer->bits, sizeof (uint64_t));
+    }
+  writer->bits = 0;
+  writer->num_of_bits = 0;
+}
+
+/**
+ * Read the next edge of edges_file
+ * @return false at the end of the file
+ */
+static bool read_edge(FILE *edges_file, FrozenEdge *edge)
+{
+  return fread (edge, sizeof (FrozenEdge), 1, edges_file) == 1;
+}
+
+/**
+ * The per state sections of a model written from an edges file
+ */
+typedef struct StateSections {
+    uint64_t *state_offsets;
+    uint64_t *edge_offsets;
+    uint32_t *totals;
+    uint8_t *freq_widths;
+    uint64_t *freq_bit_offsets;
+    uint32_t *max_frequencies;
+} StateSections;
+
+/**
+ * Allocate the per state sections of num_of_states states, zeroed
+ * @return false in case of memory allocation failure
+ */
+static bool new_state_sections(StateSections *sections,
+                               uint32_t num_of_states)
+{
+  size_t states = (size_t) num_of_states + 1;
+  sections->state_offsets = calloc (states, sizeof (uint64_t));
+  sections->edge_offsets = calloc (states, sizeof (uint64_t));
+  sections->totals = calloc (states, sizeof (uint32_t));
+  sections->freq_widths = calloc (states, sizeof (uint8_t));
+  sections->freq_bit_offsets = calloc (states, sizeof (uint64_t));
+  sections->max_frequencies = calloc (states, sizeof (uint32_t));
+  if (sections->state_offsets == NULL || sections->edge_offsets == NULL
+      || sections->totals == NULL || sections->freq_widths == NULL
+      || sections->freq_bit_offsets == NULL
+      || sections->max_frequencies == NULL)
+    {
+      printf ("%s", ALLOC_ERROR_FROZEN_BUFFER);
+      return false;
+    }
+  return true;
+}
+
+/**
+ * Free the per state sections
+ */
+static void free_state_sections(StateSections *sections)
+{
+  free (sections->state_offsets);
+  free (sections->edge_offsets);
+  free (sections->totals);
+  free (sections->freq_widths);
+  free (sections->freq_bit_offsets);
+  free (sections->max_frequencies);
+}
+
+/**
+ * First pass over the edges: count the edges and find the biggest frequency
+ * of every state.
+ * @param max_frequency_p out param, biggest frequency of all
+ * @return false if the edges can not be read, are not sorted by their from
+ * state or lead out of the states
+ */
+static bool count_rows(FILE *edges_file, FrozenHeader *header,
+                       StateSections *sections, uint32_t *max_frequency_p)
+{
+  FrozenEdge edge;
+  uint32_t last_from = 0;
+  rewind (edges_file);
+  while (read_edge (edges_file, &edge))
+    {
+      if (edge.from < last_from || edge.from >= header->num_of_states
+          || edge.to >= header->num_of_states || edge.frequency == 0)
+        {
+          printf ("%s", EDGES_ERROR_FROZEN);
+          return false;
+        }
+      last_from = edge.from;
+      sections->edge_offsets[edge.from + 1]++;
+      if (edge.frequency > sections->max_frequencies[edge.from])
+        {
+          sections->max_frequencies[edge.from] = edge.frequency;
+        }
+      if (edge.frequency > *max_frequency_p)
+        {
+          *max_frequency_p = edge.frequency;
+        }
+      header->num_of_edges++;
+    }
+  if (ferror (edges_file))
+    {
+      printf ("%s", EDGES_ERROR_FROZEN);
+      return false;
+    }
+  return true;
+}
+
+/**
+ * Turn the state sizes and edge counts into offsets, and size the frequency
+ * codes of every state.
+ * @return number of bits of all the frequency codes
+ */
+static uint64_t size_sections(FrozenHeader *header, StateSections *sections,
+                              void **states, size_t (*size_func)(void*),
+                              const uint32_t *table)
+{
+  uint64_t freq_bit = 0;
+  for (uint32_t i = 0; i < header->num_of_states; i++)
+    {
+      sections->state_offsets[i + 1] = sections->state_offsets[i]
+                                       + align_up (size_func (states[i]));
+      uint64_t row_length = sections->edge_offsets[i + 1];
+      sections->edge_offsets[i + 1] = sections->edge_offsets[i] + row_length;
+      uint32_t width = 0;
+      if (row_length > 0)
+        {
+          width = bit_width (encode_frequency (table,
+                                               header->quant_table_length,
+                                               sections->max_frequencies[i]));
+        }
+      sections->freq_widths[i] = (uint8_t) width;
+      sections->freq_bit_offsets[i] = freq_bit;
+      freq_bit += width * row_length;
+    }
+  return freq_bit;
+}
+
+/**
+ * Second pass over the edges: sum the decoded frequencies of every state
+ * @return false if the edges can not be read
+ */
+static bool count_totals(FILE *edges_file, FrozenHeader *header,
+                         StateSections *sections, const uint32_t *table)
+{
+  FrozenEdge edge;
+  rewind (edges_file);
+  while (read_edge (edges_file, &edge))
+    {
+      uint32_t code = encode_frequency (table, header->quant_table_length,
+                                        edge.frequency);
+      sections->totals[edge.from] += table == NULL ?
+                                     code + FROZEN_EXACT_CODE_SHIFT
+                                     : table[code];
+    }
+  if (ferror (edges_file))
+    {
+      printf ("%s", EDGES_ERROR_FROZEN);
+      return false;
+    }
+  return true;
+}
+
+/**
+ * Last passes over the edges: write the packed successors, then the packed
+ * frequency codes
+ */
+static void write_edge_sections(ModelWriter *writer, FILE *edges_file,
+                                FrozenHeader *header,
+                                StateSections *sections,
+                                const uint32_t *table)
+{
+  FrozenEdge edge;
+  rewind (edges_file);
+  while (read_edge (edges_file, &edge))
+    {
+      write_packed (writer, header->successor_width, edge.to);
+    }
+  flush_packed (writer);
+  write_padding (writer, header->freq_bits);
+  rewind (edges_file);
+  while (read_edge (edges_file, &edge))
+    {
+      write_packed (writer, sections->freq_widths[edge.from],
+                    encode_frequency (table, header->quant_table_length,
+                                      edge.frequency));
+    }
+  flush_packed (writer);
+  write_padding (writer, header->quant_table);
+  if (ferror (edges_file))
+    {
+      writer->failed = true;
+    }
+}
+
+/**
+ * Write the whole model, the edges being read from edges_file
+ */
+static void write_model(ModelWriter *writer, void **states,
+                        size_t (*size_func)(void*), FILE *edges_file,
+                        FrozenHeader *header, StateSections *sections,
+                        const uint32_t *table, const StateIndex *index)
+{
+  uint32_t num_of_states = header->num_of_states;
+  uint64_t states_size = sizeof (uint64_t) * (num_of_states + (uint64_t) 1);
+  write_bytes (writer, header, sizeof (FrozenHeader));
+  write_padding (writer, header->state_offsets);
+  write_bytes (writer, sections->state_offsets, states_size);
+  write_padding (writer, header->state_pool);
+  for (uint32_t i = 0; i < num_of_states; i++)
+    {
+      write_bytes (writer, states[i], size_func (states[i]));
+      write_padding (writer, header->state_pool
+                             + sections->state_offsets[i + 1]);
+    }
+  write_padding (writer, header->edge_offsets);
+  write_bytes (writer, sections->edge_offsets, states_size);
+  write_padding (writer, header->totals);
+  write_bytes (writer, sections->totals, sizeof (uint32_t) * num_of_states);
+  write_padding (writer, header->freq_widths);
+  write_bytes (writer, sections->freq_widths, num_of_states);
+  write_padding (writer, header->freq_bit_offsets);
+  write_bytes (writer, sections->freq_bit_offsets,
+               sizeof (uint64_t) * num_of_states);
+  write_padding (writer, header->successor_bits);
+  write_edge_sections (writer, edges_file, header, sections, table);
+  write_bytes (writer, table, sizeof (uint32_t) * header->quant_table_length);
+  write_padding (writer, header->hash_levels);
+  write_bytes (writer, index->hash.level_offsets,
+               sizeof (uint64_t) * (index->hash.num_of_levels + 1));
+  write_bytes (writer, index->hash.bits,
+               sizeof (uint64_t) * get_perfect_hash_words (&index->hash));
+  write_bytes (writer, index->hash.ranks,
+               sizeof (uint32_t) * get_perfect_hash_ranks (&index->hash));
+  write_padding (writer, header->hash_states);
+  write_bytes (writer, index->states, sizeof (uint64_t) * index->num_of_words);
+  write_padding (writer, header->size);
+}
+
+/**
+ * Write the model freeze_edges would build, reading the edges from a file
+ * instead of memory: only the per state sections are kept in memory, the
+ * edges are read again for every section that needs them.
+ * @param states the states, by index
+ * @param num_of_states
+ * @param size_func returns the size in bytes of a generic state
+ * @param edges_file file of FrozenEdge, sorted by their from state
+ * @param max_error maximal relative error of a stored frequency, 0 for
+ * exact frequencies
+ * @param fp file opened for binary writing
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+int write_frozen_edges(void **states, uint32_t num_of_states,
+                       size_t (*size_func)(void*), FILE *edges_file,
+                       double max_error, FILE *fp)
+{
+  FrozenHeader header;
+  init_header (&header, num_of_states);
+  StateSections sections;
+  StateIndex index;
+  if (!new_state_sections (&sections, num_of_states))
+    {
+      free_state_sections (&sections);
+      return EXIT_FAILURE;
+    }
+  if (!index_states (states, size_func, &header, &index))
+    {
+      free_state_sections (&sections);
+      return EXIT_FAILURE;
+    }
+  uint32_t max_frequency = 1, *table = NULL;
+  bool valid = count_rows (edges_file, &header, &sections, &max_frequency);
+  if (valid && max_error > 0)
+    {
+      table = new_quant_table (max_error, max_frequency,
+                               &header.quant_table_length);
+      valid = table != NULL;
+    }
+  if (valid)
+    {
+      valid = count_totals (edges_file, &header, &sections, table);
+    }
+  if (valid)
+    {
+      uint64_t freq_bits = size_sections (&header, &sections, states,
+                                          size_func, table);
+      layout_sections (&header, sections.state_offsets[num_of_states],
+                       (header.num_of_edges * header.successor_width
+                        + WORD_MASK) >> WORD_SHIFT,
+                       (freq_bits + WORD_MASK) >> WORD_SHIFT, &index);
+      ModelWriter writer = {fp, 0, false, 0, 0};
+      write_model (&writer, states, size_func, edges_file, &header,
+                   &sections, table, &index);
+      if (writer.failed)
+        {
+          printf ("%s", WRITE_ERROR_FROZEN);
+          valid = false;
+        }
+    }
+  free (table);
+  free_state_sections (&sections);
+  free_state_index (&index);
+  return valid ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * Bytes of the words holding count packed values of width bits.
+ * @param size_p out param
+ * @return false if the size does not fit in 64 bits
+ */
+static bool get_packed_size(uint64_t count, uint32_t width, uint64_t *size_p)
+{
+  if (width != 0 && count > (UINT64_MAX - WORD_MASK) / width)
+    {
+      return false;
+    }
+  *size_p = sizeof (uint64_t) * ((count * width + WORD_MASK) >> WORD_SHIFT);
+  return true;
+}
+
+/**
+ * Check that the sections of header follow each other inside the model,
+ * each one big enough for it's fixed size content.
+ * @param header header read from a model file
+ * @return true if the header is valid
+ */
+bool is_valid_frozen_header(FrozenHeader *header)
+{
+  uint64_t states = header->num_of_states;
+  uint64_t successors_size = 0;
+  uint64_t hash_states_size = 0;
+  if (memcmp (header->magic, FROZEN_MAGIC, FROZEN_MAGIC_LENGTH) != 0
+      || header->state_offsets != align_up (sizeof (FrozenHeader))
+      || header->num_of_states > INT_MAX
+      || header->successor_width > FROZEN_MAX_WIDTH
+      || header->num_of_hash_levels > PERFECT_HASH_MAX_LEVELS
+      || (header->num_of_hash_levels == 0) != (header->num_of_states == 0)
+      || !get_packed_size (header->num_of_edges, header->successor_width,
+                           &successors_size)
+      || (header->num_of_hash_levels != 0
+          && !get_packed_size (states, header->successor_width,
+                               &hash_states_size)))
+    {
+      return false;
+    }
+  uint64_t sections[] = {header->state_offsets, header->state_pool,
+                         header->edge_offsets, header->totals,
+                         header->freq_widths, header->freq_bit_offsets,
+                         header->successor_bits, header->freq_bits,
+                         header->quant_table, header->hash_levels,
+                         header->hash_bits, header->hash_ranks,
+                         header->hash_states, header->size};
+  uint64_t min_sizes[] = {sizeof (uint64_t) * (states + 1), 0,
+                          sizeof (uint64_t) * (states + 1),
+                          sizeof (uint32_t) * states, states,
+                          sizeof (uint64_t) * states, successors_size, 0,
+                          sizeof (uint32_t) * header->quant_table_length,
+                          sizeof (uint64_t)
+                          * (header->num_of_hash_levels + (uint64_t) 1),
+                          0, sizeof (uint32_t), hash_states_size};
+  for (size_t i = 0; i + 1 < sizeof (sections) / sizeof (sections[0]); i++)
+    {
+      if (sections[i + 1] < sections[i]
+          || sections[i + 1] - sections[i] < min_sizes[i])
+        {
+          return false;
+        }
+    }
+  return true;
+}
+
+/**
+ * Check that the edges of a row of the model are inside it: begin to end
+ * within the edges, and their frequency codes within the freq_bits section.
+ * @param header valid header of the model
+ * @param begin first edge of the row
+ * @param end edge after the last edge of the row
+ * @param width bits of every frequency code of the row
+ * @param freq_bit first bit of the codes of the row in freq_bits
+ * @return true if the row is valid
+ */
+bool is_valid_frozen_row(FrozenHeader *header, uint64_t begin, uint64_t end,
+                         uint32_t width, uint64_t freq_bit)
+{
+  uint64_t section_bits = (header->quant_table - header->freq_bits)
+                          * CHAR_BIT;
+  if (end < begin || end > header->num_of_edges || width > FROZEN_MAX_WIDTH
+      || freq_bit > section_bits)
+    {
+      return false;
+    }
+  return width == 0 || end - begin <= (section_bits - freq_bit) / width;
+}
+
+/**
+ * Check every row of a loaded chain: it's state within the pool, it's edges
+ * and codes within their sections, every successor a state, every code in
+ * the quantization table, and it's total the sum of it's frequencies.
+ */
+static bool is_valid_frozen_rows(FrozenChain *frozen_chain)
+{
+  FrozenHeader *header = frozen_chain->header;
+  uint64_t pool_size = header->edge_offsets - header->state_pool;
+  uint32_t states = header->num_of_states;
+  if (frozen_chain->edge_offsets[0] != 0
+      || frozen_chain->edge_offsets[states] != header->num_of_edges
+      || frozen_chain->state_offsets[states] > pool_size)
+    {
+      return false;
+    }
+  for (uint32_t state = 0; state < states; state++)
+    {
+      uint64_t begin = frozen_chain->edge_offsets[state];
+      uint64_t end = frozen_chain->edge_offsets[state + 1];
+      uint32_t width = frozen_chain->freq_widths[state];
+      uint64_t freq_bit = frozen_chain->freq_bit_offsets[state];
+      if (frozen_chain->state_offsets[state + 1]
+          < frozen_chain->state_offsets[state]
+          || !is_valid_frozen_row (header, begin, end, width, freq_bit))
+        {
+          return false;
+        }
+      uint64_t total = 0;
+      for (uint64_t edge = begin; edge < end; edge++, freq_bit += width)
+        {
+          uint32_t code = (uint32_t) read_bits (frozen_chain->freq_bits,
+                                                freq_bit, width);
+          uint64_t successor = read_bits (frozen_chain->successor_bits,
+                                          edge * header->successor_width,
+                                          header->successor_width);
+          if (successor >= states
+              || (frozen_chain->quant_table != NULL
+                  && code >= header->quant_table_length))
+            {
+              return false;
+            }
+          total += frozen_chain->quant_table == NULL
+                   ? (uint64_t) code + FROZEN_EXACT_CODE_SHIFT
+                   : frozen_chain->quant_table[code];
+        }
+      if (total > INT_MAX || total != frozen_chain->totals[state])
+        {
+          return false;
+        }
+    }
+  return true;
+}
+
+/**
+ * Check that the levels of the perfect hash of a loaded chain are not empty
+ * and fit in their sections
+ */
+static bool is_valid_state_hash(FrozenChain *frozen_chain)
+{
+  FrozenHeader *header = frozen_chain->header;
+  PerfectHash *hash = &frozen_chain->state_hash;
+  if (hash->level_offsets[0] != 0)
+    {
+      return false;
+    }
+  for (uint32_t level = 0; level < hash->num_of_levels; level++)
+    {
+      if (hash->level_offsets[level + 1] <= hash->level_offsets[level]
+          || (hash->level_offsets[level + 1] & WORD_MASK) != 0)
+        {
+          return false;
+        }
+    }
+  uint64_t words = get_perfect_hash_words (hash);
+  return words <= (header->hash_ranks - header->hash_bits) / sizeof (uint64_t)
+         && get_perfect_hash_ranks (hash) <= (header->hash_states
+                                              - header->hash_ranks)
+                                             / sizeof (uint32_t);
+}
+
+/**
+ * Read a frozen chain written by save_frozen_chain.
+ * @param fp file opened for binary reading
+ * @param print_func print function of the stored states
+ * @return FrozenChain pointer, NULL if the file is not a valid model or in
+ * case of memory allocation failure
+ * @ownership Weak Ownership. separate function for Free (free_frozen_chain)
+ */
+FrozenChain* load_frozen_chain(FILE *fp, void (*print_func)(void*))
+{
+  FrozenHeader header;
+  if (fread (&header, sizeof (FrozenHeader), 1, fp) != 1
+      || !is_valid_frozen_header (&header))
+    {
+      printf ("%s", FORMAT_ERROR_FROZEN);
+      return NULL;
+    }
+  FrozenChain *frozen_chain = new_frozen_chain (header.size);
+  if (frozen_chain == NULL)
+    {
+      return NULL;
+    }
+  memcpy (frozen_chain->buffer, &header, sizeof (FrozenHeader));
+  size_t rest = (size_t) header.size - sizeof (FrozenHeader);
+  if (fread (frozen_chain->buffer + sizeof (FrozenHeader), 1, rest, fp)
+      != rest)
+    {
+      printf ("%s", FORMAT_ERROR_FROZEN);
+      free_frozen_chain (&frozen_chain);
+      return NULL;
+    }
+  attach_sections (frozen_chain);
+  if (!is_valid_frozen_rows (frozen_chain)
+      || !is_valid_state_hash (frozen_chain))
+    {
+      printf ("%s", FORMAT_ERROR_FROZEN);
+      free_frozen_chain (&frozen_chain);
+      return NULL;
+    }
+  frozen_chain->print_func = print_func;
+  return frozen_chain;
+}
+
+/**
+ * Free frozen_chain and all of it's content from memory
+ * @param frozen_chain_p frozen chain to free
+ */
+void free_frozen_chain(FrozenChain **frozen_chain_p)
+{
+  if (*frozen_chain_p != NULL)
+    {
+      free ((*frozen_chain_p)->buffer);
+      free (*frozen_chain_p);
+      *frozen_chain_p = NULL;
+    }
+}
+
+/**
+ * @param frozen_chain
+ * @param state state index
+ * @return pointer to the stored copy of the state
+ */
+void* get_frozen_state(FrozenChain *frozen_chain, int state)
+{
+  return frozen_chain->state_pool + frozen_chain->state_offsets[state];
+}
+
+/**
+ * @param frozen_chain
+ * @param edge edge index
+ * @return index of the state the edge leads to
+ */
+int get_frozen_successor(FrozenChain *frozen_chain, uint64_t edge)
+{
+  uint32_t width = frozen_chain->header->successor_width;
+  return (int) read_bits (frozen_chain->successor_bits, edge * width, width);
+}
+
+/**
+ * @param frozen_chain
+ * @param state state the edge leaves from
+ * @param edge edge index
+ * @return frequency of the edge, as decoded from its stored code
+ */
+uint32_t get_frozen_frequency(FrozenChain *frozen_chain, int state,
+                              uint64_t edge)
+{
+  uint32_t width = frozen_chain->freq_widths[state];
+  uint64_t bit = frozen_chain->freq_bit_offsets[state]
+                 + (edge - frozen_chain->edge_offsets[state]) * width;
+  uint32_t code = (uint32_t) read_bits (frozen_chain->freq_bits, bit, width);
+  if (frozen_chain->quant_table == NULL)
+    {
+      return code + FROZEN_EXACT_CODE_SHIFT;
+    }
+  return frozen_chain->quant_table[code];
+}
+
+/**
+ * @return true if state, of the given size, is the stored state of index
+ */
+static bool is_frozen_state(FrozenChain *frozen_chain, int index,
+                            const void *state, size_t size)
+{
+  const char *stored = frozen_chain->state_pool
+                       + frozen_chain->state_offsets[index];
+  uint64_t stored_size = frozen_chain->state_offsets[index + 1]
+                         - frozen_chain->state_offsets[index];
+  if (align_up (size) != stored_size || memcmp (stored, state, size) != 0)
+    {
+      return false;
+    }
+  for (uint64_t i = size; i < stored_size; i++) // padding of a shorter state
+    {
+      if (stored[i] != 0)
+        {
+          return false;
+        }
+    }
+  return true;
+}
+
+/**
+ * Find a state by it's bytes: one hash, then one compare with the state the
+ * perfect hash leads to.
+ * @param frozen_chain
+ * @param state bytes of the state, as size_func counted them when freezing
+ * @param size number of bytes
+ * @return state index, FROZEN_NO_STATE if the state is not in the chain
+ */
+int find_frozen_state(FrozenChain *frozen_chain, const void *state,
+                      size_t size)
+{
+  FrozenHeader *header = frozen_chain->header;
+  PerfectHash *hash = &frozen_chain->state_hash;
+  uint64_t value = get_perfect_hash_value (hash, hash_key (state, size,
+                                                           hash->seed));
+  if (value >= header->num_of_states)
+    {
+      return FROZEN_NO_STATE;
+    }
+  int index = (int) read_bits (frozen_chain->hash_states,
+                               value * header->successor_width,
+                               header->successor_width);
+  if ((uint32_t) index >= header->num_of_states
+      || !is_frozen_state (frozen_chain, index, state, size))
+    {
+      return FROZEN_NO_STATE;
+    }
+  return index;
+}
+
+/**
+ * Get one random state that has successors. Consumes random numbers
+ * exactly as get_first_random_node on the chain it was frozen from.
+ * @param frozen_chain
+ * @return state index, FROZEN_NO_STATE if no state has successors
+ */
+int get_first_random_state(FrozenChain *frozen_chain)
+{
+  if (frozen_chain->header->num_of_edges == 0)
+    {
+      return FROZEN_NO_STATE;
+    }
+  while (true)
+    {
+      int state = get_random_number
+          ((int) frozen_chain->header->num_of_states);
+      if (frozen_chain->totals[state] != 0)
+        {
+          return state;
+        }
+    }
+}
+
+/**
+ * Choose randomly the next state, depend on it's frequency.
+ * @param frozen_chain
+ * @param state state to choose from
+ * @return index of the chosen state, FROZEN_NO_STATE if state has no
+ * successors
+ */
+int get_next_random_state(FrozenChain *frozen_chain, int state)
+{
+  if (frozen_chain->totals[state] == 0)
+    {
+      return FROZEN_NO_STATE;
+    }
+  int64_t index = get_random_number ((int) frozen_chain->totals[state]);
+  uint64_t end = frozen_chain->edge_offsets[state + 1];
+  for (uint64_t edge = frozen_chain->edge_offsets[state]; edge < end; edge++)
+    {
+      index -= get_frozen_frequency (frozen_chain, state, edge);
+      if (index < 0)
+        {
+          return get_frozen_successor (frozen_chain, edge);
+        }
+    }
+  return FROZEN_NO_STATE;
+}
+
+/**
+ * Generate and print random sequence out of the frozen_chain, like
+ * generate_random_sequence.
+ * @param frozen_chain
+ * @param first_state state to start with
+ * @param max_length maximum length of chain to generate
+ */
+void generate_frozen_sequence(FrozenChain *frozen_chain, int first_state,
+                              int max_length)
+{
+  int cur_state = first_state;
+  frozen_chain->print_func (get_frozen_state (frozen_chain, cur_state));
+  int i = 1;
+  while (i < max_length)
+    {
+      cur_state = get_next_random_state (frozen_chain, cur_state);
+      if (cur_state == FROZEN_NO_STATE)
+        {
+          break;
+        }
+      frozen_chain->print_func (get_frozen_state (frozen_chain, cur_state));
+      if (frozen_chain->totals[cur_state] == 0)
+        {
+          break;
+        }
+      i++;
+    }
+}
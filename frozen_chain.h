@@ -0,0 +1,247 @@
+#ifndef _FROZEN_CHAIN_H
+#define _FROZEN_CHAIN_H
+
+#include "markov_chain.h"
+#include "perfect_hash.h"
+#include <stdio.h>  // For FILE
+#include <stdint.h> // For uint32_t, uint64_t
+
+#define FROZEN_MAGIC "MKVFRZ03"
+#define FROZEN_MAGIC_LENGTH 8
+#define FROZEN_NO_STATE (-1)
+#define FROZEN_EXACT_CODE_SHIFT 1 // exact frequency f is stored as code f-1
+#define FROZEN_MAX_WIDTH 32 // most bits of a packed successor or code
+
+/***************************/
+/*        STRUCTS          */
+/***************************/
+
+/**
+ * Header of a frozen model. The model file is the header followed by its
+ * sections, each one 8-byte aligned, exactly as laid out in memory.
+ * All the section fields are byte offsets from the start of the header.
+ */
+typedef struct FrozenHeader {
+    char magic[FROZEN_MAGIC_LENGTH];
+    uint32_t num_of_states;
+    uint32_t successor_width; // bits per successor index
+    uint64_t num_of_edges;
+    uint32_t quant_table_length; // 0 if frequencies are stored exactly
+    uint32_t reserved;
+    uint64_t state_offsets; // uint64_t[num_of_states + 1] into state_pool
+    uint64_t state_pool; // flat copies of the states, 8-byte aligned each
+    uint64_t edge_offsets; // uint64_t[num_of_states + 1], CSR row starts
+    uint64_t totals; // uint32_t[num_of_states], sum of frequencies
+    uint64_t freq_widths; // uint8_t[num_of_states], bits per frequency code
+    uint64_t freq_bit_offsets; // uint64_t[num_of_states], first code bit
+    uint64_t successor_bits; // packed successor indices
+    uint64_t freq_bits; // packed frequency codes
+    uint64_t quant_table; // uint32_t[quant_table_length], code -> frequency
+    uint32_t hash_seed; // of the perfect hash of the states
+    uint32_t num_of_hash_levels; // 0 if there are no states
+    uint64_t hash_levels; // uint64_t[num_of_hash_levels + 1], bit offsets
+    uint64_t hash_bits; // bits of the perfect hash levels
+    uint64_t hash_ranks; // uint32_t ranks of the bits
+    uint64_t hash_states; // state of every hash value, successor_width bits
+    uint64_t size; // size of the whole model in bytes
+} FrozenHeader;
+
+/**
+ * Read-only, compact form of a trained MarkovChain.
+ * Edges are kept in CSR form: the successors of state i are the edges
+ * [edge_offsets[i], edge_offsets[i+1]). Every frequency is stored as a code
+ * of the minimal bit width needed by its own state: frequency-1 when exact,
+ * or the index of a log-spaced bucket in quant_table when quantized.
+ * States are found by their bytes through a minimal perfect hash, whose
+ * value leads to the state in hash_states. The states keep the order they
+ * were added to the MarkovChain in, which random generation depends on, so
+ * hash_states costs successor_width bits per state on top of the about 2.9
+ * of the hash.
+ */
+typedef struct FrozenChain {
+    char *buffer; // header and sections, laid out as in the model file
+    FrozenHeader *header;
+    uint64_t *state_offsets;
+    char *state_pool;
+    uint64_t *edge_offsets;
+    uint32_t *totals;
+    uint8_t *freq_widths;
+    uint64_t *freq_bit_offsets;
+    uint64_t *successor_bits;
+    uint64_t *freq_bits;
+    uint32_t *quant_table;
+    PerfectHash state_hash; // arrays pointing into buffer
+    uint64_t *hash_states;
+
+    // same as MarkovChain print_func, receives a state from the state_pool
+    void (*print_func)(void*);
+} FrozenChain;
+
+/**
+ * A link between two states, by index, with the number of times it was seen
+ */
+typedef struct FrozenEdge {
+    uint32_t from;
+    uint32_t to;
+    uint32_t frequency;
+} FrozenEdge;
+
+/**
+ * Freeze the given markov_chain. States are copied byte by byte, so they must
+ * be flat (hold no pointers).
+ * @param markov_chain chain to freeze, left untouched
+ * @param size_func returns the size in bytes of a generic state
+ * @param max_error maximal relative error of a stored frequency, 0 for
+ * exact frequencies
+ * @return FrozenChain pointer, NULL in case of memory allocation failure or
+ * if the states have no perfect hash
+ * @ownership Weak Ownership. separate function for Free (free_frozen_chain)
+ */
+FrozenChain* freeze_markov_chain(MarkovChain *markov_chain,
+                                 size_t (*size_func)(void*),
+                                 double max_error);
+
+/**
+ * Build a frozen chain straight from it's states and edges, with no
+ * MarkovChain. States are copied byte by byte, so they must be flat.
+ * @param states the states, by index
+ * @param num_of_states
+ * @param size_func returns the size in bytes of a generic state
+ * @param edges edges sorted by their from state, the successors of a state in
+ * the order they are to be sampled in
+ * @param num_of_edges
+ * @param max_error maximal relative error of a stored frequency, 0 for
+ * exact frequencies
+ * @return FrozenChain pointer, NULL in case of memory allocation failure or
+ * if the states have no perfect hash
+ * @ownership Weak Ownership. separate function for Free (free_frozen_chain)
+ */
+FrozenChain* freeze_edges(void **states, uint32_t num_of_states,
+                          size_t (*size_func)(void*),
+                          const FrozenEdge *edges, uint64_t num_of_edges,
+                          double max_error);
+
+/**
+ * Write frozen_chain to the given file.
+ * @param frozen_chain
+ * @param fp file opened for binary writing
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+int save_frozen_chain(FrozenChain *frozen_chain, FILE *fp);
+
+/**
+ * Write the model freeze_edges would build, reading the edges from a file
+ * instead of memory: only the per state sections are kept in memory, the
+ * edges are read again for every section that needs them.
+ * @param states the states, by index
+ * @param num_of_states
+ * @param size_func returns the size in bytes of a generic state
+ * @param edges_file file of FrozenEdge, sorted by their from state
+ * @param max_error maximal relative error of a stored frequency, 0 for
+ * exact frequencies
+ * @param fp file opened for binary writing
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+int write_frozen_edges(void **states, uint32_t num_of_states,
+                       size_t (*size_func)(void*), FILE *edges_file,
+                       double max_error, FILE *fp);
+
+/**
+ * Read a frozen chain written by save_frozen_chain.
+ * @param fp file opened for binary reading
+ * @param print_func print function of the stored states
+ * @return FrozenChain pointer, NULL if the file is not a valid model or in
+ * case of memory allocation failure
+ * @ownership Weak Ownership. separate function for Free (free_frozen_chain)
+ */
+FrozenChain* load_frozen_chain(FILE *fp, void (*print_func)(void*));
+
+/**
+ * Check that the sections of header follow each other inside the model,
+ * each one big enough for it's fixed size content.
+ * @param header header read from a model file
+ * @return true if the header is valid
+ */
+bool is_valid_frozen_header(FrozenHeader *header);
+
+/**
+ * Check that the edges of a row of the model are inside it: begin to end
+ * within the edges, and their frequency codes within the freq_bits section.
+ * @param header valid header of the model
+ * @param begin first edge of the row
+ * @param end edge after the last edge of the row
+ * @param width bits of every frequency code of the row
+ * @param freq_bit first bit of the codes of the row in freq_bits
+ * @return true if the row is valid
+ */
+bool is_valid_frozen_row(FrozenHeader *header, uint64_t begin, uint64_t end,
+                         uint32_t width, uint64_t freq_bit);
+
+/**
+ * Free frozen_chain and all of it's content from memory
+ * @param frozen_chain_p frozen chain to free
+ */
+void free_frozen_chain(FrozenChain **frozen_chain_p);
+
+/**
+ * @param frozen_chain
+ * @param state state index
+ * @return pointer to the stored copy of the state
+ */
+void* get_frozen_state(FrozenChain *frozen_chain, int state);
+
+/**
+ * @param frozen_chain
+ * @param edge edge index
+ * @return index of the state the edge leads to
+ */
+int get_frozen_successor(FrozenChain *frozen_chain, uint64_t edge);
+
+/**
+ * @param frozen_chain
+ * @param state state the edge leaves from
+ * @param edge edge index
+ * @return frequency of the edge, as decoded from its stored code
+ */
+uint32_t get_frozen_frequency(FrozenChain *frozen_chain, int state,
+                              uint64_t edge);
+
+/**
+ * Find a state by it's bytes: one hash, then one compare with the state the
+ * perfect hash leads to.
+ * @param frozen_chain
+ * @param state bytes of the state, as size_func counted them when freezing
+ * @param size number of bytes
+ * @return state index, FROZEN_NO_STATE if the state is not in the chain
+ */
+int find_frozen_state(FrozenChain *frozen_chain, const void *state,
+                      size_t size);
+
+/**
+ * Get one random state that has successors. Consumes random numbers
+ * exactly as get_first_random_node on the chain it was frozen from.
+ * @param frozen_chain
+ * @return state index, FROZEN_NO_STATE if no state has successors
+ */
+int get_first_random_state(FrozenChain *frozen_chain);
+
+/**
+ * Choose randomly the next state, depend on it's frequency.
+ * @param frozen_chain
+ * @param state state to choose from
+ * @return index of the chosen state, FROZEN_NO_STATE if state has no
+ * successors
+ */
+int get_next_random_state(FrozenChain *frozen_chain, int state);
+
+/**
+ * Generate and print random sequence out of the frozen_chain, like
+ * generate_random_sequence.
+ * @param frozen_chain
+ * @param first_state state to start with
+ * @param max_length maximum length of chain to generate
+ */
+void generate_frozen_sequence(FrozenChain *frozen_chain, int first_state,
+                              int max_length);
+
+#endif /* _FROZEN_CHAIN_H */
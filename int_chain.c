@@ -0,0 +1,120 @@
+#include "int_chain.h"
+#include <string.h>
+
+#define ALLOC_ERROR_INT_CHAIN \
+"Allocation failure: Alloc of new IntChain failed.\n"
+
+/**
+ * Initialize and Allocate new IntChain of states with no links
+ * @param num_of_states
+ * @param print_func prints a state, given a pointer to it's number
+ * @param is_last tells a last state, given a pointer to it's number
+ * @return IntChain pointer, NULL in case of memory allocation failure
+ * @ownership Weak Ownership. separate function for Free (free_int_chain)
+ */
+IntChain* new_int_chain(int num_of_states, void (*print_func)(void*),
+                        bool (*is_last)(void*))
+{
+  size_t n = num_of_states > 0 ? (size_t) num_of_states : 0;
+  IntChain *int_chain = malloc (sizeof (IntChain));
+  MarkovChain *markov_chain = malloc (sizeof (MarkovChain));
+  LinkedList *database = malloc (sizeof (LinkedList));
+  MarkovNode *nodes = malloc (sizeof (MarkovNode) * (n + 1));
+  Node *database_nodes = malloc (sizeof (Node) * (n + 1));
+  if (int_chain == NULL || markov_chain == NULL || database == NULL
+      || nodes == NULL || database_nodes == NULL)
+    {
+      printf ("%s", ALLOC_ERROR_INT_CHAIN);
+      free (int_chain);
+      free (markov_chain);
+      free (database);
+      free (nodes);
+      free (database_nodes);
+      return NULL;
+    }
+  for (size_t i = 0; i < n; i++)
+    {
+      int state = (int) i;
+      nodes[i] = (MarkovNode) {NULL, NULL, 0, 0, state, {{0}}};
+      // the union is as big as a long long, whatever MARKOV_INLINE_SIZE is
+      memcpy (&nodes[i].inline_data, &state, sizeof (int));
+      nodes[i].data = nodes[i].inline_data.bytes;
+      database_nodes[i] = (Node) {&nodes[i], NULL};
+      if (i > 0)
+        {
+          database_nodes[i - 1].next = &database_nodes[i];
+        }
+    }
+  *database = (LinkedList) {n > 0 ? database_nodes : NULL,
+                            n > 0 ? &database_nodes[n - 1] : NULL, (int) n};
+  // nothing to compare, copy or free: the view is never added to
+  *markov_chain = (MarkovChain) {database, print_func, NULL, NULL, NULL,
+                                 is_last};
+  *int_chain = (IntChain) {markov_chain, (int) n, nodes, database_nodes};
+  return int_chain;
+}
+
+/**
+ * @param int_chain
+ * @param state number of the state
+ * @return MarkovNode of the state, NULL if there is no such state
+ */
+MarkovNode* get_int_node(IntChain *int_chain, int state)
+{
+  if (state < 0 || state >= int_chain->num_of_states)
+    {
+      return NULL;
+    }
+  return &int_chain->nodes[state];
+}
+
+/**
+ * @param markov_node MarkovNode of an IntChain
+ * @return number of the state
+ */
+int get_int_state(MarkovNode *markov_node)
+{
+  return markov_node->id; // the number of the state is it's position
+}
+
+/**
+ * Link state from to state to, as if to followed it weight times
+ * @param int_chain
+ * @param from number of the state
+ * @param to number of the state
+ * @param weight number of occurrences to add
+ * @return false in case of memory allocation failure or if there is no such
+ * state
+ */
+bool add_int_link(IntChain *int_chain, int from, int to, int weight)
+{
+  MarkovNode *from_node = get_int_node (int_chain, from);
+  MarkovNode *to_node = get_int_node (int_chain, to);
+  if (from_node == NULL || to_node == NULL)
+    {
+      return false;
+    }
+  return add_weighted_node_to_counter_list (from_node, to_node,
+                                            int_chain->markov_chain, weight);
+}
+
+/**
+ * Free int_chain and all of it's content from memory
+ * @param int_chain_p chain to free
+ */
+void free_int_chain(IntChain **int_chain_p)
+{
+  if (*int_chain_p != NULL)
+    {
+      for (int i = 0; i < (*int_chain_p)->num_of_states; i++)
+        {
+          free ((*int_chain_p)->nodes[i].counter_list);
+        }
+      free ((*int_chain_p)->nodes);
+      free ((*int_chain_p)->database_nodes);
+      free ((*int_chain_p)->markov_chain->database);
+      free ((*int_chain_p)->markov_chain);
+      free (*int_chain_p);
+      *int_chain_p = NULL;
+    }
+}
@@ -0,0 +1,67 @@
+#ifndef _INT_CHAIN_H
+#define _INT_CHAIN_H
+
+#include "markov_chain.h"
+
+/***************************/
+/*        STRUCTS          */
+/***************************/
+
+/**
+ * A MarkovChain specialized for states that are the numbers 0 to
+ * num_of_states - 1. All the states are made at once, in a single array of
+ * MarkovNode indexed by their number, each holding it's number inline: a
+ * state is found by indexing, and there is nothing to copy, compare or
+ * free. The states are also the database of a MarkovChain, kept in one
+ * array of Node, so the functions of MarkovChain can walk and print it; the
+ * view must not be added to, nor freed by free_markov_chain.
+ */
+typedef struct IntChain {
+    MarkovChain *markov_chain; // view of the states, for the generic funcs
+    int num_of_states;
+    MarkovNode *nodes; // nodes[i] is state i
+    Node *database_nodes; // database of the view, in the order of the states
+} IntChain;
+
+/**
+ * Initialize and Allocate new IntChain of states with no links
+ * @param num_of_states
+ * @param print_func prints a state, given a pointer to it's number
+ * @param is_last tells a last state, given a pointer to it's number
+ * @return IntChain pointer, NULL in case of memory allocation failure
+ * @ownership Weak Ownership. separate function for Free (free_int_chain)
+ */
+IntChain* new_int_chain(int num_of_states, void (*print_func)(void*),
+                        bool (*is_last)(void*));
+
+/**
+ * @param int_chain
+ * @param state number of the state
+ * @return MarkovNode of the state, NULL if there is no such state
+ */
+MarkovNode* get_int_node(IntChain *int_chain, int state);
+
+/**
+ * @param markov_node MarkovNode of an IntChain
+ * @return number of the state
+ */
+int get_int_state(MarkovNode *markov_node);
+
+/**
+ * Link state from to state to, as if to followed it weight times
+ * @param int_chain
+ * @param from number of the state
+ * @param to number of the state
+ * @param weight number of occurrences to add
+ * @return false in case of memory allocation failure or if there is no such
+ * state
+ */
+bool add_int_link(IntChain *int_chain, int from, int to, int weight);
+
+/**
+ * Free int_chain and all of it's content from memory
+ * @param int_chain_p chain to free
+ */
+void free_int_chain(IntChain **int_chain_p);
+
+#endif /* _INT_CHAIN_H */
@@ -6,6 +6,7 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
+#include <limits.h>
 
 #define ALLOC_ERROR_MARKOV_CHAIN \
 "Allocation failure: Alloc of new MarkovChain failed.\n"
@@ -20,6 +21,14 @@
 "Allocation failure: Alloc of counter_list failed.\n"
 #define ALLOC_ERROR_REALLOC_COUNTER_LIST \
 "Allocation failure: reallocation of NextNodeCounter array failed.\n"
+#define ALLOC_ERROR_STATE_INDEX \
+"Allocation failure: Alloc of MarkovStateIndex slots failed.\n"
+#define COUNT_ERROR_COUNTER_LIST \
+"ERROR: occurrences of links from a state exceed the int range.\n"
+#define WEIGHT_ERROR_COUNTER_LIST \
+"ERROR: a link must occur at least once.\n"
+
+#define INITIAL_INDEX_SLOTS 64
 
 
 /**
@@ -61,13 +70,25 @@ MarkovNode* get_first_random_node(MarkovChain *markov_chain)
  */
 MarkovNode* get_next_random_node(MarkovNode *state_struct_ptr)
 {
-  int index = get_random_number(state_struct_ptr->
-      counter_list_total);
+  return get_next_node_by_value (state_struct_ptr, get_random_number
+      (state_struct_ptr->counter_list_total));
+}
+
+/**
+ * The next state a value in [0, counter_list_total) stands for, every state
+ * standing for as many values as it's occurrence frequency: with a uniform
+ * value, from any random source, it is chosen as by get_next_random_node.
+ * @param state_struct_ptr MarkovNode to choose from
+ * @param value number in [0, counter_list_total)
+ * @return MarkovNode of the chosen state, NULL if value is out of range
+ */
+MarkovNode* get_next_node_by_value(MarkovNode *state_struct_ptr, int value)
+{
   int i = 0;
   while (i < (state_struct_ptr->counter_list_length))
     {
-      index -= state_struct_ptr->counter_list[i].frequency;
-      if (index < 0)
+      value -= state_struct_ptr->counter_list[i].frequency;
+      if (value < 0)
        {
           return (state_struct_ptr->counter_list[i]).markov_node;
        }
@@ -182,13 +203,19 @@ MarkovNode* new_markov_node()
       return NULL;
     }
   *new_markov_node = (MarkovNode) {NULL, NULL, 0,
-                                   0};
+                                   0, 0, {{0}}};
   return new_markov_node;
 }
 
 int new_generic_data(void *data, MarkovNode *markov_node, MarkovChain
-*markov_chain)
+*markov_chain, size_t size)
 {
+  if (size <= MARKOV_INLINE_SIZE) // small state, no allocation
+    {
+      memcpy (markov_node->inline_data.bytes, data, size);
+      markov_node->data = markov_node->inline_data.bytes;
+      return EXIT_SUCCESS;
+    }
   void *cur_data = markov_chain->copy_func(data); //data allocated in copy_func
   if (cur_data == NULL)
     {
@@ -209,7 +236,10 @@ int new_generic_data(void *data, MarkovNode *markov_node, MarkovChain
  */
 void free_markov_node(MarkovChain *markov_chain_p, MarkovNode *markov_node_p)
 {
-  (markov_chain_p)->free_data(markov_node_p->data); // free generic data
+  if (markov_node_p->data != markov_node_p->inline_data.bytes)
+    {
+      (markov_chain_p)->free_data(markov_node_p->data); // free generic data
+    }
   if (markov_node_p->counter_list != NULL) // if counter_list is not NULL
     {
       free( markov_node_p->counter_list);
@@ -249,11 +279,43 @@ void free_markov_chain(MarkovChain ** ptr_chain)
  * @param second_node
  * @param markov_chain
  * @return success/failure: true if the process was successful, false if in
- * case of allocation error.
+ * case of allocation error or if the occurrences of the links from
+ * first_node would exceed INT_MAX.
  */
 bool add_node_to_counter_list(MarkovNode *first_node, MarkovNode *second_node,
                               MarkovChain *markov_chain)
 {
+  return add_weighted_node_to_counter_list (first_node, second_node,
+                                            markov_chain, 1);
+}
+
+/**
+ * Add the second markov_node to the counter list of the first markov_node,
+ * as if it followed it weight times. If already in list, update it's counter
+ * value.
+ * @param first_node
+ * @param second_node
+ * @param markov_chain
+ * @param weight number of occurrences to add, at least 1
+ * @return success/failure: true if the process was successful, false if in
+ * case of allocation error, if weight is less than 1 or if the occurrences
+ * of the links from first_node would exceed INT_MAX.
+ */
+bool add_weighted_node_to_counter_list(MarkovNode *first_node,
+                                       MarkovNode *second_node,
+                                       MarkovChain *markov_chain, int weight)
+{
+  (void) markov_chain; // states are told apart by their MarkovNode
+  if (weight < 1) // a link of no occurrences would leave a zero total
+    {
+      printf ("%s", WEIGHT_ERROR_COUNTER_LIST);
+      return false;
+    }
+  if (weight > INT_MAX - first_node->counter_list_total) // bounds frequency
+    {
+      printf ("%s", COUNT_ERROR_COUNTER_LIST);
+      return false;
+    }
   if (first_node->counter_list == NULL)
     {
       first_node->counter_list = new_counter_list(first_node);
@@ -263,14 +325,13 @@ bool add_node_to_counter_list(MarkovNode *first_node, MarkovNode *second_node,
         }
     }
   else // if NextNodeCounter counter_list is already initialized
-    { // Check if data is already in NextNodeCounter counter_list
+    { // Check if node is already in NextNodeCounter counter_list
       for (int i = 0; i < first_node->counter_list_length; i++)
-        {
-          if ((markov_chain->comp_func(first_node->counter_list[i].
-          markov_node->data,second_node->data))==0)
+        { // a state has a single MarkovNode, so nodes compare by address
+          if (first_node->counter_list[i].markov_node == second_node)
             {
-              first_node->counter_list[i].frequency++;
-              first_node->counter_list_total++;
+              first_node->counter_list[i].frequency += weight;
+              first_node->counter_list_total += weight;
               return true;
             }
         } // If it is not, reallocate counter_list and add it
@@ -283,10 +344,10 @@ bool add_node_to_counter_list(MarkovNode *first_node, MarkovNode *second_node,
         }
       first_node->counter_list = success;
     }
-  NextNodeCounter second=(NextNodeCounter){second_node,1};
+  NextNodeCounter second=(NextNodeCounter){second_node,weight};
   first_node->counter_list[first_node->counter_list_length] = second;
   first_node->counter_list_length++;
-  first_node->counter_list_total++;
+  first_node->counter_list_total += weight;
   return true;
 }
 
@@ -323,24 +384,56 @@ Node* get_node_from_database(MarkovChain *markov_chain, void *data_ptr)
  * returns NULL in case of memory allocation failure.
  */
 Node* add_to_database(MarkovChain *markov_chain, void *data_ptr)
+{
+  return add_sized_to_database (markov_chain, data_ptr, MARKOV_UNKNOWN_SIZE);
+}
+
+/**
+ * Like add_to_database, for a state of known size: a new state of up to
+ * MARKOV_INLINE_SIZE bytes is copied inside it's MarkovNode, without
+ * copy_func, and is not given to free_data.
+ * @param markov_chain the chain to look in its database
+ * @param data_ptr the state to look for
+ * @param size bytes of the state, MARKOV_UNKNOWN_SIZE to use copy_func
+ * @return Node wrapping given data_ptr in given chain's database, NULL in
+ * case of memory allocation failure.
+ */
+Node* add_sized_to_database(MarkovChain *markov_chain, void *data_ptr,
+                            size_t size)
 {
    Node *is_found = get_node_from_database (markov_chain, data_ptr);
    if (is_found != NULL)
      {
        return is_found;
      }
+  return append_to_database (markov_chain, data_ptr, size);
+}
+
+/**
+ * Add a state the caller knows is not in the database yet, to it's end,
+ * without looking for it: as add_sized_to_database, in constant time.
+ * @param markov_chain the chain to add to
+ * @param data_ptr the new state
+ * @param size bytes of the state, MARKOV_UNKNOWN_SIZE to use copy_func
+ * @return Node wrapping given data_ptr in given chain's database, NULL in
+ * case of memory allocation failure.
+ */
+Node* append_to_database(MarkovChain *markov_chain, void *data_ptr,
+                         size_t size)
+{
   MarkovNode *new_markov = new_markov_node ();
   if (new_markov == NULL)
     {
       return NULL;
     }
   int success = new_generic_data(data_ptr, new_markov,
-                                 markov_chain);
+                                 markov_chain, size);
   if (success == EXIT_FAILURE)
     {
       free(new_markov);
       return NULL;
     }
+  new_markov->id = markov_chain->database->size;
   success = add (markov_chain->database, new_markov);
   if (success == EXIT_FAILURE)
     {
@@ -351,4 +444,122 @@ Node* add_to_database(MarkovChain *markov_chain, void *data_ptr)
   return markov_chain->database->last;
 }
 
+/**
+ * Learn one occurrence of a state: add it to the database if needed, and
+ * link it after the previous state. Costs a single database lookup.
+ * @param markov_chain
+ * @param prev MarkovNode returned for the previous state, NULL if the state
+ * is not linked to it
+ * @param data_ptr the state
+ * @return MarkovNode of the state, to pass as prev for the next one, NULL in
+ * case of allocation failure
+ */
+MarkovNode* markov_chain_observe(MarkovChain *markov_chain, MarkovNode *prev,
+                                 void *data_ptr)
+{
+  return markov_chain_observe_weighted (markov_chain, prev, data_ptr, 1);
+}
+
+/**
+ * Like markov_chain_observe, as if the link was seen weight times.
+ * @param markov_chain
+ * @param prev MarkovNode returned for the previous state, or NULL
+ * @param data_ptr the state
+ * @param weight number of occurrences of the link, at least 1
+ * @return MarkovNode of the state, NULL in case of allocation failure or if
+ * weight is less than 1
+ */
+MarkovNode* markov_chain_observe_weighted(MarkovChain *markov_chain,
+                                          MarkovNode *prev, void *data_ptr,
+                                          int weight)
+{
+  return markov_chain_observe_sized (markov_chain, prev, data_ptr,
+                                     MARKOV_UNKNOWN_SIZE, weight);
+}
+
+/**
+ * Like markov_chain_observe_weighted, for a state of known size, that is
+ * stored inline if small enough (see add_sized_to_database).
+ * @param markov_chain
+ * @param prev MarkovNode returned for the previous state, or NULL
+ * @param data_ptr the state
+ * @param size bytes of the state, MARKOV_UNKNOWN_SIZE to use copy_func
+ * @param weight number of occurrences of the link, at least 1
+ * @return MarkovNode of the state, NULL in case of allocation failure or if
+ * weight is less than 1
+ */
+MarkovNode* markov_chain_observe_sized(MarkovChain *markov_chain,
+                                       MarkovNode *prev, void *data_ptr,
+                                       size_t size, int weight)
+{
+  Node *node = add_sized_to_database (markov_chain, data_ptr, size);
+  if (node == NULL)
+    {
+      return NULL;
+    }
+  if (prev != NULL && !add_weighted_node_to_counter_list (prev, node->data,
+                                                          markov_chain,
+                                                          weight))
+    {
+      return NULL;
+    }
+  return node->data;
+}
+
+/**
+ * Make room in index for one more state, doubling it's slots if it would be
+ * more than half full
+ * @param index
+ * @return false in case of memory allocation failure
+ */
+bool reserve_markov_state_index(MarkovStateIndex *index)
+{
+  if (((size_t) index->size + 1) * 2 <= index->num_of_slots)
+    {
+      return true;
+    }
+  size_t num_of_slots = index->num_of_slots == 0 ? INITIAL_INDEX_SLOTS
+                                                 : index->num_of_slots * 2;
+  Node **slots = calloc (num_of_slots, sizeof (Node*));
+  size_t *hashes = malloc (sizeof (size_t) * num_of_slots);
+  if (slots == NULL || hashes == NULL)
+    {
+      printf ("%s", ALLOC_ERROR_STATE_INDEX);
+      free (slots);
+      free (hashes);
+      return false;
+    }
+  for (size_t old = 0; old < index->num_of_slots; old++)
+    {
+      if (index->slots[old] == NULL)
+        {
+          continue;
+        }
+      size_t slot = index->hashes[old] & (num_of_slots - 1);
+      while (slots[slot] != NULL)
+        {
+          slot = (slot + 1) & (num_of_slots - 1);
+        }
+      slots[slot] = index->slots[old];
+      hashes[slot] = index->hashes[old];
+    }
+  free (index->slots);
+  free (index->hashes);
+  index->slots = slots;
+  index->hashes = hashes;
+  index->num_of_slots = num_of_slots;
+  return true;
+}
+
+/**
+ * Free the slots of index, leaving it empty
+ * @param index
+ */
+void free_markov_state_index(MarkovStateIndex *index)
+{
+  free (index->slots);
+  free (index->hashes);
+  *index = (MarkovStateIndex) {NULL, NULL, 0, 0, NULL};
+}
+
 #endif
\ No newline at end of file
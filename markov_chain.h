@@ -6,6 +6,14 @@
 #include <stdlib.h> // For exit(), malloc()
 #include <stdbool.h> // for bool
 
+// states of up to this many bytes are stored inside their MarkovNode, 0
+// stores every state by copy_func. Build with -DMARKOV_INLINE_SIZE=N to
+// change it.
+#ifndef MARKOV_INLINE_SIZE
+#define MARKOV_INLINE_SIZE 16
+#endif
+#define MARKOV_UNKNOWN_SIZE ((size_t) -1) // size of a state copy_func copies
+
 /***************************/
 /*        STRUCTS          */
 /***************************/
@@ -16,11 +24,18 @@ typedef struct NextNodeCounter {
 } NextNodeCounter;
 
 typedef struct MarkovNode {
-    void *data;
+    void *data; // points at inline_data if the state is stored inline
     NextNodeCounter *counter_list;
     // counters of counter_list elements
     int counter_list_total; // duplicates considered
     int counter_list_length; // no duplicates, actual length of array
+    int id; // position of the node in the markov_chain's database
+    union {
+        char bytes[MARKOV_INLINE_SIZE > 0 ? MARKOV_INLINE_SIZE : 1];
+        long long align_long; // aligned for any small state
+        double align_double;
+        void *align_pointer;
+    } inline_data;
 } MarkovNode;
 
 
@@ -56,6 +71,29 @@ typedef struct MarkovChain {
     bool (*is_last)(void*);
 } MarkovChain;
 
+/**
+ * Index of the states of a MarkovChain by their hash, for the functions of
+ * markov_chain_template.h that are given a hash: open addressing with linear
+ * probing, in a power of 2 number of slots kept at most half full. It is
+ * kept by the caller next to the chain, zero initialized, and indexes the
+ * states of the database in order, so states added by the generic
+ * functions are indexed when they are next looked for.
+ */
+typedef struct MarkovStateIndex {
+    Node **slots; // NULL for an empty slot
+    size_t *hashes; // hash of the state of every slot
+    size_t num_of_slots;
+    int size; // the first size states of the database are indexed
+    Node *last; // Node of the last state indexed, NULL if none
+} MarkovStateIndex;
+
+/**
+* Get random number between 0 and max_number [0, max_number).
+* @param max_number maximal number to return (not including)
+* @return Random number
+*/
+int get_random_number(int max_number);
+
 /**
  * Get one random state from the given markov_chain's database.
  * @param markov_chain
@@ -70,6 +108,16 @@ MarkovNode* get_first_random_node(MarkovChain *markov_chain);
  */
 MarkovNode* get_next_random_node(MarkovNode *state_struct_ptr);
 
+/**
+ * The next state a value in [0, counter_list_total) stands for, every state
+ * standing for as many values as it's occurrence frequency: with a uniform
+ * value, from any random source, it is chosen as by get_next_random_node.
+ * @param state_struct_ptr MarkovNode to choose from
+ * @param value number in [0, counter_list_total)
+ * @return MarkovNode of the chosen state, NULL if value is out of range
+ */
+MarkovNode* get_next_node_by_value(MarkovNode *state_struct_ptr, int value);
+
 /**
  * Receive markov_chain, generate and print random sentence out of it. The
  * sentence most have at least 2 words in it.
@@ -94,11 +142,28 @@ void free_markov_chain(MarkovChain **markov_chain);
  * @param second_node
  * @param markov_chain
  * @return success/failure: true if the process was successful, false if in
- * case of allocation error.
+ * case of allocation error or if the occurrences of the links from
+ * first_node would exceed INT_MAX.
  */
 bool add_node_to_counter_list(MarkovNode *first_node, MarkovNode
 *second_node, MarkovChain *markov_chain);
 
+/**
+ * Add the second markov_node to the counter list of the first markov_node,
+ * as if it followed it weight times. If already in list, update it's counter
+ * value.
+ * @param first_node
+ * @param second_node
+ * @param markov_chain
+ * @param weight number of occurrences to add, at least 1
+ * @return success/failure: true if the process was successful, false if in
+ * case of allocation error, if weight is less than 1 or if the occurrences
+ * of the links from first_node would exceed INT_MAX.
+ */
+bool add_weighted_node_to_counter_list(MarkovNode *first_node,
+                                       MarkovNode *second_node,
+                                       MarkovChain *markov_chain, int weight);
+
 /**
 * Check if data_ptr is in database. If so, return the markov_node wrapping it
  * in
@@ -119,6 +184,72 @@ Node* get_node_from_database(MarkovChain *markov_chain, void *data_ptr);
  */
 Node* add_to_database(MarkovChain *markov_chain, void *data_ptr);
 
+/**
+ * Like add_to_database, for a state of known size: a new state of up to
+ * MARKOV_INLINE_SIZE bytes is copied inside it's MarkovNode, without
+ * copy_func, and is not given to free_data.
+ * @param markov_chain the chain to look in its database
+ * @param data_ptr the state to look for
+ * @param size bytes of the state, MARKOV_UNKNOWN_SIZE to use copy_func
+ * @return Node wrapping given data_ptr in given chain's database, NULL in
+ * case of memory allocation failure.
+ */
+Node* add_sized_to_database(MarkovChain *markov_chain, void *data_ptr,
+                            size_t size);
+
+/**
+ * Add a state the caller knows is not in the database yet, to it's end,
+ * without looking for it: as add_sized_to_database, in constant time.
+ * @param markov_chain the chain to add to
+ * @param data_ptr the new state
+ * @param size bytes of the state, MARKOV_UNKNOWN_SIZE to use copy_func
+ * @return Node wrapping given data_ptr in given chain's database, NULL in
+ * case of memory allocation failure.
+ */
+Node* append_to_database(MarkovChain *markov_chain, void *data_ptr,
+                         size_t size);
+
+/**
+ * Learn one occurrence of a state: add it to the database if needed, and
+ * link it after the previous state. Costs a single database lookup.
+ * @param markov_chain
+ * @param prev MarkovNode returned for the previous state, NULL if the state
+ * is not linked to it
+ * @param data_ptr the state
+ * @return MarkovNode of the state, to pass as prev for the next one, NULL in
+ * case of allocation failure
+ */
+MarkovNode* markov_chain_observe(MarkovChain *markov_chain, MarkovNode *prev,
+                                 void *data_ptr);
+
+/**
+ * Like markov_chain_observe, as if the link was seen weight times.
+ * @param markov_chain
+ * @param prev MarkovNode returned for the previous state, or NULL
+ * @param data_ptr the state
+ * @param weight number of occurrences of the link, at least 1
+ * @return MarkovNode of the state, NULL in case of allocation failure or if
+ * weight is less than 1
+ */
+MarkovNode* markov_chain_observe_weighted(MarkovChain *markov_chain,
+                                          MarkovNode *prev, void *data_ptr,
+                                          int weight);
+
+/**
+ * Like markov_chain_observe_weighted, for a state of known size, that is
+ * stored inline if small enough (see add_sized_to_database).
+ * @param markov_chain
+ * @param prev MarkovNode returned for the previous state, or NULL
+ * @param data_ptr the state
+ * @param size bytes of the state, MARKOV_UNKNOWN_SIZE to use copy_func
+ * @param weight number of occurrences of the link, at least 1
+ * @return MarkovNode of the state, NULL in case of allocation failure or if
+ * weight is less than 1
+ */
+MarkovNode* markov_chain_observe_sized(MarkovChain *markov_chain,
+                                       MarkovNode *prev, void *data_ptr,
+                                       size_t size, int weight);
+
 /**
  * Initialize and Allocate new MarkovChain
  * @return MarkovChain pointer
@@ -151,4 +282,18 @@ MarkovNode* new_markov_node();
  */
 void free_markov_node(MarkovChain *markov_chain_p, MarkovNode *markov_node_p);
 
+/**
+ * Make room in index for one more state, doubling it's slots if it would be
+ * more than half full
+ * @param index
+ * @return false in case of memory allocation failure
+ */
+bool reserve_markov_state_index(MarkovStateIndex *index);
+
+/**
+ * Free the slots of index, leaving it empty
+ * @param index
+ */
+void free_markov_state_index(MarkovStateIndex *index);
+
 #endif /* MARKOV_CHAIN_H */
@@ -0,0 +1,255 @@
+/*
+ * Functions of a MarkovChain specialized for one type of state, with it's
+ * compare and print written in rather than called through the callbacks of
+ * the chain, so the compiler can inline them in the loops. Include this
+ * file, once per type, after defining:
+ *
+ *   MARKOV_TEMPLATE_NAME           prefix of the functions, e.g. word
+ *   MARKOV_TEMPLATE_TYPE           type of the states, e.g. char
+ *   MARKOV_TEMPLATE_EQUAL(a, b)    true if the states a and b are equal
+ *   MARKOV_TEMPLATE_PRINT(a)       prints the state a
+ *
+ * and optionally, both or neither:
+ *
+ *   MARKOV_TEMPLATE_HASH(a)        size_t hash of the state a
+ *   MARKOV_TEMPLATE_INDEX(chain)   MarkovStateIndex pointer the caller keeps
+ *                                  for the chain
+ *
+ * It defines static functions, NAME_get_node_from_database,
+ * NAME_add_sized_to_database, NAME_observe_sized and
+ * NAME_generate_random_sequence, that do what the function of
+ * markov_chain.h they are named after does, on a chain of such states, and
+ * undefines the parameters. With a hash a state is looked for in the index,
+ * with the hash written in too, comparing only the states of it's hash;
+ * without one the database is scanned. The chain is the usual MarkovChain,
+ * so the generic functions still work on it.
+ */
+#include "markov_chain.h"
+
+#if !defined MARKOV_TEMPLATE_NAME || !defined MARKOV_TEMPLATE_TYPE \
+    || !defined MARKOV_TEMPLATE_EQUAL || !defined MARKOV_TEMPLATE_PRINT
+#error "markov_chain_template.h needs all of it's parameters defined"
+#endif
+#if defined MARKOV_TEMPLATE_HASH != defined MARKOV_TEMPLATE_INDEX
+#error "markov_chain_template.h needs both of it's index parameters or none"
+#endif
+
+#define MARKOV_TEMPLATE_JOIN(prefix, name) prefix ## _ ## name
+#define MARKOV_TEMPLATE_EXPAND(prefix, name) MARKOV_TEMPLATE_JOIN(prefix, name)
+#define MARKOV_TEMPLATE_FUNC(name) \
+MARKOV_TEMPLATE_EXPAND(MARKOV_TEMPLATE_NAME, name)
+
+#ifdef MARKOV_TEMPLATE_HASH
+/**
+ * @param index index with at least one empty slot
+ * @param data_ptr the state to look for
+ * @param hash hash of the state
+ * @return slot of index the state is in, or the empty slot it would go to
+ */
+static inline size_t MARKOV_TEMPLATE_FUNC(find_slot)
+    (const MarkovStateIndex *index, const MARKOV_TEMPLATE_TYPE *data_ptr,
+     size_t hash)
+{
+  size_t mask = index->num_of_slots - 1;
+  size_t slot = hash & mask;
+  while (index->slots[slot] != NULL)
+    {
+      const MARKOV_TEMPLATE_TYPE *state = index->slots[slot]->data->data;
+      if (index->hashes[slot] == hash && MARKOV_TEMPLATE_EQUAL(state, data_ptr))
+        {
+          break;
+        }
+      slot = (slot + 1) & mask;
+    }
+  return slot;
+}
+
+/**
+ * Index the states added to the database since it was last indexed
+ * @param markov_chain
+ * @param index index of the chain
+ * @return false in case of memory allocation failure
+ */
+static inline bool MARKOV_TEMPLATE_FUNC(update_index)
+    (MarkovChain *markov_chain, MarkovStateIndex *index)
+{
+  while (index->size < markov_chain->database->size)
+    {
+      if (!reserve_markov_state_index (index))
+        {
+          return false;
+        }
+      Node *node = index->last == NULL ? markov_chain->database->first
+                                       : index->last->next;
+      const MARKOV_TEMPLATE_TYPE *state = node->data->data;
+      size_t hash = MARKOV_TEMPLATE_HASH(state);
+      size_t slot = MARKOV_TEMPLATE_FUNC(find_slot) (index, state, hash);
+      index->slots[slot] = node;
+      index->hashes[slot] = hash;
+      index->size++;
+      index->last = node;
+    }
+  return true;
+}
+
+/**
+ * Check if data_ptr is in database. If so, return the Node wrapping it in
+ * the markov_chain, otherwise return NULL.
+ * @param markov_chain the chain to look in its database
+ * @param data_ptr the state to look for
+ * @return Pointer to the Node wrapping given state, NULL if state not in
+ * database or in case of memory allocation failure.
+ */
+static inline Node* MARKOV_TEMPLATE_FUNC(get_node_from_database)
+    (MarkovChain *markov_chain, const MARKOV_TEMPLATE_TYPE *data_ptr)
+{
+  MarkovStateIndex *index = MARKOV_TEMPLATE_INDEX(markov_chain);
+  if (!MARKOV_TEMPLATE_FUNC(update_index) (markov_chain, index)
+      || index->size == 0)
+    {
+      return NULL;
+    }
+  return index->slots[MARKOV_TEMPLATE_FUNC(find_slot)
+      (index, data_ptr, MARKOV_TEMPLATE_HASH(data_ptr))];
+}
+
+/**
+ * Like add_sized_to_database: the Node of data_ptr, added to the end of the
+ * database if it is not in it.
+ * @param markov_chain the chain to look in its database
+ * @param data_ptr the state to look for
+ * @param size bytes of the state, MARKOV_UNKNOWN_SIZE to use copy_func
+ * @return Node wrapping given data_ptr in given chain's database, NULL in
+ * case of memory allocation failure.
+ */
+static inline Node* MARKOV_TEMPLATE_FUNC(add_sized_to_database)
+    (MarkovChain *markov_chain, MARKOV_TEMPLATE_TYPE *data_ptr, size_t size)
+{
+  MarkovStateIndex *index = MARKOV_TEMPLATE_INDEX(markov_chain);
+  if (!MARKOV_TEMPLATE_FUNC(update_index) (markov_chain, index)
+      || !reserve_markov_state_index (index))
+    {
+      return NULL;
+    }
+  size_t hash = MARKOV_TEMPLATE_HASH(data_ptr);
+  size_t slot = MARKOV_TEMPLATE_FUNC(find_slot) (index, data_ptr, hash);
+  if (index->slots[slot] != NULL)
+    {
+      return index->slots[slot];
+    }
+  Node *node = append_to_database (markov_chain, data_ptr, size);
+  if (node != NULL)
+    {
+      index->slots[slot] = node;
+      index->hashes[slot] = hash;
+      index->size++;
+      index->last = node;
+    }
+  return node;
+}
+#else
+/**
+ * Check if data_ptr is in database. If so, return the Node wrapping it in
+ * the markov_chain, otherwise return NULL.
+ * @param markov_chain the chain to look in its database
+ * @param data_ptr the state to look for
+ * @return Pointer to the Node wrapping given state, NULL if state not in
+ * database.
+ */
+static inline Node* MARKOV_TEMPLATE_FUNC(get_node_from_database)
+    (MarkovChain *markov_chain, const MARKOV_TEMPLATE_TYPE *data_ptr)
+{
+  for (Node *ptr = markov_chain->database->first; ptr != NULL;
+       ptr = ptr->next)
+    {
+      const MARKOV_TEMPLATE_TYPE *state = ptr->data->data;
+      if (MARKOV_TEMPLATE_EQUAL(state, data_ptr))
+        {
+          return ptr;
+        }
+    }
+  return NULL;
+}
+
+/**
+ * Like add_sized_to_database: the Node of data_ptr, added to the end of the
+ * database if it is not in it.
+ * @param markov_chain the chain to look in its database
+ * @param data_ptr the state to look for
+ * @param size bytes of the state, MARKOV_UNKNOWN_SIZE to use copy_func
+ * @return Node wrapping given data_ptr in given chain's database, NULL in
+ * case of memory allocation failure.
+ */
+static inline Node* MARKOV_TEMPLATE_FUNC(add_sized_to_database)
+    (MarkovChain *markov_chain, MARKOV_TEMPLATE_TYPE *data_ptr, size_t size)
+{
+  Node *is_found = MARKOV_TEMPLATE_FUNC(get_node_from_database)
+      (markov_chain, data_ptr);
+  if (is_found != NULL)
+    {
+      return is_found;
+    }
+  return append_to_database (markov_chain, data_ptr, size);
+}
+#endif
+
+/**
+ * Like markov_chain_observe_sized: learn one occurrence of a state, linked
+ * weight times after prev.
+ * @param markov_chain
+ * @param prev MarkovNode returned for the previous state, or NULL
+ * @param data_ptr the state
+ * @param size bytes of the state, MARKOV_UNKNOWN_SIZE to use copy_func
+ * @param weight number of occurrences of the link
+ * @return MarkovNode of the state, NULL in case of allocation failure
+ */
+static inline MarkovNode* MARKOV_TEMPLATE_FUNC(observe_sized)
+    (MarkovChain *markov_chain, MarkovNode *prev,
+     MARKOV_TEMPLATE_TYPE *data_ptr, size_t size, int weight)
+{
+  Node *node = MARKOV_TEMPLATE_FUNC(add_sized_to_database)
+      (markov_chain, data_ptr, size);
+  if (node == NULL)
+    {
+      return NULL;
+    }
+  if (prev != NULL && !add_weighted_node_to_counter_list (prev, node->data,
+                                                          markov_chain,
+                                                          weight))
+    {
+      return NULL;
+    }
+  return node->data;
+}
+
+/**
+ * Like generate_random_sequence: print a random sequence from first_node,
+ * of at most max_length states, stopping at a state with no successors.
+ * @param first_node markov_node to start with
+ * @param max_length maximum length of chain to generate
+ */
+static inline void MARKOV_TEMPLATE_FUNC(generate_random_sequence)
+    (MarkovNode *first_node, int max_length)
+{
+  MarkovNode *cur_node = first_node;
+  MARKOV_TEMPLATE_PRINT((MARKOV_TEMPLATE_TYPE*) cur_node->data);
+  for (int i = 1; i < max_length; i++)
+    {
+      cur_node = get_next_random_node (cur_node);
+      MARKOV_TEMPLATE_PRINT((MARKOV_TEMPLATE_TYPE*) cur_node->data);
+      if (cur_node->counter_list_total == 0)
+        {
+          break;
+        }
+    }
+}
+
+#undef MARKOV_TEMPLATE_FUNC
+#undef MARKOV_TEMPLATE_EXPAND
+#undef MARKOV_TEMPLATE_JOIN
+#undef MARKOV_TEMPLATE_NAME
+#undef MARKOV_TEMPLATE_TYPE
+#undef MARKOV_TEMPLATE_EQUAL
+#undef MARKOV_TEMPLATE_PRINT
+#undef MARKOV_TEMPLATE_HASH
+#undef MARKOV_TEMPLATE_INDEX
@@ -0,0 +1,473 @@
+#define _POSIX_C_SOURCE 200809L // For pread
+#include "paged_chain.h"
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define ALLOC_ERROR_PAGED_CHAIN \
+"Allocation failure: Alloc of new PagedChain failed.\n"
+#define ALLOC_ERROR_PAGED_STATE \
+"Allocation failure: Alloc of paged state failed.\n"
+#define FILE_ERROR_PAGED "ERROR: problem with opening file.\n"
+#define FORMAT_ERROR_PAGED "ERROR: invalid frozen model file.\n"
+#define READ_ERROR_PAGED "ERROR: problem with reading frozen model.\n"
+
+#define NO_PAGE UINT64_MAX
+#define WORD_SHIFT 6
+#define WORD_MASK 63
+#define WORD_BITS 64
+#define PAGED_MAX_MISSES 64 // random states tried before counting the ones
+                            // with successors
+
+/**
+ * Allocate the page cache of paged_chain
+ * @return false in case of memory allocation failure
+ */
+static bool new_page_cache(PagedChain *paged_chain, size_t cache_pages)
+{
+  size_t num_of_sets = (cache_pages + PAGED_WAYS - 1) / PAGED_WAYS;
+  num_of_sets = num_of_sets > 0 ? num_of_sets : 1;
+  size_t num_of_slots = num_of_sets * PAGED_WAYS;
+  paged_chain->num_of_sets = num_of_sets;
+  paged_chain->pages = malloc ((size_t) PAGED_PAGE_SIZE * num_of_slots);
+  paged_chain->page_numbers = malloc (sizeof (uint64_t) * num_of_slots);
+  paged_chain->last_used = calloc (num_of_slots, sizeof (uint64_t));
+  if (paged_chain->pages == NULL || paged_chain->page_numbers == NULL
+      || paged_chain->last_used == NULL)
+    {
+      printf ("%s", ALLOC_ERROR_PAGED_CHAIN);
+      return false;
+    }
+  for (size_t slot = 0; slot < num_of_slots; slot++)
+    {
+      paged_chain->page_numbers[slot] = NO_PAGE;
+    }
+  return true;
+}
+
+/**
+ * Read length bytes at offset of the model file, with no cache. Bytes past
+ * the end of the file read as zeros.
+ * @return false in case of read error
+ */
+static bool read_file(int fd, uint64_t offset, void *buffer, size_t length)
+{
+  size_t done = 0;
+  while (done < length)
+    {
+      ssize_t read_length = pread (fd, (char*) buffer + done, length - done,
+                                   (off_t) (offset + done));
+      if (read_length < 0)
+        {
+          return false;
+        }
+      if (read_length == 0)
+        {
+          memset ((char*) buffer + done, 0, length - done);
+          break;
+        }
+      done += (size_t) read_length;
+    }
+  return true;
+}
+
+/**
+ * @return the cached copy of page, read from the file if it is not cached
+ */
+static const char* get_page(PagedChain *paged_chain, uint64_t page)
+{
+  size_t first = (size_t) (page % paged_chain->num_of_sets) * PAGED_WAYS;
+  size_t victim = first;
+  paged_chain->clock++;
+  for (size_t slot = first; slot < first + PAGED_WAYS; slot++)
+    {
+      if (paged_chain->page_numbers[slot] == page)
+        {
+          paged_chain->last_used[slot] = paged_chain->clock;
+          return paged_chain->pages + slot * PAGED_PAGE_SIZE;
+        }
+      if (paged_chain->last_used[slot] < paged_chain->last_used[victim])
+        {
+          victim = slot;
+        }
+    }
+  char *data = paged_chain->pages + victim * PAGED_PAGE_SIZE;
+  if (!read_file (paged_chain->fd, page * PAGED_PAGE_SIZE, data,
+                  PAGED_PAGE_SIZE))
+    {
+      if (!paged_chain->failed)
+        {
+          printf ("%s", READ_ERROR_PAGED);
+        }
+      paged_chain->failed = true;
+      memset (data, 0, PAGED_PAGE_SIZE);
+    }
+  paged_chain->page_numbers[victim] = page;
+  paged_chain->last_used[victim] = paged_chain->clock;
+  paged_chain->num_of_reads++;
+  return data;
+}
+
+/**
+ * Mark the model file of paged_chain as not usable, it's content not being a
+ * valid model
+ */
+static void fail_format(PagedChain *paged_chain)
+{
+  if (!paged_chain->failed)
+    {
+      printf ("%s", FORMAT_ERROR_PAGED);
+    }
+  paged_chain->failed = true;
+}
+
+/**
+ * Read length bytes at offset of the model, through the page cache
+ */
+static void read_paged(PagedChain *paged_chain, uint64_t offset,
+                       void *buffer, size_t length)
+{
+  char *to = buffer;
+  while (length > 0)
+    {
+      const char *page = get_page (paged_chain, offset / PAGED_PAGE_SIZE);
+      size_t in_page = (size_t) (offset % PAGED_PAGE_SIZE);
+      size_t part = PAGED_PAGE_SIZE - in_page < length ?
+                    PAGED_PAGE_SIZE - in_page : length;
+      memcpy (to, page + in_page, part);
+      to += part;
+      offset += part;
+      length -= part;
+    }
+}
+
+/**
+ * @return entry index of the uint64_t array at offset of the model
+ */
+static uint64_t read_paged_u64(PagedChain *paged_chain, uint64_t offset,
+                               uint64_t index)
+{
+  uint64_t value = 0;
+  read_paged (paged_chain, offset + sizeof (uint64_t) * index, &value,
+              sizeof (uint64_t));
+  return value;
+}
+
+/**
+ * @return total of the frequencies of state
+ */
+static uint32_t read_total(PagedChain *paged_chain, int state)
+{
+  uint32_t total = 0;
+  read_paged (paged_chain, paged_chain->header.totals
+                           + sizeof (uint32_t) * state,
+              &total, sizeof (uint32_t));
+  return total;
+}
+
+/**
+ * Read width bits (at most 32) starting at bit of the packed section at
+ * offset of the model
+ */
+static uint64_t read_paged_bits(PagedChain *paged_chain, uint64_t offset,
+                                uint64_t bit, uint32_t width)
+{
+  if (width == 0)
+    {
+      return 0;
+    }
+  uint64_t words[2] = {0, 0};
+  read_paged (paged_chain, offset + sizeof (uint64_t) * (bit >> WORD_SHIFT),
+              words, sizeof (words));
+  uint32_t shift = (uint32_t) (bit & WORD_MASK);
+  uint64_t value = words[0] >> shift;
+  if (shift + width > WORD_BITS)
+    {
+      value |= words[1] << (WORD_BITS - shift);
+    }
+  return value & ((UINT64_C(1) << width) - 1);
+}
+
+/**
+ * Read the header and the quantization table of the model file
+ * @return false if the file is not a valid model, or in case of memory
+ * allocation failure
+ */
+static bool read_model_header(PagedChain *paged_chain)
+{
+  FrozenHeader *header = &paged_chain->header;
+  struct stat file_stat;
+  if (!read_file (paged_chain->fd, 0, header, sizeof (FrozenHeader))
+      || fstat (paged_chain->fd, &file_stat) != 0
+      || !is_valid_frozen_header (header)
+      || (uint64_t) file_stat.st_size < header->size)
+    {
+      printf ("%s", FORMAT_ERROR_PAGED);
+      return false;
+    }
+  if (header->quant_table_length == 0)
+    {
+      return true;
+    }
+  size_t size = sizeof (uint32_t) * header->quant_table_length;
+  paged_chain->quant_table = malloc (size);
+  if (paged_chain->quant_table == NULL)
+    {
+      printf ("%s", ALLOC_ERROR_PAGED_CHAIN);
+      return false;
+    }
+  if (!read_file (paged_chain->fd, header->quant_table,
+                  paged_chain->quant_table, size))
+    {
+      printf ("%s", READ_ERROR_PAGED);
+      return false;
+    }
+  return true;
+}
+
+/**
+ * Open a frozen model file written by save_frozen_chain to be served from
+ * the file.
+ * @param path model file
+ * @param cache_pages number of pages to cache, rounded up to PAGED_WAYS
+ * @param print_func print function of the stored states
+ * @return PagedChain pointer, NULL if the file can not be opened, is not a
+ * valid model, or in case of memory allocation failure
+ * @ownership Weak Ownership. separate function for Free (close_paged_chain)
+ */
+PagedChain* open_paged_chain(const char *path, size_t cache_pages,
+                             void (*print_func)(void*))
+{
+  PagedChain *paged_chain = calloc (1, sizeof (PagedChain));
+  if (paged_chain == NULL)
+    {
+      printf ("%s", ALLOC_ERROR_PAGED_CHAIN);
+      return NULL;
+    }
+  paged_chain->print_func = print_func;
+  paged_chain->fd = open (path, O_RDONLY);
+  if (paged_chain->fd < 0)
+    {
+      printf ("%s", FILE_ERROR_PAGED);
+      free (paged_chain);
+      return NULL;
+    }
+  if (!read_model_header (paged_chain)
+      || !new_page_cache (paged_chain, cache_pages))
+    {
+      close_paged_chain (&paged_chain);
+    }
+  return paged_chain;
+}
+
+/**
+ * Close the model file and free paged_chain and all of it's content
+ * @param paged_chain_p paged chain to free
+ */
+void close_paged_chain(PagedChain **paged_chain_p)
+{
+  if (*paged_chain_p != NULL)
+    {
+      close ((*paged_chain_p)->fd);
+      free ((*paged_chain_p)->quant_table);
+      free ((*paged_chain_p)->pages);
+      free ((*paged_chain_p)->page_numbers);
+      free ((*paged_chain_p)->last_used);
+      free ((*paged_chain_p)->state);
+      free (*paged_chain_p);
+      *paged_chain_p = NULL;
+    }
+}
+
+/**
+ * @param paged_chain
+ * @param state state index
+ * @return copy of the stored state, valid until the next call, NULL if the
+ * state is not within the model or in case of memory allocation failure
+ */
+void* get_paged_state(PagedChain *paged_chain, int state)
+{
+  uint64_t offset = read_paged_u64 (paged_chain,
+                                    paged_chain->header.state_offsets, state);
+  uint64_t end = read_paged_u64 (paged_chain,
+                                 paged_chain->header.state_offsets,
+                                 state + 1);
+  if (end < offset || end > paged_chain->header.edge_offsets
+                             - paged_chain->header.state_pool)
+    {
+      fail_format (paged_chain);
+      return NULL;
+    }
+  size_t size = (size_t) (end - offset);
+  if (size + 1 > paged_chain->state_capacity) // + 1 for a null if corrupted
+    {
+      char *grown = realloc (paged_chain->state, size + 1);
+      if (grown == NULL)
+        {
+          printf ("%s", ALLOC_ERROR_PAGED_STATE);
+          return NULL;
+        }
+      paged_chain->state = grown;
+      paged_chain->state_capacity = size + 1;
+    }
+  read_paged (paged_chain, paged_chain->header.state_pool + offset,
+              paged_chain->state, size);
+  paged_chain->state[size] = '\0';
+  return paged_chain->state;
+}
+
+/**
+ * Get one random state that has successors, as get_first_random_state. After
+ * PAGED_MAX_MISSES random states with none, the states with successors are
+ * counted and one of them is picked.
+ * @param paged_chain
+ * @return state index, FROZEN_NO_STATE if no state has successors or in case
+ * of read error
+ */
+int get_first_random_paged_state(PagedChain *paged_chain)
+{
+  if (paged_chain->header.num_of_edges == 0)
+    {
+      return FROZEN_NO_STATE;
+    }
+  int num_of_states = (int) paged_chain->header.num_of_states;
+  for (int miss = 0; miss < PAGED_MAX_MISSES && !paged_chain->failed; miss++)
+    {
+      int state = get_random_number (num_of_states);
+      if (read_total (paged_chain, state) != 0)
+        {
+          return state;
+        }
+    }
+  // few states have successors, or none if the totals are corrupted: count
+  // them, and pick one of them as uniformly
+  int num_of_starts = 0;
+  for (int state = 0; state < num_of_states && !paged_chain->failed; state++)
+    {
+      num_of_starts += read_total (paged_chain, state) != 0;
+    }
+  if (paged_chain->failed)
+    {
+      return FROZEN_NO_STATE;
+    }
+  if (num_of_starts == 0)
+    {
+      fail_format (paged_chain);
+      return FROZEN_NO_STATE;
+    }
+  int start = get_random_number (num_of_starts);
+  for (int state = 0; state < num_of_states && !paged_chain->failed; state++)
+    {
+      if (read_total (paged_chain, state) != 0 && start-- == 0)
+        {
+          return state;
+        }
+    }
+  return FROZEN_NO_STATE;
+}
+
+/**
+ * Choose randomly the next state, as get_next_random_state.
+ * @param paged_chain
+ * @param state state to choose from
+ * @return index of the chosen state, FROZEN_NO_STATE if state has no
+ * successors, in case of read error or if it's row is not a valid one
+ */
+int get_next_random_paged_state(PagedChain *paged_chain, int state)
+{
+  FrozenHeader *header = &paged_chain->header;
+  uint32_t total = read_total (paged_chain, state);
+  if (total == 0 || paged_chain->failed)
+    {
+      return FROZEN_NO_STATE;
+    }
+  uint64_t begin = read_paged_u64 (paged_chain, header->edge_offsets, state);
+  uint64_t end = read_paged_u64 (paged_chain, header->edge_offsets,
+                                 state + 1);
+  uint64_t freq_bit = read_paged_u64 (paged_chain, header->freq_bit_offsets,
+                                      state);
+  uint8_t width = 0;
+  read_paged (paged_chain, header->freq_widths + state, &width,
+              sizeof (uint8_t));
+  if (total > INT_MAX
+      || !is_valid_frozen_row (header, begin, end, width, freq_bit))
+    {
+      fail_format (paged_chain);
+      return FROZEN_NO_STATE;
+    }
+  int64_t index = get_random_number ((int) total);
+  uint64_t successor = header->num_of_states;
+  uint64_t row_total = 0;
+  for (uint64_t edge = begin; edge < end && !paged_chain->failed;
+       edge++, freq_bit += width)
+    {
+      uint32_t code = (uint32_t) read_paged_bits (paged_chain,
+                                                  header->freq_bits,
+                                                  freq_bit, width);
+      if (paged_chain->quant_table != NULL
+          && code >= header->quant_table_length)
+        {
+          fail_format (paged_chain);
+          return FROZEN_NO_STATE;
+        }
+      uint64_t frequency = paged_chain->quant_table == NULL
+                           ? (uint64_t) code + FROZEN_EXACT_CODE_SHIFT
+                           : paged_chain->quant_table[code];
+      row_total += frequency;
+      index -= (int64_t) frequency;
+      if (index < 0 && successor == header->num_of_states)
+        {
+          successor = read_paged_bits (paged_chain, header->successor_bits,
+                                       edge * header->successor_width,
+                                       header->successor_width);
+        }
+    }
+  if (paged_chain->failed)
+    {
+      return FROZEN_NO_STATE;
+    }
+  if (row_total != total || successor >= header->num_of_states)
+    {
+      fail_format (paged_chain);
+      return FROZEN_NO_STATE;
+    }
+  return (int) successor;
+}
+
+/**
+ * Generate and print random sequence out of the paged_chain, like
+ * generate_frozen_sequence.
+ * @param paged_chain
+ * @param first_state state to start with
+ * @param max_length maximum length of chain to generate
+ */
+void generate_paged_sequence(PagedChain *paged_chain, int first_state,
+                             int max_length)
+{
+  int cur_state = first_state;
+  void *state = get_paged_state (paged_chain, cur_state);
+  if (state == NULL)
+    {
+      return;
+    }
+  paged_chain->print_func (state);
+  int i = 1;
+  while (i < max_length)
+    {
+      cur_state = get_next_random_paged_state (paged_chain, cur_state);
+      if (cur_state == FROZEN_NO_STATE
+          || (state = get_paged_state (paged_chain, cur_state)) == NULL)
+        {
+          break;
+        }
+      paged_chain->print_func (state);
+      if (read_total (paged_chain, cur_state) == 0)
+        {
+          break;
+        }
+      i++;
+    }
+}
@@ -0,0 +1,104 @@
+#ifndef _PAGED_CHAIN_H
+#define _PAGED_CHAIN_H
+
+#include "frozen_chain.h"
+#include <stdlib.h> // For size_t
+#include <stdbool.h> // for bool
+#include <stdint.h> // For uint32_t, uint64_t
+
+#define PAGED_PAGE_SIZE 4096
+#define PAGED_CACHE_PAGES 256 // default number of cached pages
+#define PAGED_WAYS 4 // cache slots a page may go to
+
+/***************************/
+/*        STRUCTS          */
+/***************************/
+
+/**
+ * A frozen model served from it's file, for models bigger than the memory.
+ * Only the header and the quantization table are read when opening; every
+ * other access is a pread of the PAGED_PAGE_SIZE pages holding the bytes
+ * wanted, through a small set associative cache of pages (least recently
+ * used page of the set replaced).
+ * The CSR sections of the model are it's index: choosing the next state
+ * reads the state's offsets, total and width, then it's run of packed
+ * successors and frequencies, so a generated word costs a few pages and
+ * never a search.
+ */
+typedef struct PagedChain {
+    int fd;
+    FrozenHeader header;
+    uint32_t *quant_table; // NULL if frequencies are stored exactly
+    char *pages; // num_of_sets * PAGED_WAYS cached pages
+    uint64_t *page_numbers; // page held by each slot
+    uint64_t *last_used; // clock of the last use of each slot, 0 if empty
+    size_t num_of_sets;
+    uint64_t clock;
+    uint64_t num_of_reads; // pages read from the file
+    char *state; // copy of the last state read
+    size_t state_capacity;
+    bool failed; // a read failed or read invalid content, the model file
+                 // is not usable
+
+    // same as MarkovChain print_func, receives a state read from the file
+    void (*print_func)(void*);
+} PagedChain;
+
+/**
+ * Open a frozen model file written by save_frozen_chain to be served from
+ * the file.
+ * @param path model file
+ * @param cache_pages number of pages to cache, rounded up to PAGED_WAYS
+ * @param print_func print function of the stored states
+ * @return PagedChain pointer, NULL if the file can not be opened, is not a
+ * valid model, or in case of memory allocation failure
+ * @ownership Weak Ownership. separate function for Free (close_paged_chain)
+ */
+PagedChain* open_paged_chain(const char *path, size_t cache_pages,
+                             void (*print_func)(void*));
+
+/**
+ * Close the model file and free paged_chain and all of it's content
+ * @param paged_chain_p paged chain to free
+ */
+void close_paged_chain(PagedChain **paged_chain_p);
+
+/**
+ * @param paged_chain
+ * @param state state index
+ * @return copy of the stored state, valid until the next call, NULL if the
+ * state is not within the model or in case of memory allocation failure
+ */
+void* get_paged_state(PagedChain *paged_chain, int state);
+
+/**
+ * Get one random state that has successors, as get_first_random_state. After
+ * a few random states with none, the states with successors are counted and
+ * one of them is picked, so a model whose totals are all zeros fails rather
+ * than draws forever.
+ * @param paged_chain
+ * @return state index, FROZEN_NO_STATE if no state has successors or in case
+ * of read error
+ */
+int get_first_random_paged_state(PagedChain *paged_chain);
+
+/**
+ * Choose randomly the next state, as get_next_random_state.
+ * @param paged_chain
+ * @param state state to choose from
+ * @return index of the chosen state, FROZEN_NO_STATE if state has no
+ * successors, in case of read error or if it's row is not a valid one
+ */
+int get_next_random_paged_state(PagedChain *paged_chain, int state);
+
+/**
+ * Generate and print random sequence out of the paged_chain, like
+ * generate_frozen_sequence.
+ * @param paged_chain
+ * @param first_state state to start with
+ * @param max_length maximum length of chain to generate
+ */
+void generate_paged_sequence(PagedChain *paged_chain, int first_state,
+                             int max_length);
+
+#endif /* _PAGED_CHAIN_H */
@@ -0,0 +1,310 @@
+#include "perfect_hash.h"
+#include <stdio.h>
+#include <string.h>
+
+#define ALLOC_ERROR_PERFECT_HASH \
+"Allocation failure: Alloc of perfect hash failed.\n"
+#define BUILD_ERROR_PERFECT_HASH \
+"ERROR: no perfect hash found, two keys are the same.\n"
+
+#define FNV_OFFSET_BASIS UINT64_C(14695981039346656037)
+#define FNV_PRIME UINT64_C(1099511628211)
+#define MIX_MULTIPLIER_1 UINT64_C(0xbf58476d1ce4e5b9)
+#define MIX_MULTIPLIER_2 UINT64_C(0x94d049bb133111eb)
+#define LEVEL_INCREMENT UINT64_C(0x9e3779b97f4a7c15)
+#define WORD_BITS 64
+#define WORD_SHIFT 6
+#define WORD_MASK 63
+#define MAX_SEEDS 8
+
+/**
+ * @return value mixed by the splitmix64 finalizer
+ */
+static uint64_t mix(uint64_t value)
+{
+  value = (value ^ (value >> 30)) * MIX_MULTIPLIER_1;
+  value = (value ^ (value >> 27)) * MIX_MULTIPLIER_2;
+  return value ^ (value >> 31);
+}
+
+/**
+ * Hash of the bytes of a key, the perfect hash is built on. Every seed
+ * starts the hash from another state, so keys with the same hash under a
+ * seed are told apart under the others.
+ * @param key
+ * @param size number of bytes
+ * @param seed
+ * @return 64 bits hash
+ */
+uint64_t hash_key(const void *key, size_t size, uint32_t seed)
+{
+  const unsigned char *bytes = key;
+  uint64_t hash = FNV_OFFSET_BASIS ^ mix ((seed + (uint64_t) 1)
+                                          * LEVEL_INCREMENT);
+  for (size_t i = 0; i < size; i++)
+    {
+      hash ^= bytes[i];
+      hash *= FNV_PRIME;
+    }
+  return mix (hash ^ size);
+}
+
+/**
+ * @return bit of a level of the given number of bits the key hashes to
+ */
+static uint64_t level_bit(uint64_t key_hash, uint32_t seed, uint32_t level,
+                          uint64_t level_bits)
+{
+  uint64_t value = key_hash + (seed * (uint64_t) WORD_BITS + level + 1)
+                              * LEVEL_INCREMENT;
+  return mix (value) % level_bits;
+}
+
+/**
+ * @return true if bit is set in words
+ */
+static bool is_set(const uint64_t *words, uint64_t bit)
+{
+  return (words[bit >> WORD_SHIFT] >> (bit & WORD_MASK)) & 1;
+}
+
+/**
+ * Number of words of a level holding the given number of keys
+ */
+static uint64_t level_words(uint64_t num_of_keys)
+{
+  uint64_t words = (num_of_keys + WORD_MASK) >> WORD_SHIFT;
+  return words > 0 ? words : 1;
+}
+
+/**
+ * Place the keys in one more level: keep the bits hashed to by a single key,
+ * and move the others keys to the beginning of keys.
+ * @param bits level bits, zeroed
+ * @param collisions zeroed, as big as bits
+ * @return number of keys left for the next level
+ */
+static uint32_t fill_level(uint64_t *keys, uint32_t num_of_keys,
+                           uint32_t seed, uint32_t level, uint64_t *bits,
+                           uint64_t *collisions, uint64_t num_of_words)
+{
+  uint64_t level_bits = num_of_words * WORD_BITS;
+  for (uint32_t i = 0; i < num_of_keys; i++)
+    {
+      uint64_t bit = level_bit (keys[i], seed, level, level_bits);
+      uint64_t mask = UINT64_C(1) << (bit & WORD_MASK);
+      if (bits[bit >> WORD_SHIFT] & mask)
+        {
+          collisions[bit >> WORD_SHIFT] |= mask;
+        }
+      bits[bit >> WORD_SHIFT] |= mask;
+    }
+  uint32_t left = 0;
+  for (uint32_t i = 0; i < num_of_keys; i++)
+    {
+      if (is_set (collisions, level_bit (keys[i], seed, level, level_bits)))
+        {
+          keys[left++] = keys[i];
+        }
+    }
+  for (uint64_t word = 0; word < num_of_words; word++)
+    {
+      bits[word] &= ~collisions[word];
+    }
+  return left;
+}
+
+/**
+ * Make room in hash->bits for words more words
+ * @return false in case of memory allocation failure
+ */
+static bool grow_bits(PerfectHash *hash, uint64_t num_of_words,
+                      uint64_t *capacity_p)
+{
+  if (num_of_words <= *capacity_p)
+    {
+      return true;
+    }
+  uint64_t capacity = *capacity_p * 2 > num_of_words ? *capacity_p * 2
+                                                     : num_of_words;
+  uint64_t *bits = realloc (hash->bits, sizeof (uint64_t) * capacity);
+  if (bits == NULL)
+    {
+      return false;
+    }
+  hash->bits = bits;
+  *capacity_p = capacity;
+  return true;
+}
+
+/**
+ * Build the levels with the given seed
+ * @param keys copy of the key hashes, reordered
+ * @param collisions room for the bits of the first level
+ * @return false if the keys did not all find a bit, or in case of memory
+ * allocation failure (then *failed is set)
+ */
+static bool build_levels(uint64_t *keys, uint32_t num_of_keys,
+                         uint64_t *collisions, PerfectHash *hash,
+                         bool *failed)
+{
+  uint64_t capacity = 0, words = 0;
+  uint32_t left = num_of_keys, level = 0;
+  hash->level_offsets[0] = 0;
+  for (; left > 0 && level < PERFECT_HASH_MAX_LEVELS; level++)
+    {
+      uint64_t num_of_words = level_words (left);
+      if (!grow_bits (hash, words + num_of_words, &capacity))
+        {
+          *failed = true;
+          return false;
+        }
+      memset (hash->bits + words, 0, sizeof (uint64_t) * num_of_words);
+      memset (collisions, 0, sizeof (uint64_t) * num_of_words);
+      left = fill_level (keys, left, hash->seed, level, hash->bits + words,
+                         collisions, num_of_words);
+      words += num_of_words;
+      hash->level_offsets[level + 1] = words * WORD_BITS;
+    }
+  hash->num_of_levels = level;
+  return left == 0;
+}
+
+/**
+ * Count the set bits before every block of bits
+ * @return false in case of memory allocation failure
+ */
+static bool count_ranks(PerfectHash *hash)
+{
+  uint64_t words = get_perfect_hash_words (hash);
+  hash->ranks = malloc (sizeof (uint32_t) * get_perfect_hash_ranks (hash));
+  if (hash->ranks == NULL)
+    {
+      return false;
+    }
+  uint32_t rank = 0;
+  for (uint64_t word = 0; word < words; word++)
+    {
+      if (word % PERFECT_HASH_BLOCK_WORDS == 0)
+        {
+          hash->ranks[word / PERFECT_HASH_BLOCK_WORDS] = rank;
+        }
+      rank += (uint32_t) __builtin_popcountll (hash->bits[word]);
+    }
+  if (words % PERFECT_HASH_BLOCK_WORDS == 0)
+    {
+      hash->ranks[words / PERFECT_HASH_BLOCK_WORDS] = rank; // all set bits
+    }
+  return true;
+}
+
+/**
+ * Build the minimal perfect hash of the given keys, which must be distinct.
+ * The keys are hashed again with every seed tried, so two keys whose hashes
+ * are the same under one seed do not stop the build.
+ * @param keys
+ * @param size_func returns the size in bytes of a key
+ * @param num_of_keys
+ * @param hash out param, arrays owned by the caller (free_perfect_hash)
+ * @return false in case of memory allocation failure, or if no hash could be
+ * built, the keys not being distinct
+ */
+bool build_perfect_hash(void **keys, size_t (*size_func)(void*),
+                        uint32_t num_of_keys, PerfectHash *hash)
+{
+  *hash = (PerfectHash) {0, 0, NULL, NULL, NULL};
+  hash->level_offsets = malloc (sizeof (uint64_t)
+                                * (PERFECT_HASH_MAX_LEVELS + 1));
+  uint64_t *key_hashes = malloc (sizeof (uint64_t)
+                                 * (num_of_keys + (size_t) 1));
+  uint64_t *collisions = malloc (sizeof (uint64_t)
+                                 * level_words (num_of_keys));
+  bool failed = hash->level_offsets == NULL || key_hashes == NULL
+                || collisions == NULL;
+  bool built = false;
+  for (uint32_t seed = 0; !failed && !built && seed < MAX_SEEDS; seed++)
+    {
+      for (uint32_t i = 0; i < num_of_keys; i++)
+        {
+          key_hashes[i] = hash_key (keys[i], size_func (keys[i]), seed);
+        }
+      hash->seed = seed;
+      built = build_levels (key_hashes, num_of_keys, collisions, hash,
+                            &failed);
+    }
+  if (!failed && built)
+    {
+      failed = !count_ranks (hash);
+    }
+  free (key_hashes);
+  free (collisions);
+  if (failed || !built)
+    {
+      printf ("%s", failed ? ALLOC_ERROR_PERFECT_HASH
+                           : BUILD_ERROR_PERFECT_HASH);
+      free_perfect_hash (hash);
+      return false;
+    }
+  return true;
+}
+
+/**
+ * @param hash
+ * @return number of words of bits
+ */
+uint64_t get_perfect_hash_words(const PerfectHash *hash)
+{
+  return hash->level_offsets[hash->num_of_levels] >> WORD_SHIFT;
+}
+
+/**
+ * @param hash
+ * @return number of ranks
+ */
+uint64_t get_perfect_hash_ranks(const PerfectHash *hash)
+{
+  return get_perfect_hash_words (hash) / PERFECT_HASH_BLOCK_WORDS + 1;
+}
+
+/**
+ * @param hash
+ * @param key_hash hash_key of the key, with the seed of hash
+ * @return value of the key, PERFECT_HASH_NONE if the key is surely not in
+ * the set
+ */
+uint64_t get_perfect_hash_value(const PerfectHash *hash, uint64_t key_hash)
+{
+  for (uint32_t level = 0; level < hash->num_of_levels; level++)
+    {
+      uint64_t offset = hash->level_offsets[level];
+      uint64_t bit = offset + level_bit (key_hash, hash->seed, level,
+                                         hash->level_offsets[level + 1]
+                                         - offset);
+      if (!is_set (hash->bits, bit))
+        {
+          continue;
+        }
+      uint64_t word = bit >> WORD_SHIFT;
+      uint64_t rank = hash->ranks[word / PERFECT_HASH_BLOCK_WORDS];
+      for (uint64_t i = word - word % PERFECT_HASH_BLOCK_WORDS; i < word; i++)
+        {
+          rank += (uint64_t) __builtin_popcountll (hash->bits[i]);
+        }
+      uint64_t below = (UINT64_C(1) << (bit & WORD_MASK)) - 1;
+      return rank + (uint64_t) __builtin_popcountll (hash->bits[word]
+                                                     & below);
+    }
+  return PERFECT_HASH_NONE;
+}
+
+/**
+ * Free the arrays of a hash built by build_perfect_hash
+ * @param hash
+ */
+void free_perfect_hash(PerfectHash *hash)
+{
+  free (hash->level_offsets);
+  free (hash->bits);
+  free (hash->ranks);
+  *hash = (PerfectHash) {0, 0, NULL, NULL, NULL};
+}
@@ -0,0 +1,87 @@
+#ifndef _PERFECT_HASH_H
+#define _PERFECT_HASH_H
+
+#include <stdlib.h> // For size_t
+#include <stdbool.h> // for bool
+#include <stdint.h> // For uint32_t, uint64_t
+
+#define PERFECT_HASH_NONE UINT64_MAX
+#define PERFECT_HASH_BLOCK_WORDS 8 // words of bits counted by every rank
+#define PERFECT_HASH_MAX_LEVELS 64
+
+/***************************/
+/*        STRUCTS          */
+/***************************/
+
+/**
+ * Minimal perfect hash of a static set of keys, BBHash style: every level is
+ * a bit array as big as the number of keys it gets. A key sets the bit it
+ * hashes to in the first level; the keys of bits hashed to more than once
+ * go on to the next level, and so on. The value of a key is the rank of it's
+ * bit among all the set bits, so the n keys get the values [0, n). The
+ * levels take about e bits per key and the ranks a 16th more, so about 2.9
+ * bits per key in all; mapping the values back to the keys, if they are
+ * not numbered in value order, is the caller's and costs log2 n bits more.
+ * A key that is not in the set may hash to a set bit too: it's value must be
+ * checked against the key it stands for.
+ */
+typedef struct PerfectHash {
+    uint32_t seed;
+    uint32_t num_of_levels; // 0 if there are no keys
+    uint64_t *level_offsets; // num_of_levels + 1 bit offsets into bits
+    uint64_t *bits; // set bits of the levels, one after the other
+    uint32_t *ranks; // set bits before every PERFECT_HASH_BLOCK_WORDS words
+} PerfectHash;
+
+/**
+ * Hash of the bytes of a key, the perfect hash is built on. Every seed
+ * starts the hash from another state, so keys with the same hash under a
+ * seed are told apart under the others.
+ * @param key
+ * @param size number of bytes
+ * @param seed
+ * @return 64 bits hash
+ */
+uint64_t hash_key(const void *key, size_t size, uint32_t seed);
+
+/**
+ * Build the minimal perfect hash of the given keys, which must be distinct.
+ * The keys are hashed again with every seed tried, so two keys whose hashes
+ * are the same under one seed do not stop the build.
+ * @param keys
+ * @param size_func returns the size in bytes of a key
+ * @param num_of_keys
+ * @param hash out param, arrays owned by the caller (free_perfect_hash)
+ * @return false in case of memory allocation failure, or if no hash could be
+ * built, the keys not being distinct
+ */
+bool build_perfect_hash(void **keys, size_t (*size_func)(void*),
+                        uint32_t num_of_keys, PerfectHash *hash);
+
+/**
+ * @param hash
+ * @return number of words of bits
+ */
+uint64_t get_perfect_hash_words(const PerfectHash *hash);
+
+/**
+ * @param hash
+ * @return number of ranks
+ */
+uint64_t get_perfect_hash_ranks(const PerfectHash *hash);
+
+/**
+ * @param hash
+ * @param key_hash hash_key of the key, with the seed of hash
+ * @return value of the key, PERFECT_HASH_NONE if the key is surely not in
+ * the set
+ */
+uint64_t get_perfect_hash_value(const PerfectHash *hash, uint64_t key_hash);
+
+/**
+ * Free the arrays of a hash built by build_perfect_hash
+ * @param hash
+ */
+void free_perfect_hash(PerfectHash *hash);
+
+#endif /* _PERFECT_HASH_H */
@@ -0,0 +1,443 @@
+#define _POSIX_C_SOURCE 200809L // For glob, opendir and stat
+#include "shard_reader.h"
+#include "corpus_reader.h"
+#include <stdio.h>
+#include <string.h>
+#include <glob.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#define ALLOC_ERROR_SHARD_READER \
+"Allocation failure: Alloc of new ShardReader failed.\n"
+#define ALLOC_ERROR_SHARD_PATH \
+"Allocation failure: Alloc of shard path failed.\n"
+#define ALLOC_ERROR_SHARD_CONTENTS \
+"Allocation failure: Alloc of shard contents failed.\n"
+#define SHARD_FILE_ERROR "ERROR: problem with opening file %s.\n"
+#define NO_MATCH_ERROR "ERROR: no file matches %s.\n"
+#define THREAD_ERROR "ERROR: problem with starting reader threads.\n"
+
+#define STDIN_PATH "-"
+#define GLOB_CHARACTERS "*?["
+#define INITIAL_CAPACITY 16
+
+#define SHARD_PENDING 0
+#define SHARD_LOADED 1
+#define SHARD_FAILED 2
+
+/**
+ * Growing array of paths
+ */
+typedef struct PathList {
+    char **paths;
+    int length;
+    int capacity;
+} PathList;
+
+/**
+ * Append a copy of path to list
+ * @return false in case of memory allocation failure
+ */
+static bool append_path(PathList *list, const char *path)
+{
+  if (list->length == list->capacity)
+    {
+      int capacity = list->capacity == 0 ? INITIAL_CAPACITY
+                                         : list->capacity * 2;
+      char **paths = realloc (list->paths, sizeof (char*) * capacity);
+      if (paths == NULL)
+        {
+          printf ("%s", ALLOC_ERROR_SHARD_PATH);
+          return false;
+        }
+      list->paths = paths;
+      list->capacity = capacity;
+    }
+  char *copy = malloc (strlen (path) + 1);
+  if (copy == NULL)
+    {
+      printf ("%s", ALLOC_ERROR_SHARD_PATH);
+      return false;
+    }
+  strcpy (copy, path);
+  list->paths[list->length++] = copy;
+  return true;
+}
+
+/**
+ * Free the paths of list and the list's array
+ */
+static void free_paths(PathList *list)
+{
+  for (int i = 0; i < list->length; i++)
+    {
+      free (list->paths[i]);
+    }
+  free (list->paths);
+  *list = (PathList) {NULL, 0, 0};
+}
+
+/**
+ * Path comparison function for qsort
+ */
+static int compare_paths(const void *path_1, const void *path_2)
+{
+  return strcmp (*(char* const*) path_1, *(char* const*) path_2);
+}
+
+/**
+ * @return true if path is a directory
+ */
+static bool is_directory(const char *path)
+{
+  struct stat info;
+  return stat (path, &info) == 0 && S_ISDIR(info.st_mode);
+}
+
+/**
+ * Append the regular files of directory to list, in the order of their names.
+ * Hidden files are skipped, and sub directories are not entered.
+ * @return false in case of memory allocation failure or unreadable directory
+ */
+static bool append_directory(PathList *list, const char *directory)
+{
+  DIR *dir = opendir (directory);
+  if (dir == NULL)
+    {
+      printf (SHARD_FILE_ERROR, directory);
+      return false;
+    }
+  PathList files = {NULL, 0, 0};
+  size_t directory_length = strlen (directory);
+  bool success = true;
+  struct dirent *entry;
+  while (success && (entry = readdir (dir)) != NULL)
+    {
+      if (entry->d_name[0] == '.')
+        {
+          continue;
+        }
+      char *path = malloc (directory_length + strlen (entry->d_name) + 2);
+      if (path == NULL)
+        {
+          printf ("%s", ALLOC_ERROR_SHARD_PATH);
+          success = false;
+          break;
+        }
+      sprintf (path, "%s/%s", directory, entry->d_name);
+      struct stat info;
+      if (stat (path, &info) == 0 && S_ISREG(info.st_mode))
+        {
+          success = append_path (&files, path);
+        }
+      free (path);
+    }
+  closedir (dir);
+  if (success)
+    {
+      qsort (files.paths, files.length, sizeof (char*), compare_paths);
+      for (int i = 0; success && i < files.length; i++)
+        {
+          success = append_path (list, files.paths[i]);
+        }
+    }
+  free_paths (&files);
+  return success;
+}
+
+/**
+ * Append the shards pattern stands for to list
+ * @return false in case of memory allocation failure or if nothing matches
+ */
+static bool expand_pattern(PathList *list, const char *pattern)
+{
+  if (strpbrk (pattern, GLOB_CHARACTERS) == NULL)
+    {
+      return is_directory (pattern) ? append_directory (list, pattern)
+                                    : append_path (list, pattern);
+    }
+  glob_t matches;
+  if (glob (pattern, 0, NULL, &matches) != 0)
+    {
+      printf (NO_MATCH_ERROR, pattern);
+      return false;
+    }
+  bool success = true;
+  for (size_t i = 0; success && i < matches.gl_pathc; i++)
+    {
+      const char *path = matches.gl_pathv[i];
+      success = is_directory (path) ? append_directory (list, path)
+                                    : append_path (list, path);
+    }
+  globfree (&matches);
+  return success;
+}
+
+/**
+ * @param pattern command line corpus argument
+ * @return true if pattern is a directory or holds glob characters, so it
+ * may stand for several shards
+ */
+bool is_shard_pattern(const char *pattern)
+{
+  return strpbrk (pattern, GLOB_CHARACTERS) != NULL || is_directory (pattern);
+}
+
+/**
+ * Read a whole shard into memory, decompressing it if needed
+ * @param path
+ * @param contents_p out param, allocated contents
+ * @param length_p out param
+ * @return false if the shard could not be read
+ */
+static bool load_shard(const char *path, char **contents_p, size_t *length_p)
+{
+  bool from_stdin = strcmp (path, STDIN_PATH) == 0;
+  FILE *fp = from_stdin ? stdin : fopen (path, "rb");
+  if (fp == NULL)
+    {
+      printf (SHARD_FILE_ERROR, path);
+      return false;
+    }
+  CorpusReader *reader = open_corpus (fp);
+  bool success = reader != NULL;
+  char *contents = NULL;
+  size_t length = 0, capacity = 0, read_length = 1;
+  while (success && read_length > 0)
+    {
+      if (length == capacity)
+        {
+          capacity = capacity == 0 ? CORPUS_BUFFER_SIZE : capacity * 2;
+          char *grown = realloc (contents, capacity);
+          if (grown == NULL)
+            {
+              printf ("%s", ALLOC_ERROR_SHARD_CONTENTS);
+              success = false;
+              break;
+            }
+          contents = grown;
+        }
+      success = read_corpus (reader, contents + length, capacity - length,
+                             &read_length) == EXIT_SUCCESS;
+      length += read_length;
+    }
+  close_corpus (&reader);
+  if (!from_stdin)
+    {
+      fclose (fp);
+    }
+  if (!success)
+    {
+      free (contents);
+      return false;
+    }
+  *contents_p = contents;
+  *length_p = length;
+  return true;
+}
+
+/**
+ * Body of a reader thread: load shards in order, staying at most
+ * num_of_workers shards ahead of the caller.
+ * @param arg ShardReader pointer
+ * @return NULL
+ */
+static void* load_shards(void *arg)
+{
+  ShardReader *shards = arg;
+  pthread_mutex_lock (&shards->lock);
+  while (true)
+    {
+      while (!shards->closing && shards->next_to_load < shards->num_of_shards
+             && shards->next_to_load > shards->current
+                                       + shards->num_of_workers)
+        {
+          pthread_cond_wait (&shards->changed, &shards->lock);
+        }
+      if (shards->closing || shards->next_to_load == shards->num_of_shards)
+        {
+          break;
+        }
+      int shard = shards->next_to_load++;
+      pthread_mutex_unlock (&shards->lock);
+      char *contents = NULL;
+      size_t length = 0;
+      bool success = load_shard (shards->paths[shard], &contents, &length);
+      pthread_mutex_lock (&shards->lock);
+      shards->contents[shard] = contents;
+      shards->lengths[shard] = length;
+      shards->states[shard] = success ? SHARD_LOADED : SHARD_FAILED;
+      pthread_cond_broadcast (&shards->changed);
+    }
+  pthread_mutex_unlock (&shards->lock);
+  return NULL;
+}
+
+/**
+ * Free the memory of shards, the reader threads must be stopped
+ */
+static void free_shards(ShardReader *shards)
+{
+  PathList paths = {shards->paths, shards->num_of_shards, 0};
+  free_paths (&paths);
+  if (shards->contents != NULL)
+    {
+      for (int i = 0; i < shards->num_of_shards; i++)
+        {
+          free (shards->contents[i]);
+        }
+    }
+  free (shards->contents);
+  free (shards->lengths);
+  free (shards->states);
+  free (shards->workers);
+  free (shards);
+}
+
+/**
+ * Start the reader threads
+ * @return false if no thread could be started
+ */
+static bool start_workers(ShardReader *shards, int num_of_workers)
+{
+  pthread_mutex_init (&shards->lock, NULL);
+  pthread_cond_init (&shards->changed, NULL);
+  pthread_mutex_lock (&shards->lock); // workers read num_of_workers
+  for (int i = 0; i < num_of_workers; i++)
+    {
+      if (pthread_create (&shards->workers[i], NULL, load_shards, shards) != 0)
+        {
+          break;
+        }
+      shards->num_of_workers++;
+    }
+  pthread_mutex_unlock (&shards->lock);
+  if (shards->num_of_workers == 0)
+    {
+      printf ("%s", THREAD_ERROR);
+      pthread_cond_destroy (&shards->changed);
+      pthread_mutex_destroy (&shards->lock);
+      return false;
+    }
+  return true;
+}
+
+/**
+ * Initialize and Allocate new ShardReader, and start loading the shards.
+ * Every pattern is a file path, a directory (it's files are read in the
+ * order of their names) or a glob pattern (matches are read in order).
+ * @param patterns
+ * @param num_of_patterns
+ * @param num_of_workers number of reader threads
+ * @return ShardReader pointer, NULL in case of memory allocation failure or
+ * if a pattern matches no file
+ * @ownership Weak Ownership. separate function for Free (close_shards)
+ */
+ShardReader* open_shards(char **patterns, int num_of_patterns,
+                         int num_of_workers)
+{
+  PathList list = {NULL, 0, 0};
+  for (int i = 0; i < num_of_patterns; i++)
+    {
+      if (!expand_pattern (&list, patterns[i]))
+        {
+          free_paths (&list);
+          return NULL;
+        }
+    }
+  ShardReader *shards = malloc (sizeof (ShardReader));
+  if (shards == NULL)
+    {
+      printf ("%s", ALLOC_ERROR_SHARD_READER);
+      free_paths (&list);
+      return NULL;
+    }
+  memset (shards, 0, sizeof (ShardReader));
+  shards->paths = list.paths;
+  shards->num_of_shards = list.length;
+  shards->current = -1;
+  if (num_of_workers < 1)
+    {
+      num_of_workers = 1;
+    }
+  int n = list.length > 0 ? list.length : 1;
+  shards->contents = calloc (n, sizeof (char*));
+  shards->lengths = calloc (n, sizeof (size_t));
+  shards->states = calloc (n, sizeof (int)); // SHARD_PENDING
+  shards->workers = calloc (num_of_workers, sizeof (pthread_t));
+  if (shards->contents == NULL || shards->lengths == NULL
+      || shards->states == NULL || shards->workers == NULL)
+    {
+      printf ("%s", ALLOC_ERROR_SHARD_READER);
+      free_shards (shards);
+      return NULL;
+    }
+  if (!start_workers (shards, num_of_workers))
+    {
+      free_shards (shards);
+      return NULL;
+    }
+  return shards;
+}
+
+/**
+ * Wait for the next shard. The contents of the previous one are freed.
+ * @param shards
+ * @param contents_p out param, plain bytes of the shard
+ * @param length_p out param, number of bytes
+ * @return SHARD_FOUND, SHARD_END after the last shard or SHARD_ERROR if the
+ * shard could not be read
+ */
+int next_shard(ShardReader *shards, char **contents_p, size_t *length_p)
+{
+  pthread_mutex_lock (&shards->lock);
+  if (shards->current >= 0)
+    {
+      free (shards->contents[shards->current]);
+      shards->contents[shards->current] = NULL;
+    }
+  if (shards->current < shards->num_of_shards)
+    {
+      shards->current++;
+    }
+  pthread_cond_broadcast (&shards->changed); // room for one more shard
+  if (shards->current == shards->num_of_shards)
+    {
+      pthread_mutex_unlock (&shards->lock);
+      return SHARD_END;
+    }
+  while (shards->states[shards->current] == SHARD_PENDING)
+    {
+      pthread_cond_wait (&shards->changed, &shards->lock);
+    }
+  int state = shards->states[shards->current];
+  *contents_p = shards->contents[shards->current];
+  *length_p = shards->lengths[shards->current];
+  pthread_mutex_unlock (&shards->lock);
+  return state == SHARD_LOADED ? SHARD_FOUND : SHARD_ERROR;
+}
+
+/**
+ * Stop the reader threads and free shards and all of it's content from memory
+ * @param shards_p ShardReader to close
+ */
+void close_shards(ShardReader **shards_p)
+{
+  ShardReader *shards = *shards_p;
+  if (shards == NULL)
+    {
+      return;
+    }
+  pthread_mutex_lock (&shards->lock);
+  shards->closing = true;
+  pthread_cond_broadcast (&shards->changed);
+  pthread_mutex_unlock (&shards->lock);
+  for (int i = 0; i < shards->num_of_workers; i++)
+    {
+      pthread_join (shards->workers[i], NULL);
+    }
+  pthread_cond_destroy (&shards->changed);
+  pthread_mutex_destroy (&shards->lock);
+  free_shards (shards);
+  *shards_p = NULL;
+}
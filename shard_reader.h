@@ -0,0 +1,76 @@
+#ifndef _SHARD_READER_H
+#define _SHARD_READER_H
+
+#include <stdlib.h> // For size_t
+#include <stdbool.h> // for bool
+#include <pthread.h> // For pthread_t
+
+#define SHARD_FOUND 0
+#define SHARD_END 1
+#define SHARD_ERROR 2
+
+#define SHARD_READERS 4 // default number of reader threads
+
+/***************************/
+/*        STRUCTS          */
+/***************************/
+
+/**
+ * Reads a corpus made of many shard files, in the order of their paths.
+ * Reader threads load (and decompress) the next shards into memory while the
+ * caller learns from the current one; at most one shard per reader thread is
+ * loaded ahead of the caller, which bounds the memory used.
+ */
+typedef struct ShardReader {
+    char **paths; // expanded shard paths
+    int num_of_shards;
+    char **contents; // loaded shards, NULL until loaded or once consumed
+    size_t *lengths;
+    int *states; // of each shard: pending, loaded or failed
+    pthread_t *workers;
+    int num_of_workers;
+    pthread_mutex_t lock;
+    pthread_cond_t changed; // a shard was loaded or consumed
+    int next_to_load;
+    int current; // shard handed to the caller, -1 before the first one
+    bool closing;
+} ShardReader;
+
+/**
+ * @param pattern command line corpus argument
+ * @return true if pattern is a directory or holds glob characters, so it
+ * may stand for several shards
+ */
+bool is_shard_pattern(const char *pattern);
+
+/**
+ * Initialize and Allocate new ShardReader, and start loading the shards.
+ * Every pattern is a file path, a directory (it's files are read in the
+ * order of their names) or a glob pattern (matches are read in order).
+ * @param patterns
+ * @param num_of_patterns
+ * @param num_of_workers number of reader threads
+ * @return ShardReader pointer, NULL in case of memory allocation failure or
+ * if a pattern matches no file
+ * @ownership Weak Ownership. separate function for Free (close_shards)
+ */
+ShardReader* open_shards(char **patterns, int num_of_patterns,
+                         int num_of_workers);
+
+/**
+ * Wait for the next shard. The contents of the previous one are freed.
+ * @param shards
+ * @param contents_p out param, plain bytes of the shard
+ * @param length_p out param, number of bytes
+ * @return SHARD_FOUND, SHARD_END after the last shard or SHARD_ERROR if the
+ * shard could not be read
+ */
+int next_shard(ShardReader *shards, char **contents_p, size_t *length_p);
+
+/**
+ * Stop the reader threads and free shards and all of it's content from memory
+ * @param shards_p ShardReader to close
+ */
+void close_shards(ShardReader **shards_p);
+
+#endif /* _SHARD_READER_H */
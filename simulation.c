@@ -0,0 +1,570 @@
+#define _POSIX_C_SOURCE 200809L // For sysconf and clock_gettime
+#include "simulation.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define ALLOC_ERROR_SIMULATION \
+"Allocation failure: Alloc of walk statistics failed.\n"
+#define ALLOC_ERROR_DICE_BOARD \
+"Allocation failure: Alloc of new DiceBoard failed.\n"
+#define DICE_BOARD_ERROR "ERROR: a move leaves the board.\n"
+
+#define INITIAL_LENGTHS 64
+#define GOLDEN_GAMMA 0x9e3779b97f4a7c15u // step of the splitmix64 state
+#define NANOSECONDS 1e-9
+
+/**
+ * The walks of one thread and their totals
+ */
+typedef struct WalkTask {
+    DiceBoard *board;
+    int start_cell;
+    long long num_of_walks;
+    int max_length;
+    uint64_t random_state; // splitmix64 stream of the thread
+    long long num_of_unfinished;
+    long long *visits;
+    long long *length_counts;
+    int num_of_lengths;
+    int lengths_capacity;
+    bool failed; // length_counts could not grow
+} WalkTask;
+
+/**
+ * Next number of a splitmix64 stream: every thread steps through it's own
+ * state, so the threads share nothing but the chain.
+ */
+static uint64_t next_random(uint64_t *state)
+{
+  uint64_t z = (*state += GOLDEN_GAMMA);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9u;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebu;
+  return z ^ (z >> 31);
+}
+
+/**
+ * Count a finished walk of the given length
+ * @return false in case of memory allocation failure
+ */
+static bool count_length(WalkTask *task, int length)
+{
+  if (length >= task->lengths_capacity)
+    {
+      int capacity = task->lengths_capacity;
+      while (capacity <= length)
+        {
+          capacity *= 2;
+        }
+      long long *counts = realloc (task->length_counts,
+                                   sizeof (long long) * capacity);
+      if (counts == NULL)
+        {
+          return false;
+        }
+      size_t added = (size_t) (capacity - task->lengths_capacity);
+      memset (counts + task->lengths_capacity, 0, sizeof (long long) * added);
+      task->length_counts = counts;
+      task->lengths_capacity = capacity;
+    }
+  task->length_counts[length]++;
+  if (length >= task->num_of_lengths)
+    {
+      task->num_of_lengths = length + 1;
+    }
+  return true;
+}
+
+/**
+ * Games in the lanes of a dice task: the same steps are taken for every
+ * lane, so they are kept side by side, an array per field
+ */
+typedef struct DiceLanes {
+    uint32_t random[SIMULATION_LANES]; // xorshift32 stream of every lane
+    int32_t cell[SIMULATION_LANES];
+    int32_t moves[SIMULATION_LANES]; // of the cell
+    int32_t landed[SIMULATION_LANES]; // cell of the last roll, before jumps
+    int32_t rolls[SIMULATION_LANES];
+    int32_t live[SIMULATION_LANES]; // 1 while the lane plays a game
+} DiceLanes;
+
+/**
+ * Count a game that ended at the given cell
+ */
+static void end_game(WalkTask *task, int cell, int rolls)
+{
+  if (cell == task->board->num_of_cells || rolls > task->max_length)
+    {
+      task->num_of_unfinished++; // trapped or cut
+    }
+  else if (!count_length (task, rolls))
+    {
+      task->failed = true;
+    }
+}
+
+/**
+ * Start the next game of a task in a lane, or park the lane at the trap if
+ * the task has no games left. Games that end at their first cell are
+ * counted right away.
+ * @param started_p games of the task started so far
+ */
+static void next_game(WalkTask *task, DiceLanes *lanes, int lane,
+                      long long *started_p)
+{
+  DiceBoard *board = task->board;
+  int cell = board->num_of_cells;
+  while (*started_p < task->num_of_walks && board->moves[cell] == 0)
+    {
+      (*started_p)++;
+      task->visits[task->start_cell]++;
+      cell = board->jumps[task->start_cell];
+      if (board->moves[cell] == 0)
+        {
+          end_game (task, cell, 0);
+          cell = board->num_of_cells;
+        }
+    }
+  lanes->cell[lane] = cell;
+  lanes->moves[lane] = board->moves[cell];
+  lanes->rolls[lane] = 0;
+  lanes->live[lane] = board->moves[cell] > 0;
+}
+
+/**
+ * Play the games of a task SIMULATION_LANES at a time, in lockstep: every
+ * step rolls the dice of all the lanes and moves them through the jumps of
+ * the board, with no branches, so the compiler can keep the lanes in SIMD
+ * registers. Lanes whose game ended are refilled between the steps.
+ * @param arg WalkTask pointer
+ */
+static void* run_dice_games(void *arg)
+{
+  WalkTask *task = arg;
+  const int32_t *moves = task->board->moves, *jumps = task->board->jumps;
+  int32_t max_rolls = task->max_length;
+  DiceLanes lanes;
+  long long started = 0;
+  int num_of_live = 0;
+  for (int lane = 0; lane < SIMULATION_LANES; lane++)
+    {
+      lanes.random[lane] = (uint32_t) next_random (&task->random_state) | 1;
+      next_game (task, &lanes, lane, &started);
+      num_of_live += lanes.live[lane];
+    }
+  while (num_of_live > 0 && !task->failed)
+    {
+      int32_t ended = 0;
+      for (int lane = 0; lane < SIMULATION_LANES; lane++)
+        {
+          uint32_t random = lanes.random[lane];
+          random ^= random << 13;
+          random ^= random >> 17;
+          random ^= random << 5;
+          lanes.random[lane] = random;
+          // a parked lane has no moves, and stays where it is
+          int32_t roll = (int32_t) (((uint64_t) random
+                                     * (uint32_t) lanes.moves[lane]) >> 32);
+          int32_t landed = lanes.cell[lane]
+                           + (lanes.moves[lane] > 0) * (roll + 1);
+          int32_t cell = jumps[landed];
+          lanes.landed[lane] = landed;
+          lanes.cell[lane] = cell;
+          lanes.moves[lane] = moves[cell];
+          lanes.rolls[lane] += lanes.live[lane];
+          ended |= lanes.live[lane] & ((moves[cell] == 0)
+                                       | (lanes.rolls[lane] > max_rolls));
+        }
+      for (int lane = 0; lane < SIMULATION_LANES; lane++)
+        {
+          task->visits[lanes.landed[lane]] += lanes.live[lane];
+        }
+      for (int lane = 0; ended && lane < SIMULATION_LANES; lane++)
+        {
+          if (lanes.live[lane] && (lanes.moves[lane] == 0
+                                   || lanes.rolls[lane] > max_rolls))
+            {
+              end_game (task, lanes.cell[lane], lanes.rolls[lane]);
+              next_game (task, &lanes, lane, &started);
+              num_of_live -= !lanes.live[lane];
+            }
+        }
+    }
+  return NULL;
+}
+
+/**
+ * Play the games of every task, the first one on the calling thread. A task
+ * whose thread can not be started is run on the calling thread too.
+ * @param threads room for num_of_tasks - 1 threads
+ */
+static void run_tasks(WalkTask *tasks, int num_of_tasks, pthread_t *threads)
+{
+  int started = 0;
+  for (int i = 1; i < num_of_tasks; i++)
+    {
+      if (pthread_create (&threads[started], NULL, run_dice_games,
+                          &tasks[i]) == 0)
+        {
+          started++;
+        }
+      else
+        {
+          run_dice_games (&tasks[i]);
+        }
+    }
+  run_dice_games (&tasks[0]);
+  for (int i = 0; i < started; i++)
+    {
+      pthread_join (threads[i], NULL);
+    }
+}
+
+/**
+ * Allocate the tasks, the walks split evenly between them
+ * @return tasks, NULL in case of memory allocation failure
+ */
+static WalkTask* new_walk_tasks(WalkTask *prototype, int num_of_tasks,
+                                int num_of_states, unsigned int seed)
+{
+  WalkTask *tasks = calloc (num_of_tasks, sizeof (WalkTask));
+  if (tasks == NULL)
+    {
+      return NULL;
+    }
+  long long num_of_walks = prototype->num_of_walks;
+  bool allocated = true;
+  for (int i = 0; i < num_of_tasks; i++)
+    {
+      tasks[i] = *prototype;
+      tasks[i].num_of_walks = num_of_walks * (i + 1) / num_of_tasks
+                              - num_of_walks * i / num_of_tasks;
+      // a random place in the stream for every thread of the seed
+      uint64_t stream = ((uint64_t) seed << 32) | (uint64_t) i;
+      tasks[i].random_state = next_random (&stream);
+      tasks[i].visits = calloc (num_of_states > 0 ? num_of_states : 1,
+                                sizeof (long long));
+      tasks[i].length_counts = calloc (INITIAL_LENGTHS, sizeof (long long));
+      tasks[i].lengths_capacity = INITIAL_LENGTHS;
+      allocated = allocated && tasks[i].visits != NULL
+                  && tasks[i].length_counts != NULL;
+    }
+  if (!allocated)
+    {
+      for (int i = 0; i < num_of_tasks; i++)
+        {
+          free (tasks[i].visits);
+          free (tasks[i].length_counts);
+        }
+      free (tasks);
+      return NULL;
+    }
+  return tasks;
+}
+
+/**
+ * Add up the totals of the tasks, and free them
+ * @return false in case of memory allocation failure
+ */
+static bool add_up_tasks(WalkStatistics *statistics, WalkTask *tasks,
+                         int num_of_tasks)
+{
+  bool success = true;
+  int num_of_lengths = 0;
+  for (int i = 0; i < num_of_tasks; i++)
+    {
+      success = success && !tasks[i].failed;
+      num_of_lengths = tasks[i].num_of_lengths > num_of_lengths
+                       ? tasks[i].num_of_lengths : num_of_lengths;
+    }
+  statistics->length_counts = calloc (num_of_lengths > 0 ? num_of_lengths
+                                                         : 1,
+                                      sizeof (long long));
+  success = success && statistics->length_counts != NULL;
+  statistics->num_of_lengths = num_of_lengths;
+  for (int i = 0; i < num_of_tasks; i++)
+    {
+      for (int state = 0; success && state < statistics->num_of_states;
+           state++)
+        {
+          statistics->visits[state] += tasks[i].visits[state];
+        }
+      for (int length = 0; success && length < tasks[i].num_of_lengths;
+           length++)
+        {
+          statistics->length_counts[length] += tasks[i].length_counts[length];
+        }
+      statistics->num_of_unfinished += tasks[i].num_of_unfinished;
+      free (tasks[i].visits);
+      free (tasks[i].length_counts);
+    }
+  free (tasks);
+  return success;
+}
+
+/**
+ * @return seconds of a monotonic clock
+ */
+static double now()
+{
+  struct timespec time;
+  clock_gettime (CLOCK_MONOTONIC, &time);
+  return (double) time.tv_sec + (double) time.tv_nsec * NANOSECONDS;
+}
+
+/**
+ * Play the games of the tasks the walks are split to, and add up their
+ * totals
+ * @param prototype task of all the walks
+ * @param num_of_states number of visit counters
+ * @return WalkStatistics pointer, NULL in case of memory allocation failure
+ */
+static WalkStatistics* run_simulation(WalkTask *prototype, int num_of_states,
+                                      int num_of_threads, unsigned int seed)
+{
+  long long num_of_walks = prototype->num_of_walks;
+  if (num_of_threads == SIMULATION_ALL_THREADS)
+    {
+      long online = sysconf (_SC_NPROCESSORS_ONLN);
+      num_of_threads = online > 0 ? (int) online : 1;
+    }
+  if (num_of_threads > num_of_walks)
+    {
+      num_of_threads = num_of_walks > 0 ? (int) num_of_walks : 1;
+    }
+  WalkStatistics *statistics = malloc (sizeof (WalkStatistics));
+  long long *visits = calloc (num_of_states > 0 ? num_of_states : 1,
+                              sizeof (long long));
+  pthread_t *threads = malloc (sizeof (pthread_t) * num_of_threads);
+  WalkTask *tasks = NULL;
+  if (statistics == NULL || visits == NULL || threads == NULL
+      || (tasks = new_walk_tasks (prototype, num_of_threads, num_of_states,
+                                  seed)) == NULL)
+    {
+      printf ("%s", ALLOC_ERROR_SIMULATION);
+      free (statistics);
+      free (visits);
+      free (threads);
+      return NULL;
+    }
+  *statistics = (WalkStatistics) {num_of_states, num_of_walks, 0, visits,
+                                  NULL, 0, num_of_threads, 0};
+  double begin = now ();
+  run_tasks (tasks, num_of_threads, threads);
+  statistics->seconds = now () - begin;
+  free (threads);
+  if (!add_up_tasks (statistics, tasks, num_of_threads))
+    {
+      printf ("%s", ALLOC_ERROR_SIMULATION);
+      free_walk_statistics (&statistics);
+      return NULL;
+    }
+  return statistics;
+}
+
+/**
+ * Initialize and Allocate the DiceBoard of the given moves and links, and
+ * fold every chain of links into one jump
+ * @param moves cells a roll may move forward from every cell, 0 for none
+ * @param links cell a ladder or snake takes a game landing on every cell
+ * to, the cell itself if none
+ * @param num_of_cells
+ * @return DiceBoard pointer, NULL in case of memory allocation failure or
+ * if a roll may move past the last cell
+ * @ownership Weak Ownership. separate function for Free (free_dice_board)
+ */
+DiceBoard* new_dice_board(const int *moves, const int *links,
+                          int num_of_cells)
+{
+  for (int cell = 0; cell < num_of_cells; cell++)
+    {
+      if (moves[cell] < 0 || moves[cell] >= num_of_cells - cell
+          || links[cell] < 0 || links[cell] >= num_of_cells)
+        {
+          printf ("%s", DICE_BOARD_ERROR);
+          return NULL;
+        }
+    }
+  DiceBoard *board = malloc (sizeof (DiceBoard));
+  size_t size = (size_t) num_of_cells + 1; // and the trap
+  int32_t *board_moves = malloc (sizeof (int32_t) * size);
+  int32_t *board_links = malloc (sizeof (int32_t) * size);
+  int32_t *jumps = malloc (sizeof (int32_t) * size);
+  if (board == NULL || board_moves == NULL || board_links == NULL
+      || jumps == NULL)
+    {
+      printf ("%s", ALLOC_ERROR_DICE_BOARD);
+      free (board);
+      free (board_moves);
+      free (board_links);
+      free (jumps);
+      return NULL;
+    }
+  for (int cell = 0; cell < num_of_cells; cell++)
+    {
+      board_moves[cell] = links[cell] == cell ? moves[cell] : 0;
+      board_links[cell] = links[cell];
+      int target = cell;
+      for (int hops = 0; links[target] != target; hops++)
+        {
+          if (hops == num_of_cells) // a loop of ladders and snakes
+            {
+              target = num_of_cells;
+              break;
+            }
+          target = links[target];
+        }
+      jumps[cell] = target;
+    }
+  board_moves[num_of_cells] = 0;
+  board_links[num_of_cells] = num_of_cells;
+  jumps[num_of_cells] = num_of_cells;
+  *board = (DiceBoard) {num_of_cells, board_moves, board_links, jumps};
+  return board;
+}
+
+/**
+ * Play num_of_games games of the board from start_cell, SIMULATION_LANES
+ * games at a time on every thread. The games of a seed are the same for the
+ * same number of threads.
+ * @param board board to play, not changed while the games run
+ * @param start_cell
+ * @param num_of_games
+ * @param max_rolls rolls a game is cut at
+ * @param num_of_threads SIMULATION_ALL_THREADS for one per processor
+ * @param seed of the random streams
+ * @return WalkStatistics pointer, with the visits of every cell and the
+ * number of rolls of every game, NULL in case of memory allocation failure
+ * @ownership Weak Ownership. separate function for Free
+ * (free_walk_statistics)
+ */
+WalkStatistics* simulate_dice_games(DiceBoard *board, int start_cell,
+                                    long long num_of_games, int max_rolls,
+                                    int num_of_threads, unsigned int seed)
+{
+  int num_of_cells = board->num_of_cells;
+  long long *landings = malloc (sizeof (long long) * (num_of_cells
+                                                      + (size_t) 1));
+  if (landings == NULL)
+    {
+      printf ("%s", ALLOC_ERROR_SIMULATION);
+      return NULL;
+    }
+  WalkTask prototype = {board, start_cell, num_of_games, max_rolls, 0, 0,
+                        NULL, NULL, 0, 0, false};
+  WalkStatistics *statistics = run_simulation (&prototype, num_of_cells + 1,
+                                               num_of_threads, seed);
+  if (statistics == NULL)
+    {
+      free (landings);
+      return NULL;
+    }
+  // the lanes count the cells the games land on: a game also visits every
+  // cell on the way of the jump from there
+  memcpy (landings, statistics->visits, sizeof (long long) * num_of_cells);
+  for (int cell = 0; cell < num_of_cells; cell++)
+    {
+      if (board->links[cell] == cell || board->jumps[cell] == num_of_cells)
+        {
+          continue;
+        }
+      int target = cell;
+      do
+        {
+          target = board->links[target];
+          statistics->visits[target] += landings[cell];
+        }
+      while (board->links[target] != target);
+    }
+  statistics->num_of_states = num_of_cells;
+  free (landings);
+  return statistics;
+}
+
+/**
+ * Free board and all of it's content from memory
+ * @param board_p board to free
+ */
+void free_dice_board(DiceBoard **board_p)
+{
+  if (*board_p != NULL)
+    {
+      free ((*board_p)->moves);
+      free ((*board_p)->links);
+      free ((*board_p)->jumps);
+      free (*board_p);
+      *board_p = NULL;
+    }
+}
+
+/**
+ * @param statistics
+ * @param mean_p out param, mean length of the finished walks
+ * @param variance_p out param, variance of their length
+ */
+void walk_length_moments(WalkStatistics *statistics, double *mean_p,
+                         double *variance_p)
+{
+  double finished = 0, sum = 0;
+  for (int length = 0; length < statistics->num_of_lengths; length++)
+    {
+      finished += (double) statistics->length_counts[length];
+      sum += (double) statistics->length_counts[length] * length;
+    }
+  double mean = finished > 0 ? sum / finished : 0, squares = 0;
+  for (int length = 0; length < statistics->num_of_lengths; length++)
+    {
+      squares += (double) statistics->length_counts[length]
+                 * (length - mean) * (length - mean);
+    }
+  *mean_p = mean;
+  *variance_p = finished > 0 ? squares / finished : 0;
+}
+
+/**
+ * @param statistics
+ * @param fraction in [0, 1]
+ * @return shortest length at least fraction of the finished walks are not
+ * longer than, -1 if no walk finished
+ */
+int walk_length_percentile(WalkStatistics *statistics, double fraction)
+{
+  long long finished = statistics->num_of_walks
+                       - statistics->num_of_unfinished;
+  double target = fraction * (double) finished;
+  long long needed = (long long) target;
+  if (needed < target || needed == 0) // rounded up, and one walk at least
+    {
+      needed++;
+    }
+  long long within = 0;
+  for (int length = 0; length < statistics->num_of_lengths; length++)
+    {
+      within += statistics->length_counts[length];
+      if (within >= needed)
+        {
+          return length;
+        }
+    }
+  return -1;
+}
+
+/**
+ * Free statistics and all of it's content from memory
+ * @param statistics_p statistics to free
+ */
+void free_walk_statistics(WalkStatistics **statistics_p)
+{
+  if (*statistics_p != NULL)
+    {
+      free ((*statistics_p)->visits);
+      free ((*statistics_p)->length_counts);
+      free (*statistics_p);
+      *statistics_p = NULL;
+    }
+}
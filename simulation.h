@@ -0,0 +1,105 @@
+#ifndef _SIMULATION_H
+#define _SIMULATION_H
+
+#include <stdint.h> // For int32_t
+
+#define SIMULATION_ALL_THREADS 0 // a thread for every online processor
+#define SIMULATION_LANES 8 // games a thread of dice plays at once
+
+/***************************/
+/*        STRUCTS          */
+/***************************/
+
+/**
+ * Totals of many random games of a DiceBoard, from one start cell until
+ * they end at a cell with no moves. The games are split between threads,
+ * each with a random stream of it's own, that only read the board; their
+ * totals are added up once they are done, so nothing is printed or shared
+ * while they run.
+ */
+typedef struct WalkStatistics {
+    int num_of_states;
+    long long num_of_walks;
+    long long num_of_unfinished; // walks longer than max_length, cut there
+    long long *visits; // times the walks were at every state, by id
+    long long *length_counts; // finished walks of every length
+    int num_of_lengths; // one more than the longest finished walk
+    int num_of_threads; // threads the walks ran on
+    double seconds; // wall clock time of the walks
+} WalkStatistics;
+
+/**
+ * A board game of dice, flattened for simulate_dice_games: a roll moves a
+ * game forward uniformly from 1 to moves cells, then every ladder and snake
+ * on the way is taken in a single jump. Cell num_of_cells is a trap, the
+ * jump of a loop of ladders and snakes, that never ends.
+ */
+typedef struct DiceBoard {
+    int num_of_cells;
+    int32_t *moves; // 0 for the cells games end at, and the linked ones
+    int32_t *links; // cell a ladder or snake takes a game to, or the cell
+    int32_t *jumps; // cell a game landing on a cell ends up at
+} DiceBoard;
+
+/**
+ * Initialize and Allocate the DiceBoard of the given moves and links, and
+ * fold every chain of links into one jump
+ * @param moves cells a roll may move forward from every cell, 0 for none
+ * @param links cell a ladder or snake takes a game landing on every cell
+ * to, the cell itself if none
+ * @param num_of_cells
+ * @return DiceBoard pointer, NULL in case of memory allocation failure or
+ * if a move leaves the board
+ * @ownership Weak Ownership. separate function for Free (free_dice_board)
+ */
+DiceBoard* new_dice_board(const int *moves, const int *links,
+                          int num_of_cells);
+
+/**
+ * Play num_of_games games of the board from start_cell, SIMULATION_LANES
+ * games at a time on every thread. The games of a seed are the same for the
+ * same number of threads.
+ * @param board board to play, not changed while the games run
+ * @param start_cell
+ * @param num_of_games
+ * @param max_rolls rolls a game is cut at
+ * @param num_of_threads SIMULATION_ALL_THREADS for one per processor
+ * @param seed of the random streams
+ * @return WalkStatistics pointer, with the visits of every cell and the
+ * number of rolls of every game, NULL in case of memory allocation failure
+ * @ownership Weak Ownership. separate function for Free
+ * (free_walk_statistics)
+ */
+WalkStatistics* simulate_dice_games(DiceBoard *board, int start_cell,
+                                    long long num_of_games, int max_rolls,
+                                    int num_of_threads, unsigned int seed);
+
+/**
+ * Free board and all of it's content from memory
+ * @param board_p board to free
+ */
+void free_dice_board(DiceBoard **board_p);
+
+/**
+ * @param statistics
+ * @param mean_p out param, mean length of the finished walks
+ * @param variance_p out param, variance of their length
+ */
+void walk_length_moments(WalkStatistics *statistics, double *mean_p,
+                         double *variance_p);
+
+/**
+ * @param statistics
+ * @param fraction in [0, 1]
+ * @return shortest length at least fraction of the finished walks are not
+ * longer than, -1 if no walk finished
+ */
+int walk_length_percentile(WalkStatistics *statistics, double fraction);
+
+/**
+ * Free statistics and all of it's content from memory
+ * @param statistics_p statistics to free
+ */
+void free_walk_statistics(WalkStatistics **statistics_p);
+
+#endif /* _SIMULATION_H */
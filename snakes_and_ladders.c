@@ -1,5 +1,8 @@
 #include <string.h>
-#include "markov_chain.h"
+#include "int_chain.h"
+#include "absorbing_chain.h"
+#include "simulation.h"
+#include "transition_matrix.h"
 
 #define MAX(X, Y) (((X) < (Y)) ? (Y) : (X))
 
@@ -9,14 +12,61 @@
 #define DICE_MAX 6
 #define NUM_OF_TRANSITIONS 20
 #define ARG_NUM 3
+#define OPTION_ARG_NUM 1 // with an analysis option, no Seed and paths
+#define OPTION_PREFIX "--"
+#define ANALYZE_OPTION "--analyze"
+#define LENGTHS_OPTION "--lengths"
+#define BOARD_OPTION "--board"
+#define SIMULATE_OPTION "--simulate"
+#define THREADS_OPTION "--threads"
+#define AFTER_OPTION "--after"
+#define NO_ROLLS (-1)
+#define LENGTHS_TOLERANCE 1e-12 // probability of a longer game left out
+#define MAX_GAME_LENGTH 1000000
 #define SEED_ARG 1
 #define NUM_OF_PATHS 2
 #define DECIMAL 10
 #define COUNTER_OF_PATHS_INIT 1
-#define USAGE_ERROR "USAGE: Enter Seed & Num of wanted paths.\n"
-#define ALLOC_ERROR_CELL "Allocation failure: Alloc of new cell failed."
+#define USAGE_ERROR "USAGE: Enter Seed & Num of wanted paths, or " \
+ANALYZE_OPTION " for the exact expected game, or " LENGTHS_OPTION \
+" for the exact distribution of it's number of rolls, or " AFTER_OPTION \
+" N for the exact distribution of the cell after N rolls.\n" \
+"Options: " BOARD_OPTION " PATH (board spec: the number of cells and of " \
+"dice faces, then a pair of cell numbers \"from to\" for every ladder and " \
+"snake, separated by white space); " SIMULATE_OPTION " (play Num games " \
+"and print their statistics, not the paths); " THREADS_OPTION " N (threads " \
+"of " SIMULATE_OPTION " and " AFTER_OPTION ", one per processor by " \
+"default).\n"
+#define FILE_ERROR "ERROR: problem with opening file.\n"
+#define BOARD_ERROR "ERROR: bad board file.\n"
 #define ALLOCATION_ERROR_MASSAGE \
 "Allocation failure: Failed to allocate new memory\n"
+#define ANALYSIS_HEADER \
+"Cell\tExpected rolls to end\tExpected visits\tProbability to end\n"
+#define ANALYSIS_ROW "%d\t%.6f\t%.6f\t%.6f\n"
+#define ANALYSIS_SUMMARY "Expected rolls from cell 1 to cell %d: %.6f\n"
+#define LENGTHS_HEADER "Rolls\tProbability\tProbability within\n"
+#define LENGTHS_ROW "%d\t%.12f\t%.12f\n"
+#define LENGTHS_TAIL "Probability of more than %d rolls: %.3e\n"
+#define SIMULATION_SUMMARY \
+"Simulated %lld games on %d threads in %.3f seconds: %.0f games per second\n"
+#define SIMULATION_ROLLS "Rolls: mean %.6f, variance %.6f, min %d, " \
+"median %d, 90th percentile %d, 99th percentile %d, max %d\n"
+#define SIMULATION_UNFINISHED \
+"Games cut at %d rolls, or caught in a loop of ladders and snakes: %lld\n"
+#define AFTER_HEADER "Cell\tProbability after %d rolls\n"
+#define AFTER_ROW "%d\t%.12f\n"
+#define AFTER_TRAPPED \
+"Probability to be caught in a loop of ladders and snakes: %.3e\n"
+#define VISITS_HEADER "Cell\tVisits\tVisits per game\n"
+#define VISITS_ROW "%d\t%lld\t%.6f\n"
+#define HITS_HEADER "Transition\tFrom\tTo\tHits\tHits per game\n"
+#define HITS_ROW "%s\t%d\t%d\t%lld\t%.6f\n"
+#define LADDER_NAME "Ladder"
+#define SNAKE_NAME "Snake"
+#define MEDIAN 0.5
+#define PERCENTILE_90 0.9
+#define PERCENTILE_99 0.99
 
 /**
  * represents the transitions by ladders and snakes in the game
@@ -47,7 +97,7 @@ const int transitions[][2] = {{13, 4},
  * struct represents a Cell in the game board
  */
 typedef struct Cell {
-    int number; // Cell number 1-100
+    int number; // Cell number 1 to the size of the board
     int ladder_to;
     int snake_to;
     //both ladder_to and snake_to should be -1 if the Cell doesn't have them
@@ -66,97 +116,174 @@ static int handle_error(char *error_msg, MarkovChain **database)
 }
 
 /**
- * Creates an Array of cells that represents the board game
- * @param cells
+ * A game board: it's cells and the faces of it's dice
+ */
+typedef struct Board {
+    int size; // number of cells, the last one ends the game
+    int dice_max;
+    Cell *cells; // cells[i] is the Cell numbered i + 1
+} Board;
+
+/**
+ * Board played, for the state functions of the chain, that only get the
+ * number of the state: state i is the Cell numbered i + 1
+ */
+static int board_size = BOARD_SIZE;
+static Cell *board_cells = NULL;
+
+/**
+ * @param state MarkovNode of the chain
+ * @return Cell of the state
+ */
+static Cell* cell_of(MarkovNode *state)
+{
+  return &board_cells[get_int_state (state)];
+}
+
+/**
+ * Allocates the cells of a board, with no ladders and snakes
+ * @param board out param
+ * @param size number of cells
+ * @param dice_max faces of the dice
  * @return EXIT_SUCCESS or EXIT_FAILURE
- * @ownership Strong & Weak ownership, frees data in case of failure.
- * In case of success the array is freed in fill_database function.
+ * @ownership Weak ownership, board->cells is freed by the caller
  */
-static int create_board(Cell *cells[BOARD_SIZE])
+static int new_board(Board *board, int size, int dice_max)
 {
-    for (int i = 0; i < BOARD_SIZE; i++)
+    board->cells = malloc(sizeof(Cell) * size);
+    if (board->cells == NULL)
     {
-        cells[i] = malloc(sizeof(Cell));
-        if (cells[i] == NULL)
-        {
-            for (int j = 0; j < i; j++) {
-                free(cells[j]);
-            }
-            handle_error(ALLOCATION_ERROR_MASSAGE,NULL);
-            return EXIT_FAILURE;
-        }
-        *(cells[i]) = (Cell) {i + 1, EMPTY, EMPTY};
+        return handle_error(ALLOCATION_ERROR_MASSAGE, NULL);
     }
-    for (int i = 0; i < NUM_OF_TRANSITIONS; i++)
+    board->size = size;
+    board->dice_max = dice_max;
+    for (int i = 0; i < size; i++)
     {
-        int from = transitions[i][0]; // Cell of Transition
-        int to = transitions[i][1];
-        if (from < to)
-        {
-            cells[from - 1]->ladder_to = to; // Ladder
-        }
-        else
-        {
-            cells[from - 1]->snake_to = to; // Snake
-        }
+        board->cells[i] = (Cell) {i + 1, EMPTY, EMPTY};
     }
     return EXIT_SUCCESS;
 }
 
 /**
- * fills database
- * @param markov_chain
+ * Adds a ladder from cell from to cell to if from<to, a snake otherwise
+ * @return false if it is not a transition the board can have
+ */
+static bool add_transition(Board *board, int from, int to)
+{
+    if (from < 1 || from >= board->size || to < 1 || to > board->size
+        || from == to)
+    {
+        return false;
+    }
+    Cell *cell = &board->cells[from - 1]; // Cell of Transition
+    if (cell->ladder_to != EMPTY || cell->snake_to != EMPTY)
+    {
+        return false;
+    }
+    if (from < to)
+    {
+        cell->ladder_to = to; // Ladder
+    }
+    else
+    {
+        cell->snake_to = to; // Snake
+    }
+    return true;
+}
+
+/**
+ * Creates the board game of the transitions table
+ * @param board out param
  * @return EXIT_SUCCESS or EXIT_FAILURE
- * @ownership - Frees the Cell array allocated in create_board function
+ * @ownership Weak ownership, board->cells is freed by the caller
  */
-static int fill_database(MarkovChain *markov_chain)
+static int create_board(Board *board)
 {
-    Cell* cells[BOARD_SIZE];
-    if(create_board(cells) == EXIT_FAILURE)
+    if (new_board(board, BOARD_SIZE, DICE_MAX) == EXIT_FAILURE)
     {
         return EXIT_FAILURE;
     }
-    MarkovNode *from_node = NULL, *to_node = NULL;
-    size_t index_to;
-    for (size_t i = 0; i < BOARD_SIZE; i++)
+    for (int i = 0; i < NUM_OF_TRANSITIONS; i++)
+    {
+        add_transition(board, transitions[i][0], transitions[i][1]);
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Reads a board spec: the number of cells and of dice faces, then a pair
+ * of cell numbers "from to" for every ladder and snake, all separated by
+ * white space
+ * @param path spec file
+ * @param board out param
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ * @ownership Weak ownership, board->cells is freed by the caller
+ */
+static int load_board(char *path, Board *board)
+{
+  FILE *fp = fopen (path, "r");
+  if (fp == NULL)
+    {
+      printf ("%s", FILE_ERROR);
+      return EXIT_FAILURE;
+    }
+  int size = 0, dice_max = 0;
+  if (fscanf (fp, "%d %d", &size, &dice_max) != 2 || size < 1
+      || dice_max < 1)
+    {
+      printf ("%s", BOARD_ERROR);
+      fclose (fp);
+      return EXIT_FAILURE;
+    }
+  if (new_board (board, size, dice_max) == EXIT_FAILURE)
+    {
+      fclose (fp);
+      return EXIT_FAILURE;
+    }
+  int from, to, read;
+  while ((read = fscanf (fp, "%d %d", &from, &to)) == 2
+         && add_transition (board, from, to))
     {
-        add_to_database(markov_chain, cells[i]);
     }
-    for (size_t i = 0; i < BOARD_SIZE; i++)
+  fclose (fp);
+  if (read != EOF)
     {
-        from_node = get_node_from_database(markov_chain,
-                                           cells[i])->data;
+      printf ("%s", BOARD_ERROR);
+      free (board->cells);
+      board->cells = NULL;
+      return EXIT_FAILURE;
+    }
+  return EXIT_SUCCESS;
+}
+
+/**
+ * fills database, linking every state to the states of it's moves
+ * @param int_chain chain of a state per cell
+ * @param board
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+static int fill_database(IntChain *int_chain, Board *board)
+{
+    bool added = true;
+    for (int i = 0; added && i < board->size; i++)
+    {
+        Cell *cell = &board->cells[i];
         // If it's a cell of transition
-        if (cells[i]->snake_to != EMPTY || cells[i]->ladder_to != EMPTY)
+        if (cell->snake_to != EMPTY || cell->ladder_to != EMPTY)
         {
-            index_to = MAX(cells[i]->snake_to,cells[i]->ladder_to) - 1;
-            to_node = get_node_from_database(markov_chain,
-                                             cells[index_to])->data;
-            add_node_to_counter_list(from_node, to_node,
-                                     markov_chain);
+            int index_to = MAX(cell->snake_to, cell->ladder_to) - 1;
+            added = add_int_link(int_chain, i, index_to, 1);
         }
-        else // For a regular cell we define 6 possibilities of moving ahead
+        else // For a regular cell we define dice_max possibilities
         {
-            for (int j = 1; j <= DICE_MAX; j++)
+            for (int j = 1; added && j <= board->dice_max
+                            && j < board->size - i; j++)
             {
-                index_to = ((Cell*) (from_node->data))->number + j - 1;
-                if (index_to >= BOARD_SIZE)
-                {
-                    break;
-                }
-                to_node = get_node_from_database(markov_chain,
-                                                 cells[index_to])
-                        ->data;
-                add_node_to_counter_list(from_node,
-                                         to_node, markov_chain);
+                added = add_int_link(int_chain, i, i + j, 1);
             }
         }
     }
-    for (size_t i = 0; i < BOARD_SIZE; i++) // free temp arr
-    {
-        free(cells[i]);
-    }
-    return EXIT_SUCCESS;
+    return added ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
 /**
@@ -180,10 +307,11 @@ static void generate_tweets(MarkovChain *markov_chain_p, int max_move_num)
 
 /**
  * Cell format print function to use in generic database
- * @param cell
+ * @param state number of the state of the cell
  */
-static void print_cell(Cell *cell)
+static void print_cell(int *state)
 {
+  Cell *cell = &board_cells[*state];
   if (cell->ladder_to != EMPTY)
     {
       printf ("[%d]-ladder to %d -> ",cell->number, cell->ladder_to);
@@ -192,147 +320,501 @@ static void print_cell(Cell *cell)
     {
       printf ("[%d]-snake to %d -> ",cell->number, cell->snake_to);
     }
-  else if (cell->number != BOARD_SIZE)
+  else if (cell->number != board_size)
     {
       printf ("[%d] -> ",cell->number);
     }
-  else if (cell->number == BOARD_SIZE)
+  else if (cell->number == board_size)
     {
       printf ("[%d]",cell->number);
     }
 }
 
 /**
- * Cell deep copy function to use in generic database
- * @param cell
- * @return copied cell
- * @ownership Weak Ownership - separate function for Free (free_markov_chain)
+ * Check if cell is last (if cell number is MAX)
+ * @param state number of the state of the cell
+ * @return true if last, false if isn't
  */
-static Cell* cell_copy(Cell *cell)
+static bool is_cell_last(int *state)
 {
-  if (!cell)
+  if (state == NULL)
     {
-      return NULL;
+      return false;
     }
-  Cell *new_cell = calloc(1,sizeof (Cell));
-  if (!new_cell)
+  if (board_cells[*state].number == board_size)
     {
-      printf ("%s", ALLOC_ERROR_CELL);
+      return true;
+    }
+  return false;
+}
+
+/**
+ * Cost of leaving every cell: a roll, none for a ladder or a snake, that is
+ * taken in the roll that got to it's cell
+ * @return array of the costs by state, NULL in case of memory allocation
+ * failure
+ */
+static double* roll_costs(MarkovChain *markov_chain)
+{
+  double *costs = malloc (sizeof (double) * (markov_chain->database->size
+                                             + (size_t) 1));
+  if (costs == NULL)
+    {
+      printf ("%s", ALLOCATION_ERROR_MASSAGE);
       return NULL;
     }
-  *new_cell = (Cell) {cell->number, cell->ladder_to,
-                      cell->snake_to};
-  return new_cell;
+  for (Node *node = markov_chain->database->first; node != NULL;
+       node = node->next)
+    {
+      Cell *cell = cell_of (node->data);
+      costs[node->data->id] = cell->ladder_to != EMPTY
+                              || cell->snake_to != EMPTY ? 0 : 1;
+    }
+  return costs;
 }
 
 /**
- * Check if cell is last (if cell number is MAX)
- * @param cell
- * @return true if last, false if isn't
+ * Print the exact expected game of the board: for every cell the expected
+ * rolls until the game ends, the expected visits of a game from cell 1 and
+ * the probability to get to the last cell.
+ * @param markov_chain filled by fill_database
+ * @return EXIT_SUCCESS or EXIT_FAILURE
  */
-static bool is_cell_last(Cell *cell)
+static int analyze_board(MarkovChain *markov_chain)
 {
-  if (cell == NULL)
+  AbsorbingChain *chain = new_absorbing_chain (markov_chain);
+  if (chain == NULL)
     {
-      return false;
+      return EXIT_FAILURE;
     }
-  if (cell->number == BOARD_SIZE)
+  int n = chain->num_of_states;
+  double *costs = roll_costs (markov_chain);
+  double *rolls = malloc (sizeof (double) * (n + (size_t) 1));
+  double *visits = malloc (sizeof (double) * (n + (size_t) 1));
+  double *probabilities = malloc (sizeof (double) * (n + (size_t) 1));
+  int success = EXIT_FAILURE;
+  if (costs != NULL && rolls != NULL && visits != NULL
+      && probabilities != NULL)
     {
-      return true;
+      int start = markov_chain->database->first->data->id;
+      success = solve_expected_costs (chain, costs, rolls);
+      if (success == EXIT_SUCCESS)
+        {
+          success = solve_expected_visits (chain, start, visits);
+        }
+      if (success == EXIT_SUCCESS)
+        {
+          success = solve_goal_probabilities (chain, probabilities);
+        }
+      if (success == EXIT_SUCCESS)
+        {
+          printf (ANALYSIS_SUMMARY, board_size, rolls[start]);
+          printf ("%s", ANALYSIS_HEADER);
+          for (Node *node = markov_chain->database->first; node != NULL;
+               node = node->next)
+            {
+              int state = node->data->id;
+              printf (ANALYSIS_ROW, cell_of (node->data)->number,
+                      rolls[state], visits[state], probabilities[state]);
+            }
+        }
     }
-  return false;
+  else if (costs != NULL)
+    {
+      printf ("%s", ALLOCATION_ERROR_MASSAGE);
+    }
+  free (costs);
+  free (rolls);
+  free (visits);
+  free (probabilities);
+  free_absorbing_chain (&chain);
+  return success;
 }
 
 /**
- * Free Cell allocation to use in generic database
- * @param cell
+ * Print the exact distribution of the number of rolls of a game from cell 1
+ * until the game ends, and of the number of rolls it ends within
+ * @param markov_chain filled by fill_database
+ * @return EXIT_SUCCESS or EXIT_FAILURE
  */
-static void free_cell(Cell *cell)
+static int print_game_lengths(MarkovChain *markov_chain)
 {
-  if (cell)
+  AbsorbingChain *chain = new_absorbing_chain (markov_chain);
+  if (chain == NULL)
+    {
+      return EXIT_FAILURE;
+    }
+  int start = markov_chain->database->first->data->id;
+  double *costs = roll_costs (markov_chain);
+  double *distribution = NULL, trapped = 0;
+  int num_of_lengths = 0;
+  int success = EXIT_FAILURE;
+  if (costs != NULL)
     {
-      free(cell);
-      cell = NULL;
+      success = solve_length_distribution (chain, start, costs,
+                                           LENGTHS_TOLERANCE, MAX_GAME_LENGTH,
+                                           &distribution, &num_of_lengths,
+                                           &trapped);
+    }
+  if (success == EXIT_SUCCESS)
+    {
+      printf ("%s", LENGTHS_HEADER);
+      double within = 0;
+      for (int rolls = 0; rolls < num_of_lengths; rolls++)
+        {
+          within += distribution[rolls];
+          printf (LENGTHS_ROW, rolls, distribution[rolls], within);
+        }
+      printf (LENGTHS_TAIL, num_of_lengths - 1,
+              MAX (1 - within - trapped, 0));
+      if (trapped > 0)
+        {
+          printf (AFTER_TRAPPED, trapped);
+        }
+    }
+  free (distribution);
+  free (costs);
+  free_absorbing_chain (&chain);
+  return success;
+}
+
+/**
+ * Print the statistics of simulated games
+ * @param markov_chain
+ * @param statistics
+ */
+static void print_simulation(MarkovChain *markov_chain,
+                             WalkStatistics *statistics)
+{
+  double mean, variance;
+  walk_length_moments (statistics, &mean, &variance);
+  double games = (double) statistics->num_of_walks;
+  printf (SIMULATION_SUMMARY, statistics->num_of_walks,
+          statistics->num_of_threads, statistics->seconds,
+          statistics->seconds > 0 ? games / statistics->seconds : 0);
+  printf (SIMULATION_ROLLS, mean, variance,
+          walk_length_percentile (statistics, 0),
+          walk_length_percentile (statistics, MEDIAN),
+          walk_length_percentile (statistics, PERCENTILE_90),
+          walk_length_percentile (statistics, PERCENTILE_99),
+          statistics->num_of_lengths - 1);
+  if (statistics->num_of_unfinished > 0)
+    {
+      printf (SIMULATION_UNFINISHED, MAX_GAME_LENGTH,
+              statistics->num_of_unfinished);
+    }
+  printf ("%s", VISITS_HEADER);
+  for (Node *node = markov_chain->database->first; node != NULL;
+       node = node->next)
+    {
+      long long visits = statistics->visits[node->data->id];
+      printf (VISITS_ROW, cell_of (node->data)->number, visits,
+              (double) visits / games);
+    }
+  printf ("%s", HITS_HEADER);
+  for (Node *node = markov_chain->database->first; node != NULL;
+       node = node->next)
+    {
+      Cell *cell = cell_of (node->data);
+      if (cell->ladder_to != EMPTY || cell->snake_to != EMPTY)
+        {
+          long long hits = statistics->visits[node->data->id];
+          printf (HITS_ROW, cell->ladder_to != EMPTY ? LADDER_NAME
+                                                     : SNAKE_NAME,
+                  cell->number, MAX (cell->ladder_to, cell->snake_to), hits,
+                  (double) hits / games);
+        }
     }
 }
 
 /**
- * Compare cell function - checks if cells have the same number
- * @param cell_1
- * @param cell_2
- * @return 0 if they have same number, otherwise, the difference between them
+ * Flatten the board of the chain for simulate_dice_games. The states are
+ * numbered by their id, that is their cell number - 1, and a regular cell
+ * moves to the cells right after it.
+ * @param markov_chain
+ * @return DiceBoard pointer, NULL in case of memory allocation failure
+ * @ownership Weak Ownership. separate function for Free (free_dice_board)
  */
-static int compare_cells(Cell *cell_1, Cell *cell_2)
+static DiceBoard* flatten_board(MarkovChain *markov_chain)
 {
-  int result = (cell_1->number)-(cell_2->number);
-  return result;
+  int num_of_cells = markov_chain->database->size;
+  int *moves = malloc (sizeof (int) * (num_of_cells + (size_t) 1));
+  int *links = malloc (sizeof (int) * (num_of_cells + (size_t) 1));
+  DiceBoard *board = NULL;
+  if (moves == NULL || links == NULL)
+    {
+      printf ("%s", ALLOCATION_ERROR_MASSAGE);
+    }
+  else
+    {
+      for (Node *node = markov_chain->database->first; node != NULL;
+           node = node->next)
+        {
+          MarkovNode *state = node->data;
+          Cell *cell = cell_of (state);
+          bool jumps = cell->ladder_to != EMPTY || cell->snake_to != EMPTY;
+          moves[state->id] = jumps ? 0 : state->counter_list_length;
+          links[state->id] = jumps ? state->counter_list[0].markov_node->id
+                                   : state->id;
+        }
+      board = new_dice_board (moves, links, num_of_cells);
+    }
+  free (moves);
+  free (links);
+  return board;
 }
 
 /**
- * MarkovChain and LinkedList initialization
- * @param database_pp
- * @param markov_chain_pp
+ * Play games from cell 1 on several threads, and print their statistics
+ * rather than their paths
+ * @param markov_chain
+ * @param num_of_games
+ * @param num_of_threads SIMULATION_ALL_THREADS for one per processor
+ * @param seed
  * @return EXIT_SUCCESS or EXIT_FAILURE
- * @ownership Strong & Weak - frees LinkedList in case of failure.
- * In case of success, separate function for Free (free_markov_chain)
  */
-static int initialize_structs(LinkedList **database_pp, MarkovChain
-**markov_chain_pp)
+static int simulate_games(MarkovChain *markov_chain, long long num_of_games,
+                          int num_of_threads, unsigned int seed)
 {
-  *database_pp = new_linked_list();
-  if (*database_pp==NULL)
+  DiceBoard *board = flatten_board (markov_chain);
+  if (board == NULL)
     {
       return EXIT_FAILURE;
     }
-  *markov_chain_pp = new_markov_chain();
-  if (*markov_chain_pp == NULL)
+  WalkStatistics *statistics = simulate_dice_games
+      (board, markov_chain->database->first->data->id, num_of_games,
+       MAX_GAME_LENGTH, num_of_threads, seed);
+  free_dice_board (&board);
+  if (statistics == NULL)
     {
-      free(*database_pp);
       return EXIT_FAILURE;
     }
-  (*markov_chain_pp)->print_func = (void*) print_cell;
-  (*markov_chain_pp)->copy_func = (void*) cell_copy;
-  (*markov_chain_pp)->comp_func = (void*) compare_cells;
-  (*markov_chain_pp)->is_last = (void*) is_cell_last;
-  (*markov_chain_pp)->free_data = (void*) free_cell;
+  print_simulation (markov_chain, statistics);
+  free_walk_statistics (&statistics);
   return EXIT_SUCCESS;
 }
 
+/**
+ * Chain of the rolls of the board, a ladder or snake taken in the same roll
+ * as the move to it: the cells of the board and the trap of the DiceBoard,
+ * with the games ended or trapped staying where they are
+ * @param board flattened board
+ * @return IntChain pointer, NULL in case of memory allocation failure
+ * @ownership Weak Ownership. separate function for Free (free_int_chain)
+ */
+static IntChain* new_roll_chain(DiceBoard *board)
+{
+  IntChain *roll_chain = new_int_chain (board->num_of_cells + 1, NULL, NULL);
+  for (int cell = 0; roll_chain != NULL && cell < board->num_of_cells;
+       cell++)
+    {
+      for (int roll = 1; roll <= board->moves[cell]; roll++)
+        {
+          if (!add_int_link (roll_chain, cell, board->jumps[cell + roll], 1))
+            {
+              printf ("%s", ALLOCATION_ERROR_MASSAGE);
+              free_int_chain (&roll_chain);
+              break;
+            }
+        }
+    }
+  return roll_chain;
+}
+
+/**
+ * Print the exact distribution of the cell a game from cell 1 is at after
+ * the given number of rolls, the games that ended staying at the end
+ * @param markov_chain filled by fill_database
+ * @param num_of_rolls
+ * @param num_of_threads TRANSITION_ALL_THREADS for one per processor
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+static int print_cells_after(MarkovChain *markov_chain, int num_of_rolls,
+                             int num_of_threads)
+{
+  DiceBoard *board = flatten_board (markov_chain);
+  IntChain *roll_chain = board == NULL ? NULL : new_roll_chain (board);
+  TransitionMatrix *matrix = roll_chain == NULL ? NULL
+      : new_transition_matrix (roll_chain->markov_chain, false);
+  double *distribution = NULL;
+  int success = EXIT_FAILURE;
+  if (matrix != NULL)
+    {
+      distribution = calloc (matrix->num_of_states, sizeof (double));
+      if (distribution == NULL)
+        {
+          printf ("%s", ALLOCATION_ERROR_MASSAGE);
+        }
+    }
+  if (distribution != NULL)
+    {
+      distribution[board->jumps[markov_chain->database->first->data->id]] = 1;
+      success = step_distribution (matrix, distribution, num_of_rolls,
+                                   num_of_threads);
+    }
+  if (success == EXIT_SUCCESS)
+    {
+      printf (AFTER_HEADER, num_of_rolls);
+      for (Node *node = markov_chain->database->first; node != NULL;
+           node = node->next)
+        {
+          printf (AFTER_ROW, cell_of (node->data)->number,
+                  distribution[node->data->id]);
+        }
+      if (distribution[board->num_of_cells] > 0)
+        {
+          printf (AFTER_TRAPPED, distribution[board->num_of_cells]);
+        }
+    }
+  free (distribution);
+  free_transition_matrix (&matrix);
+  free_int_chain (&roll_chain);
+  free_dice_board (&board);
+  return success;
+}
+
+/**
+ * Options of the program, given before, after or between the arguments
+ */
+typedef struct Options {
+    bool analyze;
+    bool lengths;
+    bool simulate;
+    int threads; // of the simulation and of the rolls after
+    char *board; // spec file, NULL for the default board
+    int after; // rolls to print the distribution of the cell after, or
+               // NO_ROLLS
+} Options;
+
+/**
+ * Read the options, moving the other arguments to the start of argv
+ * @param argc num of arguments
+ * @param argv arguments
+ * @param options out param
+ * @return num of other arguments (with the program name), -1 for a bad
+ * option
+ */
+static int parse_options(int argc, char **argv, Options *options)
+{
+  int positional_num = 0;
+  for (int i = 0; i < argc; i++)
+    {
+      if (i == 0 || strncmp (argv[i], OPTION_PREFIX,
+                             strlen (OPTION_PREFIX)) != 0)
+        {
+          argv[positional_num++] = argv[i];
+        }
+      else if (strcmp (argv[i], ANALYZE_OPTION) == 0)
+        {
+          options->analyze = true;
+        }
+      else if (strcmp (argv[i], LENGTHS_OPTION) == 0)
+        {
+          options->lengths = true;
+        }
+      else if (strcmp (argv[i], SIMULATE_OPTION) == 0)
+        {
+          options->simulate = true;
+        }
+      else if (strcmp (argv[i], THREADS_OPTION) == 0 && i + 1 < argc)
+        {
+          options->threads = (int) strtol (argv[++i], NULL, DECIMAL);
+        }
+      else if (strcmp (argv[i], BOARD_OPTION) == 0 && i + 1 < argc)
+        {
+          options->board = argv[++i];
+        }
+      else if (strcmp (argv[i], AFTER_OPTION) == 0 && i + 1 < argc)
+        {
+          options->after = (int) strtol (argv[++i], NULL, DECIMAL);
+        }
+      else
+        {
+          return -1;
+        }
+    }
+  return positional_num;
+}
+
 /**
  * @param argc num of arguments
- * @param argv 1) Seed 2) Number of sentences to generate
+ * @param argv 1) Seed 2) Number of sentences to generate, or one of the
+ * analysis options, and the options
  * @return EXIT_SUCCESS or EXIT_FAILURE
  */
 int main(int argc, char *argv[])
 {
-  if (argc != ARG_NUM)
+  Options options = {false, false, false, SIMULATION_ALL_THREADS, NULL,
+                     NO_ROLLS};
+  int positional_num = parse_options (argc, argv, &options);
+  int num_of_analyses = options.analyze + options.lengths
+                        + (options.after != NO_ROLLS);
+  bool valid = positional_num == ARG_NUM && num_of_analyses == 0
+               && options.threads >= 0;
+  if (positional_num == OPTION_ARG_NUM)
+    {
+      valid = num_of_analyses == 1 && !options.simulate
+              && options.after >= NO_ROLLS && options.threads >= 0;
+    }
+  if (!valid)
     {
       printf ("%s", USAGE_ERROR);
       return EXIT_FAILURE;
     }
-  // initialize all arguments
-  unsigned int seed = strtol (argv[SEED_ARG], NULL, DECIMAL);
-  srand (seed); // use seed argument
-  int num_of_paths = (int) strtol (argv[NUM_OF_PATHS], NULL,
-                                   DECIMAL);
-  // initialization and allocation of all structs
-  LinkedList *database_p = NULL;
-  MarkovChain *markov_chain_p = NULL;
-  int check_success = initialize_structs (&database_p,
-                                          &markov_chain_p);
-  if (check_success == EXIT_FAILURE)
+  unsigned int seed = 0;
+  long long num_of_paths = 0;
+  if (positional_num == ARG_NUM)
     {
+      // initialize all arguments
+      seed = strtol (argv[SEED_ARG], NULL, DECIMAL);
+      srand (seed); // use seed argument
+      num_of_paths = strtoll (argv[NUM_OF_PATHS], NULL, DECIMAL);
+    }
+  if (options.simulate && num_of_paths < 1)
+    {
+      printf ("%s", USAGE_ERROR);
       return EXIT_FAILURE;
     }
-  markov_chain_p->database = database_p;
-  check_success = fill_database (markov_chain_p);
+  Board board;
+  int check_success = options.board != NULL
+                      ? load_board (options.board, &board)
+                      : create_board (&board);
   if (check_success == EXIT_FAILURE)
     {
-      free_markov_chain(&markov_chain_p);
       return EXIT_FAILURE;
     }
-  // tweet generation
-  generate_tweets (markov_chain_p, num_of_paths);
-  free_markov_chain(&markov_chain_p);
-  return EXIT_SUCCESS;
+  board_size = board.size;
+  board_cells = board.cells;
+  // a state per cell, found by it's number
+  IntChain *int_chain = new_int_chain (board.size, (void*) print_cell,
+                                       (void*) is_cell_last);
+  if (int_chain == NULL || fill_database (int_chain, &board) == EXIT_FAILURE)
+    {
+      free_int_chain (&int_chain);
+      free (board.cells);
+      return EXIT_FAILURE;
+    }
+  MarkovChain *markov_chain_p = int_chain->markov_chain;
+  if (options.analyze || options.lengths)
+    {
+      check_success = options.analyze ? analyze_board (markov_chain_p)
+                                      : print_game_lengths (markov_chain_p);
+    }
+  else if (options.after != NO_ROLLS)
+    {
+      check_success = print_cells_after (markov_chain_p, options.after,
+                                         options.threads);
+    }
+  else if (options.simulate)
+    {
+      check_success = simulate_games (markov_chain_p, num_of_paths,
+                                      options.threads, seed);
+    }
+  else // tweet generation
+    {
+      generate_tweets (markov_chain_p, (int) num_of_paths);
+    }
+  free_int_chain (&int_chain);
+  free (board.cells);
+  return check_success;
 }
@@ -0,0 +1,118 @@
+#include "string_pool.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+
+#define ALLOC_ERROR_STRING_POOL \
+"Allocation failure: Alloc of new StringPool failed.\n"
+#define ALLOC_ERROR_STRING_POOL_GROW \
+"Allocation failure: Alloc of StringPool block failed.\n"
+
+#define INITIAL_BLOCKS 16
+
+/**
+ * Initialize and Allocate new StringPool
+ * @return StringPool pointer, NULL in case of memory allocation failure
+ * @ownership Weak Ownership. separate function for Free (free_string_pool)
+ */
+StringPool* new_string_pool()
+{
+  StringPool *pool = malloc (sizeof (StringPool));
+  if (pool == NULL)
+    {
+      printf ("%s", ALLOC_ERROR_STRING_POOL);
+      return NULL;
+    }
+  // no current block yet: the first string opens one
+  *pool = (StringPool) {NULL, 0, 0, 0, STRING_POOL_BLOCK_SIZE};
+  return pool;
+}
+
+/**
+ * Append a block of the given size
+ * @return false in case of memory allocation failure
+ */
+static bool add_block(StringPool *pool, size_t size)
+{
+  if (pool->num_of_blocks == pool->blocks_capacity)
+    {
+      size_t capacity = pool->blocks_capacity == 0 ? INITIAL_BLOCKS
+                                                   : pool->blocks_capacity * 2;
+      char **blocks = realloc (pool->blocks, sizeof (char*) * capacity);
+      if (blocks == NULL)
+        {
+          printf ("%s", ALLOC_ERROR_STRING_POOL_GROW);
+          return false;
+        }
+      pool->blocks = blocks;
+      pool->blocks_capacity = capacity;
+    }
+  char *block = malloc (size);
+  if (block == NULL)
+    {
+      printf ("%s", ALLOC_ERROR_STRING_POOL_GROW);
+      return false;
+    }
+  pool->blocks[pool->num_of_blocks++] = block;
+  return true;
+}
+
+/**
+ * Copy a string to the end of the pool
+ * @param pool
+ * @param str bytes of the string, no null needed
+ * @param length number of bytes
+ * @return the null terminated copy, valid until the pool is freed, NULL in
+ * case of memory allocation failure
+ */
+char* add_to_string_pool(StringPool *pool, const char *str, size_t length)
+{
+  size_t size = length + 1;
+  size_t block;
+  size_t place = 0;
+  if (size > STRING_POOL_BLOCK_SIZE) // a block of it's own
+    {
+      if (!add_block (pool, size))
+        {
+          return NULL;
+        }
+      block = pool->num_of_blocks - 1;
+    }
+  else
+    {
+      if (pool->current_length + size > STRING_POOL_BLOCK_SIZE)
+        {
+          if (!add_block (pool, STRING_POOL_BLOCK_SIZE))
+            {
+              return NULL;
+            }
+          pool->current = pool->num_of_blocks - 1;
+          pool->current_length = 0;
+        }
+      block = pool->current;
+      place = pool->current_length;
+      pool->current_length += size;
+    }
+  char *copy = pool->blocks[block] + place;
+  memcpy (copy, str, length);
+  copy[length] = '\0';
+  return copy;
+}
+
+/**
+ * Free pool and all of it's strings from memory
+ * @param pool_p pool to free
+ */
+void free_string_pool(StringPool **pool_p)
+{
+  if (*pool_p != NULL)
+    {
+      for (size_t i = 0; i < (*pool_p)->num_of_blocks; i++)
+        {
+          free ((*pool_p)->blocks[i]);
+        }
+      free ((*pool_p)->blocks);
+      free (*pool_p);
+      *pool_p = NULL;
+    }
+}
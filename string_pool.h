@@ -0,0 +1,49 @@
+#ifndef _STRING_POOL_H
+#define _STRING_POOL_H
+
+#include <stdlib.h> // For size_t
+
+#define STRING_POOL_BLOCK_SIZE 65536 // bytes of a block of short strings
+
+/***************************/
+/*        STRUCTS          */
+/***************************/
+
+/**
+ * Append only pool of null terminated strings, kept one after the other in
+ * big blocks, in the order they were added, with no allocation of their
+ * own. Blocks are never moved, so the strings can be pointed at while the
+ * pool grows; a string too long for a block gets a block of it's own.
+ */
+typedef struct StringPool {
+    char **blocks;
+    size_t num_of_blocks;
+    size_t blocks_capacity;
+    size_t current; // block the next short string is written to
+    size_t current_length; // bytes used in the current block
+} StringPool;
+
+/**
+ * Initialize and Allocate new StringPool
+ * @return StringPool pointer, NULL in case of memory allocation failure
+ * @ownership Weak Ownership. separate function for Free (free_string_pool)
+ */
+StringPool* new_string_pool();
+
+/**
+ * Copy a string to the end of the pool
+ * @param pool
+ * @param str bytes of the string, no null needed
+ * @param length number of bytes
+ * @return the null terminated copy, valid until the pool is freed, NULL in
+ * case of memory allocation failure
+ */
+char* add_to_string_pool(StringPool *pool, const char *str, size_t length);
+
+/**
+ * Free pool and all of it's strings from memory
+ * @param pool_p pool to free
+ */
+void free_string_pool(StringPool **pool_p);
+
+#endif /* _STRING_POOL_H */
@@ -0,0 +1,245 @@
+#include "string_table.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+
+#define ALLOC_ERROR_STRING_TABLE \
+"Allocation failure: Alloc of new StringTable failed.\n"
+#define ALLOC_ERROR_STRING_TABLE_GROW \
+"Allocation failure: Realloc of StringTable failed.\n"
+#define ARENA_FULL_ERROR "ERROR: StringTable arena is over 4 GiB.\n"
+
+#define FNV_OFFSET_BASIS 2166136261u
+#define FNV_PRIME 16777619u
+#define INITIAL_SLOTS 1024
+#define INITIAL_ARENA_CAPACITY (1 << 16)
+#define EMPTY_SLOT (-1)
+
+/**
+ * FNV-1a hash of the given bytes
+ */
+static uint32_t hash_bytes(const char *str, size_t length)
+{
+  uint32_t hash = FNV_OFFSET_BASIS;
+  for (size_t i = 0; i < length; i++)
+    {
+      hash ^= (unsigned char) str[i];
+      hash *= FNV_PRIME;
+    }
+  return hash;
+}
+
+/**
+ * Initialize and Allocate new StringTable
+ * @param separator char written after every string in the arena
+ * @return StringTable pointer, NULL in case of memory allocation failure
+ * @ownership Weak Ownership. separate function for Free (free_string_table)
+ */
+StringTable* new_string_table(char separator)
+{
+  StringTable *table = malloc (sizeof (StringTable));
+  if (table == NULL)
+    {
+      printf ("%s", ALLOC_ERROR_STRING_TABLE);
+      return NULL;
+    }
+  int *slots = malloc (sizeof (int) * INITIAL_SLOTS);
+  if (slots == NULL)
+    {
+      printf ("%s", ALLOC_ERROR_STRING_TABLE);
+      free (table);
+      return NULL;
+    }
+  for (int i = 0; i < INITIAL_SLOTS; i++)
+    {
+      slots[i] = EMPTY_SLOT;
+    }
+  *table = (StringTable) {NULL, 0, 0, separator, NULL, NULL, NULL, 0, 0,
+                          slots, INITIAL_SLOTS};
+  return table;
+}
+
+/**
+ * @return the slot holding the string, or the empty slot it belongs in
+ */
+static size_t find_slot(StringTable *table, const char *str, size_t length,
+                        uint32_t hash)
+{
+  size_t mask = table->num_of_slots - 1;
+  for (size_t slot = hash & mask;; slot = (slot + 1) & mask)
+    {
+      int index = table->slots[slot];
+      if (index == EMPTY_SLOT)
+        {
+          return slot;
+        }
+      if (table->hashes[index] == hash
+          && get_string_length (table, index) == length
+          && memcmp (table->arena + table->offsets[index], str, length) == 0)
+        {
+          return slot;
+        }
+    }
+}
+
+/**
+ * Double the number of slots, keeping the load factor under a half
+ * @return false in case of memory allocation failure
+ */
+static bool grow_slots(StringTable *table)
+{
+  size_t num_of_slots = table->num_of_slots * 2;
+  int *slots = malloc (sizeof (int) * num_of_slots);
+  if (slots == NULL)
+    {
+      printf ("%s", ALLOC_ERROR_STRING_TABLE_GROW);
+      return false;
+    }
+  for (size_t i = 0; i < num_of_slots; i++)
+    {
+      slots[i] = EMPTY_SLOT;
+    }
+  for (int index = 0; index < table->size; index++)
+    {
+      size_t slot = table->hashes[index] & (num_of_slots - 1);
+      while (slots[slot] != EMPTY_SLOT)
+        {
+          slot = (slot + 1) & (num_of_slots - 1);
+        }
+      slots[slot] = index;
+    }
+  free (table->slots);
+  table->slots = slots;
+  table->num_of_slots = num_of_slots;
+  return true;
+}
+
+/**
+ * Make room for one more string of the given length
+ * @return false in case of memory allocation failure
+ */
+static bool reserve(StringTable *table, size_t length)
+{
+  size_t needed = table->arena_length + length + 1;
+  if (needed > UINT32_MAX)
+    {
+      printf ("%s", ARENA_FULL_ERROR);
+      return false;
+    }
+  if (needed > table->arena_capacity)
+    {
+      size_t capacity = table->arena_capacity == 0 ? INITIAL_ARENA_CAPACITY
+                                                   : table->arena_capacity;
+      while (capacity < needed)
+        {
+          capacity *= 2;
+        }
+      char *arena = realloc (table->arena, capacity);
+      if (arena == NULL)
+        {
+          printf ("%s", ALLOC_ERROR_STRING_TABLE_GROW);
+          return false;
+        }
+      table->arena = arena;
+      table->arena_capacity = capacity;
+    }
+  if (table->size == table->capacity)
+    {
+      int capacity = table->capacity == 0 ? INITIAL_SLOTS
+                                          : table->capacity * 2;
+      uint32_t *offsets = realloc (table->offsets, sizeof (uint32_t)
+                                                   * capacity);
+      if (offsets != NULL)
+        {
+          table->offsets = offsets;
+        }
+      uint32_t *hashes = realloc (table->hashes, sizeof (uint32_t) * capacity);
+      if (hashes != NULL)
+        {
+          table->hashes = hashes;
+        }
+      int *counts = realloc (table->counts, sizeof (int) * capacity);
+      if (counts != NULL)
+        {
+          table->counts = counts;
+        }
+      if (offsets == NULL || hashes == NULL || counts == NULL)
+        {
+          printf ("%s", ALLOC_ERROR_STRING_TABLE_GROW);
+          return false;
+        }
+      table->capacity = capacity;
+    }
+  if ((size_t) (table->size + 1) * 2 > table->num_of_slots)
+    {
+      return grow_slots (table);
+    }
+  return true;
+}
+
+/**
+ * Add one occurrence of the string of the given bytes
+ * @param table
+ * @param str bytes of the string, no null needed
+ * @param length number of bytes
+ * @return index of the string, in order of first addition, or
+ * STRING_TABLE_ERROR in case of memory allocation failure
+ */
+int add_to_string_table(StringTable *table, const char *str, size_t length)
+{
+  uint32_t hash = hash_bytes (str, length);
+  size_t slot = find_slot (table, str, length, hash);
+  if (table->slots[slot] != EMPTY_SLOT)
+    {
+      table->counts[table->slots[slot]]++;
+      return table->slots[slot];
+    }
+  size_t num_of_slots = table->num_of_slots;
+  if (!reserve (table, length))
+    {
+      return STRING_TABLE_ERROR;
+    }
+  if (table->num_of_slots != num_of_slots)
+    {
+      slot = find_slot (table, str, length, hash);
+    }
+  int index = table->size++;
+  table->offsets[index] = (uint32_t) table->arena_length;
+  table->hashes[index] = hash;
+  table->counts[index] = 1;
+  memcpy (table->arena + table->arena_length, str, length);
+  table->arena_length += length;
+  table->arena[table->arena_length++] = table->separator;
+  table->slots[slot] = index;
+  return index;
+}
+
+/**
+ * @param table
+ * @param index
+ * @return length of the string of the given index, separator excluded
+ */
+size_t get_string_length(StringTable *table, int index)
+{
+  size_t end = index + 1 < table->size ? table->offsets[index + 1]
+                                       : table->arena_length;
+  return end - table->offsets[index] - 1;
+}
+
+/**
+ * Free table and all of it's content from memory
+ * @param table_p table to free
+ */
+void free_string_table(StringTable **table_p)
+{
+  if (*table_p != NULL)
+    {
+      free ((*table_p)->arena);
+      free ((*table_p)->offsets);
+      free ((*table_p)->hashes);
+      free ((*table_p)->counts);
+      free ((*table_p)->slots);
+      free (*table_p);
+      *table_p = NULL;
+    }
+}
@@ -0,0 +1,64 @@
+#ifndef _STRING_TABLE_H
+#define _STRING_TABLE_H
+
+#include <stdlib.h> // For size_t
+#include <stdint.h> // For uint32_t
+
+#define STRING_TABLE_ERROR (-1)
+
+/***************************/
+/*        STRUCTS          */
+/***************************/
+
+/**
+ * Set of distinct strings, counting how many times each one was added.
+ * Strings are kept in one contiguous arena, in the order they were first
+ * added, each followed by the table's separator; they are found by an open
+ * addressing hash table of their indexes.
+ */
+typedef struct StringTable {
+    char *arena;
+    size_t arena_length;
+    size_t arena_capacity;
+    char separator; // written after every string in arena
+    uint32_t *offsets; // of each string in arena, by index
+    uint32_t *hashes; // of each string, by index
+    int *counts; // times each string was added, by index
+    int size; // number of distinct strings
+    int capacity; // of offsets, hashes and counts
+    int *slots; // string indexes, -1 for an empty slot
+    size_t num_of_slots; // a power of 2
+} StringTable;
+
+/**
+ * Initialize and Allocate new StringTable
+ * @param separator char written after every string in the arena
+ * @return StringTable pointer, NULL in case of memory allocation failure
+ * @ownership Weak Ownership. separate function for Free (free_string_table)
+ */
+StringTable* new_string_table(char separator);
+
+/**
+ * Add one occurrence of the string of the given bytes
+ * @param table
+ * @param str bytes of the string, no null needed
+ * @param length number of bytes
+ * @return index of the string, in order of first addition, or
+ * STRING_TABLE_ERROR in case of memory allocation failure
+ */
+int add_to_string_table(StringTable *table, const char *str, size_t length);
+
+/**
+ * @param table
+ * @param index
+ * @return length of the string of the given index, separator excluded
+ */
+size_t get_string_length(StringTable *table, int index);
+
+/**
+ * Free table and all of it's content from memory
+ * @param table_p table to free
+ */
+void free_string_table(StringTable **table_p);
+
+#endif /* _STRING_TABLE_H */
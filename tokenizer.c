@@ -0,0 +1,371 @@
+#include "tokenizer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#define HAS_X86_SIMD
+#endif
+
+#define ALLOC_ERROR_TOKENIZER \
+"Allocation failure: Alloc of new Tokenizer failed.\n"
+#define ALLOC_ERROR_WORD_BUFFER \
+"Allocation failure: Alloc of word buffer failed.\n"
+
+#define DOT '.'
+#define NO_DELIMITER '\0'
+#define INITIAL_CARRY_CAPACITY 64
+#define WORD_BITS 64
+#define WORD_SHIFT 6
+#define WORD_MASK 63
+#define BITMAP_WORDS (TOKENIZER_BLOCK_SIZE / WORD_BITS + 1) // and a sentinel
+
+static char empty_line_word[] = "\n";
+
+/**
+ * Checks if c separates words
+ * @param c
+ * @return true if c is a space, \r or \n
+ */
+bool is_token_delimiter(char c)
+{
+  return c == ' ' || c == '\n' || c == '\r';
+}
+
+/**
+ * Classify bytes [from, length) of block one by one, from a multiple of 64.
+ * Bits past length are set, so a scan never runs beyond the valid bytes.
+ */
+static void classify_scalar_from(const char *block, size_t from, size_t length,
+                                 uint64_t *delimiters)
+{
+  for (size_t word = from >> WORD_SHIFT; (word << WORD_SHIFT) < length; word++)
+    {
+      uint64_t bits = 0;
+      for (size_t bit = 0; bit < WORD_BITS; bit++)
+        {
+          size_t i = (word << WORD_SHIFT) + bit;
+          if (i >= length || is_token_delimiter (block[i]))
+            {
+              bits |= UINT64_C(1) << bit;
+            }
+        }
+      delimiters[word] = bits;
+    }
+}
+
+/**
+ * Classify the first length bytes of block, one byte at a time.
+ */
+static void classify_scalar(const char *block, size_t length,
+                            uint64_t *delimiters)
+{
+  classify_scalar_from (block, 0, length, delimiters);
+}
+
+#ifdef HAS_X86_SIMD
+/**
+ * Classify the first length bytes of block, 16 bytes at a time.
+ */
+static void classify_sse2(const char *block, size_t length,
+                          uint64_t *delimiters)
+{
+  const __m128i space = _mm_set1_epi8 (' ');
+  const __m128i new_line = _mm_set1_epi8 ('\n');
+  const __m128i carriage_return = _mm_set1_epi8 ('\r');
+  size_t i = 0;
+  for (; i + WORD_BITS <= length; i += WORD_BITS)
+    {
+      uint64_t bits = 0;
+      for (int lane = 0; lane < WORD_BITS; lane += 16)
+        {
+          __m128i bytes = _mm_loadu_si128 ((const __m128i*) (block + i
+                                                              + lane));
+          __m128i hits = _mm_or_si128 (
+              _mm_or_si128 (_mm_cmpeq_epi8 (bytes, space),
+                            _mm_cmpeq_epi8 (bytes, new_line)),
+              _mm_cmpeq_epi8 (bytes, carriage_return));
+          bits |= (uint64_t) (uint16_t) _mm_movemask_epi8 (hits) << lane;
+        }
+      delimiters[i >> WORD_SHIFT] = bits;
+    }
+  classify_scalar_from (block, i, length, delimiters);
+}
+
+/**
+ * Classify the first length bytes of block, 32 bytes at a time.
+ */
+__attribute__((target("avx2")))
+static void classify_avx2(const char *block, size_t length,
+                          uint64_t *delimiters)
+{
+  const __m256i space = _mm256_set1_epi8 (' ');
+  const __m256i new_line = _mm256_set1_epi8 ('\n');
+  const __m256i carriage_return = _mm256_set1_epi8 ('\r');
+  size_t i = 0;
+  for (; i + WORD_BITS <= length; i += WORD_BITS)
+    {
+      uint64_t bits = 0;
+      for (int lane = 0; lane < WORD_BITS; lane += 32)
+        {
+          __m256i bytes = _mm256_loadu_si256 ((const __m256i*) (block + i
+                                                                 + lane));
+          __m256i hits = _mm256_or_si256 (
+              _mm256_or_si256 (_mm256_cmpeq_epi8 (bytes, space),
+                               _mm256_cmpeq_epi8 (bytes, new_line)),
+              _mm256_cmpeq_epi8 (bytes, carriage_return));
+          bits |= (uint64_t) (uint32_t) _mm256_movemask_epi8 (hits) << lane;
+        }
+      delimiters[i >> WORD_SHIFT] = bits;
+    }
+  classify_scalar_from (block, i, length, delimiters);
+}
+#endif
+
+/**
+ * Choose the widest classify function the running CPU supports.
+ */
+static void (*select_classify(void))(const char*, size_t, uint64_t*)
+{
+#ifdef HAS_X86_SIMD
+  if (__builtin_cpu_supports ("avx2"))
+    {
+      return classify_avx2;
+    }
+  if (__builtin_cpu_supports ("sse2"))
+    {
+      return classify_sse2;
+    }
+#endif
+  return classify_scalar;
+}
+
+/**
+ * @param tokenizer
+ * @param from first index to check
+ * @return index of the first delimiter in block[from, end), end if none
+ */
+static size_t find_delimiter(Tokenizer *tokenizer, size_t from)
+{
+  if (from >= tokenizer->end)
+    {
+      return tokenizer->end;
+    }
+  size_t word = from >> WORD_SHIFT;
+  uint64_t bits = tokenizer->delimiters[word] & (~UINT64_C(0)
+                                                 << (from & WORD_MASK));
+  while (bits == 0) // the bits past end are set, so this stops at end
+    {
+      bits = tokenizer->delimiters[++word];
+    }
+  size_t stop = (word << WORD_SHIFT) + (size_t) __builtin_ctzll (bits);
+  return stop < tokenizer->end ? stop : tokenizer->end;
+}
+
+/**
+ * Initialize and Allocate new Tokenizer
+ * @param reader corpus to read from, not owned by the tokenizer
+ * @return Tokenizer pointer, NULL in case of memory allocation failure
+ * @ownership Weak Ownership. separate function for Free (free_tokenizer)
+ */
+Tokenizer* new_tokenizer(CorpusReader *reader)
+{
+  Tokenizer *tokenizer = malloc (sizeof (Tokenizer));
+  if (tokenizer == NULL)
+    {
+      printf ("%s", ALLOC_ERROR_TOKENIZER);
+      return NULL;
+    }
+  char *block = malloc (TOKENIZER_BLOCK_SIZE);
+  uint64_t *delimiters = malloc (sizeof (uint64_t) * BITMAP_WORDS);
+  if (block == NULL || delimiters == NULL)
+    {
+      printf ("%s", ALLOC_ERROR_TOKENIZER);
+      free (block);
+      free (delimiters);
+      free (tokenizer);
+      return NULL;
+    }
+  *tokenizer = (Tokenizer) {reader, block, delimiters, select_classify (), 0,
+                            0, NO_DELIMITER, NULL, 0, 0, true, false, false};
+  return tokenizer;
+}
+
+/**
+ * Free tokenizer and all of it's content from memory
+ * @param tokenizer_p tokenizer to free
+ */
+void free_tokenizer(Tokenizer **tokenizer_p)
+{
+  if (*tokenizer_p != NULL)
+    {
+      free ((*tokenizer_p)->block);
+      free ((*tokenizer_p)->delimiters);
+      free ((*tokenizer_p)->carry);
+      free (*tokenizer_p);
+      *tokenizer_p = NULL;
+    }
+}
+
+/**
+ * Read the next block of the corpus.
+ * @param tokenizer
+ * @return false at end of file or in case of read error
+ */
+static bool refill(Tokenizer *tokenizer)
+{
+  if (tokenizer->eof)
+    {
+      return false;
+    }
+  tokenizer->position = 0;
+  if (read_corpus (tokenizer->reader, tokenizer->block, TOKENIZER_BLOCK_SIZE,
+                   &tokenizer->end) == EXIT_FAILURE)
+    {
+      tokenizer->failed = true;
+      tokenizer->end = 0;
+    }
+  if (tokenizer->end == 0)
+    {
+      tokenizer->eof = true;
+      return false;
+    }
+  tokenizer->classify (tokenizer->block, tokenizer->end,
+                       tokenizer->delimiters);
+  tokenizer->delimiters[(tokenizer->end + WORD_MASK) >> WORD_SHIFT] =
+      ~UINT64_C(0);
+  return true;
+}
+
+/**
+ * Append bytes to the word carried between blocks, keeping it null
+ * terminated.
+ * @return false in case of memory allocation failure
+ */
+static bool append_carry(Tokenizer *tokenizer, const char *bytes,
+                         size_t length)
+{
+  size_t needed = tokenizer->carry_length + length + 1;
+  if (needed > tokenizer->carry_capacity)
+    {
+      size_t capacity = tokenizer->carry_capacity == 0 ?
+                        INITIAL_CARRY_CAPACITY : tokenizer->carry_capacity;
+      while (capacity < needed)
+        {
+          capacity *= 2;
+        }
+      char *carry = realloc (tokenizer->carry, capacity);
+      if (carry == NULL)
+        {
+          printf ("%s", ALLOC_ERROR_WORD_BUFFER);
+          return false;
+        }
+      tokenizer->carry = carry;
+      tokenizer->carry_capacity = capacity;
+    }
+  memcpy (tokenizer->carry + tokenizer->carry_length, bytes, length);
+  tokenizer->carry_length += length;
+  tokenizer->carry[tokenizer->carry_length] = '\0';
+  return true;
+}
+
+/**
+ * Fill token with the given word, and mark the line as started.
+ */
+static void emit(Tokenizer *tokenizer, Token *token, char *word,
+                 size_t length)
+{
+  *token = (Token) {word, length, tokenizer->line_start,
+                    word[length - 1] == DOT};
+  tokenizer->line_start = false;
+}
+
+/**
+ * Read the rest of a word cut by the end of a block.
+ * @param tokenizer
+ * @param start index of the word in the current block
+ * @param token out param
+ * @return TOKEN_FOUND or TOKEN_ERROR
+ */
+static int next_carried_token(Tokenizer *tokenizer, size_t start,
+                              Token *token)
+{
+  tokenizer->carry_length = 0;
+  if (!append_carry (tokenizer, tokenizer->block + start,
+                     tokenizer->end - start))
+    {
+      return TOKEN_ERROR;
+    }
+  tokenizer->position = tokenizer->end;
+  while (refill (tokenizer))
+    {
+      size_t stop = find_delimiter (tokenizer, 0);
+      if (!append_carry (tokenizer, tokenizer->block, stop))
+        {
+          return TOKEN_ERROR;
+        }
+      tokenizer->position = stop;
+      if (stop < tokenizer->end)
+        {
+          break;
+        }
+    }
+  if (tokenizer->failed)
+    {
+      return TOKEN_ERROR;
+    }
+  emit (tokenizer, token, tokenizer->carry, tokenizer->carry_length);
+  return TOKEN_FOUND;
+}
+
+/**
+ * Read the next word.
+ * @param tokenizer
+ * @param token out param, the word read
+ * @return TOKEN_FOUND, TOKEN_END at end of file or TOKEN_ERROR in case of
+ * memory allocation failure or corpus read error
+ */
+int next_token(Tokenizer *tokenizer, Token *token)
+{
+  if (tokenizer->saved_delimiter != NO_DELIMITER)
+    {
+      tokenizer->block[tokenizer->position] = tokenizer->saved_delimiter;
+      tokenizer->saved_delimiter = NO_DELIMITER;
+    }
+  while (true)
+    {
+      if (tokenizer->position == tokenizer->end && !refill (tokenizer))
+        {
+          return tokenizer->failed ? TOKEN_ERROR : TOKEN_END;
+        }
+      char c = tokenizer->block[tokenizer->position];
+      if (c == '\n')
+        {
+          tokenizer->position++;
+          if (tokenizer->line_start) // a line with no word in it
+            {
+              emit (tokenizer, token, empty_line_word, 1);
+              tokenizer->line_start = true;
+              return TOKEN_FOUND;
+            }
+          tokenizer->line_start = true;
+          continue;
+        }
+      if (is_token_delimiter (c))
+        {
+          tokenizer->position++;
+          continue;
+        }
+      size_t start = tokenizer->position;
+      size_t stop = find_delimiter (tokenizer, start);
+      if (stop == tokenizer->end)
+        {
+          return next_carried_token (tokenizer, start, token);
+        }
+      tokenizer->saved_delimiter = tokenizer->block[stop];
+      tokenizer->block[stop] = '\0';
+      tokenizer->position = stop;
+      emit (tokenizer, token, tokenizer->block + start, stop - start);
+      return TOKEN_FOUND;
+    }
+}
@@ -0,0 +1,86 @@
+#ifndef _TOKENIZER_H
+#define _TOKENIZER_H
+
+#include <stdlib.h> // For size_t
+#include <stdbool.h> // for bool
+#include <stdint.h> // For uint64_t
+#include "corpus_reader.h"
+
+#define TOKENIZER_BLOCK_SIZE (1 << 20) // a multiple of 64
+
+#define TOKEN_FOUND 0
+#define TOKEN_END 1
+#define TOKEN_ERROR 2
+
+/***************************/
+/*        STRUCTS          */
+/***************************/
+
+/**
+ * A word read by the tokenizer. Words are separated by spaces, carriage
+ * returns and new lines. A line holding no word is read as the single word
+ * "\n", like the line based reader it replaces did.
+ */
+typedef struct Token {
+    char *word; // null terminated, valid until the next call to next_token
+    size_t length;
+    bool line_start; // first word of it's line
+    bool ends_with_dot;
+} Token;
+
+/**
+ * Reads words out of a corpus in big blocks, with no limit on the length of a
+ * line or of a word. A word cut by the end of a block is carried over to the
+ * next one.
+ * Every block is classified once, 16 to 32 bytes at a time when the CPU
+ * allows, into a bitmap of it's delimiters; words are then found with bit
+ * scans instead of byte by byte.
+ */
+typedef struct Tokenizer {
+    CorpusReader *reader; // not owned by the tokenizer
+    char *block; // TOKENIZER_BLOCK_SIZE bytes
+    uint64_t *delimiters; // bit i is set if block[i] is a delimiter
+    // fills delimiters for the first length bytes of block, chosen at runtime
+    void (*classify)(const char *block, size_t length, uint64_t *delimiters);
+    size_t position; // next byte of block to scan
+    size_t end; // number of valid bytes in block
+    char saved_delimiter; // delimiter overwritten by the last word's null
+    char *carry; // beginning of a word cut by the end of a block
+    size_t carry_length;
+    size_t carry_capacity;
+    bool line_start; // the next word is the first of it's line
+    bool eof;
+    bool failed; // the corpus could not be read to it's end
+} Tokenizer;
+
+/**
+ * Initialize and Allocate new Tokenizer
+ * @param reader corpus to read from, not owned by the tokenizer
+ * @return Tokenizer pointer, NULL in case of memory allocation failure
+ * @ownership Weak Ownership. separate function for Free (free_tokenizer)
+ */
+Tokenizer* new_tokenizer(CorpusReader *reader);
+
+/**
+ * Read the next word.
+ * @param tokenizer
+ * @param token out param, the word read
+ * @return TOKEN_FOUND, TOKEN_END at end of file or TOKEN_ERROR in case of
+ * memory allocation failure or corpus read error
+ */
+int next_token(Tokenizer *tokenizer, Token *token);
+
+/**
+ * Checks if c separates words
+ * @param c
+ * @return true if c is a space, \r or \n
+ */
+bool is_token_delimiter(char c);
+
+/**
+ * Free tokenizer and all of it's content from memory
+ * @param tokenizer_p tokenizer to free
+ */
+void free_tokenizer(Tokenizer **tokenizer_p);
+
+#endif /* _TOKENIZER_H */
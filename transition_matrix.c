@@ -0,0 +1,568 @@
+#define _POSIX_C_SOURCE 200809L // For sysconf
+#include "transition_matrix.h"
+#include <pthread.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+#define ALLOC_ERROR_TRANSITION_MATRIX \
+"Allocation failure: Alloc of new TransitionMatrix failed.\n"
+#define ALLOC_ERROR_POWER_ITERATION \
+"Allocation failure: Alloc of power iteration failed.\n"
+#define CONVERGENCE_ERROR "ERROR: the power iteration did not converge.\n"
+
+#define MIN(X, Y) (((X) < (Y)) ? (X) : (Y))
+#define DENSE_BLOCK 64 // rows and columns of the blocks of a multiply
+#define DENSE_ALIGNMENT 8 // the rows of a dense matrix are padded to
+
+/**
+ * The states one thread computes the next distribution of, in a step
+ */
+typedef struct StepTask {
+    TransitionMatrix *matrix;
+    int first_state;
+    int end_state; // one past the last state of the task
+    const double *current;
+    double *next;
+    double dangling; // probability of the dangling states in current
+    bool lazy; // half of current stays where it is
+    double change; // sum of the changes of the states of the task
+    double next_dangling; // probability of the dangling states in next
+} StepTask;
+
+/**
+ * Fill the sparse columns: the links of every state, as probabilities of
+ * it's successors, found from their side. A state with no successors links
+ * to itself if the walk stays there.
+ */
+static void fill_columns(TransitionMatrix *matrix, MarkovChain *markov_chain,
+                         bool restarts)
+{
+  int n = matrix->num_of_states;
+  memset (matrix->column_starts, 0, sizeof (int) * (n + 1));
+  for (Node *node = markov_chain->database->first; node != NULL;
+       node = node->next)
+    {
+      MarkovNode *markov_node = node->data;
+      bool dangling = markov_node->counter_list_length == 0;
+      matrix->is_dangling[markov_node->id] = dangling && restarts;
+      matrix->column_starts[markov_node->id + 1] += dangling && !restarts;
+      for (int i = 0; i < markov_node->counter_list_length; i++)
+        {
+          matrix->column_starts[markov_node->counter_list[i].markov_node->id
+                                + 1]++;
+        }
+    }
+  for (int state = 0; state < n; state++)
+    {
+      matrix->column_starts[state + 1] += matrix->column_starts[state];
+    }
+  // the database is in the order of the ids, so are the predecessors
+  for (Node *node = markov_chain->database->first; node != NULL;
+       node = node->next)
+    {
+      MarkovNode *markov_node = node->data;
+      if (markov_node->counter_list_length == 0 && !restarts)
+        {
+          int place = matrix->column_starts[markov_node->id]++;
+          matrix->predecessors[place] = markov_node->id;
+          matrix->probabilities[place] = 1;
+        }
+      for (int i = 0; i < markov_node->counter_list_length; i++)
+        {
+          NextNodeCounter counter = markov_node->counter_list[i];
+          int place = matrix->column_starts[counter.markov_node->id]++;
+          matrix->predecessors[place] = markov_node->id;
+          matrix->probabilities[place] = counter.frequency
+                                         / (double) markov_node
+                                             ->counter_list_total;
+        }
+    }
+  for (int state = n; state > 0; state--) // undo the shift of the fill
+    {
+      matrix->column_starts[state] = matrix->column_starts[state - 1];
+    }
+  matrix->column_starts[0] = 0;
+}
+
+/**
+ * Fill the distribution of the first state: uniform over the states with
+ * successors, or over all of them if none has any
+ */
+static void fill_restart(TransitionMatrix *matrix, MarkovChain *markov_chain)
+{
+  int n = matrix->num_of_states, num_of_starts = 0;
+  for (Node *node = markov_chain->database->first; node != NULL;
+       node = node->next)
+    {
+      num_of_starts += node->data->counter_list_length > 0;
+    }
+  for (Node *node = markov_chain->database->first; node != NULL;
+       node = node->next)
+    {
+      if (num_of_starts == 0)
+        {
+          matrix->restart[node->data->id] = 1.0 / n;
+        }
+      else
+        {
+          matrix->restart[node->data->id] = node->data->counter_list_length
+                                            > 0 ? 1.0 / num_of_starts : 0;
+        }
+    }
+}
+
+/**
+ * Initialize and Allocate the TransitionMatrix of the given MarkovChain
+ * @param markov_chain
+ * @param restarts true if the walk starts over after a state with no
+ * successors, false if it stays there
+ * @return TransitionMatrix pointer, NULL in case of memory allocation
+ * failure
+ * @ownership Weak Ownership. separate function for Free
+ * (free_transition_matrix)
+ */
+TransitionMatrix* new_transition_matrix(MarkovChain *markov_chain,
+                                        bool restarts)
+{
+  TransitionMatrix *matrix = calloc (1, sizeof (TransitionMatrix));
+  if (matrix == NULL)
+    {
+      printf ("%s", ALLOC_ERROR_TRANSITION_MATRIX);
+      return NULL;
+    }
+  size_t n = markov_chain->database->size, num_of_links = 0;
+  for (Node *node = markov_chain->database->first; node != NULL;
+       node = node->next)
+    {
+      // a state with no successors links to itself if the walk stays there
+      num_of_links += node->data->counter_list_length > 0
+                      ? (size_t) node->data->counter_list_length : !restarts;
+    }
+  matrix->num_of_states = (int) n;
+  matrix->column_starts = malloc (sizeof (int) * (n + 1));
+  matrix->predecessors = malloc (sizeof (int) * (num_of_links + 1));
+  matrix->probabilities = malloc (sizeof (double) * (num_of_links + 1));
+  matrix->is_dangling = malloc (sizeof (bool) * (n + 1));
+  matrix->restart = malloc (sizeof (double) * (n + 1));
+  if (matrix->column_starts == NULL || matrix->predecessors == NULL
+      || matrix->probabilities == NULL || matrix->is_dangling == NULL
+      || matrix->restart == NULL)
+    {
+      printf ("%s", ALLOC_ERROR_TRANSITION_MATRIX);
+      free_transition_matrix (&matrix);
+      return NULL;
+    }
+  fill_columns (matrix, markov_chain, restarts);
+  fill_restart (matrix, markov_chain);
+  return matrix;
+}
+
+/**
+ * Compute the next distribution of the states of a task
+ * @param arg StepTask pointer
+ */
+static void* run_step(void *arg)
+{
+  StepTask *task = arg;
+  TransitionMatrix *matrix = task->matrix;
+  const double *current = task->current;
+  double change = 0, next_dangling = 0;
+  for (int state = task->first_state; state < task->end_state; state++)
+    {
+      double sum = task->dangling * matrix->restart[state];
+      for (int i = matrix->column_starts[state];
+           i < matrix->column_starts[state + 1]; i++)
+        {
+          sum += matrix->probabilities[i] * current[matrix->predecessors[i]];
+        }
+      if (task->lazy)
+        {
+          sum = (sum + current[state]) / 2;
+        }
+      change += fabs (sum - current[state]);
+      task->next[state] = sum;
+      if (matrix->is_dangling[state])
+        {
+          next_dangling += sum;
+        }
+    }
+  task->change = change;
+  task->next_dangling = next_dangling;
+  return NULL;
+}
+
+/**
+ * Run func on every task, the first one on the calling thread. A task whose
+ * thread can not be started is run on the calling thread too.
+ * @param threads room for num_of_tasks - 1 threads
+ */
+static void run_tasks(void* (*func)(void*), StepTask *tasks, int num_of_tasks,
+                      pthread_t *threads)
+{
+  int started = 0;
+  for (int i = 1; i < num_of_tasks; i++)
+    {
+      if (pthread_create (&threads[started], NULL, func, &tasks[i]) == 0)
+        {
+          started++;
+        }
+      else
+        {
+          func (&tasks[i]);
+        }
+    }
+  func (&tasks[0]);
+  for (int i = 0; i < started; i++)
+    {
+      pthread_join (threads[i], NULL);
+    }
+}
+
+/**
+ * @return number of threads to step the matrix on, at most one for every
+ * TRANSITION_LINKS_PER_THREAD links and states
+ */
+static int count_tasks(TransitionMatrix *matrix, int num_of_threads)
+{
+  if (num_of_threads == TRANSITION_ALL_THREADS)
+    {
+      long online = sysconf (_SC_NPROCESSORS_ONLN);
+      num_of_threads = online > 0 ? (int) online : 1;
+    }
+  long long work = (long long) matrix->column_starts[matrix->num_of_states]
+                   + matrix->num_of_states;
+  long long most = work / TRANSITION_LINKS_PER_THREAD;
+  if (num_of_threads > most)
+    {
+      num_of_threads = most > 0 ? (int) most : 1;
+    }
+  return num_of_threads;
+}
+
+/**
+ * Split the states between the tasks, every task getting about as many of
+ * the links and states
+ */
+static void split_states(TransitionMatrix *matrix, StepTask *tasks,
+                         int num_of_tasks)
+{
+  int n = matrix->num_of_states, state = 0;
+  long long work = (long long) matrix->column_starts[n] + n;
+  for (int i = 0; i < num_of_tasks; i++)
+    {
+      long long end_work = work * (i + 1) / num_of_tasks;
+      tasks[i].first_state = state;
+      while (state < n
+             && (long long) matrix->column_starts[state] + state < end_work)
+        {
+          state++;
+        }
+      tasks[i].end_state = i == num_of_tasks - 1 ? n : state;
+    }
+}
+
+/**
+ * Step distribution along the matrix until a step changes it by at most
+ * tolerance, or max_steps steps were taken
+ * @param distribution in/out param
+ * @param lazy half of the distribution stays where it is every step
+ * @param steps_p out param, steps taken
+ * @param change_p out param, sum of the changes of the last step
+ * @return EXIT_SUCCESS or EXIT_FAILURE in case of memory allocation failure
+ */
+static int power_iterate(TransitionMatrix *matrix, double *distribution,
+                         int max_steps, double tolerance, bool lazy,
+                         int num_of_threads, int *steps_p, double *change_p)
+{
+  int n = matrix->num_of_states;
+  int num_of_tasks = count_tasks (matrix, num_of_threads);
+  double *buffer = malloc (sizeof (double) * (n + (size_t) 1));
+  StepTask *tasks = malloc (sizeof (StepTask) * num_of_tasks);
+  pthread_t *threads = malloc (sizeof (pthread_t) * num_of_tasks);
+  if (buffer == NULL || tasks == NULL || threads == NULL)
+    {
+      printf ("%s", ALLOC_ERROR_POWER_ITERATION);
+      free (buffer);
+      free (tasks);
+      free (threads);
+      return EXIT_FAILURE;
+    }
+  split_states (matrix, tasks, num_of_tasks);
+  double dangling = 0, change = INFINITY;
+  for (int state = 0; state < n; state++)
+    {
+      dangling += matrix->is_dangling[state] ? distribution[state] : 0;
+    }
+  double *current = distribution, *next = buffer;
+  int step = 0;
+  for (; step < max_steps && !(change <= tolerance); step++)
+    {
+      for (int i = 0; i < num_of_tasks; i++)
+        {
+          tasks[i].matrix = matrix;
+          tasks[i].current = current;
+          tasks[i].next = next;
+          tasks[i].dangling = dangling;
+          tasks[i].lazy = lazy;
+        }
+      run_tasks (run_step, tasks, num_of_tasks, threads);
+      change = 0;
+      dangling = 0;
+      for (int i = 0; i < num_of_tasks; i++)
+        {
+          change += tasks[i].change;
+          dangling += tasks[i].next_dangling;
+        }
+      double *swap = current;
+      current = next;
+      next = swap;
+    }
+  if (current != distribution)
+    {
+      memcpy (distribution, current, sizeof (double) * n);
+    }
+  free (buffer);
+  free (tasks);
+  free (threads);
+  *steps_p = step;
+  *change_p = change;
+  return EXIT_SUCCESS;
+}
+
+/**
+ * @return true if raising the dense matrix to the power of num_of_steps
+ * takes fewer multiplies than num_of_steps sparse steps
+ */
+static bool is_dense_faster(TransitionMatrix *matrix, int num_of_steps)
+{
+  int n = matrix->num_of_states, squarings = 0;
+  if (n > TRANSITION_DENSE_STATES)
+    {
+      return false;
+    }
+  for (int steps = num_of_steps; steps > 1; steps /= 2)
+    {
+      squarings++;
+    }
+  // building the dense matrix and a multiply by the distribution per bit
+  double dense_work = (double) n * n * n * squarings
+                      + 2.0 * n * n * (squarings + 1);
+  double sparse_work = (double) num_of_steps
+                       * (matrix->column_starts[n] + n);
+  return dense_work < sparse_work;
+}
+
+/**
+ * @param stride doubles of a row
+ * @return the matrix, dense, NULL in case of memory allocation failure
+ */
+static double* new_dense_matrix(TransitionMatrix *matrix, int stride)
+{
+  int n = matrix->num_of_states;
+  double *dense = calloc ((size_t) n * stride, sizeof (double));
+  if (dense == NULL)
+    {
+      return NULL;
+    }
+  for (int state = 0; state < n; state++)
+    {
+      for (int i = matrix->column_starts[state];
+           i < matrix->column_starts[state + 1]; i++)
+        {
+          dense[(size_t) matrix->predecessors[i] * stride + state]
+              += matrix->probabilities[i];
+        }
+    }
+  for (int state = 0; state < n; state++)
+    {
+      if (matrix->is_dangling[state])
+        {
+          memcpy (dense + (size_t) state * stride, matrix->restart,
+                  sizeof (double) * n);
+        }
+    }
+  return dense;
+}
+
+/**
+ * product = first * second, of n rows of stride doubles, a block at a time
+ * so the rows of the blocks of second stay in cache while they are used.
+ * The innermost loop goes along the rows, with no branches, for the
+ * compiler to vectorize.
+ */
+static void multiply_dense(const double *restrict first,
+                           const double *restrict second,
+                           double *restrict product, int n, int stride)
+{
+  memset (product, 0, sizeof (double) * n * stride);
+  for (int row = 0; row < n; row += DENSE_BLOCK)
+    {
+      for (int middle = 0; middle < n; middle += DENSE_BLOCK)
+        {
+          for (int column = 0; column < stride; column += DENSE_BLOCK)
+            {
+              int end_column = MIN (column + DENSE_BLOCK, stride);
+              for (int i = row; i < MIN (row + DENSE_BLOCK, n); i++)
+                {
+                  double *product_row = product + (size_t) i * stride;
+                  for (int k = middle; k < MIN (middle + DENSE_BLOCK, n); k++)
+                    {
+                      double factor = first[(size_t) i * stride + k];
+                      const double *second_row = second + (size_t) k * stride;
+                      if (factor == 0)
+                        {
+                          continue; // a step that can not be taken
+                        }
+                      for (int j = column; j < end_column; j++)
+                        {
+                          product_row[j] += factor * second_row[j];
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+/**
+ * product = vector * dense, of n rows of stride doubles
+ */
+static void multiply_vector(const double *restrict vector,
+                            const double *restrict dense,
+                            double *restrict product, int n, int stride)
+{
+  memset (product, 0, sizeof (double) * stride);
+  for (int k = 0; k < n; k++)
+    {
+      const double *dense_row = dense + (size_t) k * stride;
+      for (int j = 0; j < stride; j++)
+        {
+          product[j] += vector[k] * dense_row[j];
+        }
+    }
+}
+
+/**
+ * Move a distribution num_of_steps steps by repeated squaring: the
+ * distribution is multiplied by the powers of the matrix of the bits of
+ * num_of_steps, each one the square of the one before.
+ * @return EXIT_SUCCESS or EXIT_FAILURE in case of memory allocation failure
+ */
+static int dense_steps(TransitionMatrix *matrix, double *distribution,
+                       int num_of_steps)
+{
+  int n = matrix->num_of_states;
+  int stride = (n + DENSE_ALIGNMENT - 1) / DENSE_ALIGNMENT * DENSE_ALIGNMENT;
+  double *power = new_dense_matrix (matrix, stride);
+  double *square = malloc (sizeof (double) * n * (size_t) stride);
+  double *vector = calloc (stride, sizeof (double));
+  double *product = malloc (sizeof (double) * stride);
+  if (power == NULL || square == NULL || vector == NULL || product == NULL)
+    {
+      printf ("%s", ALLOC_ERROR_POWER_ITERATION);
+      free (power);
+      free (square);
+      free (vector);
+      free (product);
+      return EXIT_FAILURE;
+    }
+  memcpy (vector, distribution, sizeof (double) * n);
+  for (int steps = num_of_steps; steps > 0; steps /= 2)
+    {
+      if (steps % 2 == 1)
+        {
+          multiply_vector (vector, power, product, n, stride);
+          memcpy (vector, product, sizeof (double) * stride);
+        }
+      if (steps > 1)
+        {
+          multiply_dense (power, power, square, n, stride);
+          double *swap = power;
+          power = square;
+          square = swap;
+        }
+    }
+  memcpy (distribution, vector, sizeof (double) * n);
+  free (power);
+  free (square);
+  free (vector);
+  free (product);
+  return EXIT_SUCCESS;
+}
+
+/**
+ * Move a distribution num_of_steps steps along the matrix: the distribution
+ * of the state of the walk num_of_steps states after the given one.
+ * @param matrix
+ * @param distribution in/out param, num_of_states values summing to 1
+ * @param num_of_steps
+ * @param num_of_threads TRANSITION_ALL_THREADS for one per processor
+ * @return EXIT_SUCCESS or EXIT_FAILURE in case of memory allocation failure
+ */
+int step_distribution(TransitionMatrix *matrix, double *distribution,
+                      int num_of_steps, int num_of_threads)
+{
+  if (is_dense_faster (matrix, num_of_steps))
+    {
+      return dense_steps (matrix, distribution, num_of_steps);
+    }
+  int steps = 0;
+  double change = 0;
+  // a distribution a step does not change at all is where it stays
+  return power_iterate (matrix, distribution, num_of_steps, 0, false,
+                        num_of_threads, &steps, &change);
+}
+
+/**
+ * Stationary distribution of the matrix, the share of the steps of an
+ * endless walk spent at every state, by power iteration from restart. The
+ * steps are lazy, half of the distribution staying where it is, which keeps
+ * the stationary distribution but lets the iteration converge on periodic
+ * chains too.
+ * @param matrix
+ * @param tolerance sum of the changes of a step to stop under
+ * @param max_steps steps to give up after
+ * @param num_of_threads TRANSITION_ALL_THREADS for one per processor
+ * @param distribution out param, num_of_states values
+ * @param steps_p out param, steps taken
+ * @return EXIT_SUCCESS or EXIT_FAILURE in case of memory allocation failure
+ * or if the iteration did not converge
+ */
+int stationary_distribution(TransitionMatrix *matrix, double tolerance,
+                            int max_steps, int num_of_threads,
+                            double *distribution, int *steps_p)
+{
+  double change = 0;
+  memcpy (distribution, matrix->restart,
+          sizeof (double) * matrix->num_of_states);
+  if (power_iterate (matrix, distribution, max_steps, tolerance, true,
+                     num_of_threads, steps_p, &change) == EXIT_FAILURE)
+    {
+      return EXIT_FAILURE;
+    }
+  if (change > tolerance)
+    {
+      printf ("%s", CONVERGENCE_ERROR);
+      return EXIT_FAILURE;
+    }
+  return EXIT_SUCCESS;
+}
+
+/**
+ * Free matrix and all of it's content from memory
+ * @param matrix_p matrix to free
+ */
+void free_transition_matrix(TransitionMatrix **matrix_p)
+{
+  if (*matrix_p != NULL)
+    {
+      free ((*matrix_p)->column_starts);
+      free ((*matrix_p)->predecessors);
+      free ((*matrix_p)->probabilities);
+      free ((*matrix_p)->is_dangling);
+      free ((*matrix_p)->restart);
+      free (*matrix_p);
+      *matrix_p = NULL;
+    }
+}
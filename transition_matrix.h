@@ -0,0 +1,90 @@
+#ifndef _TRANSITION_MATRIX_H
+#define _TRANSITION_MATRIX_H
+
+#include "markov_chain.h"
+
+#define TRANSITION_ALL_THREADS 0 // a thread for every online processor
+#define TRANSITION_TOLERANCE 1e-10 // change of a step power iteration stops
+#define TRANSITION_MAX_STEPS 100000
+#define TRANSITION_LINKS_PER_THREAD 65536 // least work a thread is given
+#define TRANSITION_DENSE_STATES 512 // most states stepped by dense squaring
+
+/***************************/
+/*        STRUCTS          */
+/***************************/
+
+/**
+ * Transition probabilities of a MarkovChain as a row-stochastic sparse
+ * matrix, with states numbered by their MarkovNode id. Every row is a state
+ * the walk leaves, as generate_random_sequence does: a state with no
+ * successors, dangling, either starts the walk over at a random state,
+ * picked from restart as get_first_random_node picks it, or keeps it there
+ * for good. The matrix is kept in compressed sparse columns, the transpose
+ * of the rows, so a step of a distribution is a gather over the
+ * predecessors of every state: the states are split between threads, each
+ * writing only it's own. Chains of at most TRANSITION_DENSE_STATES states
+ * may rather be stepped many steps at once, by squaring the dense matrix.
+ */
+typedef struct TransitionMatrix {
+    int num_of_states;
+    int *column_starts; // num_of_states + 1, into predecessors
+    int *predecessors;
+    double *probabilities; // of the link from every predecessor
+    bool *is_dangling; // no successors, the walk starts over at restart,
+                       // false for all if the walk stays at them
+    double *restart; // distribution of the first state of a walk
+} TransitionMatrix;
+
+/**
+ * Initialize and Allocate the TransitionMatrix of the given MarkovChain
+ * @param markov_chain
+ * @param restarts true if the walk starts over after a state with no
+ * successors, false if it stays there
+ * @return TransitionMatrix pointer, NULL in case of memory allocation
+ * failure
+ * @ownership Weak Ownership. separate function for Free
+ * (free_transition_matrix)
+ */
+TransitionMatrix* new_transition_matrix(MarkovChain *markov_chain,
+                                        bool restarts);
+
+/**
+ * Move a distribution num_of_steps steps along the matrix: the distribution
+ * of the state of the walk num_of_steps states after the given one. A small
+ * matrix is raised to the power of num_of_steps by repeated squaring, in
+ * dense blocks, if that takes fewer operations than the sparse steps.
+ * @param matrix
+ * @param distribution in/out param, num_of_states values summing to 1
+ * @param num_of_steps
+ * @param num_of_threads TRANSITION_ALL_THREADS for one per processor
+ * @return EXIT_SUCCESS or EXIT_FAILURE in case of memory allocation failure
+ */
+int step_distribution(TransitionMatrix *matrix, double *distribution,
+                      int num_of_steps, int num_of_threads);
+
+/**
+ * Stationary distribution of the matrix, the share of the steps of an
+ * endless walk spent at every state, by power iteration from restart. The
+ * steps are lazy, half of the distribution staying where it is, which keeps
+ * the stationary distribution but lets the iteration converge on periodic
+ * chains too.
+ * @param matrix
+ * @param tolerance sum of the changes of a step to stop under
+ * @param max_steps steps to give up after
+ * @param num_of_threads TRANSITION_ALL_THREADS for one per processor
+ * @param distribution out param, num_of_states values
+ * @param steps_p out param, steps taken
+ * @return EXIT_SUCCESS or EXIT_FAILURE in case of memory allocation failure
+ * or if the iteration did not converge
+ */
+int stationary_distribution(TransitionMatrix *matrix, double tolerance,
+                            int max_steps, int num_of_threads,
+                            double *distribution, int *steps_p);
+
+/**
+ * Free matrix and all of it's content from memory
+ * @param matrix_p matrix to free
+ */
+void free_transition_matrix(TransitionMatrix **matrix_p);
+
+#endif /* _TRANSITION_MATRIX_H */
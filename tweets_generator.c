@@ -2,141 +2,443 @@
 #include <stdlib.h>
 #include <string.h>
 #include "markov_chain.h"
+#include "frozen_chain.h"
+#include "tokenizer.h"
+#include "shard_reader.h"
+#include "string_table.h"
+#include "string_pool.h"
+#include "bigram_counts.h"
+#include "bulk_builder.h"
+#include "paged_chain.h"
+#include "transition_matrix.h"
+#include "absorbing_chain.h"
 
 #define ARG_MIN_NUM 4
-#define ARG_MAX_NUM 5
+#define ARG_MAX_NUM 5 // from which the last argument may be Num of words
+#define MODEL_ARG_NUM 3
 #define SEED_ARG 1
 #define TWEETS_NUM 2
 #define TWEET_FILE 3
-#define NUM_OF_WORDS 4
-#define MAX_ROW 1000
-#define MAX_WORD 100
 #define DOT_ASCII 46
 #define MAX_WORDS_IN_TWEETS 20
 #define DECIMAL 10
 #define NUM_OF_TWEET 1
 #define MAX_INT 2147483647
+#define OPTION_PREFIX "--"
+#define SAVE_MODEL_OPTION "--save-model"
+#define LOAD_MODEL_OPTION "--load-model"
+#define PAGED_MODEL_OPTION "--paged-model"
+#define QUANTIZE_OPTION "--quantize"
+#define FIRST_WORD_OPTION "--first-word"
+#define READERS_OPTION "--readers"
+#define DEDUP_OPTION "--dedup"
+#define IMPORT_COUNTS_OPTION "--import-counts"
+#define EXPORT_COUNTS_OPTION "--export-counts"
+#define BULK_OPTION "--bulk"
+#define MEMORY_BUDGET_OPTION "--memory-budget"
+#define FORECAST_OPTION "--forecast"
+#define STATIONARY_OPTION "--stationary"
+#define THREADS_OPTION "--threads"
+#define ENDINGS_OPTION "--endings"
+#define NO_FORECAST (-1)
+#define NO_ENDINGS 0
+#define BYTES_IN_MB (1024 * 1024)
+#define TEXT_COUNTS_EXTENSION ".tsv"
+#define STDIN_PATH "-"
 #define FILE_ERROR "ERROR: problem with opening file.\n"
-#define ALLOC_CHAR_ERROR \
-"Allocation failure: Alloc of new char array failed.\n"
+#define WORD_ERROR "ERROR: the first word is not in the model.\n"
+#define ALLOC_ERROR_FORECAST \
+"Allocation failure: Alloc of word forecast failed.\n"
+#define FORECAST_HEADER "Likeliest words %d words after the first one:\n"
+#define STATIONARY_HEADER \
+"Likeliest words of endless tweets, after %d steps of power iteration:\n"
+#define FORECAST_LINE "%d. %s %.6f\n"
+#define ALLOC_ERROR_ENDINGS \
+"Allocation failure: Alloc of tweet endings failed.\n"
+#define ENDINGS_SUMMARY "Tweets of at most %d words: %.6f end a sentence, " \
+"%.6f end with no more words, %.6f are cut, %.6f words expected\n"
+#define ENDINGS_HEADER "Start words likeliest to be cut:\n" \
+"Word\tEnds a sentence\tEnds\tExpected words\n"
+#define ENDINGS_ROW "%s\t%.6f\t%.6f\t%.6f\n"
 #define USAGE_ERROR \
-"USAGE: Enter Seed, Tweet Num, File url & Num of words to read (optional).\n"
+"USAGE: Enter Seed, Tweet Num, File url(s) & Num of words to read " \
+"(optional).\n"\
+"File url - reads from the standard input, gzip and zstd files are read "\
+"decompressed.\n" \
+"Several File urls, directories and glob patterns are read in order, by " \
+"--readers N threads.\n" \
+"Options: --save-model PATH, --quantize MAX_ERROR, --load-model PATH " \
+"(replaces File url and Num of words), --paged-model PATH (as --load-model, "\
+"reading the model from it's file as needed), --first-word WORD (every " \
+"tweet starts with WORD, not with --paged-model), --dedup (learns every " \
+"distinct line once, weighted by it's count), --import-counts PATH " \
+"(replaces File url and Num of words), --export-counts PATH (bigram " \
+"counts, text if PATH has .tsv in it, binary otherwise), --bulk (builds " \
+"the model by sorting the links read, with none of --dedup, --load-model " \
+"and the counts options), --memory-budget MB (--bulk spilling the links to " \
+"temporary files past MB, needs --save-model), --forecast STEPS (lists the " \
+"Tweet Num likeliest words STEPS words after the first one, of --first-word "\
+"WORD or a random one, instead of tweets), --stationary (lists the Tweet " \
+"Num likeliest words of an endless stream of tweets, instead of tweets), " \
+"--threads N (of the two), --endings WORDS (how likely tweets of at most " \
+"WORDS words are to end a sentence, from --first-word WORD or a random " \
+"first one, and the Tweet Num start words likeliest to be cut, instead of " \
+"tweets), none of the three with --load-model or --bulk.\n"
 
 /**
- * Insert MarkovNode of word2 to NextNodeCounter array of word_1
- * @param list MarkovChain
- * @param word_1
- * @param word_2
+ * Command line options, given anywhere among the positional arguments
+ */
+typedef struct Options {
+    char *save_model; // path to write the frozen model to, or NULL
+    char *load_model; // path to read a frozen model from, or NULL
+    bool paged; // serve the model of load_model from it's file
+    double max_error; // relative error of quantized frequencies, 0 if exact
+    char *first_word; // word every tweet starts with, or NULL for random
+    int readers; // number of threads reading shards
+    bool dedup; // learn every distinct line once, weighted by it's count
+    char *import_counts; // path to read bigram counts from, or NULL
+    char *export_counts; // path to write bigram counts to, or NULL
+    bool bulk; // build the frozen chain from the sorted links read
+    size_t memory_budget; // bytes of links --bulk keeps in memory, 0 if all
+    int forecast; // steps to forecast the words after, or NO_FORECAST
+    bool stationary; // forecast the words of endless tweets
+    int threads; // threads of the forecast
+    int endings; // most words of the tweets to analyze the ends of, or
+                 // NO_ENDINGS
+} Options;
+
+static void print_char_func(char *data);
+
+/**
+ * Index of the words of the database by their hash, the chain's
+ * get_node_from_database gets no other argument to reach it by
+ */
+static MarkovStateIndex word_index = {NULL, NULL, 0, 0, NULL};
+
+// the functions of the chain of words, comparing, hashing and printing them
+// inline; a word is checked by it's first char before the rest of it is
+// compared
+#define MARKOV_TEMPLATE_NAME word
+#define MARKOV_TEMPLATE_TYPE char
+#define MARKOV_TEMPLATE_EQUAL(a, b) (*(a) == *(b) && strcmp (a, b) == 0)
+#define MARKOV_TEMPLATE_PRINT(a) print_char_func (a)
+#define MARKOV_TEMPLATE_HASH(a) ((size_t) hash_key (a, strlen (a), 0))
+#define MARKOV_TEMPLATE_INDEX(markov_chain) (&word_index)
+#include "markov_chain_template.h"
+
+/**
+ * Where the words read go: counted as lines first with --dedup, collected as
+ * links with --bulk, otherwise learned by the MarkovChain
+ */
+typedef struct Learner {
+    MarkovChain *markov_chain;
+    StringTable *lines; // table of distinct lines, or NULL
+    BulkBuilder *bulk; // or NULL
+} Learner;
+
+/**
+ * Reads from the corpus the wanted number of words and inserts them in the
+ * MarkovChain database. A word is linked to the one before it in it's line,
+ * unless that one ends a sentence.
+ * @param reader
+ * @param words_to_read in/out param, decreased by the number of words read
+ * @param line_weights weight of the links of each line, NULL for 1
+ * @param markov_chain
  * @return EXIT_SUCCESS or EXIT_FAILURE
  */
-static int insert_to_counter_list(MarkovChain list, char *word_1, char *word_2)
+static int learn_corpus(CorpusReader *reader, int *words_to_read,
+                        const int *line_weights, MarkovChain *markov_chain)
 {
-  Node *node_word1 = get_node_from_database (&list,word_1);
-  Node *node_word2 = get_node_from_database (&list,word_2);
-  if ((node_word1 != NULL) && (node_word2 != NULL))
+  Tokenizer *tokenizer = new_tokenizer (reader);
+  if (tokenizer == NULL)
+    {
+      return EXIT_FAILURE;
+    }
+  int num_of_read_words = 0, line = -1;
+  MarkovNode *prev = NULL; // node of the word to link the next one after
+  Token token;
+  int status = TOKEN_FOUND;
+  while (num_of_read_words < *words_to_read
+         && (status = next_token (tokenizer, &token)) == TOKEN_FOUND)
+    {
+      if (token.line_start)
+        {
+          line++;
+          prev = NULL;
+        }
+      int weight = line_weights == NULL ? 1 : line_weights[line];
+      MarkovNode *node = word_observe_sized (markov_chain, prev, token.word,
+                                             token.length + 1, weight);
+      if (node == NULL)
+        {
+          free_tokenizer (&tokenizer);
+          return EXIT_FAILURE;
+        }
+      num_of_read_words++;
+      prev = token.ends_with_dot ? NULL : node;
+    }
+  free_tokenizer (&tokenizer);
+  *words_to_read -= num_of_read_words;
+  return status == TOKEN_ERROR ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/**
+ * Reads from the corpus the wanted number of words and collects their links
+ * for a bulk build, as learn_corpus links them.
+ * @param reader
+ * @param words_to_read in/out param, decreased by the number of words read
+ * @param bulk
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+static int collect_links(CorpusReader *reader, int *words_to_read,
+                         BulkBuilder *bulk)
+{
+  Tokenizer *tokenizer = new_tokenizer (reader);
+  if (tokenizer == NULL)
+    {
+      return EXIT_FAILURE;
+    }
+  int num_of_read_words = 0, prev = BULK_NO_WORD;
+  Token token;
+  int status = TOKEN_FOUND;
+  while (num_of_read_words < *words_to_read
+         && (status = next_token (tokenizer, &token)) == TOKEN_FOUND)
     {
-      bool success = add_node_to_counter_list(node_word1->data,
-                           node_word2->data, &list);
-      if (success == false)
+      int id = bulk_observe (bulk, token.line_start ? BULK_NO_WORD : prev,
+                             token.word, token.length);
+      if (id == BULK_ERROR)
         {
+          free_tokenizer (&tokenizer);
           return EXIT_FAILURE;
         }
+      num_of_read_words++;
+      prev = token.ends_with_dot ? BULK_NO_WORD : id;
+    }
+  free_tokenizer (&tokenizer);
+  *words_to_read -= num_of_read_words;
+  return status == TOKEN_ERROR ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/**
+ * Cut line after the given number of words.
+ * @param line
+ * @param length
+ * @param words in/out param, the maximal number of words to keep, then the
+ * number kept. A line with no word is one word, as the tokenizer reads it.
+ * @return length of the kept beginning of line
+ */
+static size_t cut_line(const char *line, size_t length, int *words)
+{
+  int count = 0;
+  for (size_t i = 0; i < length; i++)
+    {
+      if (!is_token_delimiter (line[i])
+          && (i == 0 || is_token_delimiter (line[i - 1])))
+        {
+          if (count == *words)
+            {
+              return i;
+            }
+          count++;
+        }
+    }
+  *words = count > 0 ? count : 1;
+  return length;
+}
+
+/**
+ * Distinct lines counted, and the number of words still to read
+ */
+typedef struct LineCounts {
+    StringTable *lines;
+    int words_to_read;
+} LineCounts;
+
+/**
+ * Count an occurrence of line, or of it's beginning if the words to read
+ * end in it.
+ * @param line
+ * @param length
+ * @param arg LineCounts pointer
+ * @return CORPUS_LINE_NEXT, CORPUS_LINE_STOP or CORPUS_LINE_ERROR
+ */
+static int count_line(char *line, size_t length, void *arg)
+{
+  LineCounts *counts = arg;
+  int words = counts->words_to_read;
+  length = cut_line (line, length, &words);
+  counts->words_to_read -= words;
+  if (add_to_string_table (counts->lines, line, length) == STRING_TABLE_ERROR)
+    {
+      return CORPUS_LINE_ERROR;
+    }
+  return counts->words_to_read > 0 ? CORPUS_LINE_NEXT : CORPUS_LINE_STOP;
+}
+
+/**
+ * Reads from the corpus the lines holding the wanted number of words, and
+ * count the occurrences of every distinct line.
+ * @param reader
+ * @param words_to_read in/out param, decreased by the number of words read
+ * @param lines table of distinct lines
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+static int count_lines(CorpusReader *reader, int *words_to_read,
+                       StringTable *lines)
+{
+  if (*words_to_read <= 0)
+    {
       return EXIT_SUCCESS;
     }
-  return EXIT_FAILURE;
+  LineCounts counts = {lines, *words_to_read};
+  int success = read_corpus_lines (reader, count_line, &counts);
+  *words_to_read = counts.words_to_read;
+  return success;
 }
 
 /**
- * Insert word to database
- * @param list MarkovChain
- * @param word
+ * Learn every distinct line once, with it's links weighted by the number of
+ * times the line was read. The distinct lines are learned in the order they
+ * were first read, so the MarkovChain is the one learning all the lines in
+ * order would give.
+ * @param lines table of distinct lines, separated by new lines
+ * @param markov_chain
  * @return EXIT_SUCCESS or EXIT_FAILURE
  */
-static int insert_single_word_to_db(MarkovChain *list, char *word)
+static int learn_lines(StringTable *lines, MarkovChain *markov_chain)
 {
-  Node *node_p = add_to_database (list, word);
-  if (node_p == NULL)
+  CorpusReader *reader = open_corpus_buffer (lines->arena,
+                                             lines->arena_length);
+  if (reader == NULL)
     {
       return EXIT_FAILURE;
     }
-  return EXIT_SUCCESS;
+  int words_to_read = MAX_INT;
+  int success = learn_corpus (reader, &words_to_read, lines->counts,
+                              markov_chain);
+  close_corpus (&reader);
+  return success;
 }
 
 /**
- * Checks if string is marked by \n, \r or \0
- * @param word char*
- * @return true if word is marked, false if not
+ * Learn from the corpus, only count it's lines, or collect it's links
+ * @param reader
+ * @param words_to_read in/out param, decreased by the number of words read
+ * @param learner
+ * @return EXIT_SUCCESS or EXIT_FAILURE
  */
-static bool is_str_marked(char* word)
+static int read_corpus_words(CorpusReader *reader, int *words_to_read,
+                             Learner *learner)
 {
-  int last_index = (int) strlen (word) - 1;
-  if ((word[last_index] == '\n') || (word[last_index] == '\0') ||
-   (word[last_index] == '\r'))
+  if (learner->lines != NULL)
     {
-      return true;
+      return count_lines (reader, words_to_read, learner->lines);
     }
-  return false;
+  if (learner->bulk != NULL)
+    {
+      return collect_links (reader, words_to_read, learner->bulk);
+    }
+  return learn_corpus (reader, words_to_read, NULL, learner->markov_chain);
 }
 
 /**
  * Reads from the file the wanted number of words and inserts them in the
- * MarkovChain database.
+ * MarkovChain database. The file may be compressed with gzip or zstd, it is
+ * then decompressed by a second thread while being read.
  * @param fp
  * @param words_to_read
- * @param markov_chain
+ * @param learner
  * @return EXIT_SUCCESS or EXIT_FAILURE
  */
-static int fill_database(FILE *fp, int words_to_read, MarkovChain *markov_chain
-)
+static int fill_database(FILE *fp, int words_to_read, Learner *learner)
 {
-  int num_of_read_words = 0;
-  char single_line[MAX_ROW];
-  while (fgets (single_line,MAX_ROW,fp) != NULL
-  && (num_of_read_words < words_to_read))
+  CorpusReader *reader = open_corpus (fp);
+  if (reader == NULL)
     {
-      char *line = " ";
-      char *word_1 = strtok(single_line,line);
-      char new_word[MAX_WORD] = {0};
-      int success = insert_single_word_to_db (markov_chain, word_1);
-      if (success==EXIT_FAILURE)
+      return EXIT_FAILURE;
+    }
+  int success = read_corpus_words (reader, &words_to_read, learner);
+  close_corpus (&reader);
+  return success;
+}
+
+/**
+ * Reads the wanted number of words from a corpus made of many shard files,
+ * in order, and inserts them in the MarkovChain database. Every shard starts
+ * a new line, so no word is linked across two shards.
+ * @param patterns shard paths, directories or glob patterns
+ * @param num_of_patterns
+ * @param words_to_read
+ * @param readers number of threads reading shards ahead
+ * @param learner
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+static int fill_database_from_shards(char **patterns, int num_of_patterns,
+                                     int words_to_read, int readers,
+                                     Learner *learner)
+{
+  ShardReader *shards = open_shards (patterns, num_of_patterns, readers);
+  if (shards == NULL)
+    {
+      return EXIT_FAILURE;
+    }
+  int success = EXIT_SUCCESS, status = SHARD_FOUND;
+  char *contents = NULL;
+  size_t length = 0;
+  while (success == EXIT_SUCCESS && words_to_read > 0
+         && (status = next_shard (shards, &contents, &length)) == SHARD_FOUND)
+    {
+      CorpusReader *reader = open_corpus_buffer (contents, length);
+      if (reader == NULL)
         {
-          return EXIT_FAILURE;
+          success = EXIT_FAILURE;
+          break;
         }
-      num_of_read_words++; // Loop all the other words in current line
-      while (word_1 != NULL && (num_of_read_words < words_to_read))
+      success = read_corpus_words (reader, &words_to_read, learner);
+      close_corpus (&reader);
+    }
+  close_shards (&shards);
+  return status == SHARD_ERROR ? EXIT_FAILURE : success;
+}
+
+/**
+ * Learning process: fill the database from the single opened file, or from
+ * the shards the paths stand for
+ * @param tweets_file opened file, NULL to read shards
+ * @param paths
+ * @param num_of_paths
+ * @param words_to_read
+ * @param options
+ * @param learner
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+static int learn(FILE *tweets_file, char **paths, int num_of_paths,
+                 int words_to_read, Options *options, Learner *learner)
+{
+  if (options->dedup)
+    {
+      learner->lines = new_string_table ('\n');
+      if (learner->lines == NULL)
         {
-          char *word_2 = strtok (NULL, line);
-          if (word_2 == NULL)
-            {
-              break;
-            }
-          while (is_str_marked(word_2)) // clean word from \* marks
-            {
-              for (int i=0; i < (int) strlen (word_2)-1;i++)
-                {
-                  new_word[i] = word_2[i];
-                }
-              word_2 = new_word;
-            }
-          success = insert_single_word_to_db(markov_chain, word_2);
-          if (success == EXIT_FAILURE)
-            {
-              return EXIT_FAILURE;
-            }
-          num_of_read_words++;
-          if (word_1[strlen (word_1)-1] != DOT_ASCII)
-            {
-              bool b_success = insert_to_counter_list
-                  (*markov_chain, word_1, word_2);
-              if (b_success == EXIT_FAILURE)
-                {
-                  return EXIT_FAILURE;
-                }
-            }
-          word_1 = word_2;
+          return EXIT_FAILURE;
         }
     }
-  return EXIT_SUCCESS;
+  int success;
+  if (tweets_file == NULL)
+    {
+      success = fill_database_from_shards (paths, num_of_paths, words_to_read,
+                                           options->readers, learner);
+    }
+  else
+    {
+      success = fill_database (tweets_file, words_to_read, learner);
+    }
+  if (success == EXIT_SUCCESS && learner->lines != NULL)
+    {
+      success = learn_lines (learner->lines, learner->markov_chain);
+    }
+  free_string_table (&learner->lines);
+  return success;
 }
 
 /**
@@ -154,8 +456,7 @@ static void generate_tweets(MarkovChain *markov_chain_p, int num_of_tweets)
       if (first_node != NULL)
         {
           printf ("Tweet %d: ", count_tweets);
-          generate_random_sequence (markov_chain_p,first_node,
-                                    MAX_WORDS_IN_TWEETS);
+          word_generate_random_sequence (first_node, MAX_WORDS_IN_TWEETS);
           printf ("\n");
           count_tweets++;
         }
@@ -197,10 +498,16 @@ static void print_char_func(char *data)
 }
 
 /**
- * String copy function to use in generic database
+ * Pool of the words of the database too long to be stored inline, a
+ * MarkovChain's copy_func gets no other argument to reach it by
+ */
+static StringPool *word_pool = NULL;
+
+/**
+ * String copy function to use in generic database: copies to word_pool
  * @param str
  * @return char* - copied string
- * @ownership Weak Ownership - separate function for Free (free_markov_chain)
+ * @ownership word_pool owns the copy (free_string_pool)
  */
 static char* str_copy(char* str)
 {
@@ -208,49 +515,47 @@ static char* str_copy(char* str)
     {
       return NULL;
     }
-  char *new_str = malloc (sizeof (char) * strlen (str)+1);
-  if (!new_str)
-    {
-      printf ("%s", ALLOC_CHAR_ERROR);
-      return NULL;
-    }
-  strcpy (new_str, str);
-  return new_str;
+  return add_to_string_pool (word_pool, str, strlen (str));
 }
 
 /**
- * Free string allocation to use in generic database
+ * Free function to use in generic database: the words are freed all
+ * together, with word_pool
  * @param str
  */
 static void str_free(char* str)
 {
-  if (str)
-    {
-      free(str);
-      str = NULL;
-    }
+  (void) str;
 }
 
 /**
- * MarkovChain and LinkedList initialization
+ * MarkovChain, LinkedList and word_pool initialization
  * @param database_pp
  * @param markov_chain_pp
- * @ownership Strong & Weak - frees LinkedList in case of failure.
- * In case of success, separate function for Free (free_markov_chain)
+ * @ownership Strong & Weak - frees LinkedList and word_pool in case of
+ * failure. In case of success, separate functions for Free
+ * (free_markov_chain, then free_string_pool)
  * @return EXIT_SUCCESS or EXIT_FAILURE
  */
 static int initialize_structs(LinkedList **database_pp, MarkovChain
 **markov_chain_pp)
 {
+  word_pool = new_string_pool ();
+  if (word_pool == NULL)
+    {
+      return EXIT_FAILURE;
+    }
   *database_pp = new_linked_list();
   if (*database_pp==NULL)
     {
+      free_string_pool (&word_pool);
       return EXIT_FAILURE;
     }
   *markov_chain_pp = new_markov_chain();
   if (*markov_chain_pp == NULL)
     {
       free (*database_pp);
+      free_string_pool (&word_pool);
       return EXIT_FAILURE;
     }
   (*markov_chain_pp)->database = *database_pp;
@@ -263,14 +568,797 @@ static int initialize_structs(LinkedList **database_pp, MarkovChain
 }
 
 /**
+ * Size of a string state, to use in frozen database
+ * @param str
+ * @return size in bytes, terminating null included
+ */
+static size_t str_size(char *str)
+{
+  return strlen (str) + 1;
+}
+
+/**
+ * Generates wanted number of tweets from the FrozenChain
+ * @param frozen_chain
+ * @param num_of_tweets
+ * @param first_word word every tweet starts with, NULL for a random one
+ * @return EXIT_SUCCESS or EXIT_FAILURE if first_word is not in the model
+ */
+static int generate_frozen_tweets(FrozenChain *frozen_chain, int num_of_tweets,
+                                  char *first_word)
+{
+  int first_state = FROZEN_NO_STATE;
+  if (first_word != NULL)
+    {
+      first_state = find_frozen_state (frozen_chain, first_word,
+                                       str_size (first_word));
+      if (first_state == FROZEN_NO_STATE)
+        {
+          printf ("%s", WORD_ERROR);
+          return EXIT_FAILURE;
+        }
+    }
+  int count_tweets = NUM_OF_TWEET;
+  while (count_tweets <= num_of_tweets)
+    {
+      if (first_word == NULL)
+        {
+          first_state = get_first_random_state (frozen_chain);
+        }
+      if (first_state == FROZEN_NO_STATE)
+        {
+          break;
+        }
+      printf ("Tweet %d: ", count_tweets);
+      generate_frozen_sequence (frozen_chain, first_state,
+                                MAX_WORDS_IN_TWEETS);
+      printf ("\n");
+      count_tweets++;
+    }
+  return EXIT_SUCCESS;
+}
+
+/**
+ * Load a frozen model and generate tweets from it
+ * @param path model file
+ * @param num_of_tweets
+ * @param first_word word every tweet starts with, NULL for a random one
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+static int generate_from_model(char *path, int num_of_tweets,
+                               char *first_word)
+{
+  FILE *model_file = fopen (path, "rb");
+  if (model_file == NULL)
+    {
+      printf ("%s", FILE_ERROR);
+      return EXIT_FAILURE;
+    }
+  FrozenChain *frozen_chain = load_frozen_chain (model_file,
+                                                 (void*) print_char_func);
+  fclose (model_file);
+  if (frozen_chain == NULL)
+    {
+      return EXIT_FAILURE;
+    }
+  int success = generate_frozen_tweets (frozen_chain, num_of_tweets,
+                                       first_word);
+  free_frozen_chain (&frozen_chain);
+  return success;
+}
+
+/**
+ * Save the FrozenChain if wanted, and generate tweets from it
+ * @param frozen_chain
+ * @param options
+ * @param num_of_tweets
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+static int save_and_generate(FrozenChain *frozen_chain, Options *options,
+                             int num_of_tweets)
+{
+  int success = EXIT_SUCCESS;
+  if (options->save_model != NULL)
+    {
+      FILE *model_file = fopen (options->save_model, "wb");
+      if (model_file == NULL)
+        {
+          printf ("%s", FILE_ERROR);
+          return EXIT_FAILURE;
+        }
+      success = save_frozen_chain (frozen_chain, model_file);
+      if (fclose (model_file) != 0)
+        {
+          success = EXIT_FAILURE;
+        }
+    }
+  if (success == EXIT_SUCCESS)
+    {
+      success = generate_frozen_tweets (frozen_chain, num_of_tweets,
+                                        options->first_word);
+    }
+  return success;
+}
+
+/**
+ * Generates wanted number of tweets from the PagedChain
+ * @param paged_chain
+ * @param num_of_tweets
+ * @return EXIT_SUCCESS or EXIT_FAILURE in case of read error
+ */
+static int generate_paged_tweets(PagedChain *paged_chain, int num_of_tweets)
+{
+  int count_tweets = NUM_OF_TWEET;
+  while (count_tweets <= num_of_tweets)
+    {
+      int first_state = get_first_random_paged_state (paged_chain);
+      if (first_state == FROZEN_NO_STATE)
+        {
+          break;
+        }
+      printf ("Tweet %d: ", count_tweets);
+      generate_paged_sequence (paged_chain, first_state, MAX_WORDS_IN_TWEETS);
+      printf ("\n");
+      count_tweets++;
+    }
+  return paged_chain->failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/**
+ * Open a frozen model to be read from it's file as needed, and generate
+ * tweets from it
+ * @param path model file
+ * @param num_of_tweets
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+static int generate_from_paged_model(char *path, int num_of_tweets)
+{
+  PagedChain *paged_chain = open_paged_chain (path, PAGED_CACHE_PAGES,
+                                              (void*) print_char_func);
+  if (paged_chain == NULL)
+    {
+      return EXIT_FAILURE;
+    }
+  int success = generate_paged_tweets (paged_chain, num_of_tweets);
+  close_paged_chain (&paged_chain);
+  return success;
+}
+
+/**
+ * Freeze the trained MarkovChain, save it if wanted, and generate tweets from
+ * the frozen form
+ * @param markov_chain_p
+ * @param options
+ * @param num_of_tweets
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+static int freeze_and_generate(MarkovChain *markov_chain_p, Options *options,
+                               int num_of_tweets)
+{
+  FrozenChain *frozen_chain = freeze_markov_chain (markov_chain_p,
+                                                   (void*) str_size,
+                                                   options->max_error);
+  if (frozen_chain == NULL)
+    {
+      return EXIT_FAILURE;
+    }
+  int success = save_and_generate (frozen_chain, options, num_of_tweets);
+  free_frozen_chain (&frozen_chain);
+  return success;
+}
+
+/**
+ * Open the corpus to learn from. STDIN_PATH stands for the standard input,
+ * so a pipe or a FIFO can be read with no temporary file; it is made
+ * unbuffered, as the tokenizer already reads it in big blocks.
+ * @param path file path or STDIN_PATH
+ * @return FILE pointer, NULL if the file could not be opened
+ */
+static FILE* open_tweets_file(char *path)
+{
+  if (strcmp (path, STDIN_PATH) == 0)
+    {
+      setvbuf (stdin, NULL, _IONBF, 0);
+      return stdin;
+    }
+  return fopen (path, "r");
+}
+
+/**
+ * Separate the options from the positional arguments, which are moved to the
+ * beginning of argv in their order
  * @param argc num of arguments
- * @param argv 1) Seed 2) Number of sentences to generate 3) File name
- * 4) Number of words to read from file (optional)
+ * @param argv arguments, argv[0] stays first
+ * @param options out param, parsed options
+ * @return number of positional arguments, -1 if arguments are invalid
+ */
+static int parse_options(int argc, char **argv, Options *options)
+{
+  int positional_num = 0;
+  for (int i = 0; i < argc; i++)
+    {
+      if (i == 0 || strncmp (argv[i], OPTION_PREFIX,
+                             strlen (OPTION_PREFIX)) != 0)
+        {
+          argv[positional_num++] = argv[i];
+          continue;
+        }
+      if (strcmp (argv[i], DEDUP_OPTION) == 0)
+        {
+          options->dedup = true;
+          continue;
+        }
+      if (strcmp (argv[i], BULK_OPTION) == 0)
+        {
+          options->bulk = true;
+          continue;
+        }
+      if (strcmp (argv[i], STATIONARY_OPTION) == 0)
+        {
+          options->stationary = true;
+          continue;
+        }
+      if (i + 1 == argc)
+        {
+          return -1;
+        }
+      if (strcmp (argv[i], SAVE_MODEL_OPTION) == 0)
+        {
+          options->save_model = argv[++i];
+        }
+      else if (strcmp (argv[i], LOAD_MODEL_OPTION) == 0)
+        {
+          options->load_model = argv[++i];
+        }
+      else if (strcmp (argv[i], PAGED_MODEL_OPTION) == 0)
+        {
+          options->load_model = argv[++i];
+          options->paged = true;
+        }
+      else if (strcmp (argv[i], QUANTIZE_OPTION) == 0)
+        {
+          options->max_error = strtod (argv[++i], NULL);
+        }
+      else if (strcmp (argv[i], FIRST_WORD_OPTION) == 0)
+        {
+          options->first_word = argv[++i];
+        }
+      else if (strcmp (argv[i], IMPORT_COUNTS_OPTION) == 0)
+        {
+          options->import_counts = argv[++i];
+        }
+      else if (strcmp (argv[i], EXPORT_COUNTS_OPTION) == 0)
+        {
+          options->export_counts = argv[++i];
+        }
+      else if (strcmp (argv[i], MEMORY_BUDGET_OPTION) == 0)
+        {
+          options->bulk = true;
+          options->memory_budget = (size_t) strtoul (argv[++i], NULL, DECIMAL)
+                                   * BYTES_IN_MB;
+        }
+      else if (strcmp (argv[i], READERS_OPTION) == 0)
+        {
+          options->readers = (int) strtol (argv[++i], NULL, DECIMAL);
+        }
+      else if (strcmp (argv[i], FORECAST_OPTION) == 0)
+        {
+          options->forecast = (int) strtol (argv[++i], NULL, DECIMAL);
+        }
+      else if (strcmp (argv[i], THREADS_OPTION) == 0)
+        {
+          options->threads = (int) strtol (argv[++i], NULL, DECIMAL);
+        }
+      else if (strcmp (argv[i], ENDINGS_OPTION) == 0)
+        {
+          options->endings = (int) strtol (argv[++i], NULL, DECIMAL);
+          if (options->endings <= NO_ENDINGS)
+            {
+              return -1;
+            }
+        }
+      else
+        {
+          return -1;
+        }
+    }
+  return positional_num;
+}
+
+/**
+ * @param str
+ * @return true if the whole of str is a decimal number
+ */
+static bool is_number(char *str)
+{
+  char *end = NULL;
+  strtol (str, &end, DECIMAL);
+  return end != str && *end == '\0';
+}
+
+/**
+ * Learning process: read the words to read from the File url(s) of the
+ * positional arguments
+ * @param argv positional arguments
+ * @param positional_num number of positional arguments
+ * @param options
+ * @param learner
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+static int learn_from_arguments(char **argv, int positional_num,
+                                Options *options, Learner *learner)
+{
+  char *path = argv[TWEET_FILE];
+  int num_of_paths = positional_num - TWEET_FILE;
+  int words_to_read = MAX_INT;
+  if (positional_num >= ARG_MAX_NUM && is_number (argv[positional_num - 1]))
+    {
+      words_to_read=(int)strtol(argv[positional_num - 1], NULL,
+                                DECIMAL);
+      num_of_paths--;
+    }
+  bool sharded = num_of_paths > 1 || is_shard_pattern (path);
+  FILE *tweets_file = sharded ? NULL : open_tweets_file (path); // File handling
+  if (!sharded && tweets_file == NULL)
+    {
+      printf ("%s",FILE_ERROR);
+      return EXIT_FAILURE;
+    }
+  int success = learn (tweets_file, argv + TWEET_FILE, num_of_paths,
+                       words_to_read, options, learner);
+  if (tweets_file != NULL && tweets_file != stdin)
+    {
+      fclose (tweets_file); // Strong Ownership
+    }
+  return success;
+}
+
+/**
+ * @param path
+ * @return true if path names a bigram counts file of the text format
+ */
+static bool is_text_counts(char *path)
+{
+  return strstr (path, TEXT_COUNTS_EXTENSION) != NULL;
+}
+
+/**
+ * word_add_sized_to_database, for a generic state
+ */
+static Node* add_word_to_database(MarkovChain *markov_chain, void *data_ptr,
+                                  size_t size)
+{
+  return word_add_sized_to_database (markov_chain, data_ptr, size);
+}
+
+/**
+ * Learning process from pre-aggregated bigram counts, instead of a corpus
+ * @param path bigram counts file, or STDIN_PATH
+ * @param markov_chain
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+static int import_counts(char *path, MarkovChain *markov_chain)
+{
+  FILE *counts_file = open_tweets_file (path);
+  if (counts_file == NULL)
+    {
+      printf ("%s", FILE_ERROR);
+      return EXIT_FAILURE;
+    }
+  int success = import_bigram_counts (counts_file, is_text_counts (path),
+                                      markov_chain, add_word_to_database);
+  if (counts_file != stdin)
+    {
+      fclose (counts_file);
+    }
+  return success;
+}
+
+/**
+ * A word of the chain, and the probability to be at it
+ */
+typedef struct WordProbability {
+    char *word;
+    double probability;
+} WordProbability;
+
+/**
+ * Order words from the likeliest, words as likely by their chars
+ */
+static int compare_probabilities(const void *first, const void *second)
+{
+  const WordProbability *first_word = first, *second_word = second;
+  if (first_word->probability != second_word->probability)
+    {
+      return first_word->probability < second_word->probability ? 1 : -1;
+    }
+  return strcmp (first_word->word, second_word->word);
+}
+
+/**
+ * Print the likeliest words of a distribution
+ * @param markov_chain
+ * @param distribution probability of every word, by it's id
+ * @param num_of_words number of words to print
+ * @return EXIT_SUCCESS or EXIT_FAILURE in case of memory allocation failure
+ */
+static int print_likeliest_words(MarkovChain *markov_chain,
+                                 const double *distribution, int num_of_words)
+{
+  int n = markov_chain->database->size;
+  WordProbability *words = malloc (sizeof (WordProbability)
+                                   * (n + (size_t) 1));
+  if (words == NULL)
+    {
+      printf ("%s", ALLOC_ERROR_FORECAST);
+      return EXIT_FAILURE;
+    }
+  for (Node *node = markov_chain->database->first; node != NULL;
+       node = node->next)
+    {
+      words[node->data->id] = (WordProbability) {node->data->data,
+                                                 distribution[node->data->id]};
+    }
+  qsort (words, n, sizeof (WordProbability), compare_probabilities);
+  for (int rank = 0; rank < num_of_words && rank < n; rank++)
+    {
+      printf (FORECAST_LINE, rank + 1, words[rank].word,
+              words[rank].probability);
+    }
+  free (words);
+  return EXIT_SUCCESS;
+}
+
+/**
+ * Forecast the words of the tweets, with no sampling: the distribution of
+ * the word the given number of steps into them, from the first word or a
+ * random one, or the share of every word in an endless stream of them
+ * @param markov_chain
+ * @param options
+ * @param num_of_words number of likeliest words to print
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+static int forecast_words(MarkovChain *markov_chain, Options *options,
+                          int num_of_words)
+{
+  TransitionMatrix *matrix = new_transition_matrix (markov_chain, true);
+  if (matrix == NULL)
+    {
+      return EXIT_FAILURE;
+    }
+  int n = matrix->num_of_states, steps = 0, success = EXIT_SUCCESS;
+  double *distribution = calloc (n + (size_t) 1, sizeof (double));
+  Node *first = options->first_word == NULL ? NULL
+      : word_get_node_from_database (markov_chain, options->first_word);
+  if (distribution == NULL)
+    {
+      printf ("%s", ALLOC_ERROR_FORECAST);
+      success = EXIT_FAILURE;
+    }
+  else if (options->stationary)
+    {
+      success = stationary_distribution (matrix, TRANSITION_TOLERANCE,
+                                         TRANSITION_MAX_STEPS,
+                                         options->threads, distribution,
+                                         &steps);
+      if (success == EXIT_SUCCESS)
+        {
+          printf (STATIONARY_HEADER, steps);
+        }
+    }
+  else if (options->first_word != NULL && first == NULL)
+    {
+      printf ("%s", WORD_ERROR);
+      success = EXIT_FAILURE;
+    }
+  else
+    {
+      if (first != NULL)
+        {
+          distribution[first->data->id] = 1;
+        }
+      else
+        {
+          memcpy (distribution, matrix->restart, sizeof (double) * n);
+        }
+      success = step_distribution (matrix, distribution, options->forecast,
+                                   options->threads);
+      if (success == EXIT_SUCCESS)
+        {
+          printf (FORECAST_HEADER, options->forecast);
+        }
+    }
+  if (success == EXIT_SUCCESS)
+    {
+      success = print_likeliest_words (markov_chain, distribution,
+                                       num_of_words);
+    }
+  free (distribution);
+  free_transition_matrix (&matrix);
+  return success;
+}
+
+/**
+ * A start word and how the tweets from it end
+ */
+typedef struct WordEnding {
+    char *word;
+    double goal_probability; // to end a sentence
+    double end_probability; // to end before it is cut
+    double words; // expected number of words
+} WordEnding;
+
+/**
+ * Order start words from the likeliest to be cut, words as likely by their
+ * expected number of words, then by their chars
+ */
+static int compare_endings(const void *first, const void *second)
+{
+  const WordEnding *first_word = first, *second_word = second;
+  if (first_word->end_probability != second_word->end_probability)
+    {
+      return first_word->end_probability < second_word->end_probability
+             ? -1 : 1;
+    }
+  if (first_word->words != second_word->words)
+    {
+      return first_word->words > second_word->words ? -1 : 1;
+    }
+  return strcmp (first_word->word, second_word->word);
+}
+
+/**
+ * Print how the tweets from the first word, or from a random one as
+ * get_first_random_node picks it, end, and the start words whose tweets are
+ * likeliest to be cut
+ * @param markov_chain
+ * @param first first word of the tweets, NULL for a random one
+ * @param max_words most words of a tweet
+ * @param goal out param of solve_bounded_walks, and the two after it
+ * @param num_of_words number of start words to print
+ * @return EXIT_SUCCESS or EXIT_FAILURE in case of memory allocation failure
+ */
+static int print_endings(MarkovChain *markov_chain, Node *first,
+                         int max_words, const double *goal,
+                         const double *end, const double *steps,
+                         int num_of_words)
+{
+  WordEnding *words = malloc (sizeof (WordEnding)
+                              * (markov_chain->database->size + (size_t) 1));
+  if (words == NULL)
+    {
+      printf ("%s", ALLOC_ERROR_ENDINGS);
+      return EXIT_FAILURE;
+    }
+  int num_of_starts = 0;
+  double total_goal = 0, total_end = 0, total_words = 0;
+  for (Node *node = first != NULL ? first : markov_chain->database->first;
+       node != NULL; node = first != NULL ? NULL : node->next)
+    {
+      int id = node->data->id;
+      if (node->data->counter_list_length > 0 || node == first)
+        {
+          words[num_of_starts++] = (WordEnding) {node->data->data, goal[id],
+                                                 end[id], 1 + steps[id]};
+          total_goal += goal[id];
+          total_end += end[id];
+          total_words += 1 + steps[id];
+        }
+    }
+  double starts = num_of_starts > 0 ? num_of_starts : 1;
+  printf (ENDINGS_SUMMARY, max_words, total_goal / starts,
+          (total_end - total_goal) / starts, 1 - total_end / starts,
+          total_words / starts);
+  qsort (words, num_of_starts, sizeof (WordEnding), compare_endings);
+  printf ("%s", ENDINGS_HEADER);
+  for (int rank = 0; rank < num_of_words && rank < num_of_starts; rank++)
+    {
+      printf (ENDINGS_ROW, words[rank].word, words[rank].goal_probability,
+              words[rank].end_probability, words[rank].words);
+    }
+  free (words);
+  return EXIT_SUCCESS;
+}
+
+/**
+ * Analyze how the tweets of at most the given number of words end, with no
+ * sampling: a tweet goes on from it's first word until a word with no
+ * successors, a sentence end if it ends with a dot, or until it is cut
+ * @param markov_chain
+ * @param options
+ * @param num_of_words number of start words to print
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+static int analyze_endings(MarkovChain *markov_chain, Options *options,
+                           int num_of_words)
+{
+  Node *first = options->first_word == NULL ? NULL
+      : word_get_node_from_database (markov_chain, options->first_word);
+  if (options->first_word != NULL && first == NULL)
+    {
+      printf ("%s", WORD_ERROR);
+      return EXIT_FAILURE;
+    }
+  AbsorbingChain *chain = new_absorbing_chain (markov_chain);
+  if (chain == NULL)
+    {
+      return EXIT_FAILURE;
+    }
+  size_t n = chain->num_of_states + (size_t) 1;
+  double *goal = malloc (sizeof (double) * n);
+  double *end = malloc (sizeof (double) * n);
+  double *steps = malloc (sizeof (double) * n);
+  int success = EXIT_FAILURE;
+  if (goal == NULL || end == NULL || steps == NULL)
+    {
+      printf ("%s", ALLOC_ERROR_ENDINGS);
+    }
+  // the first word is given, the others are the steps of the walk
+  else if (solve_bounded_walks (chain, options->endings - 1, goal, end,
+                                steps) == EXIT_SUCCESS)
+    {
+      success = print_endings (markov_chain, first, options->endings, goal,
+                               end, steps, num_of_words);
+    }
+  free (goal);
+  free (end);
+  free (steps);
+  free_absorbing_chain (&chain);
+  return success;
+}
+
+/**
+ * Export the learned bigram counts if wanted, and generate tweets
+ * @param markov_chain_p
+ * @param options
+ * @param num_of_tweets
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+static int export_and_generate(MarkovChain *markov_chain_p, Options *options,
+                               int num_of_tweets)
+{
+  if (options->export_counts != NULL)
+    {
+      bool text = is_text_counts (options->export_counts);
+      FILE *counts_file = fopen (options->export_counts, text ? "w" : "wb");
+      if (counts_file == NULL)
+        {
+          printf ("%s", FILE_ERROR);
+          return EXIT_FAILURE;
+        }
+      int success = export_bigram_counts (markov_chain_p, counts_file, text);
+      if (fclose (counts_file) != 0 || success == EXIT_FAILURE)
+        {
+          return EXIT_FAILURE;
+        }
+    }
+  if (options->endings != NO_ENDINGS)
+    {
+      return analyze_endings (markov_chain_p, options, num_of_tweets);
+    }
+  if (options->forecast != NO_FORECAST || options->stationary)
+    {
+      return forecast_words (markov_chain_p, options, num_of_tweets);
+    }
+  if (options->save_model != NULL || options->max_error > 0
+      || options->first_word != NULL)
+    {
+      return freeze_and_generate (markov_chain_p, options, num_of_tweets);
+    }
+  generate_tweets (markov_chain_p, num_of_tweets); // Tweet generation
+  return EXIT_SUCCESS;
+}
+
+/**
+ * Write the model of the links collected under a memory budget, then
+ * generate tweets from it
+ * @param bulk
+ * @param options
+ * @param num_of_tweets
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+static int write_and_generate(BulkBuilder *bulk, Options *options,
+                              int num_of_tweets)
+{
+  FILE *model_file = fopen (options->save_model, "wb");
+  if (model_file == NULL)
+    {
+      printf ("%s", FILE_ERROR);
+      return EXIT_FAILURE;
+    }
+  int success = write_bulk_model (bulk, options->max_error, model_file);
+  if (fclose (model_file) != 0)
+    {
+      success = EXIT_FAILURE;
+    }
+  if (success == EXIT_SUCCESS)
+    {
+      success = generate_from_model (options->save_model, num_of_tweets,
+                                     options->first_word);
+    }
+  return success;
+}
+
+/**
+ * Bulk learning process: collect the links of the words to read, build the
+ * FrozenChain from them, save it if wanted and generate tweets from it
+ * @param argv positional arguments
+ * @param positional_num number of positional arguments
+ * @param options
+ * @param num_of_tweets
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+static int bulk_learn_and_generate(char **argv, int positional_num,
+                                   Options *options, int num_of_tweets)
+{
+  Learner learner = {NULL, NULL, new_bulk_builder (BULK_SORT_THREADS,
+                                                   options->memory_budget)};
+  if (learner.bulk == NULL)
+    {
+      return EXIT_FAILURE;
+    }
+  int success = learn_from_arguments (argv, positional_num, options,
+                                      &learner);
+  if (options->memory_budget > 0)
+    {
+      if (success == EXIT_SUCCESS)
+        {
+          success = write_and_generate (learner.bulk, options, num_of_tweets);
+        }
+      free_bulk_builder (&learner.bulk);
+      return success;
+    }
+  FrozenChain *frozen_chain = NULL;
+  if (success == EXIT_SUCCESS)
+    {
+      frozen_chain = build_bulk_chain (learner.bulk, options->max_error,
+                                       (void*) print_char_func);
+    }
+  free_bulk_builder (&learner.bulk);
+  if (frozen_chain == NULL)
+    {
+      return EXIT_FAILURE;
+    }
+  success = save_and_generate (frozen_chain, options, num_of_tweets);
+  free_frozen_chain (&frozen_chain);
+  return success;
+}
+
+/**
+ * @param argc num of arguments
+ * @param argv 1) Seed 2) Number of sentences to generate 3) File name(s)
+ * 4) Number of words to read from file (optional), and options anywhere
  * @return EXIT_SUCCESS or EXIT_FAILURE
  */
 int main(int argc, char **argv)
 {
-  if (argc != ARG_MIN_NUM && argc != ARG_MAX_NUM)
+  Options options = {NULL, NULL, false, 0, NULL, SHARD_READERS, false, NULL,
+                     NULL, false, 0, NO_FORECAST, false,
+                     TRANSITION_ALL_THREADS, NO_ENDINGS};
+  int positional_num = parse_options (argc, argv, &options);
+  bool valid = positional_num >= ARG_MIN_NUM;
+  if (options.load_model != NULL || options.import_counts != NULL)
+    {
+      valid = positional_num == MODEL_ARG_NUM;
+    }
+  if (options.paged && options.first_word != NULL)
+    {
+      valid = false;
+    }
+  if (options.bulk && (options.dedup || options.load_model != NULL
+      || options.import_counts != NULL || options.export_counts != NULL
+      || (options.memory_budget > 0 && options.save_model == NULL)))
+    {
+      valid = false;
+    }
+  if ((options.forecast != NO_FORECAST || options.stationary
+       || options.endings != NO_ENDINGS)
+      && (options.load_model != NULL || options.bulk || options.threads < 0
+          || options.forecast < NO_FORECAST))
+    {
+      valid = false;
+    }
+  if (!valid)
     {
       printf ("%s", USAGE_ERROR);
       return EXIT_FAILURE;
@@ -280,18 +1368,19 @@ int main(int argc, char **argv)
   srand (seed);
   int num_of_tweets = (int) strtol
       (argv[TWEETS_NUM], NULL, DECIMAL);
-  char *path = argv[TWEET_FILE];
-  int words_to_read = MAX_INT;
-  if (argc != ARG_MIN_NUM)
+  if (options.load_model != NULL && options.paged)
     {
-      words_to_read=(int)strtol(argv[NUM_OF_WORDS], NULL,
-                                DECIMAL);
+      return generate_from_paged_model (options.load_model, num_of_tweets);
     }
-  FILE *tweets_file = fopen ( path, "r"); // File handling
-  if (tweets_file == NULL)
+  if (options.load_model != NULL)
     {
-      printf ("%s",FILE_ERROR);
-      return EXIT_FAILURE;
+      return generate_from_model (options.load_model, num_of_tweets,
+                                  options.first_word);
+    }
+  if (options.bulk)
+    {
+      return bulk_learn_and_generate (argv, positional_num, &options,
+                                      num_of_tweets);
     }
   // Initialization and allocation of all structs
   LinkedList *database_p = NULL;
@@ -302,15 +1391,22 @@ int main(int argc, char **argv)
     {
       return EXIT_FAILURE;
     }
-  success = fill_database(tweets_file, words_to_read, // Learning process
-                          markov_chain_p);
-  fclose (tweets_file); // Strong Ownership
-  if (success == EXIT_FAILURE)
+  if (options.import_counts != NULL)
     {
-      free_markov_chain (&markov_chain_p);
-      return EXIT_FAILURE;
+      success = import_counts (options.import_counts, markov_chain_p);
+    }
+  else
+    {
+      Learner learner = {markov_chain_p, NULL, NULL};
+      success = learn_from_arguments (argv, positional_num, &options,
+                                      &learner);
+    }
+  if (success == EXIT_SUCCESS)
+    {
+      success = export_and_generate (markov_chain_p, &options, num_of_tweets);
     }
-  generate_tweets (markov_chain_p, num_of_tweets); // Tweet generation
   free_markov_chain(&markov_chain_p);
-  return EXIT_SUCCESS;
+  free_markov_state_index (&word_index);
+  free_string_pool (&word_pool);
+  return success;
 }
\ No newline at end of file